@@ -55,6 +55,16 @@
 /* fixed size GC arena */
 //#define MRB_GC_FIXED_ARENA
 
+/* compile hot loops to x86-64 machine code (Linux only) */
+//#define MRB_JIT
+
+/* back-edges taken before an irep is compiled; used with MRB_JIT */
+//#define MRB_JIT_THRESHOLD 1000
+
+/* grow the VM stack by MRB_STACK_GROWTH values at a time instead of doubling
+   it; uses less memory on small devices, but deep recursion gets slower */
+//#define MRB_STACK_EXTEND_LINEAR
+
 /* -DDISABLE_XXXX to drop following features */
 //#define DISABLE_STDIO		/* use of stdio */
 
@@ -71,6 +71,9 @@
 struct RClass;
 struct RProc;
 struct REnv;
+struct RString;
+struct RArray;
+struct RHash;
 struct mrb_state;
 struct mrb_pool;
 typedef void (each_object_callback)(mrb_state *mrb, RBasic* obj, void *data);
@@ -113,6 +116,7 @@ struct mrb_callinfo {
     mrb_code *pc;                 /* return address */
     mrb_code *err;                /* error position */
     int acc;
+    int cbound_prev;              /* next C boundary below this one (see mrb_context::cbound) */
     RClass *target_class;
     int ridx;
     int eidx;
@@ -139,21 +143,65 @@ struct mrb_context {
   int m_esize;
   enum mrb_fiber_state status;
   struct RFiber *fib;
+  int cbound;                   /* 1 + index of the topmost callinfo entered from C, 0 if none */
+  int stused, ciused;           /* high-water marks of the two stacks; a pooled context clears only these */
 };
 struct SysInterface {
     virtual void print_f(const char *fmt, ...);
     virtual void error_f(const char *fmt,...);
 };
-struct ArgStore {
-
-    ArgStore &operator>>(mrb_value &v) {
-        return *this;
-    }
-    ArgStore &operator>>(mrb_sym &v) {
-        return *this;
-    }
+/* targets of mrb_state::get_args that take no positional argument */
+struct ArgBlock {           /* the block, nil if none was passed ('&') */
+    mrb_value value;
+};
+struct ArgRest {            /* the remaining arguments ('*') */
+    mrb_value *ptr;
+    int len;
+};
+template<class... T> struct arg_spec;
+template<> struct arg_spec<> {
+    enum { positional = 0, rest = 0 };
+};
+template<class T, class... R> struct arg_spec<T, R...> {
+    enum { positional = 1 + arg_spec<R...>::positional, rest = arg_spec<R...>::rest };
+};
+template<class... R> struct arg_spec<ArgBlock, R...> {
+    enum { positional = arg_spec<R...>::positional, rest = arg_spec<R...>::rest };
+};
+template<class... R> struct arg_spec<ArgRest, R...> {
+    enum { positional = arg_spec<R...>::positional, rest = 1 };
 };
 struct mrb_jmpbuf;
+/* core methods whose behaviour codegen (behind an OP_CHKMETH guard) or the
+   core itself may inline while they are not redefined */
+enum mrb_inlinable {
+    MRB_INLINE_TIMES,   /* Integer#times */
+    MRB_INLINE_EACH,    /* Range#each */
+    MRB_INLINE_LOOP,    /* Kernel#loop */
+    MRB_INLINE_FIXNUM_CMP,  /* Fixnum#<=>, for Array#sort */
+    MRB_INLINE_FLOAT_CMP,   /* Float#<=> */
+    MRB_INLINE_STRING_CMP,  /* String#<=> */
+    MRB_INLINE_MAX
+};
+/* A call from C to a method known by name. The method found for the last
+   receiver class is reused until a method table or an ancestor chain changes;
+   see mrb_state::funcall(CallSite &, ...). Zero-initialize it and set mid. */
+struct CallSite {
+    mrb_sym mid;
+    uint32_t serial;            /* method_serial at the lookup */
+    RClass *klass;              /* receiver class of the lookup */
+    RClass *owner;              /* where the method was found */
+    RProc *proc;
+};
+/* call sites of the core's own calls into Ruby code */
+enum mrb_core_call {
+    MRB_CALL_HASH,      /* key.hash, for Hash */
+    MRB_CALL_EQL,       /* eql? */
+    MRB_CALL_EQ,        /* == */
+    MRB_CALL_CALL,      /* call, for Hash default procs */
+    MRB_CALL_INSPECT,   /* inspect */
+    MRB_CALL_MAX
+};
 struct mrb_state {
     mrb_jmpbuf *jmp;
     MemManager m_gc;
@@ -186,6 +234,20 @@ struct mrb_state {
     MemManager &gc() {return m_gc;}
     mrb_sym symidx;
     struct SymTable *name2sym;      /* symbol table */
+    uint64_t hash_seed;             /* seed for String and Symbol hashing */
+    struct {
+        int target;                 /* callinfo index of the frame being broken out of */
+        mrb_value val;
+        bool pending;               /* set while unwinding the C stack (see OP_RETURN) */
+    } m_break;
+    mrb_context *ctx_pool;          /* finished fiber contexts kept for reuse, linked by prev */
+    int ctx_pool_len;
+    RProc *m_inlinable[MRB_INLINE_MAX]; /* as defined once the core was loaded */
+    uint32_t method_serial;         /* bumped when a method table or an ancestor chain changes */
+    CallSite m_calls[MRB_CALL_MAX];
+#ifdef MRB_JIT
+    struct mrb_jit_code *jit_list;  /* compiled ireps, see src/jit.h */
+#endif
 
 #ifdef ENABLE_DEBUG
     void (*code_fetch_hook)(struct mrb_state* mrb, struct mrb_irep *irep, mrb_code *pc, mrb_value *regs);
@@ -206,7 +268,6 @@ struct mrb_state {
         return intern2(name, strlen(name));
     }
     mrb_sym intern2(const char *name, size_t len, bool lit=false);
-    ArgStore arg_store() {return ArgStore(); }
 public:
     static mrb_state *create(mrb_allocf f=nullptr, void *ud=nullptr);
     void destroy();
@@ -223,10 +284,45 @@ public:
         get_arg(*arg_src,res);
         return res;
     }
+    /*
+     * Typed counterpart of mrb_get_args: each argument is converted the way
+     * its C type asks for, chosen at compile time.
+     *
+     *   mrb_value   o        RString *   S        mrb_float   f
+     *   RClass *    C        RArray *    A        mrb_int     i
+     *   mrb_sym     n        RHash *     H        bool        b
+     *   ArgBlock    &        ArgRest     *
+     *
+     * All arguments are required, unless Req says how many are; the others
+     * are left untouched when not passed. Returns the number of arguments
+     * taken, as mrb_get_args does.
+     *
+     *   mrb_int n; RString *s; ArgBlock blk;
+     *   get_args(n, s, blk);            // "iS&"
+     *   get_args<1>(n, s);              // "i|S"
+     */
+    template<int Req = -1, class... T>
+    int get_args(T &... out) {
+        mrb_value *sp = m_ctx->m_stack + 1;
+        int argc = m_ctx->m_ci->argc;
+        if (argc < 0) {
+            RArray *a = mrb_ary_ptr(m_ctx->m_stack[1]);
+            argc = a->m_len;
+            sp = a->m_ptr;
+        }
+        const int pos = arg_spec<T...>::positional;
+        if (argc < (Req < 0 ? pos : Req) || (!arg_spec<T...>::rest && argc > pos))
+            mrb_raise(I_ARGUMENT_ERROR, "wrong number of arguments");
+        return fetch_args(sp, argc, 0, out...);
+    }
     NORET(void mrb_raise(RClass *m_ctx, const char *msg));
     NORET(void mrb_raisef(RClass *c, const char *fmt...));
 
     mrb_value funcall(mrb_value self, const char *name, int argc...);
+    mrb_value funcall(CallSite &cs, mrb_value self, int argc, const mrb_value *argv);
+    mrb_value funcall(mrb_core_call k, mrb_value self, int argc, const mrb_value *argv) {
+        return funcall(m_calls[k], self, argc, argv);
+    }
     bool class_defined(const char *name);
     void mrb_objspace_each_objects(each_object_callback *callback, void *data);
     mrb_value run_proc(RProc *proc, mrb_value self, int stack_keep);
@@ -248,6 +344,31 @@ protected:
     void        get_arg(const mrb_value &arg, mrb_sym &tgt);
     void        get_arg(const mrb_value &arg, RClass *&tgt);
     void        get_arg(const mrb_value &arg, mrb_value &tgt) { tgt = arg; }
+    void        get_arg(const mrb_value &arg, mrb_float &tgt);
+    void        get_arg(const mrb_value &arg, bool &tgt);
+    void        get_arg(const mrb_value &arg, RString *&tgt);
+    void        get_arg(const mrb_value &arg, RArray *&tgt);
+    void        get_arg(const mrb_value &arg, RHash *&tgt);
+    mrb_value   block_arg();
+    int         fetch_args(mrb_value *, int, int i) { return i; }
+                template<class T, class... R>
+    int         fetch_args(mrb_value *sp, int argc, int i, T &out, R &... rest) {
+                    if (i >= argc)
+                        return fetch_args(sp, argc, i, rest...);
+                    get_arg(sp[i], out);
+                    return fetch_args(sp, argc, i + 1, rest...);
+                }
+                template<class... R>
+    int         fetch_args(mrb_value *sp, int argc, int i, ArgBlock &out, R &... rest) {
+                    out.value = block_arg();
+                    return fetch_args(sp, argc, i, rest...);
+                }
+                template<class... R>
+    int         fetch_args(mrb_value *sp, int argc, int i, ArgRest &out, R &... rest) {
+                    out.ptr = (i < argc) ? sp + i : nullptr;
+                    out.len = (i < argc) ? argc - i : 0;
+                    return fetch_args(sp, argc, (i < argc) ? argc : i, rest...);
+                }
     RProc *     prepare_method_missing(RClass *c, mrb_sym mid, const int &a, int &n, mrb_value *regs);
                 template<bool optional=false>
     mrb_value * arg_read_prepare(int args) {
@@ -65,6 +65,7 @@ struct CallNode;
 struct FCallNode;
 struct BlockArgNode;
 struct BreakNode;
+struct MethodCheckNode;
 // no codegen use
 struct LiteralDelimNode;
 struct ArgNode;
@@ -136,6 +137,7 @@ struct NodeVisitor {
     virtual void visit(LVarNode * n)=0;
     virtual void visit(BlockArgNode * n)=0;
     virtual void visit(BreakNode * n)=0;
+    virtual void visit(MethodCheckNode * n)=0;
     virtual void visit(LiteralDelimNode * n)=0;
     virtual void visit(ArgNode * n)=0;
     virtual void visit(DxstrNode * n)=0;
@@ -208,6 +210,7 @@ struct NodeVisitor_Null : public NodeVisitor {
     virtual void visit(LVarNode * n) {}
     virtual void visit(BlockArgNode * n) {}
     virtual void visit(BreakNode * n) {}
+    virtual void visit(MethodCheckNode * n) {}
     virtual void visit(LiteralDelimNode * n) {}
     virtual void visit(ArgNode * n) {}
     virtual void visit(DxstrNode * n) {}
@@ -32,7 +32,7 @@ static const mrb_vtype ttype=MRB_TT_ARRAY;
             mrb_shared_array *shared;
         } m_aux;
         //TODO: semantics of this field change depending on the shared flag
-        // When not shared this is a pointer to base data
+        // When not shared this points m_gap slots past the start of the buffer, capa counts from here
         // when shared it's an 'iterator'-like element over shared->ptr
         mrb_value * m_ptr;
 public:
@@ -77,11 +77,12 @@ static  RArray *    splat(mrb_state *mrb, const mrb_value &v);
         bool empty_p() const;
         RString *inspect();
         void        splice(mrb_int head, mrb_int len, const mrb_value &rpl);
+        bool        sort_builtin(const mrb_value *keys);
         void mrb_ary_modify();
         mrb_value mrb_ary_ceqq();
 protected:
         mrb_value * base_ptr() {
-            return (flags & MRB_ARY_SHARED) ? m_aux.shared->ptr : m_ptr;
+            return (flags & MRB_ARY_SHARED) ? m_aux.shared->ptr : m_ptr - m_gap;
         }
 static  RArray *    ary_new_capa(mrb_state *mrb, size_t capa);
         RString *inspect_ary(RArray *list_arr);
@@ -91,6 +92,8 @@ static  RArray *    ary_new_capa(mrb_state *mrb, size_t capa);
         void        ary_make_shared();
         void        ary_replace(const mrb_value *argv, mrb_int m_len);
         void        ary_expand_capa(mrb_state *mrb, size_t m_len);
+        void        ary_compact();
+        void        ary_unshift_room(mrb_int n);
         void        ary_concat(const mrb_value *m_ptr, mrb_int blen);
         void        ary_shrink_capa();
         void        ary_modify();
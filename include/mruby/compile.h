@@ -28,6 +28,7 @@ struct mrbc_context {
     mrb_bool capture_errors:1;
     mrb_bool dump_result:1;
     mrb_bool no_exec:1;
+    mrb_bool optimize:1;
 };
 /* lexer states */
 enum mrb_lex_state_enum {
@@ -298,6 +299,7 @@ void mrbc_partial_hook(mrb_state *mrb, mrbc_context *c, int (*partial_hook)(mrb_
 mrb_parser_state* mrb_parser_new(mrb_state*);
 void mrb_parser_free(mrb_parser_state*);
 void mrb_parser_parse(mrb_parser_state*,mrbc_context*);
+void mrb_ast_optimize(mrb_parser_state*);
 struct RProc *mrb_generate_code(mrb_state*, mrb_parser_state*);
 /* program load functions */
 #ifdef ENABLE_STDIO
@@ -53,5 +53,6 @@ int32_t mrb_debug_get_line(mrb_irep *irep, uint32_t pc);
 mrb_irep_debug_info_file *mrb_debug_info_append_file(
     mrb_state *mrb, mrb_irep *irep,
     uint32_t start_pos, uint32_t end_pos);
+void mrb_debug_info_remap(mrb_state *mrb, mrb_irep *irep, const uint32_t *pcmap);
 mrb_irep_debug_info *mrb_debug_info_alloc(mrb_state *mrb, mrb_irep *irep);
 void mrb_debug_info_free(MemManager &mm, mrb_irep_debug_info *d);
@@ -40,7 +40,7 @@ mrb_value mrb_load_irep_file(mrb_state*,FILE*);
 
 /* Rite Binary File header */
 #define RITE_BINARY_IDENTIFIER        "RITE"
-#define RITE_BINARY_FORMAT_VER        "0002"
+#define RITE_BINARY_FORMAT_VER        "0004"
 #define RITE_COMPILER_NAME            "MATZ"
 #define RITE_COMPILER_VERSION         "0000"
 
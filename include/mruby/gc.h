@@ -13,5 +13,9 @@
 typedef void (each_object_callback)(mrb_state *mrb, struct RBasic* obj, void *data);
 void mrb_objspace_each_objects(mrb_state *mrb, each_object_callback* callback, void *data);
 void mrb_free_context(mrb_state *mrb, struct mrb_context *c);
+/* fiber contexts come from and go back to a per-state pool */
+struct mrb_context *mrb_context_new(mrb_state *mrb, size_t stack_size, size_t ci_size);
+void mrb_context_release(mrb_state *mrb, struct mrb_context *c);
+bool mrb_context_crosses_c(struct mrb_context *c);
 
 #endif  /* MRUBY_GC_H */
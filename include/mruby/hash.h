@@ -7,13 +7,16 @@
 #pragma once
 #include "mruby/value.h"
 #include "mruby/khash.h"
+#include "mruby/string.h"
 
 struct ValueHashFunc {
     khint_t operator()(MemManager *m,mrb_value key) const {
         khint_t h = (khint_t)mrb_type(key) << 24;
         mrb_value h2;
 
-        h2 = m->vm()->funcall(key, "hash", 0, 0);
+        if (key.is_string())
+            return h ^ (khint_t)mrb_str_hash(m->vm(), key.ptr<RString>());
+        h2 = m->vm()->funcall(MRB_CALL_HASH, key, 0, nullptr);
         h ^= h2.value.i;
         return h;
     }
@@ -27,6 +27,10 @@ struct mrb_irep {
     uint16_t *lines;
     struct mrb_irep_debug_info* debug_info;
     size_t ilen, plen, slen, rlen, refcnt;
+#ifdef MRB_JIT
+    struct mrb_jit_code *jit;   /* native code, once the irep got hot */
+    uint32_t jit_count;         /* back-edges taken in the interpreter */
+#endif
 };
 
 mrb_irep *mrb_add_irep(mrb_state *mrb);
@@ -35,3 +39,7 @@ mrb_value mrb_load_irep_ctx(mrb_state*, const uint8_t*, struct mrbc_context*);
 void mrb_irep_free(MemManager &mm, struct mrb_irep*);
 void mrb_irep_incref(mrb_state*, struct mrb_irep*);
 void mrb_irep_decref(MemManager &, struct mrb_irep*);
+void mrb_irep_optimize(mrb_state*, struct mrb_irep*);
+#ifdef MRB_JIT
+void mrb_jit_dump_stats(mrb_state *mrb, FILE *out);
+#endif
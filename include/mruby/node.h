@@ -88,6 +88,7 @@ enum node_type : uint8_t {
     NODE_LITERAL_DELIM,
     NODE_WORDS,
     NODE_SYMBOLS,
+    NODE_METHOD_CHECK,
     //    NODE_WHEN,
     //    NODE_METHOD,
     //    NODE_FBODY,
@@ -170,12 +171,14 @@ struct ArgsStore {
         m_rest = rest;
         m_post_mandatory = m2;
         m_blk = blk;
+        m_blk_escapes = true;
     }
     mrb_ast_node *m_mandatory;
     mrb_ast_node *m_opt;
     mrb_sym m_rest;
     mrb_ast_node *m_post_mandatory;
     mrb_sym m_blk;
+    bool m_blk_escapes; /* m_blk is used as more than a callee or forwarded block */
 };
 struct CommandArgs {
     CommandArgs(mrb_ast_node *args, mrb_ast_node *blk=nullptr) {
@@ -417,6 +420,16 @@ struct HashNode : public UnaryNode {
     void accept(NodeVisitor *v) { v->visit(this); }
 };
 
+/* only built by the AST optimizer: true while m_recv.m_method is still the
+   core method m_which (an mrb_inlinable), see OP_CHKMETH */
+struct MethodCheckNode : public UpdatedNode {
+    MethodCheckNode(mrb_ast_node *r, mrb_sym m, int which) : m_recv(r),m_method(m),m_which(which) {}
+    virtual node_type getType() const { return NODE_METHOD_CHECK; }
+    void accept(NodeVisitor *v) { v->visit(this); }
+    mrb_ast_node *m_recv;
+    mrb_sym m_method;
+    int m_which;
+};
 struct DsymNode : public UpdatedNode {
     DsymNode(DstrNode *s)  : m_str(s) {}
     virtual node_type getType() const { return NODE_DSYM; }
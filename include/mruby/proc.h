@@ -14,7 +14,7 @@
 #define MRB_ASPEC_POST(a) (((a) >> 7) & 0x1f)
 #define MRB_ASPEC_KEY(a) (((a) >> 2) & 0x1f)
 #define MRB_ASPEC_KDICT(a) ((a) & (1<<1))
-#define MRB_ASPEC_BLOCK(a) ((a) & 1)
+#define MRB_ASPEC_BLOCK(a) ((a) & 1) /* &blk, used as more than a callee or a forwarded block */
 enum eProcFlags {
     MRB_PROC_CFUNC  = (1<<7),
     MRB_PROC_STRICT = (1<<8)
@@ -44,6 +44,9 @@ public:
         m_target_class = src->m_target_class;
         env   = src->env;
     }
+    /* the proc may outlive the frames it was passed down through, and so may
+       every environment it closes over */
+    void escape();
     static RProc *alloc(mrb_state *mrb);
     static RProc *copy_construct(mrb_state *mrb,RProc *from) {
         RProc * r = alloc(mrb);
@@ -62,8 +65,13 @@ struct REnv : public RBasic {
     mrb_value *stack;
     mrb_sym mid;
     int cioff;
+    bool escaped; /* a closure over it may be called after its frame is gone */
     constexpr inline int stackSize() const { return this->flags; }
     static REnv *alloc(mrb_state *mrb);
 };
+inline void RProc::escape() {
+    for (REnv *e = env; e && !e->escaped; e = (REnv *)e->c)
+        e->escaped = true;
+}
 /* implementation of #send method */
 mrb_value mrb_f_send(mrb_state *mrb, mrb_value self);
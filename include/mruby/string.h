@@ -13,7 +13,8 @@
 #endif
 enum eStringFlags {
     MRB_STR_SHARED = 1,
-    MRB_STR_NOFREE = 2
+    MRB_STR_NOFREE = 2,
+    MRB_STR_HASHED = 4  /* m_hash holds the hash of the current contents */
 };
 #define IS_EVSTR(p,e) ((p) < (e) && (*(p) == '$' || *(p) == '@' || *(p) == '{'))
 
@@ -32,8 +33,14 @@ public:
     static RString *create(mrb_state *mrb, const char *p) { return create(mrb,p,strlen(p));}
     static RString *create(mrb_state *mrb, mrb_int capa);
     static RString *create_static(mrb_state *mrb, const char *p, mrb_int len);
+    static RString *new_from_values(mrb_state *mrb, int n, const mrb_value *vals);
     RString *dup() const {
-        return create(m_vm, m_ptr, len);
+        RString *res = create(m_vm, m_ptr, len);
+        if (flags & MRB_STR_HASHED) {
+            res->m_hash = m_hash;
+            res->flags |= MRB_STR_HASHED;
+        }
+        return res;
     }
     void str_cat(const char *m_ptr, int len);
     void str_cat(RString *oth);
@@ -51,6 +58,7 @@ public:
     bool chomp_bang(RString *sep);
     bool downcase_bang();
     bool upcase_bang();
+    bool swapcase_bang();
     RString *subseq(mrb_int beg, mrb_int len);
     RString *substr(mrb_int beg, mrb_int len);
 private:
@@ -62,6 +70,8 @@ private:
 #define RSTRING_END(s)    (RSTRING(s)->m_ptr + RSTRING(s)->len)
 
 void mrb_gc_free_str(mrb_state*, RString*);
+uint32_t mrb_hash_bytes(mrb_state *mrb, const char *p, size_t len);
+mrb_int mrb_str_hash(mrb_state *mrb, RString *s);
 void mrb_str_concat(mrb_state*, mrb_value, mrb_value);
 mrb_value mrb_str_plus(mrb_state*, mrb_value, mrb_value);
 RString *mrb_ptr_to_str(mrb_state *, void *);
@@ -173,6 +173,10 @@ struct RBasic {
                     mrb_vtype   tt:8;
                     uint32_t    color:3;
                     uint32_t    flags:21; // REnv uses flags to store number of children.
+                    union {               // per-type word, fits in the padding before `c`
+                        uint32_t m_hash;  // cached hash value (RString)
+                        uint32_t m_gap;   // unused slots in front of m_ptr (unshared RArray)
+                    };
                     RClass *    c;
                     RBasic *    gcnext;
                     mrb_state * m_vm;
@@ -227,7 +231,8 @@ public:
 };
 
 struct RFiber : public RObject {
-    mrb_context *cxt;
+    mrb_context *cxt;       /* null once the fiber finished and its context was pooled */
+    bool terminated;
 };
 
 static inline mrb_value mrb_fixnum_value(mrb_int i)
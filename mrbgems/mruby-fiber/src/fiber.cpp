@@ -2,6 +2,7 @@
 #include "mruby/array.h"
 #include "mruby/class.h"
 #include "mruby/proc.h"
+#include "mruby/gc.h"
 
 #define FIBER_STACK_INIT_SIZE 64
 #define FIBER_CI_INIT_SIZE 8
@@ -61,7 +62,6 @@
 */
 static mrb_value fiber_init(mrb_state *mrb, mrb_value self)
 {
-    static const struct mrb_context mrb_context_zero = { 0 };
     RFiber *f = (RFiber*)self.value.p;
     mrb_context *c;
     RProc *p;
@@ -78,22 +78,15 @@ static mrb_value fiber_init(mrb_state *mrb, mrb_value self)
         mrb_raise(E_ARGUMENT_ERROR, "tried to create Fiber from C defined method");
     }
 
-    f->cxt = (mrb_context*)mrb->gc()._malloc(sizeof(mrb_context));
-    *f->cxt = mrb_context_zero;
+    /* contexts of finished fibers are recycled, stacks included */
+    f->cxt = mrb_context_new(mrb, FIBER_STACK_INIT_SIZE, FIBER_CI_INIT_SIZE);
+    f->terminated = false;
     c = f->cxt;
 
-    /* initialize VM stack */
-    c->m_stbase = (mrb_value *)mrb->gc()._calloc(FIBER_STACK_INIT_SIZE, sizeof(mrb_value));
-    c->stend = c->m_stbase + FIBER_STACK_INIT_SIZE;
-    c->m_stack = c->m_stbase;
-
     /* copy receiver from a block */
     c->m_stack[0] = mrb->m_ctx->m_stack[0];
 
     /* initialize callinfo stack */
-    c->cibase = (mrb_callinfo *)mrb->gc()._calloc(FIBER_CI_INIT_SIZE, sizeof(mrb_callinfo));
-    c->ciend = c->cibase + FIBER_CI_INIT_SIZE;
-    c->m_ci = c->cibase;
     c->m_ci->stackent = c->m_stack;
 
     /* adjust return callinfo */
@@ -104,6 +97,8 @@ static mrb_value fiber_init(mrb_state *mrb, mrb_value self)
     ci->nregs = p->ireps()->nregs;
     ci[1] = ci[0];
     c->m_ci++;                      /* push dummy callinfo */
+    c->stused = ci->nregs;          /* frames set up by hand, not by the VM */
+    c->ciused = 2;
     c->fib = f;
     c->status = MRB_FIBER_CREATED;
 
@@ -115,6 +110,8 @@ static mrb_context* fiber_check(mrb_state *mrb, mrb_value fib)
     RFiber *f = (RFiber*)fib.value.p;
 
     if (!f->cxt) {
+        if (f->terminated)
+            mrb->mrb_raise(E_RUNTIME_ERROR, "resuming dead fiber");
         mrb_raise(E_ARGUMENT_ERROR, "uninitialized Fiber");
     }
     return f->cxt;
@@ -151,12 +148,9 @@ static mrb_value fiber_resume(mrb_state *mrb, mrb_value self)
     mrb_context *c = fiber_check(mrb, self);
     mrb_value *a;
     int len;
-    mrb_callinfo *ci;
 
-    for (ci = c->m_ci; ci >= c->cibase; ci--) {
-        if (ci->acc < 0) {
-            mrb->mrb_raise(E_ARGUMENT_ERROR, "can't cross C function boundary");
-        }
+    if (mrb_context_crosses_c(c)) {
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "can't cross C function boundary");
     }
     if (c->status == MRB_FIBER_RESUMED) {
         mrb->mrb_raise(E_RUNTIME_ERROR, "double resume");
@@ -174,6 +168,8 @@ static mrb_value fiber_resume(mrb_state *mrb, mrb_value self)
         while (b<e) {
             *b++ = *a++;
         }
+        if (len + 1 > c->stused)
+            c->stused = len + 1;
         c->cibase->argc = len;
         c->prev = mrb->m_ctx;
         if (c->prev->fib)
@@ -203,8 +199,11 @@ static mrb_value fiber_resume(mrb_state *mrb, mrb_value self)
  */
 static mrb_value fiber_alive_p(mrb_state *mrb, mrb_value self)
 {
-    struct mrb_context *c = fiber_check(mrb, self);
-    return mrb_value::wrap(c->status != MRB_FIBER_TERMINATED);
+    RFiber *f = (RFiber*)self.value.p;
+
+    if (f->terminated)
+        return mrb_value::_false();
+    return mrb_value::wrap(fiber_check(mrb, self)->status != MRB_FIBER_TERMINATED);
 }
 
 /*
@@ -220,13 +219,11 @@ static mrb_value fiber_alive_p(mrb_state *mrb, mrb_value self)
 static mrb_value fiber_yield(mrb_state *mrb, mrb_value self)
 {
     struct mrb_context *c = mrb->m_ctx;
-    mrb_callinfo *ci;
     mrb_value *a;
     int len;
-    for (ci = c->m_ci; ci >= c->cibase; ci--) {
-        if (ci->acc < 0) {
-            mrb->mrb_raise(E_ARGUMENT_ERROR, "can't cross C function boundary");
-        }
+
+    if (mrb_context_crosses_c(c)) {
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "can't cross C function boundary");
     }
     if (!c->prev) {
         mrb->mrb_raise(E_ARGUMENT_ERROR, "can't yield from root fiber");
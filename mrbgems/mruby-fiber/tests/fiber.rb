@@ -62,3 +62,40 @@ assert('Yield raises when called on root fiber') {
     true
   end
 }
+
+assert('Fiber contexts are reused') {
+  procs = []
+  sum = 0
+  1000.times { |i|
+    f = Fiber.new { |x| y = x; procs << Proc.new { y } if i % 100 == 0; Fiber.yield y; y }
+    sum += f.resume(i) + f.resume
+  }
+  sum == 999000 and procs.map { |pr| pr.call } == [0,100,200,300,400,500,600,700,800,900]
+}
+
+assert('Fiber is dead after raising') {
+  f = Fiber.new { raise "boom" }
+  begin
+    f.resume
+  rescue => e1
+  end
+  e1.message == "boom" and not f.alive?
+}
+
+assert('Fiber.yield inside String#each_char and #each_byte') {
+  f = Fiber.new { "ab".each_char { |c| Fiber.yield c }; "ab".each_byte { |b| Fiber.yield b }; :done }
+  [f.resume, f.resume, f.resume, f.resume, f.resume] == ["a", "b", 97, 98, :done]
+}
+
+assert('Fiber.yield inside Array#sort and #sort_by') {
+  f = Fiber.new { [3, 1, 2].sort { |a, b| Fiber.yield :cmp; a <=> b } }
+  r = f.resume
+  r = f.resume while r == :cmp
+  g = Fiber.new { [3, 1, 2].sort_by { |x| Fiber.yield x; -x } }
+  r == [1, 2, 3] and [g.resume, g.resume, g.resume, g.resume] == [3, 1, 2, [3, 2, 1]]
+}
+
+assert('Reused fiber contexts start clean') {
+  Fiber.new { a = "x"; b = :y; c = 1; d = 2.0 }.resume
+  Fiber.new { if false; a = b = c = d = 1; end; [a, b, c, d] }.resume == [nil, nil, nil, nil]
+}
@@ -89,6 +89,69 @@ erfc(double x)
 
 #endif
 
+/*
+ * Every unary function also accepts an Array and returns a new Array of
+ * the results, so a large sample costs one method call and one
+ * allocation instead of one call per element. Floats and Fixnums are
+ * read straight from the element buffer in a loop the compiler can
+ * inline the function into; any other element goes through #to_f.
+ */
+
+static inline mrb_float
+math_to_f(mrb_state *mrb, const mrb_value &v)
+{
+    switch (mrb_type(v)) {
+        case MRB_TT_FLOAT:
+            return mrb_float(v);
+        case MRB_TT_FIXNUM:
+            return (mrb_float)mrb_fixnum(v);
+        case MRB_TT_STRING:
+            mrb->mrb_raise(E_TYPE_ERROR, "String can't be coerced into Float");
+        default:
+            return mrb_float(mrb_convert_type(mrb, v, MRB_TT_FLOAT, "Float", "to_f"));
+    }
+}
+
+template<typename Fn>
+static mrb_value
+math_map(mrb_state *mrb, mrb_value x, Fn fn)
+{
+    if (!x.is_array())
+        return mrb_float_value(fn(math_to_f(mrb, x)));
+
+    RArray *src = RARRAY(x);
+    mrb_int len = src->m_len;
+    RArray *res = RArray::create(mrb, len);
+    const mrb_value *in = src->m_ptr;
+    mrb_value *out = res->m_ptr;
+    mrb_int i;
+
+    for (i = 0; i < len; i++) {
+        if (in[i].is_float())
+            out[i] = mrb_float_value(fn(mrb_float(in[i])));
+        else if (in[i].is_fixnum())
+            out[i] = mrb_float_value(fn((mrb_float)mrb_fixnum(in[i])));
+        else
+            break;
+    }
+    /* #to_f may change the source array, so re-read it each time */
+    for (; i < len && i < src->m_len; i++) {
+        out[i] = mrb_float_value(fn(math_to_f(mrb, src->m_ptr[i])));
+    }
+    res->m_len = i;
+    return res->wrap();
+}
+
+template<double (*F)(double)>
+static mrb_value
+math_unary(mrb_state *mrb)
+{
+    mrb_value x;
+
+    mrb_get_args(mrb, "o", &x);
+    return math_map(mrb, x, [](mrb_float v) { return F(v); });
+}
+
 /*
   TRIGONOMETRIC FUNCTIONS
 */
@@ -96,6 +159,7 @@ erfc(double x)
 /*
  *  call-seq:
  *     Math.sin(x)    -> float
+ *     Math.sin(array) -> array
  *
  *  Computes the sine of <i>x</i> (expressed in radians). Returns
  *  -1..1.
@@ -103,17 +167,13 @@ erfc(double x)
 static mrb_value
 math_sin(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = sin(x);
-
-    return mrb_float_value(x);
+    return math_unary<sin>(mrb);
 }
 
 /*
  *  call-seq:
  *     Math.cos(x)    -> float
+ *     Math.cos(array) -> array
  *
  *  Computes the cosine of <i>x</i> (expressed in radians). Returns
  *  -1..1.
@@ -121,29 +181,20 @@ math_sin(mrb_state *mrb, mrb_value obj)
 static mrb_value
 math_cos(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = cos(x);
-
-    return mrb_float_value(x);
+    return math_unary<cos>(mrb);
 }
 
 /*
  *  call-seq:
  *     Math.tan(x)    -> float
+ *     Math.tan(array) -> array
  *
  *  Returns the tangent of <i>x</i> (expressed in radians).
  */
 static mrb_value
 math_tan(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = tan(x);
-
-    return mrb_float_value(x);
+    return math_unary<tan>(mrb);
 }
 
 /*
@@ -153,52 +204,40 @@ math_tan(mrb_state *mrb, mrb_value obj)
 /*
  *  call-seq:
  *     Math.asin(x)    -> float
+ *     Math.asin(array) -> array
  *
  *  Computes the arc sine of <i>x</i>. Returns -{PI/2} .. {PI/2}.
  */
 static mrb_value
 math_asin(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = asin(x);
-
-    return mrb_float_value(x);
+    return math_unary<asin>(mrb);
 }
 
 /*
  *  call-seq:
  *     Math.acos(x)    -> float
+ *     Math.acos(array) -> array
  *
  *  Computes the arc cosine of <i>x</i>. Returns 0..PI.
  */
 static mrb_value
 math_acos(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = acos(x);
-
-    return mrb_float_value(x);
+    return math_unary<acos>(mrb);
 }
 
 /*
  *  call-seq:
  *     Math.atan(x)    -> float
+ *     Math.atan(array) -> array
  *
  *  Computes the arc tangent of <i>x</i>. Returns -{PI/2} .. {PI/2}.
  */
 static mrb_value
 math_atan(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = atan(x);
-
-    return mrb_float_value(x);
+    return math_unary<atan>(mrb);
 }
 
 /*
@@ -239,6 +278,7 @@ math_atan2(mrb_state *mrb, mrb_value obj)
 /*
  *  call-seq:
  *     Math.sinh(x)    -> float
+ *     Math.sinh(array) -> array
  *
  *  Computes the hyperbolic sine of <i>x</i> (expressed in
  *  radians).
@@ -246,34 +286,26 @@ math_atan2(mrb_state *mrb, mrb_value obj)
 static mrb_value
 math_sinh(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = sinh(x);
-
-    return mrb_float_value(x);
+    return math_unary<sinh>(mrb);
 }
 
 /*
  *  call-seq:
  *     Math.cosh(x)    -> float
+ *     Math.cosh(array) -> array
  *
  *  Computes the hyperbolic cosine of <i>x</i> (expressed in radians).
  */
 static mrb_value
 math_cosh(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = cosh(x);
-
-    return mrb_float_value(x);
+    return math_unary<cosh>(mrb);
 }
 
 /*
  *  call-seq:
  *     Math.tanh()    -> float
+ *     Math.tanh(array) -> array
  *
  *  Computes the hyperbolic tangent of <i>x</i> (expressed in
  *  radians).
@@ -281,12 +313,7 @@ math_cosh(mrb_state *mrb, mrb_value obj)
 static mrb_value
 math_tanh(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = tanh(x);
-
-    return mrb_float_value(x);
+    return math_unary<tanh>(mrb);
 }
 
 
@@ -297,53 +324,40 @@ math_tanh(mrb_state *mrb, mrb_value obj)
 /*
  *  call-seq:
  *     Math.asinh(x)    -> float
+ *     Math.asinh(array) -> array
  *
  *  Computes the inverse hyperbolic sine of <i>x</i>.
  */
 static mrb_value
 math_asinh(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-
-    x = asinh(x);
-
-    return mrb_float_value(x);
+    return math_unary<asinh>(mrb);
 }
 
 /*
  *  call-seq:
  *     Math.acosh(x)    -> float
+ *     Math.acosh(array) -> array
  *
  *  Computes the inverse hyperbolic cosine of <i>x</i>.
  */
 static mrb_value
 math_acosh(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = acosh(x);
-
-    return mrb_float_value(x);
+    return math_unary<acosh>(mrb);
 }
 
 /*
  *  call-seq:
  *     Math.atanh(x)    -> float
+ *     Math.atanh(array) -> array
  *
  *  Computes the inverse hyperbolic tangent of <i>x</i>.
  */
 static mrb_value
 math_atanh(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = atanh(x);
-
-    return mrb_float_value(x);
+    return math_unary<atanh>(mrb);
 }
 
 /*
@@ -373,6 +387,7 @@ extern double log2(double);
 /*
  *  call-seq:
  *     Math.exp(x)    -> float
+ *     Math.exp(array) -> array
  *
  *  Returns e**x.
  *
@@ -384,18 +399,15 @@ extern double log2(double);
 static mrb_value
 math_exp(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = exp(x);
-
-    return mrb_float_value(x);
+    return math_unary<exp>(mrb);
 }
 
 /*
  *  call-seq:
  *     Math.log(numeric)    -> float
  *     Math.log(num,base)   -> float
+ *     Math.log(array)      -> array
+ *     Math.log(array,base) -> array
  *
  *  Returns the natural logarithm of <i>numeric</i>.
  *  If additional second argument is given, it will be the base
@@ -410,20 +422,22 @@ math_exp(mrb_state *mrb, mrb_value obj)
 static mrb_value
 math_log(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x, base;
+    mrb_value x;
+    mrb_float base;
     int argc;
 
-    argc = mrb_get_args(mrb, "f|f", &x, &base);
-    x = log(x);
+    argc = mrb_get_args(mrb, "o|f", &x, &base);
     if (argc == 2) {
-        x /= log(base);
+        mrb_float lb = log(base);
+        return math_map(mrb, x, [lb](mrb_float v) { return log(v) / lb; });
     }
-    return mrb_float_value(x);
+    return math_map(mrb, x, [](mrb_float v) { return log(v); });
 }
 
 /*
  *  call-seq:
  *     Math.log2(numeric)    -> float
+ *     Math.log2(array)      -> array
  *
  *  Returns the base 2 logarithm of <i>numeric</i>.
  *
@@ -436,17 +450,13 @@ math_log(mrb_state *mrb, mrb_value obj)
 static mrb_value
 math_log2(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = log2(x);
-
-    return mrb_float_value(x);
+    return math_unary<log2>(mrb);
 }
 
 /*
  *  call-seq:
  *     Math.log10(numeric)    -> float
+ *     Math.log10(array)      -> array
  *
  *  Returns the base 10 logarithm of <i>numeric</i>.
  *
@@ -458,17 +468,13 @@ math_log2(mrb_state *mrb, mrb_value obj)
 static mrb_value
 math_log10(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = log10(x);
-
-    return mrb_float_value(x);
+    return math_unary<log10>(mrb);
 }
 
 /*
  *  call-seq:
  *     Math.sqrt(numeric)    -> float
+ *     Math.sqrt(array)      -> array
  *
  *  Returns the square root of <i>numeric</i>.
  *
@@ -476,18 +482,14 @@ math_log10(mrb_state *mrb, mrb_value obj)
 static mrb_value
 math_sqrt(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = sqrt(x);
-
-    return mrb_float_value(x);
+    return math_unary<sqrt>(mrb);
 }
 
 
 /*
  *  call-seq:
  *     Math.cbrt(numeric)    -> float
+ *     Math.cbrt(array)      -> array
  *
  *  Returns the cube root of <i>numeric</i>.
  *
@@ -519,12 +521,7 @@ math_sqrt(mrb_state *mrb, mrb_value obj)
 static mrb_value
 math_cbrt(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = cbrt(x);
-
-    return mrb_float_value(x);
+    return math_unary<cbrt>(mrb);
 }
 
 
@@ -595,36 +592,28 @@ math_hypot(mrb_state *mrb, mrb_value obj)
 /*
  * call-seq:
  *    Math.erf(x)  -> float
+ *    Math.erf(array) -> array
  *
  *  Calculates the error function of x.
  */
 static mrb_value
 math_erf(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = erf(x);
-
-    return mrb_float_value(x);
+    return math_unary<erf>(mrb);
 }
 
 
 /*
  * call-seq:
  *    Math.erfc(x)  -> float
+ *    Math.erfc(array) -> array
  *
  *  Calculates the complementary error function of x.
  */
 static mrb_value
 math_erfc(mrb_state *mrb, mrb_value obj)
 {
-    mrb_float x;
-
-    mrb_get_args(mrb, "f", &x);
-    x = erfc(x);
-
-    return mrb_float_value(x);
+    return math_unary<erfc>(mrb);
 }
 
 /* ------------------------------------------------------------------------*/
@@ -134,3 +134,14 @@ end
 assert('Math.erfc -1') do
   check_float(Math.erfc(-1), 1.8427007929497148)
 end
+
+assert('Math functions over an Array') do
+  assert_equal [1.0, 2.0, 3.0], Math.sqrt([1, 4, 9.0])
+  assert_equal [], Math.sin([])
+  assert_equal [0.0, 1.0], Math.log([1, Math::E])
+  assert_true check_float(Math.log([8, 1000], 2)[1], Math.log(1000, 2))
+  a = [0.5, 1, 2]
+  assert_equal a.map {|x| Math.exp(x) }, Math.exp(a)
+  assert_equal [0.5, 1, 2], a
+  assert_raise(TypeError) { Math.cos([1, "2"]) }
+end
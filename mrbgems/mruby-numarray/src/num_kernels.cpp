@@ -0,0 +1,671 @@
+/*
+** num_kernels.cpp - vector kernels used by FloatArray and IntArray
+**
+** See Copyright Notice in mruby.h
+*/
+
+#include <cmath>
+#include "num_kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define MRB_NUM_X86
+#include <immintrin.h>
+#endif
+
+/*
+ * Element-wise kernels are templates over the operation and over whether the
+ * second operand is a vector or a broadcast scalar (`S`, then `b` points to
+ * the scalar). The dispatch table below picks one instantiation per call.
+ */
+
+template <int OP>
+static inline double f64_apply(double x, double y)
+{
+    switch (OP) {
+    case NUM_ADD: return x + y;
+    case NUM_SUB: return x - y;
+    case NUM_MUL: return x * y;
+    default:      return x / y;
+    }
+}
+
+template <int OP>
+static inline int64_t i64_apply(int64_t x, int64_t y)
+{
+    /* unsigned arithmetic, so overflow wraps instead of being undefined */
+    switch (OP) {
+    case NUM_ADD: return (int64_t)((uint64_t)x + (uint64_t)y);
+    case NUM_SUB: return (int64_t)((uint64_t)x - (uint64_t)y);
+    default:      return (int64_t)((uint64_t)x * (uint64_t)y);
+    }
+}
+
+template <int CMP, typename T>
+static inline bool cmp_apply(T x, T y)
+{
+    switch (CMP) {
+    case NUM_LT: return x < y;
+    case NUM_LE: return x <= y;
+    case NUM_GT: return x > y;
+    case NUM_GE: return x >= y;
+    default:     return x == y;
+    }
+}
+
+template <int OP, bool S>
+static void f64_op_generic(double *d, const double *a, const double *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        d[i] = f64_apply<OP>(a[i], S ? *b : b[i]);
+}
+
+template <int CMP, bool S>
+static void f64_cmp_generic(int64_t *d, const double *a, const double *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        d[i] = cmp_apply<CMP>(a[i], S ? *b : b[i]);
+}
+
+#ifndef MRB_NUM_X86 /* the SIMD versions replace these */
+static double f64_sum_generic(const double *a, size_t n)
+{
+    double acc[4] = {0, 0, 0, 0};
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        acc[0] += a[i]; acc[1] += a[i+1]; acc[2] += a[i+2]; acc[3] += a[i+3];
+    }
+    double r = (acc[0] + acc[2]) + (acc[1] + acc[3]);
+    for (; i < n; i++)
+        r += a[i];
+    return r;
+}
+
+static double f64_dot_generic(const double *a, const double *b, size_t n)
+{
+    double acc[4] = {0, 0, 0, 0};
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        acc[0] += a[i]*b[i]; acc[1] += a[i+1]*b[i+1];
+        acc[2] += a[i+2]*b[i+2]; acc[3] += a[i+3]*b[i+3];
+    }
+    double r = (acc[0] + acc[2]) + (acc[1] + acc[3]);
+    for (; i < n; i++)
+        r += a[i]*b[i];
+    return r;
+}
+#endif
+
+template <bool MAX>
+static double f64_minmax_generic(const double *a, size_t n)
+{
+    double r = a[0];
+
+    for (size_t i = 0; i < n; i++) {
+        if (std::isnan(a[i]))
+            return a[i];
+        if (MAX ? a[i] > r : a[i] < r)
+            r = a[i];
+    }
+    return r;
+}
+
+template <int OP, bool S>
+static void i64_op_generic(int64_t *d, const int64_t *a, const int64_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        d[i] = i64_apply<OP>(a[i], S ? *b : b[i]);
+}
+
+template <int CMP, bool S>
+static void i64_cmp_generic(int64_t *d, const int64_t *a, const int64_t *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        d[i] = cmp_apply<CMP>(a[i], S ? *b : b[i]);
+}
+
+#ifndef MRB_NUM_X86
+static int64_t i64_sum_generic(const int64_t *a, size_t n)
+{
+    uint64_t r = 0;
+
+    for (size_t i = 0; i < n; i++)
+        r += (uint64_t)a[i];
+    return (int64_t)r;
+}
+#endif
+
+static int64_t i64_dot_generic(const int64_t *a, const int64_t *b, size_t n)
+{
+    uint64_t r = 0;
+
+    for (size_t i = 0; i < n; i++)
+        r += (uint64_t)a[i] * (uint64_t)b[i];
+    return (int64_t)r;
+}
+
+template <bool MAX>
+static int64_t i64_minmax_generic(const int64_t *a, size_t n)
+{
+    int64_t r = a[0];
+
+    for (size_t i = 1; i < n; i++) {
+        if (MAX ? a[i] > r : a[i] < r)
+            r = a[i];
+    }
+    return r;
+}
+
+#ifdef MRB_NUM_X86
+
+/* SSE2: two registers per step so that reductions see the same four lanes as AVX */
+
+template <int OP>
+static inline __m128d f64_vop_sse2(__m128d x, __m128d y)
+{
+    switch (OP) {
+    case NUM_ADD: return _mm_add_pd(x, y);
+    case NUM_SUB: return _mm_sub_pd(x, y);
+    case NUM_MUL: return _mm_mul_pd(x, y);
+    default:      return _mm_div_pd(x, y);
+    }
+}
+
+template <int OP, bool S>
+static void f64_op_sse2(double *d, const double *a, const double *b, size_t n)
+{
+    const __m128d s = S ? _mm_set1_pd(*b) : _mm_setzero_pd();
+    size_t i = 0;
+
+    for (; i + 2 <= n; i += 2) {
+        __m128d y = S ? s : _mm_loadu_pd(b + i);
+        _mm_storeu_pd(d + i, f64_vop_sse2<OP>(_mm_loadu_pd(a + i), y));
+    }
+    for (; i < n; i++)
+        d[i] = f64_apply<OP>(a[i], S ? *b : b[i]);
+}
+
+template <int CMP>
+static inline __m128d f64_vcmp_sse2(__m128d x, __m128d y)
+{
+    switch (CMP) {
+    case NUM_LT: return _mm_cmplt_pd(x, y);
+    case NUM_LE: return _mm_cmple_pd(x, y);
+    case NUM_GT: return _mm_cmpgt_pd(x, y);
+    case NUM_GE: return _mm_cmpge_pd(x, y);
+    default:     return _mm_cmpeq_pd(x, y);
+    }
+}
+
+template <int CMP, bool S>
+static void f64_cmp_sse2(int64_t *d, const double *a, const double *b, size_t n)
+{
+    const __m128d s = S ? _mm_set1_pd(*b) : _mm_setzero_pd();
+    const __m128i one = _mm_set1_epi64x(1);
+    size_t i = 0;
+
+    for (; i + 2 <= n; i += 2) {
+        __m128d y = S ? s : _mm_loadu_pd(b + i);
+        __m128i m = _mm_castpd_si128(f64_vcmp_sse2<CMP>(_mm_loadu_pd(a + i), y));
+        _mm_storeu_si128((__m128i *)(d + i), _mm_and_si128(m, one));
+    }
+    for (; i < n; i++)
+        d[i] = cmp_apply<CMP>(a[i], S ? *b : b[i]);
+}
+
+static double f64_sum_sse2(const double *a, size_t n)
+{
+    __m128d lo = _mm_setzero_pd(), hi = _mm_setzero_pd();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        lo = _mm_add_pd(lo, _mm_loadu_pd(a + i));
+        hi = _mm_add_pd(hi, _mm_loadu_pd(a + i + 2));
+    }
+    __m128d t = _mm_add_pd(lo, hi);
+    double r = _mm_cvtsd_f64(t) + _mm_cvtsd_f64(_mm_unpackhi_pd(t, t));
+    for (; i < n; i++)
+        r += a[i];
+    return r;
+}
+
+static double f64_dot_sse2(const double *a, const double *b, size_t n)
+{
+    __m128d lo = _mm_setzero_pd(), hi = _mm_setzero_pd();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        lo = _mm_add_pd(lo, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        hi = _mm_add_pd(hi, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+    }
+    __m128d t = _mm_add_pd(lo, hi);
+    double r = _mm_cvtsd_f64(t) + _mm_cvtsd_f64(_mm_unpackhi_pd(t, t));
+    for (; i < n; i++)
+        r += a[i]*b[i];
+    return r;
+}
+
+template <bool MAX>
+static double f64_minmax_sse2(const double *a, size_t n)
+{
+    __m128d r = _mm_set1_pd(a[0]);
+    __m128d nan = _mm_setzero_pd();
+    size_t i = 0;
+
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(a + i);
+        nan = _mm_or_pd(nan, _mm_cmpunord_pd(x, x));
+        r = MAX ? _mm_max_pd(r, x) : _mm_min_pd(r, x);
+    }
+    if (_mm_movemask_pd(nan))
+        return NAN;
+    r = MAX ? _mm_max_pd(r, _mm_unpackhi_pd(r, r)) : _mm_min_pd(r, _mm_unpackhi_pd(r, r));
+    double v = _mm_cvtsd_f64(r);
+    for (; i < n; i++) {
+        if (std::isnan(a[i]))
+            return a[i];
+        if (MAX ? a[i] > v : a[i] < v)
+            v = a[i];
+    }
+    return v;
+}
+
+template <int OP, bool S>
+static void i64_op_sse2(int64_t *d, const int64_t *a, const int64_t *b, size_t n)
+{
+    if (OP == NUM_MUL) { /* no 64 bit multiply before AVX-512 */
+        i64_op_generic<OP, S>(d, a, b, n);
+        return;
+    }
+    const __m128i s = S ? _mm_set1_epi64x(*b) : _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 2 <= n; i += 2) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i y = S ? s : _mm_loadu_si128((const __m128i *)(b + i));
+        _mm_storeu_si128((__m128i *)(d + i), OP == NUM_ADD ? _mm_add_epi64(x, y) : _mm_sub_epi64(x, y));
+    }
+    for (; i < n; i++)
+        d[i] = i64_apply<OP>(a[i], S ? *b : b[i]);
+}
+
+static int64_t i64_sum_sse2(const int64_t *a, size_t n)
+{
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 2 <= n; i += 2)
+        acc = _mm_add_epi64(acc, _mm_loadu_si128((const __m128i *)(a + i)));
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, acc);
+    uint64_t r = (uint64_t)lanes[0] + (uint64_t)lanes[1];
+    for (; i < n; i++)
+        r += (uint64_t)a[i];
+    return (int64_t)r;
+}
+
+template <int OP>
+__attribute__((target("avx2")))
+static inline __m256d f64_vop_avx2(__m256d x, __m256d y)
+{
+    switch (OP) {
+    case NUM_ADD: return _mm256_add_pd(x, y);
+    case NUM_SUB: return _mm256_sub_pd(x, y);
+    case NUM_MUL: return _mm256_mul_pd(x, y);
+    default:      return _mm256_div_pd(x, y);
+    }
+}
+
+template <int OP, bool S>
+__attribute__((target("avx2")))
+static void f64_op_avx2(double *d, const double *a, const double *b, size_t n)
+{
+    const __m256d s = S ? _mm256_set1_pd(*b) : _mm256_setzero_pd();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m256d y = S ? s : _mm256_loadu_pd(b + i);
+        _mm256_storeu_pd(d + i, f64_vop_avx2<OP>(_mm256_loadu_pd(a + i), y));
+    }
+    for (; i < n; i++)
+        d[i] = f64_apply<OP>(a[i], S ? *b : b[i]);
+}
+
+template <int CMP>
+__attribute__((target("avx2")))
+static inline __m256d f64_vcmp_avx2(__m256d x, __m256d y)
+{
+    switch (CMP) {
+    case NUM_LT: return _mm256_cmp_pd(x, y, _CMP_LT_OQ);
+    case NUM_LE: return _mm256_cmp_pd(x, y, _CMP_LE_OQ);
+    case NUM_GT: return _mm256_cmp_pd(x, y, _CMP_GT_OQ);
+    case NUM_GE: return _mm256_cmp_pd(x, y, _CMP_GE_OQ);
+    default:     return _mm256_cmp_pd(x, y, _CMP_EQ_OQ);
+    }
+}
+
+template <int CMP, bool S>
+__attribute__((target("avx2")))
+static void f64_cmp_avx2(int64_t *d, const double *a, const double *b, size_t n)
+{
+    const __m256d s = S ? _mm256_set1_pd(*b) : _mm256_setzero_pd();
+    const __m256i one = _mm256_set1_epi64x(1);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m256d y = S ? s : _mm256_loadu_pd(b + i);
+        __m256i m = _mm256_castpd_si256(f64_vcmp_avx2<CMP>(_mm256_loadu_pd(a + i), y));
+        _mm256_storeu_si256((__m256i *)(d + i), _mm256_and_si256(m, one));
+    }
+    for (; i < n; i++)
+        d[i] = cmp_apply<CMP>(a[i], S ? *b : b[i]);
+}
+
+__attribute__((target("avx2")))
+static inline double f64_hsum_avx2(__m256d acc)
+{
+    __m128d t = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    return _mm_cvtsd_f64(t) + _mm_cvtsd_f64(_mm_unpackhi_pd(t, t));
+}
+
+__attribute__((target("avx2")))
+static double f64_sum_avx2(const double *a, size_t n)
+{
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+        acc = _mm256_add_pd(acc, _mm256_loadu_pd(a + i));
+    double r = f64_hsum_avx2(acc);
+    for (; i < n; i++)
+        r += a[i];
+    return r;
+}
+
+__attribute__((target("avx2")))
+static double f64_dot_avx2(const double *a, const double *b, size_t n)
+{
+    __m256d acc = _mm256_setzero_pd();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    double r = f64_hsum_avx2(acc);
+    for (; i < n; i++)
+        r += a[i]*b[i];
+    return r;
+}
+
+template <bool MAX>
+__attribute__((target("avx2")))
+static double f64_minmax_avx2(const double *a, size_t n)
+{
+    __m256d r = _mm256_set1_pd(a[0]);
+    __m256d nan = _mm256_setzero_pd();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(a + i);
+        nan = _mm256_or_pd(nan, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+        r = MAX ? _mm256_max_pd(r, x) : _mm256_min_pd(r, x);
+    }
+    if (_mm256_movemask_pd(nan))
+        return NAN;
+    __m128d lo = _mm256_castpd256_pd128(r), hi = _mm256_extractf128_pd(r, 1);
+    __m128d t = MAX ? _mm_max_pd(lo, hi) : _mm_min_pd(lo, hi);
+    t = MAX ? _mm_max_pd(t, _mm_unpackhi_pd(t, t)) : _mm_min_pd(t, _mm_unpackhi_pd(t, t));
+    double v = _mm_cvtsd_f64(t);
+    for (; i < n; i++) {
+        if (std::isnan(a[i]))
+            return a[i];
+        if (MAX ? a[i] > v : a[i] < v)
+            v = a[i];
+    }
+    return v;
+}
+
+template <int OP, bool S>
+__attribute__((target("avx2")))
+static void i64_op_avx2(int64_t *d, const int64_t *a, const int64_t *b, size_t n)
+{
+    if (OP == NUM_MUL) {
+        i64_op_generic<OP, S>(d, a, b, n);
+        return;
+    }
+    const __m256i s = S ? _mm256_set1_epi64x(*b) : _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i y = S ? s : _mm256_loadu_si256((const __m256i *)(b + i));
+        _mm256_storeu_si256((__m256i *)(d + i), OP == NUM_ADD ? _mm256_add_epi64(x, y) : _mm256_sub_epi64(x, y));
+    }
+    for (; i < n; i++)
+        d[i] = i64_apply<OP>(a[i], S ? *b : b[i]);
+}
+
+template <int CMP>
+__attribute__((target("avx2")))
+static inline __m256i i64_vcmp_avx2(__m256i x, __m256i y)
+{
+    const __m256i ones = _mm256_set1_epi64x(-1);
+
+    switch (CMP) {
+    case NUM_LT: return _mm256_cmpgt_epi64(y, x);
+    case NUM_LE: return _mm256_xor_si256(_mm256_cmpgt_epi64(x, y), ones);
+    case NUM_GT: return _mm256_cmpgt_epi64(x, y);
+    case NUM_GE: return _mm256_xor_si256(_mm256_cmpgt_epi64(y, x), ones);
+    default:     return _mm256_cmpeq_epi64(x, y);
+    }
+}
+
+template <int CMP, bool S>
+__attribute__((target("avx2")))
+static void i64_cmp_avx2(int64_t *d, const int64_t *a, const int64_t *b, size_t n)
+{
+    const __m256i s = S ? _mm256_set1_epi64x(*b) : _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi64x(1);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i y = S ? s : _mm256_loadu_si256((const __m256i *)(b + i));
+        _mm256_storeu_si256((__m256i *)(d + i), _mm256_and_si256(i64_vcmp_avx2<CMP>(x, y), one));
+    }
+    for (; i < n; i++)
+        d[i] = cmp_apply<CMP>(a[i], S ? *b : b[i]);
+}
+
+__attribute__((target("avx2")))
+static int64_t i64_sum_avx2(const int64_t *a, size_t n)
+{
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+        acc = _mm256_add_epi64(acc, _mm256_loadu_si256((const __m256i *)(a + i)));
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    uint64_t r = (uint64_t)lanes[0] + (uint64_t)lanes[1] + (uint64_t)lanes[2] + (uint64_t)lanes[3];
+    for (; i < n; i++)
+        r += (uint64_t)a[i];
+    return (int64_t)r;
+}
+
+template <bool MAX>
+__attribute__((target("avx2")))
+static int64_t i64_minmax_avx2(const int64_t *a, size_t n)
+{
+    __m256i r = _mm256_set1_epi64x(a[0]);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i gt = MAX ? _mm256_cmpgt_epi64(x, r) : _mm256_cmpgt_epi64(r, x);
+        r = _mm256_blendv_epi8(r, x, gt);
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, r);
+    int64_t v = lanes[0];
+    for (int k = 1; k < 4; k++) {
+        if (MAX ? lanes[k] > v : lanes[k] < v)
+            v = lanes[k];
+    }
+    for (; i < n; i++) {
+        if (MAX ? a[i] > v : a[i] < v)
+            v = a[i];
+    }
+    return v;
+}
+
+#endif /* MRB_NUM_X86 */
+
+namespace {
+typedef void (*f64_op_fn)(double *, const double *, const double *, size_t);
+typedef void (*f64_cmp_fn)(int64_t *, const double *, const double *, size_t);
+typedef void (*i64_op_fn)(int64_t *, const int64_t *, const int64_t *, size_t);
+typedef void (*i64_cmp_fn)(int64_t *, const int64_t *, const int64_t *, size_t);
+
+#define NUM_OPS(k, s) { k<NUM_ADD, s>, k<NUM_SUB, s>, k<NUM_MUL, s>, k<NUM_DIV, s> }
+#define NUM_CMPS(k, s) { k<NUM_LT, s>, k<NUM_LE, s>, k<NUM_GT, s>, k<NUM_GE, s>, k<NUM_EQ, s> }
+
+/* one row per instruction set; [0] is the vector form, [1] the scalar one */
+struct NumKernels {
+    f64_op_fn f64_op[2][4];
+    f64_cmp_fn f64_cmp[2][5];
+    double (*f64_sum)(const double *, size_t);
+    double (*f64_dot)(const double *, const double *, size_t);
+    double (*f64_min)(const double *, size_t);
+    double (*f64_max)(const double *, size_t);
+    i64_op_fn i64_op[2][4];
+    i64_cmp_fn i64_cmp[2][5];
+    int64_t (*i64_sum)(const int64_t *, size_t);
+    int64_t (*i64_dot)(const int64_t *, const int64_t *, size_t);
+    int64_t (*i64_min)(const int64_t *, size_t);
+    int64_t (*i64_max)(const int64_t *, size_t);
+};
+
+#ifndef MRB_NUM_X86
+const NumKernels generic_kernels = {
+    { NUM_OPS(f64_op_generic, false), NUM_OPS(f64_op_generic, true) },
+    { NUM_CMPS(f64_cmp_generic, false), NUM_CMPS(f64_cmp_generic, true) },
+    f64_sum_generic, f64_dot_generic, f64_minmax_generic<false>, f64_minmax_generic<true>,
+    { NUM_OPS(i64_op_generic, false), NUM_OPS(i64_op_generic, true) },
+    { NUM_CMPS(i64_cmp_generic, false), NUM_CMPS(i64_cmp_generic, true) },
+    i64_sum_generic, i64_dot_generic, i64_minmax_generic<false>, i64_minmax_generic<true>,
+};
+#else
+const NumKernels sse2_kernels = {
+    { NUM_OPS(f64_op_sse2, false), NUM_OPS(f64_op_sse2, true) },
+    { NUM_CMPS(f64_cmp_sse2, false), NUM_CMPS(f64_cmp_sse2, true) },
+    f64_sum_sse2, f64_dot_sse2, f64_minmax_sse2<false>, f64_minmax_sse2<true>,
+    { NUM_OPS(i64_op_sse2, false), NUM_OPS(i64_op_sse2, true) },
+    /* SSE2 has no 64 bit compares */
+    { NUM_CMPS(i64_cmp_generic, false), NUM_CMPS(i64_cmp_generic, true) },
+    i64_sum_sse2, i64_dot_generic, i64_minmax_generic<false>, i64_minmax_generic<true>,
+};
+
+const NumKernels avx2_kernels = {
+    { NUM_OPS(f64_op_avx2, false), NUM_OPS(f64_op_avx2, true) },
+    { NUM_CMPS(f64_cmp_avx2, false), NUM_CMPS(f64_cmp_avx2, true) },
+    f64_sum_avx2, f64_dot_avx2, f64_minmax_avx2<false>, f64_minmax_avx2<true>,
+    { NUM_OPS(i64_op_avx2, false), NUM_OPS(i64_op_avx2, true) },
+    { NUM_CMPS(i64_cmp_avx2, false), NUM_CMPS(i64_cmp_avx2, true) },
+    i64_sum_avx2, i64_dot_generic, i64_minmax_avx2<false>, i64_minmax_avx2<true>,
+};
+#endif
+
+const NumKernels &kernels()
+{
+#ifdef MRB_NUM_X86
+    static const NumKernels &k = []() -> const NumKernels & {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? avx2_kernels : sse2_kernels;
+    }();
+    return k;
+#else
+    return generic_kernels;
+#endif
+}
+} // end of anonymous namespace
+
+void num_f64_op(NumOp op, double *d, const double *a, const double *b, size_t n)
+{
+    kernels().f64_op[0][op](d, a, b, n);
+}
+
+void num_f64_op_s(NumOp op, double *d, const double *a, double s, size_t n)
+{
+    kernels().f64_op[1][op](d, a, &s, n);
+}
+
+double num_f64_sum(const double *a, size_t n)
+{
+    return kernels().f64_sum(a, n);
+}
+
+double num_f64_dot(const double *a, const double *b, size_t n)
+{
+    return kernels().f64_dot(a, b, n);
+}
+
+double num_f64_min(const double *a, size_t n)
+{
+    return kernels().f64_min(a, n);
+}
+
+double num_f64_max(const double *a, size_t n)
+{
+    return kernels().f64_max(a, n);
+}
+
+void num_f64_cmp(NumCmp cmp, int64_t *d, const double *a, const double *b, size_t n)
+{
+    kernels().f64_cmp[0][cmp](d, a, b, n);
+}
+
+void num_f64_cmp_s(NumCmp cmp, int64_t *d, const double *a, double s, size_t n)
+{
+    kernels().f64_cmp[1][cmp](d, a, &s, n);
+}
+
+void num_i64_op(NumOp op, int64_t *d, const int64_t *a, const int64_t *b, size_t n)
+{
+    kernels().i64_op[0][op](d, a, b, n);
+}
+
+void num_i64_op_s(NumOp op, int64_t *d, const int64_t *a, int64_t s, size_t n)
+{
+    kernels().i64_op[1][op](d, a, &s, n);
+}
+
+int64_t num_i64_sum(const int64_t *a, size_t n)
+{
+    return kernels().i64_sum(a, n);
+}
+
+int64_t num_i64_dot(const int64_t *a, const int64_t *b, size_t n)
+{
+    return kernels().i64_dot(a, b, n);
+}
+
+int64_t num_i64_min(const int64_t *a, size_t n)
+{
+    return kernels().i64_min(a, n);
+}
+
+int64_t num_i64_max(const int64_t *a, size_t n)
+{
+    return kernels().i64_max(a, n);
+}
+
+void num_i64_cmp(NumCmp cmp, int64_t *d, const int64_t *a, const int64_t *b, size_t n)
+{
+    kernels().i64_cmp[0][cmp](d, a, b, n);
+}
+
+void num_i64_cmp_s(NumCmp cmp, int64_t *d, const int64_t *a, int64_t s, size_t n)
+{
+    kernels().i64_cmp[1][cmp](d, a, &s, n);
+}
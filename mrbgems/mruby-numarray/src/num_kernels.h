@@ -0,0 +1,38 @@
+/*
+** num_kernels.h - vector kernels used by FloatArray and IntArray
+**
+** See Copyright Notice in mruby.h
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum NumOp { NUM_ADD, NUM_SUB, NUM_MUL, NUM_DIV };
+enum NumCmp { NUM_LT, NUM_LE, NUM_GT, NUM_GE, NUM_EQ };
+
+/* d[i] = a[i] op b[i] */
+void num_f64_op(NumOp op, double *d, const double *a, const double *b, size_t n);
+/* d[i] = a[i] op s */
+void num_f64_op_s(NumOp op, double *d, const double *a, double s, size_t n);
+/* reductions sum four interleaved lanes, so the result does not depend on the CPU */
+double num_f64_sum(const double *a, size_t n);
+double num_f64_dot(const double *a, const double *b, size_t n);
+/* n > 0; NaN if any element is NaN */
+double num_f64_min(const double *a, size_t n);
+double num_f64_max(const double *a, size_t n);
+/* d[i] = (a[i] cmp b[i]) ? 1 : 0 */
+void num_f64_cmp(NumCmp cmp, int64_t *d, const double *a, const double *b, size_t n);
+void num_f64_cmp_s(NumCmp cmp, int64_t *d, const double *a, double s, size_t n);
+
+/* integer kernels wrap around on overflow; NUM_DIV is not supported */
+void num_i64_op(NumOp op, int64_t *d, const int64_t *a, const int64_t *b, size_t n);
+void num_i64_op_s(NumOp op, int64_t *d, const int64_t *a, int64_t s, size_t n);
+int64_t num_i64_sum(const int64_t *a, size_t n);
+int64_t num_i64_dot(const int64_t *a, const int64_t *b, size_t n);
+/* n > 0 */
+int64_t num_i64_min(const int64_t *a, size_t n);
+int64_t num_i64_max(const int64_t *a, size_t n);
+void num_i64_cmp(NumCmp cmp, int64_t *d, const int64_t *a, const int64_t *b, size_t n);
+void num_i64_cmp_s(NumCmp cmp, int64_t *d, const int64_t *a, int64_t s, size_t n);
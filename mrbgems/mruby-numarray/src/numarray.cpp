@@ -0,0 +1,637 @@
+/*
+** numarray.cpp - FloatArray and IntArray classes
+**
+** Packed vectors of double / int64_t. Arithmetic, comparisons and reductions
+** run the kernels in num_kernels.cpp over the whole vector.
+**
+** See Copyright Notice in mruby.h
+*/
+
+#include <cmath>
+#include <cstring>
+#include "mruby.h"
+#include "mruby/array.h"
+#include "mruby/class.h"
+#include "mruby/data.h"
+#include "mruby/string.h"
+#include "num_kernels.h"
+
+template <typename T>
+struct NumVec {
+    mrb_int len;
+    T *ptr;
+};
+typedef NumVec<double> FloatVec;
+typedef NumVec<int64_t> IntVec;
+
+static void num_vec_free(mrb_state *mrb, void *p)
+{
+    FloatVec *v = (FloatVec *)p; /* both instantiations have the same layout */
+
+    mrb->gc()._free(v->ptr);
+    mrb->gc()._free(v);
+}
+
+static const struct mrb_data_type float_array_type = {
+    "FloatArray", num_vec_free,
+};
+static const struct mrb_data_type int_array_type = {
+    "IntArray", num_vec_free,
+};
+
+/* per element type: data type, boxing and unboxing */
+struct FloatTraits {
+    typedef double elem;
+    static const mrb_data_type *type() { return &float_array_type; }
+    static mrb_value box(mrb_state *, double x) { return mrb_float_value(x); }
+    static double unbox(mrb_state *mrb, const mrb_value &v) {
+        if (v.is_float())
+            return mrb_float(v);
+        if (v.is_fixnum())
+            return mrb_fixnum(v);
+        mrb->mrb_raisef(E_TYPE_ERROR, "%S can't be stored in FloatArray",
+                        mrb_str_new_cstr(mrb, mrb_obj_classname(mrb, v))->wrap());
+        return 0;
+    }
+};
+
+struct IntTraits {
+    typedef int64_t elem;
+    static const mrb_data_type *type() { return &int_array_type; }
+    static mrb_value box(mrb_state *, int64_t x) {
+        /* like Fixnum arithmetic, values outside mrb_int come back as Float */
+        if (x < MRB_INT_MIN || x > MRB_INT_MAX)
+            return mrb_float_value((mrb_float)x);
+        return mrb_fixnum_value((mrb_int)x);
+    }
+    static int64_t unbox(mrb_state *mrb, const mrb_value &v) {
+        if (v.is_fixnum())
+            return mrb_fixnum(v);
+        mrb->mrb_raisef(E_TYPE_ERROR, "%S can't be stored in IntArray",
+                        mrb_str_new_cstr(mrb, mrb_obj_classname(mrb, v))->wrap());
+        return 0;
+    }
+};
+
+template <class Tr>
+static NumVec<typename Tr::elem> *vec_get(mrb_state *mrb, const mrb_value &self)
+{
+    mrb_data_check_type(mrb, self, Tr::type());
+    NumVec<typename Tr::elem> *v = (NumVec<typename Tr::elem> *)DATA_PTR(self);
+    if (!v) {
+        mrb->mrb_raisef(E_ARGUMENT_ERROR, "uninitialized %S",
+                        mrb_str_new_cstr(mrb, Tr::type()->struct_name)->wrap());
+    }
+    return v;
+}
+
+template <class Tr>
+static NumVec<typename Tr::elem> *vec_alloc(mrb_state *mrb, mrb_int len)
+{
+    typedef typename Tr::elem T;
+
+    if (len < 0) {
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "negative array size");
+    }
+    if ((size_t)len > SIZE_MAX / sizeof(T)) {
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "array size too big");
+    }
+    T *ptr = (T *)mrb->gc()._malloc(sizeof(T) * (len ? len : 1));
+    NumVec<T> *v = (NumVec<T> *)mrb->gc()._malloc(sizeof(NumVec<T>));
+    v->len = len;
+    v->ptr = ptr;
+    return v;
+}
+
+/* a new, uninitialized vector object of the class `Tr` describes */
+template <class Tr>
+static mrb_value vec_new(mrb_state *mrb, mrb_int len, NumVec<typename Tr::elem> **out)
+{
+    RClass *c = mrb->class_get(Tr::type()->struct_name);
+    *out = vec_alloc<Tr>(mrb, len);
+    return RData::object_alloc(mrb, c, *out, Tr::type())->wrap();
+}
+
+static bool is_float_array(const mrb_value &v)
+{
+    return mrb_type(v) == MRB_TT_DATA && DATA_TYPE(v) == &float_array_type;
+}
+
+static bool is_int_array(const mrb_value &v)
+{
+    return mrb_type(v) == MRB_TT_DATA && DATA_TYPE(v) == &int_array_type;
+}
+
+/* FloatArray view of a FloatArray or IntArray */
+static mrb_value float_view(mrb_state *mrb, const mrb_value &v)
+{
+    if (is_float_array(v))
+        return v;
+    if (!is_int_array(v)) {
+        mrb->mrb_raisef(E_TYPE_ERROR, "expected FloatArray or IntArray, got %S",
+                        mrb_str_new_cstr(mrb, mrb_obj_classname(mrb, v))->wrap());
+    }
+    IntVec *src = vec_get<IntTraits>(mrb, v);
+    FloatVec *dst;
+    mrb_value res = vec_new<FloatTraits>(mrb, src->len, &dst);
+    for (mrb_int i = 0; i < src->len; i++)
+        dst->ptr[i] = (double)src->ptr[i];
+    return res;
+}
+
+template <typename T>
+static void check_same_len(mrb_state *mrb, const NumVec<T> *a, const NumVec<T> *b)
+{
+    if (a->len != b->len) {
+        mrb->mrb_raisef(E_ARGUMENT_ERROR, "length mismatch (%S for %S)",
+                        mrb_fixnum_value(b->len), mrb_fixnum_value(a->len));
+    }
+}
+
+/*
+ *  call-seq:
+ *     FloatArray.new(size, fill = 0)   -> float_array
+ *     FloatArray.new(array)            -> float_array
+ *     IntArray.new(size, fill = 0)     -> int_array
+ *     IntArray.new(array)              -> int_array
+ */
+template <class Tr>
+static mrb_value vec_initialize(mrb_state *mrb, mrb_value self)
+{
+    typedef typename Tr::elem T;
+    mrb_value arg, fill = mrb_fixnum_value(0);
+
+    mrb_get_args(mrb, "o|o", &arg, &fill);
+    NumVec<T> *v;
+    if (arg.is_array()) {
+        RArray *a = mrb_ary_ptr(arg);
+        v = vec_alloc<Tr>(mrb, a->m_len);
+        DATA_TYPE(self) = Tr::type();
+        if (DATA_PTR(self))
+            num_vec_free(mrb, DATA_PTR(self));
+        DATA_PTR(self) = v;
+        for (mrb_int i = 0; i < v->len; i++)
+            v->ptr[i] = Tr::unbox(mrb, a->m_ptr[i]);
+        return self;
+    }
+    mrb_int len = mrb_fixnum(mrb_to_int(mrb, arg));
+    T x = Tr::unbox(mrb, fill);
+    v = vec_alloc<Tr>(mrb, len);
+    DATA_TYPE(self) = Tr::type();
+    if (DATA_PTR(self))
+        num_vec_free(mrb, DATA_PTR(self));
+    DATA_PTR(self) = v;
+    for (mrb_int i = 0; i < len; i++)
+        v->ptr[i] = x;
+    return self;
+}
+
+template <class Tr>
+static mrb_value vec_init_copy(mrb_state *mrb, mrb_value self)
+{
+    typedef typename Tr::elem T;
+    mrb_value other;
+
+    mrb_get_args(mrb, "o", &other);
+    if (mrb_obj_equal(self, other))
+        return self;
+    NumVec<T> *src = vec_get<Tr>(mrb, other);
+    NumVec<T> *v = vec_alloc<Tr>(mrb, src->len);
+    memcpy(v->ptr, src->ptr, sizeof(T) * src->len);
+    DATA_TYPE(self) = Tr::type();
+    if (DATA_PTR(self))
+        num_vec_free(mrb, DATA_PTR(self));
+    DATA_PTR(self) = v;
+    return self;
+}
+
+template <class Tr>
+static mrb_value vec_size(mrb_state *mrb, mrb_value self)
+{
+    return mrb_fixnum_value(vec_get<Tr>(mrb, self)->len);
+}
+
+template <class Tr>
+static mrb_value vec_aref(mrb_state *mrb, mrb_value self)
+{
+    mrb_int i;
+
+    mrb_get_args(mrb, "i", &i);
+    NumVec<typename Tr::elem> *v = vec_get<Tr>(mrb, self);
+    if (i < 0)
+        i += v->len;
+    if (i < 0 || i >= v->len)
+        return mrb_value::nil();
+    return Tr::box(mrb, v->ptr[i]);
+}
+
+template <class Tr>
+static mrb_value vec_aset(mrb_state *mrb, mrb_value self)
+{
+    mrb_int i;
+    mrb_value val;
+
+    mrb_get_args(mrb, "io", &i, &val);
+    NumVec<typename Tr::elem> *v = vec_get<Tr>(mrb, self);
+    mrb_int idx = i < 0 ? i + v->len : i;
+    if (idx < 0 || idx >= v->len) {
+        mrb->mrb_raisef(E_INDEX_ERROR, "index %S out of %S", mrb_fixnum_value(i),
+                        mrb_str_new_cstr(mrb, Tr::type()->struct_name)->wrap());
+    }
+    v->ptr[idx] = Tr::unbox(mrb, val);
+    return val;
+}
+
+template <class Tr>
+static mrb_value vec_to_a(mrb_state *mrb, mrb_value self)
+{
+    NumVec<typename Tr::elem> *v = vec_get<Tr>(mrb, self);
+    RArray *a = RArray::create(mrb, v->len);
+    int ai = mrb->gc().arena_save();
+
+    for (mrb_int i = 0; i < v->len; i++) {
+        a->push(Tr::box(mrb, v->ptr[i]));
+        mrb->gc().arena_restore(ai);
+    }
+    return a->wrap();
+}
+
+template <class Tr>
+static mrb_value vec_each(mrb_state *mrb, mrb_value self)
+{
+    mrb_value blk;
+
+    mrb_get_args(mrb, "&", &blk);
+    if (blk.is_nil()) {
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "no block given");
+    }
+    int ai = mrb->gc().arena_save();
+    /* re-read the vector every time, the block may replace it */
+    for (mrb_int i = 0; i < vec_get<Tr>(mrb, self)->len; i++) {
+        mrb_yield(mrb, blk, Tr::box(mrb, vec_get<Tr>(mrb, self)->ptr[i]));
+        mrb->gc().arena_restore(ai);
+    }
+    return self;
+}
+
+template <class Tr>
+static mrb_value vec_inspect(mrb_state *mrb, mrb_value self)
+{
+    RString *s = RString::create(mrb, Tr::type()->struct_name);
+    s->str_cat(mrb_inspect(mrb, vec_to_a<Tr>(mrb, self)));
+    return s->wrap();
+}
+
+template <class Tr>
+static mrb_value vec_equal(mrb_state *mrb, mrb_value self)
+{
+    typedef typename Tr::elem T;
+    mrb_value other;
+
+    mrb_get_args(mrb, "o", &other);
+    if (mrb_type(other) != MRB_TT_DATA || DATA_TYPE(other) != Tr::type() || !DATA_PTR(other))
+        return mrb_value::_false();
+    NumVec<T> *a = vec_get<Tr>(mrb, self), *b = vec_get<Tr>(mrb, other);
+    if (a->len != b->len)
+        return mrb_value::_false();
+    for (mrb_int i = 0; i < a->len; i++) {
+        if (a->ptr[i] != b->ptr[i])
+            return mrb_value::_false();
+    }
+    return mrb_value::_true();
+}
+
+/* FloatArray op (FloatArray | IntArray | Numeric) */
+static mrb_value float_binop(mrb_state *mrb, const mrb_value &self, const mrb_value &other, NumOp op)
+{
+    FloatVec *a = vec_get<FloatTraits>(mrb, self);
+    FloatVec *d;
+
+    if (other.is_fixnum() || other.is_float()) {
+        double s = FloatTraits::unbox(mrb, other);
+        mrb_value res = vec_new<FloatTraits>(mrb, a->len, &d);
+        num_f64_op_s(op, d->ptr, a->ptr, s, a->len);
+        return res;
+    }
+    mrb_value ov = float_view(mrb, other);
+    FloatVec *b = vec_get<FloatTraits>(mrb, ov);
+    check_same_len(mrb, a, b);
+    mrb_value res = vec_new<FloatTraits>(mrb, a->len, &d);
+    num_f64_op(op, d->ptr, a->ptr, b->ptr, a->len);
+    return res;
+}
+
+/* IntArray op (IntArray | Fixnum); anything involving floats, and `/`, gives a FloatArray */
+static mrb_value int_binop(mrb_state *mrb, const mrb_value &self, const mrb_value &other, NumOp op)
+{
+    IntVec *a = vec_get<IntTraits>(mrb, self);
+    IntVec *d;
+
+    if (op == NUM_DIV || !(other.is_fixnum() || is_int_array(other)))
+        return float_binop(mrb, float_view(mrb, self), other, op);
+    if (other.is_fixnum()) {
+        mrb_value res = vec_new<IntTraits>(mrb, a->len, &d);
+        num_i64_op_s(op, d->ptr, a->ptr, mrb_fixnum(other), a->len);
+        return res;
+    }
+    IntVec *b = vec_get<IntTraits>(mrb, other);
+    check_same_len(mrb, a, b);
+    mrb_value res = vec_new<IntTraits>(mrb, a->len, &d);
+    num_i64_op(op, d->ptr, a->ptr, b->ptr, a->len);
+    return res;
+}
+
+/* element-wise comparisons return an IntArray of 0 and 1 */
+static mrb_value float_cmp(mrb_state *mrb, const mrb_value &self, const mrb_value &other, NumCmp cmp)
+{
+    FloatVec *a = vec_get<FloatTraits>(mrb, self);
+    IntVec *d;
+
+    if (other.is_fixnum() || other.is_float()) {
+        double s = FloatTraits::unbox(mrb, other);
+        mrb_value res = vec_new<IntTraits>(mrb, a->len, &d);
+        num_f64_cmp_s(cmp, d->ptr, a->ptr, s, a->len);
+        return res;
+    }
+    mrb_value ov = float_view(mrb, other);
+    FloatVec *b = vec_get<FloatTraits>(mrb, ov);
+    check_same_len(mrb, a, b);
+    mrb_value res = vec_new<IntTraits>(mrb, a->len, &d);
+    num_f64_cmp(cmp, d->ptr, a->ptr, b->ptr, a->len);
+    return res;
+}
+
+static mrb_value int_cmp(mrb_state *mrb, const mrb_value &self, const mrb_value &other, NumCmp cmp)
+{
+    IntVec *a = vec_get<IntTraits>(mrb, self);
+    IntVec *d;
+
+    if (!(other.is_fixnum() || is_int_array(other)))
+        return float_cmp(mrb, float_view(mrb, self), other, cmp);
+    if (other.is_fixnum()) {
+        mrb_value res = vec_new<IntTraits>(mrb, a->len, &d);
+        num_i64_cmp_s(cmp, d->ptr, a->ptr, mrb_fixnum(other), a->len);
+        return res;
+    }
+    IntVec *b = vec_get<IntTraits>(mrb, other);
+    check_same_len(mrb, a, b);
+    mrb_value res = vec_new<IntTraits>(mrb, a->len, &d);
+    num_i64_cmp(cmp, d->ptr, a->ptr, b->ptr, a->len);
+    return res;
+}
+
+template <NumOp OP>
+static mrb_value float_arith(mrb_state *mrb, mrb_value self)
+{
+    return float_binop(mrb, self, mrb->get_arg<mrb_value>(), OP);
+}
+
+template <NumOp OP>
+static mrb_value int_arith(mrb_state *mrb, mrb_value self)
+{
+    return int_binop(mrb, self, mrb->get_arg<mrb_value>(), OP);
+}
+
+template <NumCmp CMP>
+static mrb_value float_compare(mrb_state *mrb, mrb_value self)
+{
+    return float_cmp(mrb, self, mrb->get_arg<mrb_value>(), CMP);
+}
+
+template <NumCmp CMP>
+static mrb_value int_compare(mrb_state *mrb, mrb_value self)
+{
+    return int_cmp(mrb, self, mrb->get_arg<mrb_value>(), CMP);
+}
+
+static mrb_value float_sum(mrb_state *mrb, mrb_value self)
+{
+    FloatVec *a = vec_get<FloatTraits>(mrb, self);
+    return mrb_float_value(num_f64_sum(a->ptr, a->len));
+}
+
+static mrb_value float_min(mrb_state *mrb, mrb_value self)
+{
+    FloatVec *a = vec_get<FloatTraits>(mrb, self);
+    return a->len ? mrb_float_value(num_f64_min(a->ptr, a->len)) : mrb_value::nil();
+}
+
+static mrb_value float_max(mrb_state *mrb, mrb_value self)
+{
+    FloatVec *a = vec_get<FloatTraits>(mrb, self);
+    return a->len ? mrb_float_value(num_f64_max(a->ptr, a->len)) : mrb_value::nil();
+}
+
+static mrb_value float_dot_with(mrb_state *mrb, const mrb_value &self, const mrb_value &other)
+{
+    FloatVec *a = vec_get<FloatTraits>(mrb, self);
+    mrb_value ov = float_view(mrb, other);
+    FloatVec *b = vec_get<FloatTraits>(mrb, ov);
+
+    check_same_len(mrb, a, b);
+    return mrb_float_value(num_f64_dot(a->ptr, b->ptr, a->len));
+}
+
+static mrb_value float_dot(mrb_state *mrb, mrb_value self)
+{
+    return float_dot_with(mrb, self, mrb->get_arg<mrb_value>());
+}
+
+static mrb_value int_sum(mrb_state *mrb, mrb_value self)
+{
+    IntVec *a = vec_get<IntTraits>(mrb, self);
+    return IntTraits::box(mrb, num_i64_sum(a->ptr, a->len));
+}
+
+static mrb_value int_min(mrb_state *mrb, mrb_value self)
+{
+    IntVec *a = vec_get<IntTraits>(mrb, self);
+    return a->len ? IntTraits::box(mrb, num_i64_min(a->ptr, a->len)) : mrb_value::nil();
+}
+
+static mrb_value int_max(mrb_state *mrb, mrb_value self)
+{
+    IntVec *a = vec_get<IntTraits>(mrb, self);
+    return a->len ? IntTraits::box(mrb, num_i64_max(a->ptr, a->len)) : mrb_value::nil();
+}
+
+static mrb_value int_dot(mrb_state *mrb, mrb_value self)
+{
+    mrb_value other = mrb->get_arg<mrb_value>();
+
+    if (!is_int_array(other))
+        return float_dot_with(mrb, float_view(mrb, self), other);
+    IntVec *a = vec_get<IntTraits>(mrb, self), *b = vec_get<IntTraits>(mrb, other);
+    check_same_len(mrb, a, b);
+    return IntTraits::box(mrb, num_i64_dot(a->ptr, b->ptr, a->len));
+}
+
+static mrb_value int_to_f(mrb_state *mrb, mrb_value self)
+{
+    return float_view(mrb, self);
+}
+
+static mrb_value float_to_i(mrb_state *mrb, mrb_value self)
+{
+    FloatVec *a = vec_get<FloatTraits>(mrb, self);
+    IntVec *d;
+    mrb_value res = vec_new<IntTraits>(mrb, a->len, &d);
+
+    for (mrb_int i = 0; i < a->len; i++) {
+        double x = a->ptr[i];
+        /* 2**63 is exact as a double; NaN fails both comparisons */
+        if (!(x > -9223372036854775808.0 - 1024 && x < 9223372036854775808.0)) {
+            mrb->mrb_raisef(E_RANGE_ERROR, "%S out of range of integer", mrb_float_value(x));
+        }
+        d->ptr[i] = (int64_t)x;
+    }
+    return res;
+}
+
+static mrb_value float_to_f(mrb_state *, mrb_value self)
+{
+    return self;
+}
+
+static mrb_value int_to_i(mrb_state *, mrb_value self)
+{
+    return self;
+}
+
+typedef double (*unary_fn)(double);
+
+/* Math module functions that map(:name) runs without calling back into Ruby */
+static unary_fn math_unary(mrb_state *mrb, mrb_sym name)
+{
+    static const struct { const char *name; unary_fn fn; } table[] = {
+        {"sin", ::sin}, {"cos", ::cos}, {"tan", ::tan},
+        {"asin", ::asin}, {"acos", ::acos}, {"atan", ::atan},
+        {"sinh", ::sinh}, {"cosh", ::cosh}, {"tanh", ::tanh},
+        {"asinh", ::asinh}, {"acosh", ::acosh}, {"atanh", ::atanh},
+        {"exp", ::exp}, {"log", ::log}, {"log2", ::log2}, {"log10", ::log10},
+        {"sqrt", ::sqrt}, {"cbrt", ::cbrt}, {"erf", ::erf}, {"erfc", ::erfc},
+    };
+    size_t len;
+    const char *s = mrb_sym2name_len(mrb, name, len);
+
+    for (size_t i = 0; i < sizeof(table)/sizeof(table[0]); i++) {
+        if (strlen(table[i].name) == len && memcmp(table[i].name, s, len) == 0)
+            return table[i].fn;
+    }
+    return nullptr;
+}
+
+/*
+ *  call-seq:
+ *     num_array.map(:sqrt)       -> float_array
+ *     num_array.map { |x| ... }  -> num_array
+ *
+ *  With a symbol, applies the Math module function of that name to every
+ *  element and returns a FloatArray. With a block, returns a vector of the
+ *  receiver's class holding the block's results.
+ */
+template <class Tr>
+static mrb_value vec_map(mrb_state *mrb, mrb_value self)
+{
+    typedef typename Tr::elem T;
+    mrb_sym name;
+    mrb_value blk;
+
+    /* new objects stay in the GC arena until we return, which keeps res alive */
+    if (mrb_get_args(mrb, "|n&", &name, &blk) == 0) {
+        if (blk.is_nil()) {
+            mrb->mrb_raise(E_ARGUMENT_ERROR, "no block given");
+        }
+        NumVec<T> *d;
+        mrb_int len = vec_get<Tr>(mrb, self)->len;
+        mrb_value res = vec_new<Tr>(mrb, len, &d);
+        int ai = mrb->gc().arena_save();
+        /* the block may shrink or replace the receiver */
+        for (mrb_int i = 0; i < len; i++) {
+            NumVec<T> *v = vec_get<Tr>(mrb, self);
+            mrb_value x = mrb_yield(mrb, blk, i < v->len ? Tr::box(mrb, v->ptr[i]) : mrb_value::nil());
+            d->ptr[i] = Tr::unbox(mrb, x);
+            mrb->gc().arena_restore(ai);
+        }
+        return res;
+    }
+
+    mrb_value src = float_view(mrb, self);
+    FloatVec *a = vec_get<FloatTraits>(mrb, src), *d;
+    mrb_value res = vec_new<FloatTraits>(mrb, a->len, &d);
+    if (unary_fn fn = math_unary(mrb, name)) {
+        for (mrb_int i = 0; i < a->len; i++)
+            d->ptr[i] = fn(a->ptr[i]);
+        return res;
+    }
+    /* any other Math function goes through a regular call */
+    mrb_value math = mrb->class_get("Math")->wrap();
+    int ai = mrb->gc().arena_save();
+    for (mrb_int i = 0; i < a->len; i++) {
+        mrb_value x = mrb_float_value(a->ptr[i]);
+        d->ptr[i] = FloatTraits::unbox(mrb, mrb_funcall_argv(mrb, math, name, 1, &x));
+        mrb->gc().arena_restore(ai);
+    }
+    return res;
+}
+
+template <class Tr>
+static RClass &define_vec_methods(RClass &c)
+{
+    return c.instance_tt(MRB_TT_DATA)
+            .define_method("initialize",      vec_initialize<Tr>, MRB_ARGS_ARG(1, 1))
+            .define_method("initialize_copy", vec_init_copy<Tr>,  MRB_ARGS_REQ(1))
+            .define_method("size",            vec_size<Tr>,       MRB_ARGS_NONE())
+            .define_method("length",          vec_size<Tr>,       MRB_ARGS_NONE())
+            .define_method("[]",              vec_aref<Tr>,       MRB_ARGS_REQ(1))
+            .define_method("[]=",             vec_aset<Tr>,       MRB_ARGS_REQ(2))
+            .define_method("to_a",            vec_to_a<Tr>,       MRB_ARGS_NONE())
+            .define_method("each",            vec_each<Tr>,       MRB_ARGS_BLOCK())
+            .define_method("map",             vec_map<Tr>,        MRB_ARGS_OPT(1) | MRB_ARGS_BLOCK())
+            .define_method("inspect",         vec_inspect<Tr>,    MRB_ARGS_NONE())
+            .define_alias("to_s", "inspect")
+            .define_method("==",              vec_equal<Tr>,      MRB_ARGS_REQ(1))
+            ;
+}
+
+void mrb_mruby_numarray_gem_init(mrb_state *mrb)
+{
+    define_vec_methods<FloatTraits>(mrb->define_class("FloatArray", mrb->object_class))
+            .define_method("+",    float_arith<NUM_ADD>,   MRB_ARGS_REQ(1))
+            .define_method("-",    float_arith<NUM_SUB>,   MRB_ARGS_REQ(1))
+            .define_method("*",    float_arith<NUM_MUL>,   MRB_ARGS_REQ(1))
+            .define_method("/",    float_arith<NUM_DIV>,   MRB_ARGS_REQ(1))
+            .define_method("lt",   float_compare<NUM_LT>,  MRB_ARGS_REQ(1))
+            .define_method("le",   float_compare<NUM_LE>,  MRB_ARGS_REQ(1))
+            .define_method("gt",   float_compare<NUM_GT>,  MRB_ARGS_REQ(1))
+            .define_method("ge",   float_compare<NUM_GE>,  MRB_ARGS_REQ(1))
+            .define_method("eq",   float_compare<NUM_EQ>,  MRB_ARGS_REQ(1))
+            .define_method("sum",  float_sum,              MRB_ARGS_NONE())
+            .define_method("min",  float_min,              MRB_ARGS_NONE())
+            .define_method("max",  float_max,              MRB_ARGS_NONE())
+            .define_method("dot",  float_dot,              MRB_ARGS_REQ(1))
+            .define_method("to_f", float_to_f,             MRB_ARGS_NONE())
+            .define_method("to_i", float_to_i,             MRB_ARGS_NONE())
+            ;
+    define_vec_methods<IntTraits>(mrb->define_class("IntArray", mrb->object_class))
+            .define_method("+",    int_arith<NUM_ADD>,     MRB_ARGS_REQ(1))
+            .define_method("-",    int_arith<NUM_SUB>,     MRB_ARGS_REQ(1))
+            .define_method("*",    int_arith<NUM_MUL>,     MRB_ARGS_REQ(1))
+            .define_method("/",    int_arith<NUM_DIV>,     MRB_ARGS_REQ(1))
+            .define_method("lt",   int_compare<NUM_LT>,    MRB_ARGS_REQ(1))
+            .define_method("le",   int_compare<NUM_LE>,    MRB_ARGS_REQ(1))
+            .define_method("gt",   int_compare<NUM_GT>,    MRB_ARGS_REQ(1))
+            .define_method("ge",   int_compare<NUM_GE>,    MRB_ARGS_REQ(1))
+            .define_method("eq",   int_compare<NUM_EQ>,    MRB_ARGS_REQ(1))
+            .define_method("sum",  int_sum,                MRB_ARGS_NONE())
+            .define_method("min",  int_min,                MRB_ARGS_NONE())
+            .define_method("max",  int_max,                MRB_ARGS_NONE())
+            .define_method("dot",  int_dot,                MRB_ARGS_REQ(1))
+            .define_method("to_f", int_to_f,               MRB_ARGS_NONE())
+            .define_method("to_i", int_to_i,               MRB_ARGS_NONE())
+            ;
+}
+
+void mrb_mruby_numarray_gem_final(mrb_state *mrb)
+{
+}
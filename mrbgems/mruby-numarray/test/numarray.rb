@@ -0,0 +1,81 @@
+##
+# FloatArray / IntArray Test
+
+assert('FloatArray.new') do
+  assert_equal [0.0, 0.0, 0.0], FloatArray.new(3).to_a
+  assert_equal [1.5, 1.5], FloatArray.new(2, 1.5).to_a
+  assert_equal [1.0, 2.5], FloatArray.new([1, 2.5]).to_a
+  assert_raise(TypeError) { FloatArray.new(["a"]) }
+  assert_raise(TypeError) { IntArray.new([1.5]) }
+end
+
+assert('FloatArray#[] and #[]=') do
+  a = FloatArray.new([1, 2, 3])
+  assert_equal 3, a.size
+  assert_equal 3.0, a[-1]
+  assert_nil a[3]
+  a[1] = 7
+  assert_equal 7.0, a[1]
+  assert_raise(IndexError) { a[3] = 1 }
+end
+
+assert('FloatArray arithmetic') do
+  a = FloatArray.new([1, 2, 3, 4, 5])
+  b = FloatArray.new([5, 4, 3, 2, 1])
+  assert_equal [6.0, 6.0, 6.0, 6.0, 6.0], (a + b).to_a
+  assert_equal [-4.0, -2.0, 0.0, 2.0, 4.0], (a - b).to_a
+  assert_equal [2.0, 4.0, 6.0, 8.0, 10.0], (a * 2).to_a
+  assert_equal [0.5, 1.0, 1.5, 2.0, 2.5], (a / 2).to_a
+  assert_equal FloatArray.new([2, 4, 6, 8, 10]), a + IntArray.new([1, 2, 3, 4, 5])
+  assert_raise(ArgumentError) { a + FloatArray.new(2) }
+  assert_raise(TypeError) { a + [1, 2, 3, 4, 5] }
+end
+
+assert('FloatArray reductions') do
+  a = FloatArray.new((1..11).to_a)
+  assert_equal 66.0, a.sum
+  assert_equal 1.0, a.min
+  assert_equal 11.0, a.max
+  assert_equal 506.0, a.dot(a)
+  assert_nil FloatArray.new(0).min
+  assert_true FloatArray.new([1, 0.0 / 0.0, 3]).max.nan?
+end
+
+assert('FloatArray comparisons') do
+  a = FloatArray.new([1, 2, 3, 4, 5])
+  assert_equal [1, 1, 0, 0, 0], a.lt(3).to_a
+  assert_equal [0, 0, 1, 1, 1], a.ge(3).to_a
+  assert_equal [0, 0, 1, 0, 0], a.eq(FloatArray.new([5, 4, 3, 2, 1])).to_a
+  assert_equal 2, a.gt(3).sum
+end
+
+assert('FloatArray#map') do
+  a = FloatArray.new([1, 4, 9])
+  assert_equal [1.0, 2.0, 3.0], a.map(:sqrt).to_a
+  assert_equal [2.0, 5.0, 10.0], a.map {|x| x + 1 }.to_a
+  assert_equal FloatArray, IntArray.new([0]).map(:exp).class
+end
+
+assert('IntArray') do
+  a = IntArray.new([3, 1, 4, 1, 5, 9, 2, 6])
+  assert_equal 31, a.sum
+  assert_equal 1, a.min
+  assert_equal 9, a.max
+  assert_equal [4, 2, 5, 2, 6, 10, 3, 7], (a + 1).to_a
+  assert_equal [9, 1, 16, 1, 25, 81, 4, 36], (a * a).to_a
+  assert_equal [0, 0, 1, 0, 1, 1, 0, 1], a.gt(3).to_a
+  assert_equal FloatArray.new([1.5, 0.5, 2, 0.5, 2.5, 4.5, 1, 3]), a / 2
+  assert_equal FloatArray, (a + 0.5).class
+  assert_equal 173, a.dot(a)
+  assert_equal [3, 1], IntArray.new([3.9, 1.2].map {|x| x.to_i }).to_a
+  assert_equal [3, -1], FloatArray.new([3.9, -1.2]).to_i.to_a
+end
+
+assert('FloatArray#inspect and #dup') do
+  a = FloatArray.new([1, 2])
+  assert_equal "FloatArray[1.0, 2.0]", a.inspect
+  b = a.dup
+  b[0] = 5
+  assert_equal 1.0, a[0]
+  assert_equal "IntArray[1, 2]", IntArray.new([1, 2]).inspect
+end
@@ -8,219 +8,374 @@
 #include "mruby/variable.h"
 #include "mruby/data.h"
 #include "mruby/class.h"
+#include "mruby/array.h"
+#include "mruby/string.h"
+#include "mruby/range.h"
 #include "mt19937ar.h"
+#include "xoshiro256.h"
 
+#include <string.h>
 #include <time.h>
+#include <utility>
 
-#define GLOBAL_RAND_SEED_KEY          "$mrb_g_rand_seed"
-#define GLOBAL_RAND_SEED_KEY_CSTR_LEN 16
-#define INSTANCE_RAND_SEED_KEY          "$mrb_i_rand_seed"
-#define INSTANCE_RAND_SEED_KEY_CSTR_LEN 16
-#define MT_STATE_KEY            "$mrb_i_mt_state"
+/* Kernel#rand and friends use a Random object kept per mrb_state in this global */
+#define GLOBAL_RAND_KEY         "$mrb_g_rand"
+#define INSTANCE_RAND_SEED_KEY  "$mrb_i_rand_seed"
+#define RAND_STATE_KEY          "$mrb_i_rand_state"
 
-static void mt_state_free(mrb_state *mrb, void *p)
+enum rand_engine {
+    RAND_MT19937,
+    RAND_XOSHIRO256
+};
+
+struct rand_state {
+    rand_engine engine;
+    union {
+        mt_state mt;
+        xoshiro_state xs;
+    };
+};
+
+static void rand_state_free(mrb_state *mrb, void *p)
 {
     mrb->gc()._free(p);
 }
 
-static const struct mrb_data_type mt_state_type = {
-    MT_STATE_KEY, mt_state_free,
+static const struct mrb_data_type rand_state_type = {
+    RAND_STATE_KEY, rand_state_free,
 };
 
-static void mt_g_srand(unsigned long seed)
+static void rand_seed(rand_state *t, unsigned long seed)
 {
-    init_genrand(seed);
+    if (t->engine == RAND_MT19937)
+        mrb_random_init_genrand(&t->mt, seed);
+    else
+        mrb_random_xoshiro_init(&t->xs, seed);
 }
 
-static unsigned long mt_g_rand()
+static inline uint32_t rand_u32(rand_state *t)
 {
-    return genrand_int32();
+    if (t->engine == RAND_MT19937)
+        return (uint32_t)mrb_random_genrand_int32(&t->mt);
+    return (uint32_t)(mrb_random_xoshiro_next(&t->xs) >> 32);
 }
 
-static double mt_g_rand_real()
+/* MT19937 keeps its [0,1] results so seeded scripts see the same numbers */
+static inline double rand_real(rand_state *t)
 {
-    return genrand_real1();
+    if (t->engine == RAND_MT19937)
+        return mrb_random_genrand_real1(&t->mt);
+    return (mrb_random_xoshiro_next(&t->xs) >> 11) * (1.0 / 9007199254740992.0);
 }
 
-static mrb_value mrb_random_mt_g_srand(mrb_state *mrb, mrb_value seed)
+/* returns a value in [0, n), n > 0 */
+static inline uint32_t rand_below(rand_state *t, uint32_t n)
 {
-    if (seed.is_nil()) {
-        seed = mrb_fixnum_value(time(NULL) + mt_g_rand());
-        if (mrb_fixnum(seed) < 0) {
-            seed = mrb_fixnum_value( 0 - mrb_fixnum(seed));
-        }
+    if (t->engine == RAND_MT19937)
+        return rand_u32(t) % n;
+
+    /* Lemire's multiply-shift, rejecting the few products that would bias it */
+    uint64_t m = (uint64_t)rand_u32(t) * n;
+    if ((uint32_t)m < n) {
+        uint32_t threshold = -n % n;
+        while ((uint32_t)m < threshold)
+            m = (uint64_t)rand_u32(t) * n;
     }
+    return (uint32_t)(m >> 32);
+}
 
-    mt_g_srand((unsigned) mrb_fixnum(seed));
-
-    return seed;
+static rand_engine get_engine(mrb_state *mrb, mrb_sym name)
+{
+    size_t len;
+    const char *s = mrb_sym2name_len(mrb, name, len);
+
+    if (len == 7 && !memcmp(s, "mt19937", 7))
+        return RAND_MT19937;
+    if (len == 10 && !memcmp(s, "xoshiro256", 10))
+        return RAND_XOSHIRO256;
+    mrb->mrb_raisef(E_ARGUMENT_ERROR, "unknown random engine %S", mrb_sym2str(mrb, name));
+    return RAND_MT19937; /* not reached */
 }
 
-static mrb_value mrb_random_mt_g_rand(mrb_state *mrb, mrb_value max)
+static rand_state *get_rand_state(mrb_state *mrb, mrb_value random)
 {
-    mrb_value value;
+    rand_state *t = DATA_GET_PTR(mrb, random, &rand_state_type, rand_state);
 
-    if (mrb_fixnum(max) == 0) {
-        value = mrb_float_value(mt_g_rand_real());
-    } else {
-        value = mrb_fixnum_value(mt_g_rand() % mrb_fixnum(max));
+    if (!t) {
+        mrb->mrb_raise(E_TYPE_ERROR, "expected an initialized Random");
     }
-
-    return value;
+    return t;
 }
 
-static void mt_srand(mt_state *t, unsigned long seed)
+static rand_state *get_default_state(mrb_state *mrb)
 {
-    mrb_random_init_genrand(t, seed);
+    return get_rand_state(mrb, mrb->mrb_gv_get(mrb_intern_lit(mrb, GLOBAL_RAND_KEY)));
 }
 
-static unsigned long mt_rand(mt_state *t)
+static rand_state *get_rand_arg(mrb_state *mrb, mrb_value random)
 {
-    return mrb_random_genrand_int32(t);
+    if (random.is_nil())
+        return get_default_state(mrb);
+    return get_rand_state(mrb, random);
 }
 
-static double mt_rand_real(mt_state *t)
+static mrb_value get_opt(mrb_state* mrb)
 {
-    return mrb_random_genrand_real1(t);
+    mrb_value arg = mrb_fixnum_value(0);
+    mrb_get_args(mrb, "|o", &arg);
+
+    if (!arg.is_nil()) {
+        if (!arg.is_fixnum()) {
+            mrb->mrb_raise(E_ARGUMENT_ERROR, "invalid argument type");
+        }
+        arg = mrb_check_convert_type(mrb, arg, MRB_TT_FIXNUM, "Fixnum", "to_int");
+        if (mrb_fixnum(arg) < 0) {
+            arg = mrb_fixnum_value(0 - mrb_fixnum(arg));
+        }
+    }
+    return arg;
 }
 
-static mrb_value mrb_random_mt_srand(mrb_state *mrb, mt_state *t, mrb_value seed)
+/* reseeds t from seed (nil picks one) and records the seed on self; returns the old seed */
+static mrb_value random_srand(mrb_state *mrb, mrb_value self, rand_state *t, mrb_value seed)
 {
+    mrb_sym seed_key = mrb_intern_lit(mrb, INSTANCE_RAND_SEED_KEY);
+    mrb_value old_seed = self.mrb_iv_get(seed_key);
+
     if (seed.is_nil()) {
-        seed = mrb_fixnum_value(time(NULL) + mt_rand(t));
-        if (mrb_fixnum(seed) < 0) {
-            seed = mrb_fixnum_value( 0 - mrb_fixnum(seed));
-        }
+        uint64_t x = (uint64_t)time(NULL) ^ ((uint64_t)clock() << 32) ^ (uint64_t)(uintptr_t)t;
+        x = (x ^ (x >> 33)) * 0xff51afd7ed558ccdULL;
+        seed = mrb_fixnum_value((mrb_int)((x ^ (x >> 33)) & 0x7fffffff));
+    }
+    else if (!seed.is_fixnum()) {
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "invalid argument type");
+    }
+    else if (mrb_fixnum(seed) < 0) {
+        seed = mrb_fixnum_value(0 - mrb_fixnum(seed));
     }
+    rand_seed(t, (unsigned) mrb_fixnum(seed));
+    mrb_iv_set(mrb, self, seed_key, seed);
+    return old_seed;
+}
 
-    mt_srand(t, (unsigned) mrb_fixnum(seed));
+static mrb_value random_rand(mrb_state *mrb, rand_state *t)
+{
+    mrb_value max = get_opt(mrb);
 
-    return seed;
+    if (max.is_nil() || mrb_fixnum(max) == 0)
+        return mrb_float_value(rand_real(t));
+    return mrb_fixnum_value(rand_below(t, mrb_fixnum(max)));
 }
 
-static mrb_value mrb_random_mt_rand(mrb_state *mrb, mt_state *t, mrb_value max)
+static mrb_value random_bytes(mrb_state *mrb, rand_state *t)
 {
-    mrb_value value;
+    mrb_int len = mrb->get_arg<mrb_int>();
+    mrb_int i = 0;
 
-    if (mrb_fixnum(max) == 0) {
-        value = mrb_float_value(mt_rand_real(t));
-    } else {
-        value = mrb_fixnum_value(mt_rand(t) % mrb_fixnum(max));
+    if (len < 0) {
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "negative string size");
+    }
+    RString *str = RString::create(mrb, nullptr, len);
+    unsigned char *p = (unsigned char *)str->m_ptr;
+    if (t->engine == RAND_XOSHIRO256) {
+        for (; i + 8 <= len; i += 8) {
+            uint64_t v = mrb_random_xoshiro_next(&t->xs);
+            for (int k = 0; k < 8; k++, v >>= 8)
+                p[i + k] = (unsigned char)v;
+        }
+    }
+    else {
+        for (; i + 4 <= len; i += 4) {
+            uint32_t v = rand_u32(t);
+            for (int k = 0; k < 4; k++, v >>= 8)
+                p[i + k] = (unsigned char)v;
+        }
+    }
+    if (i < len) {
+        uint32_t v = rand_u32(t);
+        for (; i < len; i++, v >>= 8)
+            p[i] = (unsigned char)v;
     }
+    return str->wrap();
+}
 
-    return value;
+static double num_to_dbl(mrb_state *mrb, mrb_value v)
+{
+    if (v.is_fixnum())
+        return (double)mrb_fixnum(v);
+    if (v.is_float())
+        return mrb_float(v);
+    mrb->mrb_raise(E_ARGUMENT_ERROR, "invalid argument type");
+    return 0.0; /* not reached */
 }
 
-static mrb_value get_opt(mrb_state* mrb)
+static mrb_value random_rand_array(mrb_state *mrb, rand_state *t)
 {
-    mrb_value arg = mrb_fixnum_value(0);
-    mrb_get_args(mrb, "|o", &arg);
+    mrb_int len, i;
+    mrb_value max = mrb_value::nil();
 
-    if (!arg.is_nil()) {
-        if (!arg.is_fixnum()) {
-            mrb->mrb_raise(E_ARGUMENT_ERROR, "invalid argument type");
+    mrb_get_args(mrb, "i|o", &len, &max);
+    if (len < 0) {
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "negative array size");
+    }
+    RArray *ary = RArray::create(mrb, len);
+    mrb_value *ptr = ary->m_ptr;
+    if (max.is_fixnum() && mrb_fixnum(max) != 0) {
+        uint32_t n = (uint32_t)(mrb_fixnum(max) < 0 ? 0 - mrb_fixnum(max) : mrb_fixnum(max));
+        for (i = 0; i < len; i++)
+            ptr[i] = mrb_fixnum_value(rand_below(t, n));
+    }
+    else if (max.is_float()) {
+        double scale = mrb_float(max);
+        for (i = 0; i < len; i++)
+            ptr[i] = mrb_float_value(rand_real(t) * scale);
+    }
+    else if (mrb_type(max) == MRB_TT_RANGE) {
+        RRange *r = mrb_range_ptr(max);
+        if (r->edges->beg.is_fixnum() && r->edges->end.is_fixnum()) {
+            mrb_int beg = mrb_fixnum(r->edges->beg);
+            int64_t span = (int64_t)mrb_fixnum(r->edges->end) - beg + (r->excl ? 0 : 1);
+            if (span <= 0) {
+                mrb->mrb_raise(E_ARGUMENT_ERROR, "invalid range");
+            }
+            for (i = 0; i < len; i++) {
+                /* only the full 32-bit range has a span that does not fit */
+                uint32_t off = span > UINT32_MAX ? rand_u32(t) : rand_below(t, (uint32_t)span);
+                ptr[i] = mrb_fixnum_value((mrb_int)(beg + off));
+            }
         }
-        arg = mrb_check_convert_type(mrb, arg, MRB_TT_FIXNUM, "Fixnum", "to_int");
-        if (mrb_fixnum(arg) < 0) {
-            arg = mrb_fixnum_value(0 - mrb_fixnum(arg));
+        else {
+            double beg = num_to_dbl(mrb, r->edges->beg);
+            double width = num_to_dbl(mrb, r->edges->end) - beg;
+            for (i = 0; i < len; i++)
+                ptr[i] = mrb_float_value(beg + rand_real(t) * width);
         }
     }
-    return arg;
+    else if (max.is_nil() || max.is_fixnum()) {
+        for (i = 0; i < len; i++)
+            ptr[i] = mrb_float_value(rand_real(t));
+    }
+    else {
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "invalid argument type");
+    }
+    ary->m_len = len;
+    return ary->wrap();
 }
 
 static mrb_value mrb_random_g_rand(mrb_state *mrb, mrb_value self)
 {
-    mrb_value max;
-    mrb_value seed;
-
-    max = get_opt(mrb);
-    seed = mrb->mrb_gv_get(mrb->intern2(GLOBAL_RAND_SEED_KEY,GLOBAL_RAND_SEED_KEY_CSTR_LEN));
-    if (seed.is_nil()) {
-        mrb_random_mt_g_srand(mrb, mrb_value::nil());
-    }
-    return mrb_random_mt_g_rand(mrb, max);
+    return random_rand(mrb, get_default_state(mrb));
 }
 
 static mrb_value mrb_random_g_srand(mrb_state *mrb, mrb_value self)
 {
-    mrb_value seed;
-    mrb_value old_seed;
-
-    seed = get_opt(mrb);
-    seed = mrb_random_mt_g_srand(mrb, seed);
-    mrb_sym glob_randseed=mrb->intern2(GLOBAL_RAND_SEED_KEY,GLOBAL_RAND_SEED_KEY_CSTR_LEN);
-    old_seed = mrb->mrb_gv_get(glob_randseed);
-    mrb->gv_set(glob_randseed, seed);
-    return old_seed;
+    mrb_value seed = mrb_value::nil();
+    mrb_value random = mrb->mrb_gv_get(mrb_intern_lit(mrb, GLOBAL_RAND_KEY));
+
+    mrb_get_args(mrb, "|o", &seed);
+    return random_srand(mrb, random, get_rand_state(mrb, random), seed);
 }
 
-static mrb_value mrb_random_init(mrb_state *mrb, mrb_value self)
+/*
+ *  call-seq:
+ *     Random.bytes(n)   ->   string
+ *
+ *  Returns a string of n random bytes from the default generator.
+ */
+static mrb_value mrb_random_g_bytes(mrb_state *mrb, mrb_value self)
 {
-    mrb_value seed;
-    mt_state *t;
+    return random_bytes(mrb, get_default_state(mrb));
+}
 
-    DATA_TYPE(self) = &mt_state_type;
-    DATA_PTR(self) = NULL;
+/*
+ *  call-seq:
+ *     Random.rand_array(n, max = nil)   ->   array
+ *
+ *  Same as Random#rand_array, using the default generator.
+ */
+static mrb_value mrb_random_g_rand_array(mrb_state *mrb, mrb_value self)
+{
+    return random_rand_array(mrb, get_default_state(mrb));
+}
+
+static mrb_value random_new(mrb_state *mrb, RClass *cls, rand_engine engine, mrb_value seed)
+{
+    rand_state *t = (rand_state *)mrb->gc()._malloc(sizeof(rand_state));
+    t->engine = engine;
+    mrb_value self = mrb_value::wrap(RData::object_alloc(mrb, cls, t, &rand_state_type));
+    random_srand(mrb, self, t, seed);
+    return self;
+}
+
+/*
+ *  call-seq:
+ *     Random.new(seed = nil, engine = :mt19937)   ->   random
+ *
+ *  Creates a generator. Without a seed one is picked from the clock.
+ *  The engine is either :mt19937 or the faster :xoshiro256.
+ */
+static mrb_value mrb_random_init(mrb_state *mrb, mrb_value self)
+{
+    mrb_value seed = mrb_value::nil();
+    mrb_sym engine = 0;
+    rand_state *t;
 
+    mrb_get_args(mrb, "|on", &seed, &engine);
     /* avoid memory leaks */
-    t = (mt_state*)DATA_PTR(self);
-    if (t) {
-        mrb->gc()._free(t);
+    if (DATA_TYPE(self) == &rand_state_type && DATA_PTR(self)) {
+        mrb->gc()._free(DATA_PTR(self));
     }
-    t = (mt_state *)mrb->gc()._malloc(sizeof(mt_state));
-    t->mti = N + 1;
+    DATA_TYPE(self) = &rand_state_type;
+    DATA_PTR(self) = NULL;
 
-    seed = get_opt(mrb);
-    seed = mrb_random_mt_srand(mrb, t, seed);
-    mrb_iv_set(mrb, self, mrb->intern2(INSTANCE_RAND_SEED_KEY,INSTANCE_RAND_SEED_KEY_CSTR_LEN), seed);
+    t = (rand_state *)mrb->gc()._malloc(sizeof(rand_state));
+    t->engine = engine ? get_engine(mrb, engine) : RAND_MT19937;
     DATA_PTR(self) = t;
+    random_srand(mrb, self, t, seed);
     return self;
 }
-static void mrb_random_rand_seed(mrb_state *mrb, mrb_value self)
-{
-    mrb_value seed;
-    mt_state *t = (mt_state *)DATA_PTR(self);
 
-    seed = self.mrb_iv_get(mrb->intern2(INSTANCE_RAND_SEED_KEY, INSTANCE_RAND_SEED_KEY_CSTR_LEN));
-    if (seed.is_nil()) {
-        mrb_random_mt_srand(mrb, t, mrb_value::nil());
-    }
-}
 static mrb_value mrb_random_rand(mrb_state *mrb, mrb_value self)
 {
-    mrb_value max;
-    mt_state *t = (mt_state *)DATA_PTR(self);
-    max = get_opt(mrb);
-    mrb_random_rand_seed(mrb, self);
-    return mrb_random_mt_rand(mrb, t, max);
+    return random_rand(mrb, get_rand_state(mrb, self));
 }
 
 static mrb_value mrb_random_srand(mrb_state *mrb, mrb_value self)
 {
-    mrb_value seed;
-    mrb_value old_seed;
-    mt_state *t = (mt_state *)DATA_PTR(self);
-
-    seed = get_opt(mrb);
-    seed = mrb_random_mt_srand(mrb, t, seed);
-    mrb_sym sym_seed_key = mrb->intern2(INSTANCE_RAND_SEED_KEY,INSTANCE_RAND_SEED_KEY_CSTR_LEN);
-    old_seed = self.mrb_iv_get(sym_seed_key);
-    mrb_iv_set(mrb, self, sym_seed_key, seed);
-    return old_seed;
+    mrb_value seed = mrb_value::nil();
+
+    mrb_get_args(mrb, "|o", &seed);
+    return random_srand(mrb, self, get_rand_state(mrb, self), seed);
 }
-static void
-mrb_random_g_rand_seed(mrb_state *mrb)
+
+/*
+ *  call-seq:
+ *     random.bytes(n)   ->   string
+ *
+ *  Returns a string of n random bytes.
+ */
+static mrb_value mrb_random_bytes(mrb_state *mrb, mrb_value self)
 {
-    mrb_value seed;
+    return random_bytes(mrb, get_rand_state(mrb, self));
+}
 
-    seed = mrb->mrb_gv_get(mrb->intern2(GLOBAL_RAND_SEED_KEY, GLOBAL_RAND_SEED_KEY_CSTR_LEN));
-    if (seed.is_nil()) {
-        mrb_random_mt_g_srand(mrb, mrb_value::nil());
-    }
+/*
+ *  call-seq:
+ *     random.rand_array(n)          ->   array of floats in [0, 1]
+ *     random.rand_array(n, max)     ->   array of integers in [0, max)
+ *     random.rand_array(n, range)   ->   array of numbers in range
+ *
+ *  Fills a new array with n random numbers in one call. A Float max or a
+ *  range with a Float end gives floats.
+ */
+static mrb_value mrb_random_rand_array(mrb_state *mrb, mrb_value self)
+{
+    return random_rand_array(mrb, get_rand_state(mrb, self));
 }
+
 /*
  *  call-seq:
- *     ary.shuffle!   ->   ary
+ *     ary.shuffle!(random = nil)   ->   ary
  *
  *  Shuffles elements in self in place.
  */
@@ -229,26 +384,16 @@ static mrb_value
 mrb_ary_shuffle_bang(mrb_state *mrb, mrb_value ary)
 {
     mrb_int i;
-    mrb_value seed;
     RArray *arr_p = mrb_ary_ptr(ary);
     mrb_value random = mrb_value::nil();
+
+    mrb_get_args(mrb, "|o", &random);
+    rand_state *t = get_rand_arg(mrb, random);
     if (arr_p->m_len > 1) {
-        mrb_get_args(mrb, "|o", &random);
-        if( random.is_nil() ) {
-            mrb_random_g_rand_seed(mrb);
-        } else {
-            mrb_data_check_type(mrb, random, &mt_state_type);
-            mrb_random_rand_seed(mrb, random);
-        }
         arr_p->mrb_ary_modify();
+        mrb_value *ptr = arr_p->m_ptr;
         for (i = arr_p->m_len - 1; i > 0; i--)  {
-            mrb_int j;
-            if( random.is_nil() ) {
-                j = mrb_fixnum(mrb_random_mt_g_rand(mrb, mrb_fixnum_value(arr_p->m_len)));
-            } else {
-                j = mrb_fixnum(mrb_random_mt_rand(mrb, (mt_state *)DATA_PTR(random), mrb_fixnum_value(arr_p->m_len)));
-            }
-            std::swap(arr_p->m_ptr[i],arr_p->m_ptr[j]);
+            std::swap(ptr[i], ptr[rand_below(t, i + 1)]);
         }
     }
 
@@ -257,7 +402,7 @@ mrb_ary_shuffle_bang(mrb_state *mrb, mrb_value ary)
 
 /*
  *  call-seq:
- *     ary.shuffle   ->   new_ary
+ *     ary.shuffle(random = nil)   ->   new_ary
  *
  *  Returns a new array with elements of self shuffled.
  */
@@ -271,25 +416,75 @@ mrb_ary_shuffle(mrb_state *mrb, mrb_value ary)
     return new_ary;
 }
 
+/*
+ *  call-seq:
+ *     ary.sample(random = nil)      ->   obj
+ *     ary.sample(n, random = nil)   ->   new_ary
+ *
+ *  Returns a random element, or n distinct elements, of self.
+ */
+
+static mrb_value
+mrb_ary_sample(mrb_state *mrb, mrb_value ary)
+{
+    mrb_value nv = mrb_value::nil();
+    mrb_value random = mrb_value::nil();
+    mrb_int i, n, len = RARRAY_LEN(ary);
+
+    mrb_get_args(mrb, "|oo", &nv, &random);
+    if (!nv.is_nil() && !nv.is_fixnum()) {
+        random = nv;
+        nv = mrb_value::nil();
+    }
+    rand_state *t = get_rand_arg(mrb, random);
+    if (nv.is_nil()) {
+        if (len == 0)
+            return mrb_value::nil();
+        return RARRAY_PTR(ary)[rand_below(t, len)];
+    }
+    n = mrb_fixnum(nv);
+    if (n < 0) {
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "negative sample number");
+    }
+    if (n > len)
+        n = len;
+    /* partial Fisher-Yates over a copy: only the first n slots are drawn */
+    RArray *pool = RArray::new_from_values(mrb, len, RARRAY_PTR(ary));
+    for (i = 0; i < n; i++) {
+        std::swap(pool->m_ptr[i], pool->m_ptr[i + rand_below(t, len - i)]);
+    }
+    return RArray::new_from_values(mrb, n, pool->m_ptr)->wrap();
+}
+
 void mrb_mruby_random_gem_init(mrb_state *mrb)
 {
     mrb->kernel_module->define_method("rand", mrb_random_g_rand, MRB_ARGS_OPT(1)).
             define_method("srand", mrb_random_g_srand, MRB_ARGS_OPT(1));
 
-    mrb->define_class("Random", mrb->object_class)
-            .instance_tt(MRB_TT_DATA)
+    RClass &random = mrb->define_class("Random", mrb->object_class);
+    random.instance_tt(MRB_TT_DATA)
             .define_class_method("rand", mrb_random_g_rand, MRB_ARGS_OPT(1))
             .define_class_method("srand", mrb_random_g_srand, MRB_ARGS_OPT(1))
-            .define_method("initialize", mrb_random_init, MRB_ARGS_OPT(1))
+            .define_class_method("bytes", mrb_random_g_bytes, MRB_ARGS_REQ(1))
+            .define_class_method("rand_array", mrb_random_g_rand_array, MRB_ARGS_ARG(1,1))
+            .define_method("initialize", mrb_random_init, MRB_ARGS_OPT(2))
             .define_method("rand", mrb_random_rand, MRB_ARGS_OPT(1))
             .define_method("srand", mrb_random_srand, MRB_ARGS_OPT(1))
-            .define_method("shuffle", mrb_ary_shuffle, MRB_ARGS_OPT(1))
+            .define_method("bytes", mrb_random_bytes, MRB_ARGS_REQ(1))
+            .define_method("rand_array", mrb_random_rand_array, MRB_ARGS_ARG(1,1))
+            .fin()
+            ;
+
+    mrb->array_class->define_method("shuffle", mrb_ary_shuffle, MRB_ARGS_OPT(1))
             .define_method("shuffle!", mrb_ary_shuffle_bang, MRB_ARGS_OPT(1))
+            .define_method("sample", mrb_ary_sample, MRB_ARGS_OPT(2))
             .fin()
             ;
+
+    mrb->gv_set(mrb_intern_lit(mrb, GLOBAL_RAND_KEY),
+                random_new(mrb, &random, RAND_MT19937, mrb_value::nil()));
 }
 
 void mrb_mruby_random_gem_final(mrb_state *mrb)
 {
 }
-
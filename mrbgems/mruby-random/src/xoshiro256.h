@@ -0,0 +1,45 @@
+/*
+** xoshiro256.h - xoshiro256** random functions
+**
+** See Copyright Notice in mruby.h
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+/* xoshiro256** by David Blackman and Sebastiano Vigna (public domain) */
+typedef struct {
+  uint64_t s[4];
+} xoshiro_state;
+
+static inline uint64_t xoshiro_rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+/* the state is expanded from the seed with splitmix64, so it is never all zero */
+static inline void mrb_random_xoshiro_init(xoshiro_state *t, uint64_t seed)
+{
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        t->s[i] = z ^ (z >> 31);
+    }
+}
+
+static inline uint64_t mrb_random_xoshiro_next(xoshiro_state *t)
+{
+    uint64_t *s = t->s;
+    const uint64_t result = xoshiro_rotl(s[1] * 5, 7) * 9;
+    const uint64_t u = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= u;
+    s[3] = xoshiro_rotl(s[3], 45);
+    return result;
+}
@@ -30,3 +30,38 @@ end
 assert("float") do
   rand.class == Float
 end
+
+assert("Random engines") do
+  r1 = Random.new(123, :xoshiro256)
+  r2 = Random.new(123, :xoshiro256)
+  a = r1.rand_array(100, 10)
+  assert_equal a, r2.rand_array(100, 10)
+  assert_true a.all? {|x| x >= 0 && x < 10 }
+  assert_raise(ArgumentError) { Random.new(1, :nope) }
+end
+
+assert("Random#bytes") do
+  r = Random.new(5, :xoshiro256)
+  assert_equal 13, r.bytes(13).size
+  assert_equal Random.new(5).bytes(7), Random.new(5).bytes(7)
+  assert_equal 0, Random.bytes(0).size
+end
+
+assert("Random#rand_array") do
+  r = Random.new(9)
+  assert_equal 50, r.rand_array(50).size
+  assert_true r.rand_array(50).all? {|x| x.class == Float }
+  assert_true r.rand_array(50, 3..5).all? {|x| x >= 3 && x <= 5 }
+  assert_true r.rand_array(50, 1.0...2.0).all? {|x| x >= 1.0 && x <= 2.0 }
+end
+
+assert("Array#shuffle and #sample") do
+  a = (1..20).to_a
+  assert_equal a, a.shuffle(Random.new(1)).sort
+  assert_equal a.shuffle(Random.new(2, :xoshiro256)), a.shuffle(Random.new(2, :xoshiro256))
+  s = a.sample(5)
+  assert_equal 5, s.uniq.size
+  assert_true s.all? {|x| a.include?(x) }
+  assert_true a.include?(a.sample)
+  assert_nil [].sample
+end
@@ -0,0 +1,209 @@
+##
+# Scheduler
+#
+# Cooperative fiber scheduler. Tasks are fibers kept on a run queue; a
+# task gives up the CPU with #pass, #sleep or by waiting on a file
+# descriptor, and #run drives all of them until none is left.
+#
+#   s = Scheduler.new
+#   s.spawn { s.sleep 0.1; puts "later" }
+#   s.spawn { puts "first" }
+#   s.run
+
+class Scheduler
+
+  def initialize
+    @ready = []    # [fiber, args] pairs to resume on the next pass
+    @timers = []   # binary heap of [deadline, seq, fiber]
+    @seq = 0
+    @readers = {}  # fd => fiber waiting for it to become readable
+    @writers = {}  # fd => fiber waiting for it to become writable
+    @poller = nil
+  end
+
+  ##
+  # Creates a task running the block and queues it; +args+ are passed to
+  # the block when it first runs.
+  def spawn(*args, &block)
+    raise ArgumentError, "tried to spawn a task without a block" unless block
+    fiber = Fiber.new(&block)
+    @ready.push [fiber, args]
+    fiber
+  end
+
+  ##
+  # Lets every other ready task run before the current one continues.
+  def pass
+    @ready.push [Fiber.current, nil]
+    Fiber.yield
+    nil
+  end
+
+  ##
+  # Suspends the current task for +sec+ seconds without blocking the
+  # others. Returns the time actually slept.
+  def sleep(sec)
+    start = Scheduler.monotonic
+    timer_push [start + sec, @seq += 1, Fiber.current]
+    Fiber.yield
+    Scheduler.monotonic - start
+  end
+
+  ##
+  # Suspends the current task until +fd+ can be read without blocking.
+  def wait_readable(fd)
+    wait_fd(@readers, fd)
+  end
+
+  ##
+  # Suspends the current task until +fd+ can be written without blocking.
+  def wait_writable(fd)
+    wait_fd(@writers, fd)
+  end
+
+  ##
+  # Reads up to +maxlen+ bytes from the non-blocking +fd+, suspending the
+  # task while nothing is available. Returns nil at end of file.
+  def read(fd, maxlen)
+    while true
+      data = Scheduler.fd_read(fd, maxlen)
+      return data unless data == false
+      wait_readable(fd)
+    end
+  end
+
+  ##
+  # Writes all of +str+ to the non-blocking +fd+, suspending the task
+  # whenever the fd is full. Returns the number of bytes written.
+  def write(fd, str)
+    len = str.size
+    while str.size > 0
+      n = Scheduler.fd_write(fd, str)
+      if n
+        str = str[n, str.size - n]
+      else
+        wait_writable(fd)
+      end
+    end
+    len
+  end
+
+  ##
+  # Runs tasks until the run queue, the timers and the fd waiters are all
+  # empty. Exceptions raised by a task propagate out of #run.
+  def run
+    while !@ready.empty? || !@timers.empty? || !@readers.empty? || !@writers.empty?
+      batch = @ready
+      @ready = []
+      batch.each do |task|
+        fiber = task[0]
+        args = task[1]
+        if args
+          fiber.resume(*args)
+        else
+          fiber.resume
+        end
+      end
+
+      # block only when nothing is runnable; otherwise just collect fd events
+      if @readers.empty? && @writers.empty?
+        timeout = @ready.empty? ? next_timeout : nil
+        poller.wait(timeout) if timeout && timeout > 0
+      else
+        poll(@ready.empty? ? next_timeout : 0)
+      end
+      expire_timers
+    end
+    self
+  end
+
+  private
+
+  def wait_fd(waiters, fd)
+    raise ArgumentError, "fd #{fd} already has a waiter" if waiters[fd]
+    waiters[fd] = Fiber.current
+    update_fd(fd)
+    Fiber.yield
+    nil
+  end
+
+  def update_fd(fd)
+    events = 0
+    events |= READABLE if @readers[fd]
+    events |= WRITABLE if @writers[fd]
+    poller.modify(fd, events)
+  end
+
+  def poller
+    @poller ||= Poller.new
+  end
+
+  def poll(timeout)
+    ready = poller.wait(timeout)
+    i = 0
+    while i < ready.size
+      fd = ready[i]
+      events = ready[i + 1]
+      if events & READABLE != 0
+        fiber = @readers.delete(fd)
+        @ready.push [fiber, nil] if fiber
+      end
+      if events & WRITABLE != 0
+        fiber = @writers.delete(fd)
+        @ready.push [fiber, nil] if fiber
+      end
+      update_fd(fd)
+      i += 2
+    end
+  end
+
+  # seconds until the earliest timer is due, or nil when there is none
+  def next_timeout
+    return nil if @timers.empty?
+    t = @timers[0][0] - Scheduler.monotonic
+    t < 0 ? 0 : t
+  end
+
+  def expire_timers
+    return if @timers.empty?
+    now = Scheduler.monotonic
+    while !@timers.empty? && @timers[0][0] <= now
+      @ready.push [timer_pop[2], nil]
+    end
+  end
+
+  def timer_less(a, b)
+    a[0] < b[0] || (a[0] == b[0] && a[1] < b[1])
+  end
+
+  def timer_push(timer)
+    h = @timers
+    i = h.size
+    h.push timer
+    while i > 0
+      parent = (i - 1) / 2
+      break unless timer_less(h[i], h[parent])
+      h[i], h[parent] = h[parent], h[i]
+      i = parent
+    end
+  end
+
+  def timer_pop
+    h = @timers
+    top = h[0]
+    last = h.pop
+    return top if h.empty?
+    h[0] = last
+    i = 0
+    n = h.size
+    while true
+      l = 2 * i + 1
+      break if l >= n
+      c = (l + 1 < n && timer_less(h[l + 1], h[l])) ? l + 1 : l
+      break unless timer_less(h[c], h[i])
+      h[i], h[c] = h[c], h[i]
+      i = c
+    end
+    top
+  end
+end
@@ -0,0 +1,351 @@
+/*
+** scheduler.cpp - Scheduler class
+**
+** Native half of the fiber scheduler: a monotonic clock, non-blocking pipe
+** and fd helpers, and Scheduler::Poller, a thin epoll wrapper. The run
+** queue, timers and fiber bookkeeping live in mrblib/scheduler.rb.
+**
+** See Copyright Notice in mruby.h
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+#include "mruby.h"
+#include "mruby/array.h"
+#include "mruby/class.h"
+#include "mruby/data.h"
+#include "mruby/error.h"
+#include "mruby/string.h"
+
+/* event bits shared with mrblib/scheduler.rb */
+#define SCHED_READABLE 1
+#define SCHED_WRITABLE 2
+
+#define POLLER_MAX_EVENTS 256
+
+struct Poller {
+    int epfd;
+    std::vector<uint8_t> mask;  /* events registered per fd */
+};
+
+static void poller_free(mrb_state *mrb, void *p)
+{
+    Poller *poller = (Poller *)p;
+
+    if (poller->epfd >= 0)
+        close(poller->epfd);
+    poller->~Poller();
+    mrb->gc()._free(poller);
+}
+
+static const struct mrb_data_type poller_type = {
+    "Scheduler::Poller", poller_free,
+};
+
+static Poller *poller_get(mrb_state *mrb, mrb_value self)
+{
+    Poller *poller = DATA_GET_PTR(mrb, self, &poller_type, Poller);
+
+    if (!poller) {
+        mrb->mrb_raise(E_TYPE_ERROR, "uninitialized Poller");
+    }
+    return poller;
+}
+
+static int fd_arg(mrb_state *mrb)
+{
+    mrb_int fd = mrb->get_arg<mrb_int>();
+
+    if (fd < 0) {
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "negative file descriptor");
+    }
+    return (int)fd;
+}
+
+/*
+ *  call-seq:
+ *     Scheduler.monotonic   ->  float
+ *
+ *  Seconds from an arbitrary point, unaffected by changes to the wall clock.
+ */
+static mrb_value sched_monotonic(mrb_state *mrb, mrb_value self)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return mrb_float_value((mrb_float)ts.tv_sec + (mrb_float)ts.tv_nsec * 1e-9);
+}
+
+/*
+ *  call-seq:
+ *     Scheduler.pipe   ->  [read_fd, write_fd]
+ *
+ *  Creates a pipe whose ends are both in non-blocking mode.
+ */
+static mrb_value sched_pipe(mrb_state *mrb, mrb_value self)
+{
+    int fds[2];
+
+    if (pipe(fds) < 0) {
+        mrb_sys_fail(mrb, "pipe");
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    mrb_value ends[2] = { mrb_fixnum_value(fds[0]), mrb_fixnum_value(fds[1]) };
+    return RArray::new_from_values(mrb, 2, ends)->wrap();
+}
+
+/*
+ *  call-seq:
+ *     Scheduler.nonblock(fd)   ->  fd
+ *
+ *  Puts fd in non-blocking mode, so reads and writes can be multiplexed.
+ */
+static mrb_value sched_nonblock(mrb_state *mrb, mrb_value self)
+{
+    int fd = fd_arg(mrb);
+    int flags = fcntl(fd, F_GETFL);
+
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        mrb_sys_fail(mrb, "fcntl");
+    }
+    return mrb_fixnum_value(fd);
+}
+
+/*
+ *  call-seq:
+ *     Scheduler.fd_read(fd, maxlen)   ->  string, nil or false
+ *
+ *  Reads up to maxlen bytes. Returns nil at end of file and false when
+ *  the read would block.
+ */
+static mrb_value sched_fd_read(mrb_state *mrb, mrb_value self)
+{
+    mrb_int fd, maxlen;
+
+    mrb_get_args(mrb, "ii", &fd, &maxlen);
+    if (maxlen < 0) {
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "negative length");
+    }
+    RString *buf = RString::create(mrb, nullptr, maxlen);
+    ssize_t n;
+    do {
+        n = read((int)fd, buf->m_ptr, (size_t)maxlen);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return mrb_value::_false();
+        mrb_sys_fail(mrb, "read");
+    }
+    if (n == 0 && maxlen > 0)
+        return mrb_value::nil();
+    buf->len = n;
+    buf->m_ptr[n] = '\0';
+    return buf->wrap();
+}
+
+/*
+ *  call-seq:
+ *     Scheduler.fd_write(fd, str)   ->  integer or nil
+ *
+ *  Writes as much of str as fits without blocking. Returns the number of
+ *  bytes written, or nil when nothing could be written.
+ */
+static mrb_value sched_fd_write(mrb_state *mrb, mrb_value self)
+{
+    mrb_int fd;
+    mrb_value str;
+    ssize_t n;
+
+    mrb_get_args(mrb, "iS", &fd, &str);
+    do {
+        n = write((int)fd, RSTRING_PTR(str), (size_t)RSTRING_LEN(str));
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return mrb_value::nil();
+        mrb_sys_fail(mrb, "write");
+    }
+    return mrb_fixnum_value((mrb_int)n);
+}
+
+/*
+ *  call-seq:
+ *     Scheduler.fd_close(fd)   ->  nil
+ */
+static mrb_value sched_fd_close(mrb_state *mrb, mrb_value self)
+{
+    if (close(fd_arg(mrb)) < 0) {
+        mrb_sys_fail(mrb, "close");
+    }
+    return mrb_value::nil();
+}
+
+#ifdef __linux__
+
+static mrb_value poller_init(mrb_state *mrb, mrb_value self)
+{
+    if (DATA_TYPE(self) == &poller_type && DATA_PTR(self)) {
+        poller_free(mrb, DATA_PTR(self));
+    }
+    DATA_TYPE(self) = &poller_type;
+    DATA_PTR(self) = NULL;
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        mrb_sys_fail(mrb, "epoll_create1");
+    }
+    Poller *poller = new (mrb->gc()._malloc(sizeof(Poller))) Poller;
+    poller->epfd = epfd;
+    DATA_PTR(self) = poller;
+    return self;
+}
+
+/*
+ *  call-seq:
+ *     poller.modify(fd, events)   ->  self
+ *
+ *  Sets the events (READABLE | WRITABLE) fd is watched for; 0 stops
+ *  watching it.
+ */
+static mrb_value poller_modify(mrb_state *mrb, mrb_value self)
+{
+    Poller *poller = poller_get(mrb, self);
+    mrb_int fd, events;
+
+    mrb_get_args(mrb, "ii", &fd, &events);
+    if (fd < 0) {
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "negative file descriptor");
+    }
+    if ((size_t)fd >= poller->mask.size())
+        poller->mask.resize(fd + 1, 0);
+
+    struct epoll_event ev;
+    ev.events = 0;
+    if (events & SCHED_READABLE)
+        ev.events |= EPOLLIN;
+    if (events & SCHED_WRITABLE)
+        ev.events |= EPOLLOUT;
+    ev.data.fd = (int)fd;
+    int op;
+    if (!events)
+        op = EPOLL_CTL_DEL;
+    else if (poller->mask[fd])
+        op = EPOLL_CTL_MOD;
+    else
+        op = EPOLL_CTL_ADD;
+    int r = epoll_ctl(poller->epfd, op, (int)fd, &ev);
+    /* closing an fd drops it from the epoll set behind our back */
+    if (r < 0 && errno == ENOENT && op == EPOLL_CTL_MOD)
+        r = epoll_ctl(poller->epfd, EPOLL_CTL_ADD, (int)fd, &ev);
+    else if (r < 0 && errno == EEXIST && op == EPOLL_CTL_ADD)
+        r = epoll_ctl(poller->epfd, EPOLL_CTL_MOD, (int)fd, &ev);
+    else if (r < 0 && (errno == ENOENT || errno == EBADF) && op == EPOLL_CTL_DEL)
+        r = 0;
+    if (r < 0) {
+        mrb_sys_fail(mrb, "epoll_ctl");
+    }
+    poller->mask[fd] = (uint8_t)events;
+    return self;
+}
+
+/*
+ *  call-seq:
+ *     poller.wait(timeout = nil)   ->  [fd, events, fd, events, ...]
+ *
+ *  Waits up to timeout seconds (forever when nil) for a watched fd to
+ *  become ready. Errors and hang-ups are reported as both events, so any
+ *  waiter wakes up and sees them on its next read or write.
+ */
+static mrb_value poller_wait(mrb_state *mrb, mrb_value self)
+{
+    Poller *poller = poller_get(mrb, self);
+    mrb_value timeout = mrb_value::nil();
+    struct epoll_event events[POLLER_MAX_EVENTS];
+    int ms = -1;
+
+    mrb_get_args(mrb, "|o", &timeout);
+    if (timeout.is_fixnum()) {
+        ms = mrb_fixnum(timeout) < 0 ? 0 : mrb_fixnum(timeout) * 1000;
+    }
+    else if (timeout.is_float()) {
+        mrb_float t = mrb_float(timeout);
+        /* round up, so a timer is never woken before it is due */
+        ms = t <= 0 ? 0 : (int)(t * 1000.0 + 0.999);
+    }
+    else if (!timeout.is_nil()) {
+        mrb->mrb_raise(E_TYPE_ERROR, "timeout must be a number or nil");
+    }
+
+    int n = epoll_wait(poller->epfd, events, POLLER_MAX_EVENTS, ms);
+    if (n < 0) {
+        if (errno != EINTR)
+            mrb_sys_fail(mrb, "epoll_wait");
+        n = 0;
+    }
+    RArray *ready = RArray::create(mrb, n * 2);
+    for (int i = 0; i < n; i++) {
+        uint32_t e = events[i].events;
+        mrb_int bits = 0;
+        if (e & (EPOLLIN | EPOLLERR | EPOLLHUP))
+            bits |= SCHED_READABLE;
+        if (e & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+            bits |= SCHED_WRITABLE;
+        ready->push(mrb_fixnum_value(events[i].data.fd));
+        ready->push(mrb_fixnum_value(bits));
+    }
+    return ready->wrap();
+}
+
+#else
+
+static mrb_value poller_init(mrb_state *mrb, mrb_value self)
+{
+    mrb->mrb_raise(E_NOTIMP_ERROR, "Scheduler::Poller needs epoll");
+    return self;
+}
+
+static mrb_value poller_modify(mrb_state *mrb, mrb_value self)
+{
+    return poller_init(mrb, self);
+}
+
+static mrb_value poller_wait(mrb_state *mrb, mrb_value self)
+{
+    return poller_init(mrb, self);
+}
+
+#endif
+
+void mrb_mruby_scheduler_gem_init(mrb_state *mrb)
+{
+    RClass &sched = mrb->define_class("Scheduler", mrb->object_class);
+
+    sched.define_const("READABLE", mrb_fixnum_value(SCHED_READABLE))
+            .define_const("WRITABLE", mrb_fixnum_value(SCHED_WRITABLE))
+            .define_class_method("monotonic", sched_monotonic, MRB_ARGS_NONE())
+            .define_class_method("pipe", sched_pipe, MRB_ARGS_NONE())
+            .define_class_method("nonblock", sched_nonblock, MRB_ARGS_REQ(1))
+            .define_class_method("fd_read", sched_fd_read, MRB_ARGS_REQ(2))
+            .define_class_method("fd_write", sched_fd_write, MRB_ARGS_REQ(2))
+            .define_class_method("fd_close", sched_fd_close, MRB_ARGS_REQ(1))
+            .fin();
+
+    sched.define_class_under("Poller", mrb->object_class)->instance_tt(MRB_TT_DATA)
+            .define_method("initialize", poller_init, MRB_ARGS_NONE())
+            .define_method("modify", poller_modify, MRB_ARGS_REQ(2))
+            .define_method("wait", poller_wait, MRB_ARGS_OPT(1))
+            .fin();
+}
+
+void mrb_mruby_scheduler_gem_final(mrb_state *mrb)
+{
+}
@@ -0,0 +1,85 @@
+##
+# Scheduler Test
+
+assert('Scheduler#pass') do
+  s = Scheduler.new
+  log = []
+  s.spawn(:a) {|name| 3.times {|i| log << "#{name}#{i}"; s.pass } }
+  s.spawn(:b) {|name| 3.times {|i| log << "#{name}#{i}"; s.pass } }
+  s.run
+  assert_equal %w[a0 b0 a1 b1 a2 b2], log
+end
+
+assert('Scheduler#sleep') do
+  s = Scheduler.new
+  log = []
+  s.spawn { s.sleep 0.03; log << 3 }
+  s.spawn { s.sleep 0.01; log << 1 }
+  s.spawn { s.sleep 0.02; log << 2 }
+  s.spawn { log << 0 }
+  start = Scheduler.monotonic
+  s.run
+  assert_equal [0, 1, 2, 3], log
+  assert_true Scheduler.monotonic - start >= 0.03
+end
+
+assert('Scheduler#sleep(0) keeps timer order') do
+  s = Scheduler.new
+  log = []
+  10.times {|i| s.spawn { s.sleep 0; log << i } }
+  s.run
+  assert_equal (0...10).to_a, log
+end
+
+assert('Scheduler pipe ping-pong') do
+  s = Scheduler.new
+  a_r, a_w = Scheduler.pipe
+  b_r, b_w = Scheduler.pipe
+  got = []
+  s.spawn do
+    5.times do |i|
+      s.write(a_w, "ping#{i}")
+      got << s.read(b_r, 64)
+    end
+    Scheduler.fd_close(a_w)
+  end
+  s.spawn do
+    while msg = s.read(a_r, 64)
+      s.write(b_w, msg.sub("ping", "pong"))
+    end
+    got << :eof
+  end
+  s.run
+  [a_r, b_r, b_w].each {|fd| Scheduler.fd_close(fd) }
+  assert_equal %w[pong0 pong1 pong2 pong3 pong4] + [:eof], got
+end
+
+assert('Scheduler#write waits for a full pipe') do
+  s = Scheduler.new
+  r, w = Scheduler.pipe
+  data = "x" * 300000
+  received = 0
+  s.spawn do
+    assert_equal data.size, s.write(w, data)
+    Scheduler.fd_close(w)
+  end
+  s.spawn do
+    while chunk = s.read(r, 65536)
+      received += chunk.size
+    end
+  end
+  s.run
+  Scheduler.fd_close(r)
+  assert_equal data.size, received
+end
+
+assert('Scheduler fd_read without data') do
+  r, w = Scheduler.pipe
+  assert_false Scheduler.fd_read(r, 16)
+  Scheduler.fd_write(w, "abc")
+  assert_equal "abc", Scheduler.fd_read(r, 16)
+  Scheduler.fd_close(w)
+  eof = Scheduler.fd_read(r, 16)
+  Scheduler.fd_close(r)
+  assert_nil eof
+end
@@ -0,0 +1,16 @@
+class String
+  ##
+  # Uses +self+ as a format specification and returns the result of
+  # applying it to +args+, as Kernel#sprintf does. An Array supplies one
+  # argument per element.
+  #
+  #   "%05d" % 123                #=> "00123"
+  #   "%-5s: %08x" % ["ID", 255]  #=> "ID   : 000000ff"
+  def %(args)
+    if args.is_a?(Array)
+      sprintf(self, *args)
+    else
+      sprintf(self, args)
+    end
+  end
+end
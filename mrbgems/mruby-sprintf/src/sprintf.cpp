@@ -9,9 +9,11 @@
 #include <limits.h>
 #include <stdio.h>
 #include <string.h>
+#include <vector>
 #include "mruby/string.h"
 #include "mruby/hash.h"
 #include "mruby/numeric.h"
+#include "mruby/data.h"
 #include <math.h>
 #include <ctype.h>
 
@@ -211,6 +213,416 @@ get_hash(mrb_state *mrb, mrb_value *hash, int argc, const mrb_value *argv)
     return (*hash = tmp);
 }
 
+/*
+ * Compiled formats.
+ *
+ * Parsing a format string costs more than formatting its arguments, and
+ * programs use the same few formats over and over. A format made of plain
+ * text and directives with flags, a numeric width and a precision (no `*',
+ * `$' or names) is compiled once into a list of ops, kept in a small
+ * per-state cache keyed by the format's bytes. Any other format, or an
+ * argument the ops do not handle, goes through the interpreter in
+ * mrb_str_format.
+ */
+
+#define FMT_CACHE_KEY  "$mrb_g_sprintf_cache"
+#define FMT_CACHE_SIZE 64   /* entries, power of two */
+#define FMT_MAX_ARGS   16   /* directives per compiled format */
+#define FMT_MAX_OPS    (2 * FMT_MAX_ARGS + 1)  /* literal runs are merged */
+
+struct fmt_op {
+    char type;          /* conversion character, 0 for literal text */
+    int flags;
+    mrb_int width;
+    mrb_int prec;
+    mrb_int lit_off;    /* literal text in fmt_compiled::lits */
+    mrb_int lit_len;
+    char spec[32];      /* printf spec of a float conversion */
+};
+
+struct fmt_compiled {
+    uint32_t hash;
+    bool used;
+    bool ok;            /* false: the format must be interpreted */
+    int nargs;
+    mrb_int lit_total;
+    std::vector<char> src;
+    std::vector<char> lits;
+    std::vector<fmt_op> ops;
+};
+
+struct fmt_cache {
+    fmt_compiled entry[FMT_CACHE_SIZE];
+};
+
+static void
+fmt_cache_free(mrb_state *mrb, void *p)
+{
+    fmt_cache *cache = (fmt_cache *)p;
+
+    cache->~fmt_cache();
+    mrb->gc()._free(cache);
+}
+
+static const struct mrb_data_type fmt_cache_type = {
+    "sprintf_cache", fmt_cache_free,
+};
+
+static fmt_cache *
+fmt_cache_get(mrb_state *mrb)
+{
+    mrb_sym key = mrb_intern_lit(mrb, FMT_CACHE_KEY);
+    fmt_cache *cache = DATA_GET_PTR(mrb, mrb->mrb_gv_get(key), &fmt_cache_type, fmt_cache);
+
+    if (!cache) {
+        cache = new (mrb->gc()._malloc(sizeof(fmt_cache))) fmt_cache;
+        mrb->gv_set(key, RData::object_alloc(mrb, mrb->object_class, cache, &fmt_cache_type)->wrap());
+    }
+    return cache;
+}
+
+static void
+fmt_push_literal(fmt_compiled *cf, const char *p, mrb_int len)
+{
+    if (len == 0)
+        return;
+    if (cf->ops.empty() || cf->ops.back().type != 0) {
+        fmt_op op;
+        op.type = 0;
+        op.lit_off = cf->lits.size();
+        op.lit_len = 0;
+        cf->ops.push_back(op);
+    }
+    cf->lits.insert(cf->lits.end(), p, p + len);
+    cf->ops.back().lit_len += len;
+    cf->lit_total += len;
+}
+
+static bool
+fmt_getnum(const char *&p, const char *end, mrb_int &n)
+{
+    for (n = 0; p < end && ISDIGIT(*p); p++) {
+        if (n > (INT_MAX - 9) / 10)
+            return false;
+        n = 10 * n + (*p - '0');
+    }
+    return p < end;
+}
+
+/* Compiles the subset described above; returns false for anything else,
+   including malformed formats, whose errors the interpreter reports. */
+static bool
+fmt_compile(fmt_compiled *cf, const char *p, const char *end)
+{
+    while (p < end) {
+        const char *t;
+        fmt_op op;
+
+        for (t = p; t < end && *t != '%'; t++) ;
+        fmt_push_literal(cf, p, t - p);
+        if (t >= end)
+            return true;
+        p = t + 1;
+        if (p >= end)
+            return false;
+        if (*p == '%') {
+            fmt_push_literal(cf, p, 1);
+            p++;
+            continue;
+        }
+
+        op.flags = FNONE;
+        op.width = op.prec = -1;
+        for (; p < end; p++) {
+            if (*p == ' ') op.flags |= FSPACE;
+            else if (*p == '#') op.flags |= FSHARP;
+            else if (*p == '+') op.flags |= FPLUS;
+            else if (*p == '-') op.flags |= FMINUS;
+            else if (*p == '0') op.flags |= FZERO;
+            else break;
+        }
+        if (p < end && ISDIGIT(*p)) {
+            if (!fmt_getnum(p, end, op.width) || *p == '$')
+                return false;
+            op.flags |= FWIDTH;
+        }
+        if (p < end && *p == '.') {
+            p++;
+            op.flags |= FPREC|FPREC0;
+            if (!fmt_getnum(p, end, op.prec))
+                return false;
+        }
+        if (p >= end)
+            return false;
+
+        switch (*p) {
+            case 'd': case 'i': case 'u':
+            case 'o': case 'x': case 'X':
+            case 's': case 'p':
+                break;
+            case 'f': case 'g': case 'G':
+            case 'e': case 'E': case 'a': case 'A':
+                fmt_setup(op.spec, sizeof(op.spec), *p, op.flags, op.width, op.prec);
+                break;
+            default:
+                return false;
+        }
+        if (cf->nargs == FMT_MAX_ARGS)
+            return false;
+        op.type = *p++;
+        cf->nargs++;
+        cf->ops.push_back(op);
+    }
+    return true;
+}
+
+static const fmt_compiled *
+fmt_lookup(mrb_state *mrb, mrb_value fmt)
+{
+    const char *p = RSTRING_PTR(fmt);
+    mrb_int len = RSTRING_LEN(fmt);
+    uint32_t h = 2166136261u ^ (uint32_t)len;
+
+    /* FNV-1a over the ends of the format only; memcmp below settles it */
+    for (mrb_int i = 0; i < len && i < 8; i++)
+        h = (h ^ (unsigned char)p[i]) * 16777619u;
+    for (mrb_int i = len > 16 ? len - 8 : 8; i < len; i++)
+        h = (h ^ (unsigned char)p[i]) * 16777619u;
+
+    fmt_compiled *cf = &fmt_cache_get(mrb)->entry[h & (FMT_CACHE_SIZE - 1)];
+    if (cf->used && cf->hash == h && (mrb_int)cf->src.size() == len && memcmp(cf->src.data(), p, len) == 0)
+        return cf->ok ? cf : nullptr;
+
+    cf->used = true;
+    cf->hash = h;
+    cf->nargs = 0;
+    cf->lit_total = 0;
+    cf->src.assign(p, p + len);
+    cf->lits.clear();
+    cf->ops.clear();
+    cf->ok = fmt_compile(cf, p, p + len);
+    return cf->ok ? cf : nullptr;
+}
+
+/* true when every argument is of a kind the ops format directly */
+static bool
+fmt_args_ok(const fmt_compiled *cf, int argc, const mrb_value *argv)
+{
+    int i = 0;
+
+    if (cf->nargs > argc)
+        return false;
+    for (const fmt_op &op : cf->ops) {
+        switch (op.type) {
+            case 0:
+                continue;
+            case 'o': case 'x': case 'X':
+                /* negative numbers print as two's complement, left to the interpreter */
+                if (argv[i].is_fixnum() && mrb_fixnum(argv[i]) < 0 && !(op.flags & (FPLUS|FSPACE)))
+                    return false;
+                /* fall through */
+            case 'd': case 'i': case 'u':
+                if (!argv[i].is_fixnum())
+                    return false;
+                break;
+            case 's': case 'p':
+                break;
+            default:
+                if (argv[i].is_float()) {
+                    if (isnan(mrb_float(argv[i])) || isinf(mrb_float(argv[i])))
+                        return false;
+                }
+                else if (!argv[i].is_fixnum()) {
+                    return false;
+                }
+                break;
+        }
+        i++;
+    }
+    return true;
+}
+
+struct fmt_buf {
+    RString *str;
+    mrb_int len;
+    mrb_int capa;
+
+    char *reserve(mrb_int n) {
+        if (len + n >= capa) {
+            while (len + n >= capa)
+                capa *= 2;
+            str->resize(capa);
+        }
+        return str->m_ptr + len;
+    }
+    void push(const char *s, mrb_int n) {
+        memcpy(reserve(n), s, n);
+        len += n;
+    }
+    void fill(char c, mrb_int n) {
+        if (n <= 0)
+            return;
+        memset(reserve(n), c, n);
+        len += n;
+    }
+};
+
+/* %d %i %u %o %x %X; same layout rules as the interpreter, digits written
+   straight into the buffer */
+static void
+fmt_int(fmt_buf &b, const fmt_op &op, mrb_int v)
+{
+    char nbuf[32], *e = nbuf + sizeof(nbuf), *s = e;
+    const char *digits = (op.type == 'X') ? "0123456789ABCDEF" : "0123456789abcdef";
+    int base = (op.type == 'o') ? 8 : (op.type == 'x' || op.type == 'X') ? 16 : 10;
+    mrb_int width = op.width, prec = op.prec, len;
+    uint64_t mag = (v < 0) ? 0 - (uint64_t)(int64_t)v : (uint64_t)v;
+    const char *prefix = NULL;
+    char sc = 0;
+
+    if (v < 0) {
+        sc = '-';
+        width--;
+    }
+    else if (op.flags & FPLUS) {
+        sc = '+';
+        width--;
+    }
+    else if (op.flags & FSPACE) {
+        sc = ' ';
+        width--;
+    }
+    if (op.flags & FSHARP) {
+        if (base == 8) prefix = "0";
+        else if (base == 16) prefix = (op.type == 'X') ? "0X" : "0x";
+    }
+    do {
+        *--s = digits[mag % base];
+    } while (mag /= base);
+    len = e - s;
+
+    if (prefix && !prefix[1]) { /* octal */
+        if (len == 1 && *s == '0') {
+            len = 0;
+            if (op.flags & FPREC) prec--;
+        }
+        else if ((op.flags & FPREC) && (prec > len)) {
+            prefix = NULL;
+        }
+    }
+    else if (len == 1 && *s == '0') {
+        prefix = NULL;
+    }
+    if (prefix)
+        width -= (mrb_int)strlen(prefix);
+
+    if ((op.flags & (FZERO|FMINUS|FPREC)) == FZERO) {
+        prec = width;
+        width = 0;
+    }
+    else {
+        if (prec < len) {
+            if (!prefix && prec == 0 && len == 1 && *s == '0') len = 0;
+            prec = len;
+        }
+        width -= prec;
+    }
+
+    if (!(op.flags & FMINUS))
+        b.fill(' ', width);
+    if (sc)
+        b.push(&sc, 1);
+    if (prefix)
+        b.push(prefix, (mrb_int)strlen(prefix));
+    if ((op.flags & (FMINUS|FPREC)) != FMINUS)
+        b.fill('0', prec - len);
+    b.push(s, len);
+    if (op.flags & FMINUS)
+        b.fill(' ', width);
+}
+
+static void
+fmt_float(fmt_buf &b, const fmt_op &op, double fval)
+{
+    int need = 0, i;
+
+    if (op.type != 'e' && op.type != 'E') {
+        i = INT_MIN;
+        frexp(fval, &i);
+        if (i > 0)
+            need = BIT_DIGITS(i);
+    }
+    need += (op.flags & FPREC) ? op.prec : 6;
+    if ((op.flags & FWIDTH) && need < op.width)
+        need = op.width;
+    need += 20;
+    b.len += snprintf(b.reserve(need), need, op.spec, fval);
+}
+
+static mrb_value
+fmt_exec(mrb_state *mrb, const fmt_compiled *cf, int argc, const mrb_value *argv)
+{
+    mrb_value args[FMT_MAX_ARGS];
+    fmt_op ops_copy[FMT_MAX_OPS];
+    const fmt_op *ops = cf->ops.data();
+    const char *lits = cf->lits.data();
+    size_t nops = cf->ops.size();
+    fmt_buf b;
+    int i = 0;
+
+    /* #to_s and #inspect may move the VM stack that argv points into */
+    memcpy(args, argv, cf->nargs * sizeof(mrb_value));
+    b.capa = cf->lit_total + cf->nargs * 16 + 16;
+    b.str = RString::create(mrb, b.capa);
+    b.str->resize(b.capa);
+    b.len = 0;
+
+    assert(nops <= FMT_MAX_OPS);
+    for (size_t k = 0; k < nops; k++) {
+        const fmt_op *op = &ops[k];
+        switch (op->type) {
+            case 0:
+                b.push(lits + op->lit_off, op->lit_len);
+                continue;
+            case 'd': case 'i': case 'u':
+            case 'o': case 'x': case 'X':
+                fmt_int(b, *op, mrb_fixnum(args[i]));
+                break;
+            case 's': case 'p': {
+                mrb_value arg = args[i];
+                if (ops != ops_copy && (op->type == 'p' || !arg.is_string())) {
+                    /* #to_s or #inspect may call sprintf with a format that
+                       lands in this cache entry and recompiles it; finish
+                       from a copy of our own */
+                    memcpy(ops_copy, ops, nops * sizeof(fmt_op));
+                    ops = ops_copy;
+                    op = &ops[k];
+                    lits = RString::create(mrb, lits, cf->lits.size())->m_ptr;
+                }
+                if (op->type == 'p')
+                    arg = mrb_inspect(mrb, arg)->wrap();
+                RString *str = arg.is_string() ? arg.ptr<RString>() : mrb_obj_as_string(mrb, arg);
+                mrb_int len = str->len;
+                if ((op->flags & FPREC) && op->prec < len)
+                    len = op->prec;
+                mrb_int pad = (op->flags & FWIDTH) ? op->width - len : 0;
+                if (!(op->flags & FMINUS))
+                    b.fill(' ', pad);
+                b.push(str->m_ptr, len);
+                if (op->flags & FMINUS)
+                    b.fill(' ', pad);
+                break;
+            }
+            default:
+                fmt_float(b, *op, args[i].is_float() ? mrb_float(args[i]) : (double)mrb_fixnum(args[i]));
+                break;
+        }
+        i++;
+    }
+    b.str->resize(b.len);
+    return b.str->wrap();
+}
+
 /*
  *  call-seq:
  *     format(format_string [, arguments...] )   -> string
@@ -522,9 +934,15 @@ mrb_str_format(mrb_state *mrb, int argc, const mrb_value *argv, mrb_value fmt)
     mrb->mrb_raise(E_ARGUMENT_ERROR, "flag after precision");      \
 }
 
+    fmt = mrb_str_to_str(mrb, fmt);
+    if (!memchr(RSTRING_PTR(fmt), '%', RSTRING_LEN(fmt)))
+        return RString::create(mrb, RSTRING_PTR(fmt), RSTRING_LEN(fmt))->wrap();
+    const fmt_compiled *cf = fmt_lookup(mrb, fmt);
+    if (cf && fmt_args_ok(cf, argc, argv))
+        return fmt_exec(mrb, cf, argc, argv);
+
     ++argc;
     --argv;
-    fmt = mrb_str_to_str(mrb, fmt);
     p = RSTRING_PTR(fmt);
     end = p + RSTRING_LEN(fmt);
     blen = 0;
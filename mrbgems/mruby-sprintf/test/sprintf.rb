@@ -1,3 +1,47 @@
 ##
 # Kernel#sprintf Kernel#format Test
 
+
+assert('Kernel#sprintf integers') do
+  assert_equal "  123|123  |00123", sprintf("%5d|%-5d|%05d", 123, 123, 123)
+  assert_equal "+7 -7  7", sprintf("%+d %d % d", 7, -7, 7)
+  assert_equal "7b 0X7B 0173", sprintf("%x %#X %#o", 123, 123, 123)
+  assert_equal "..f85", sprintf("%x", -123)
+  assert_equal "      -00123", sprintf("%12.5d", -123)
+end
+
+assert('Kernel#sprintf strings and floats') do
+  assert_equal "[  ab|ab  |abc]", sprintf("[%4.2s|%-4s|%s]", "abcd", "ab", :abc)
+  assert_equal "\"x\" nil", sprintf("%p %p", "x", nil)
+  assert_equal "3.14 2.500e+00 1e+10", sprintf("%.2f %.3e %g", 3.14159, 2.5, 1e10)
+  assert_equal "  1.50|100%", sprintf("%6.2f|%d%%", 1.5, 100)
+end
+
+assert('Kernel#sprintf reuses a format') do
+  fmt = "%s=%d"
+  r = []
+  3.times {|i| r << sprintf(fmt, "k", i) }
+  fmt.replace("%x=%d")
+  r << sprintf(fmt, 255, 1)
+  assert_equal ["k=0", "k=1", "k=2", "ff=1"], r
+  assert_raise(ArgumentError) { sprintf(fmt, 1) }
+end
+
+assert('String#%') do
+  assert_equal "00042", "%05d" % 42
+  assert_equal "a-1", "%s-%d" % ["a", 1]
+end
+
+assert('Kernel#sprintf called again from #to_s') do
+  # the inner formats share a cache slot with "%s|%s"
+  class SprintfReentrant
+    def initialize(fmt, *args); @fmt = fmt; @args = args; end
+    def to_s; sprintf(@fmt, *@args); end
+    def inspect; to_s; end
+  end
+  a = SprintfReentrant.new("%d %d %d %d %d %d %d %d 19", 1, 2, 3, 4, 5, 6, 7, 8)
+  assert_equal "1 2 3 4 5 6 7 8 19|tail", sprintf("%s|%s", a, "tail")
+  b = SprintfReentrant.new("%d-31", 7)
+  assert_equal "7-31|tail", sprintf("%s|%s", b, "tail")
+  assert_equal "<7-31>", sprintf("<%p>", b)
+end
@@ -12,9 +12,12 @@ if Object.const_defined?(:Struct)
     #
     # ISO 15.2.18.4.4
     def each(&block)
-      self.class.members.each{|field|
-        block.call(self[field])
-      }
+      i = 0
+      n = self.size
+      while i < n
+        block.call(self[i])
+        i += 1
+      end
       self
     end
 
@@ -25,9 +28,13 @@ if Object.const_defined?(:Struct)
     #
     # ISO 15.2.18.4.5
     def each_pair(&block)
-      self.class.members.each{|field|
-        block.call(field.to_sym, self[field])
-      }
+      fields = self.class.members
+      i = 0
+      n = self.size
+      while i < n
+        block.call(fields[i], self[i])
+        i += 1
+      end
       self
     end
 
@@ -39,10 +46,13 @@ if Object.const_defined?(:Struct)
     # ISO 15.2.18.4.7
     def select(&block)
       ary = []
-      self.class.members.each{|field|
-        val = self[field]
+      i = 0
+      n = self.size
+      while i < n
+        val = self[i]
         ary.push(val) if block.call(val)
-      }
+        i += 1
+      end
       ary
     end
   end
@@ -12,11 +12,17 @@
 #include "mruby/class.h"
 #include "mruby/data.h"
 #include "mruby/variable.h"
+#include "mruby/hash.h"
 
 #define RSTRUCT_ARY(st) mrb_ary_ptr(st)
 #define RSTRUCT_LEN(st) RSTRUCT_ARY(st)->m_len
 #define RSTRUCT_PTR(st) RSTRUCT_ARY(st)->m_ptr
 
+/* "__member_index__", interned by the gem init. Every mrb_state interns the
+   same core and gem names in the same order first, so the id is the same for
+   all of them. */
+static mrb_sym index_sym;
+
 static RClass * struct_class(mrb_state *mrb)
 {
     return mrb->class_get("Struct");
@@ -60,7 +66,7 @@ mrb_value mrb_struct_s_members(mrb_state *mrb, mrb_value klass)
 mrb_value mrb_struct_members(mrb_state *mrb, mrb_value s)
 {
     mrb_value members = mrb_struct_s_members(mrb, mrb_value::wrap(mrb_obj_class(mrb, s)));
-    if (!strcmp(mrb_obj_class(mrb, s)->class_name(), "Struct")) {
+    if (mrb_obj_class(mrb, s) == struct_class(mrb)) {
         if (RSTRUCT_LEN(s) != RARRAY_LEN(members)) {
             mrb->mrb_raisef(E_TYPE_ERROR,
                             "struct size differs (%S required %S given)",
@@ -105,24 +111,57 @@ mrb_struct_members_m(mrb_state *mrb, mrb_value obj)
     return mrb_struct_s_members_m(mrb, mrb_value::wrap(mrb_obj_class(mrb, obj)));
 }
 
+/*
+ *  make_struct records, once per class, a hash from each member name to its
+ *  slot index and from each "name=" setter to the complement of that index,
+ *  so that names resolve in O(1) whatever the number of members. A subclass
+ *  gets a copy of the reference on first use, so later lookups only look at
+ *  the receiver's own class.
+ */
+static mrb_value
+struct_index_get(mrb_state *mrb, mrb_value s, mrb_sym id)
+{
+    RClass *c = mrb_obj_class(mrb, s);
+    mrb_value index = c->iv_get(index_sym);
+
+    if (!index.is_hash()) {
+        index = struct_ivar_get(mrb, mrb_value::wrap(c), index_sym);
+        if (!index.is_hash()) {
+            mrb->mrb_raise(E_TYPE_ERROR, "uninitialized struct");
+        }
+        c->iv_set(index_sym, index);
+    }
+    return index.ptr<RHash>()->fetch(mrb_symbol_value(id), mrb_value::nil());
+}
+
+static mrb_int
+struct_member_slot(mrb_state *mrb, mrb_value s, mrb_sym id)
+{
+    mrb_value i = struct_index_get(mrb, s, id);
+
+    if (!i.is_fixnum() || mrb_fixnum(i) < 0)
+        return -1;
+    return mrb_fixnum(i);
+}
+
+static inline mrb_value
+struct_slot_get(mrb_value s, mrb_int i)
+{
+    /* a subclass overriding initialize without calling super has no slots */
+    if (i >= RSTRUCT_LEN(s))
+        return mrb_value::nil();
+    return RSTRUCT_PTR(s)[i];
+}
+
 mrb_value
 mrb_struct_getmember(mrb_state *mrb, mrb_value obj, mrb_sym id)
 {
-    mrb_value members, slot, *ptr, *ptr_members;
-    mrb_int i, len;
-    
-    ptr = RSTRUCT_PTR(obj);
-    members = mrb_struct_members(mrb, obj);
-    ptr_members = RARRAY_PTR(members);
-    slot = mrb_symbol_value(id);
-    len = RARRAY_LEN(members);
-    for (i=0; i<len; i++) {
-        if (mrb_obj_equal(ptr_members[i], slot)) {
-            return ptr[i];
-        }
+    mrb_int i = struct_member_slot(mrb, obj, id);
+
+    if (i < 0) {
+        mrb->mrb_raisef(E_INDEX_ERROR, "%S is not struct member", mrb_sym2str(mrb, id));
     }
-    mrb->mrb_raisef(E_INDEX_ERROR, "%S is not struct member", mrb_sym2str(mrb, id));
-    return mrb_value::nil();       /* not reached */
+    return struct_slot_get(obj, i);
 }
 
 static mrb_value
@@ -131,32 +170,55 @@ mrb_struct_ref(mrb_state *mrb, mrb_value obj)
     return mrb_struct_getmember(mrb, obj, mrb->m_ctx->m_ci->mid);
 }
 
-static mrb_value mrb_struct_ref0(mrb_state* mrb, mrb_value obj) {return RSTRUCT_PTR(obj)[0];}
-static mrb_value mrb_struct_ref1(mrb_state* mrb, mrb_value obj) {return RSTRUCT_PTR(obj)[1];}
-static mrb_value mrb_struct_ref2(mrb_state* mrb, mrb_value obj) {return RSTRUCT_PTR(obj)[2];}
-static mrb_value mrb_struct_ref3(mrb_state* mrb, mrb_value obj) {return RSTRUCT_PTR(obj)[3];}
-static mrb_value mrb_struct_ref4(mrb_state* mrb, mrb_value obj) {return RSTRUCT_PTR(obj)[4];}
-static mrb_value mrb_struct_ref5(mrb_state* mrb, mrb_value obj) {return RSTRUCT_PTR(obj)[5];}
-static mrb_value mrb_struct_ref6(mrb_state* mrb, mrb_value obj) {return RSTRUCT_PTR(obj)[6];}
-static mrb_value mrb_struct_ref7(mrb_state* mrb, mrb_value obj) {return RSTRUCT_PTR(obj)[7];}
-static mrb_value mrb_struct_ref8(mrb_state* mrb, mrb_value obj) {return RSTRUCT_PTR(obj)[8];}
-static mrb_value mrb_struct_ref9(mrb_state* mrb, mrb_value obj) {return RSTRUCT_PTR(obj)[9];}
+static mrb_value
+mrb_struct_set_m(mrb_state *mrb, mrb_value obj)
+{
+    mrb_sym mid = mrb->m_ctx->m_ci->mid;
+    mrb_value i = struct_index_get(mrb, obj, mid);
+    mrb_value val = mrb->get_arg<mrb_value>();
+
+    if (!i.is_fixnum() || mrb_fixnum(i) >= 0) {
+        mrb->mrb_raisef(E_INDEX_ERROR, "`%S' is not a struct member", mrb_sym2str(mrb, mid));
+    }
+    RSTRUCT_ARY(obj)->set(~mrb_fixnum(i), val);
+    return val;
+}
+
+/* accessors for the leading members have their slot index compiled in */
+template<int I>
+static mrb_value mrb_struct_ref_n(mrb_state *, mrb_value obj)
+{
+    return struct_slot_get(obj, I);
+}
+
+template<int I>
+static mrb_value mrb_struct_set_n(mrb_state *mrb, mrb_value obj)
+{
+    mrb_value val = mrb->get_arg<mrb_value>();
+
+    RSTRUCT_ARY(obj)->set(I, val);
+    return val;
+}
 
 #define numberof(array) (int)(sizeof(array) / sizeof((array)[0]))
-#define N_REF_FUNC numberof(ref_func)
-
-static mrb_value (*const ref_func[])(mrb_state*, mrb_value) = {
-        mrb_struct_ref0,
-        mrb_struct_ref1,
-        mrb_struct_ref2,
-        mrb_struct_ref3,
-        mrb_struct_ref4,
-        mrb_struct_ref5,
-        mrb_struct_ref6,
-        mrb_struct_ref7,
-        mrb_struct_ref8,
-        mrb_struct_ref9,
-        };
+#define N_REF_FUNC numberof(accessor_func)
+#define STRUCT_ACCESSOR(i) { mrb_struct_ref_n<i>, mrb_struct_set_n<i> }
+
+static const struct {
+    mrb_func_t ref;
+    mrb_func_t set;
+} accessor_func[] = {
+    STRUCT_ACCESSOR(0),  STRUCT_ACCESSOR(1),  STRUCT_ACCESSOR(2),  STRUCT_ACCESSOR(3),
+    STRUCT_ACCESSOR(4),  STRUCT_ACCESSOR(5),  STRUCT_ACCESSOR(6),  STRUCT_ACCESSOR(7),
+    STRUCT_ACCESSOR(8),  STRUCT_ACCESSOR(9),  STRUCT_ACCESSOR(10), STRUCT_ACCESSOR(11),
+    STRUCT_ACCESSOR(12), STRUCT_ACCESSOR(13), STRUCT_ACCESSOR(14), STRUCT_ACCESSOR(15),
+    STRUCT_ACCESSOR(16), STRUCT_ACCESSOR(17), STRUCT_ACCESSOR(18), STRUCT_ACCESSOR(19),
+    STRUCT_ACCESSOR(20), STRUCT_ACCESSOR(21), STRUCT_ACCESSOR(22), STRUCT_ACCESSOR(23),
+    STRUCT_ACCESSOR(24), STRUCT_ACCESSOR(25), STRUCT_ACCESSOR(26), STRUCT_ACCESSOR(27),
+    STRUCT_ACCESSOR(28), STRUCT_ACCESSOR(29), STRUCT_ACCESSOR(30), STRUCT_ACCESSOR(31),
+};
+
+#undef STRUCT_ACCESSOR
 
 mrb_sym
 mrb_id_attrset(mrb_state *mrb, mrb_sym id)
@@ -177,42 +239,6 @@ mrb_id_attrset(mrb_state *mrb, mrb_sym id)
     return mid;
 }
 
-static mrb_value
-mrb_struct_set(mrb_state *mrb, mrb_value obj, mrb_value val)
-{
-    const char *name;
-    int i;
-    size_t len;
-    mrb_sym mid;
-    mrb_value members, slot, *ptr, *ptr_members;
-    
-    /* get base id */
-    name = mrb_sym2name_len(mrb, mrb->m_ctx->m_ci->mid, len);
-    mid = mrb_intern(mrb, name, len-1); /* omit last "=" */
-    
-    members = mrb_struct_members(mrb, obj);
-    ptr_members = RARRAY_PTR(members);
-    len = RARRAY_LEN(members);
-    ptr = RSTRUCT_PTR(obj);
-    for (i=0; i<len; i++) {
-        slot = ptr_members[i];
-        if (mrb_symbol(slot) == mid) {
-            return ptr[i] = val;
-        }
-    }
-    mrb->mrb_raisef(E_INDEX_ERROR, "`%S' is not a struct member", mrb_sym2str(mrb, mid));
-    return mrb_value::nil();            /* not reached */
-}
-
-static mrb_value
-mrb_struct_set_m(mrb_state *mrb, mrb_value obj)
-{
-    mrb_value val;
-    
-    mrb_get_args(mrb, "o", &val);
-    return mrb_struct_set(mrb, obj, val);
-}
-
 #define is_notop_id(id) (id)//((id)>tLAST_TOKEN)
 #define is_local_id(id) (is_notop_id(id))//&&((id)&ID_SCOPE_MASK)==ID_LOCAL)
 int
@@ -254,24 +280,33 @@ make_struct(mrb_state *mrb, mrb_value name, RArray *members, struct RClass * kla
     }
     MRB_SET_INSTANCE_TT(c, MRB_TT_ARRAY);
     nstr = mrb_value::wrap(c);
+    ptr_members = members->m_ptr;
+    len = members->m_len;
+    RHash *index = RHash::new_capa(mrb, len*2);
     c->iv_set(mrb_intern(mrb, "__members__", 11), members->wrap());
+    c->iv_set(index_sym, index->wrap());
     c->define_class_method("new", mrb_instance_new, MRB_ARGS_ANY())
             .define_class_method("[]", mrb_instance_new, MRB_ARGS_ANY())
             .define_class_method("members", mrb_struct_s_members_m, MRB_ARGS_NONE())
             ;
     //RSTRUCT(nstr)->basic.c->super = c->c;
-    ptr_members = members->m_ptr;
-    len = members->m_len;
     for (i=0; i< len; i++) {
         mrb_sym id = mrb_symbol(ptr_members[i]);
+        mrb_sym set_id = mrb_id_attrset(mrb, id);
+        /* the first of duplicated names wins, as the old linear scan did */
+        if (!index->fetch(ptr_members[i], mrb_value::nil()).is_nil())
+            continue;
+        index->set(ptr_members[i], mrb_fixnum_value(i));
+        index->set(mrb_symbol_value(set_id), mrb_fixnum_value(~i));
         if (mrb_is_local_id(id) || mrb_is_const_id(id)) {
             if (i < N_REF_FUNC) {
-                c->define_method_id(id, ref_func[i], MRB_ARGS_NONE());
+                c->define_method_id(id, accessor_func[i].ref, MRB_ARGS_NONE());
+                c->define_method_id(set_id, accessor_func[i].set, MRB_ARGS_REQ(1));
             }
             else {
                 c->define_method_id(id, mrb_struct_ref, MRB_ARGS_NONE());
+                c->define_method_id(set_id, mrb_struct_set_m, MRB_ARGS_REQ(1));
             }
-            c->define_method_id(mrb_id_attrset(mrb, id), mrb_struct_set_m, MRB_ARGS_REQ(1));
         }
     }
     return nstr;
@@ -528,20 +563,12 @@ mrb_value mrb_struct_init_copy(mrb_state *mrb, mrb_value copy)
 static mrb_value
 mrb_struct_aref_id(mrb_state *mrb, mrb_value s, mrb_sym id)
 {
-    mrb_value *ptr, members, *ptr_members;
-    mrb_int i, len;
-    
-    ptr = RSTRUCT_PTR(s);
-    members = mrb_struct_members(mrb, s);
-    ptr_members = RARRAY_PTR(members);
-    len = RARRAY_LEN(members);
-    for (i=0; i<len; i++) {
-        if (mrb_symbol(ptr_members[i]) == id) {
-            return ptr[i];
-        }
+    mrb_int i = struct_member_slot(mrb, s, id);
+
+    if (i < 0) {
+        mrb->mrb_raisef(E_INDEX_ERROR, "no member '%S' in struct", mrb_sym2str(mrb, id));
     }
-    mrb->mrb_raisef(E_INDEX_ERROR, "no member '%S' in struct", mrb_sym2str(mrb, id));
-    return mrb_value::nil();       /* not reached */
+    return struct_slot_get(s, i);
 }
 
 /* 15.2.18.4.2  */
@@ -605,26 +632,13 @@ mrb_struct_aref(mrb_state *mrb, mrb_value s)
 static mrb_value
 mrb_struct_aset_id(mrb_state *mrb, mrb_value s, mrb_sym id, mrb_value val)
 {
-    mrb_value members, *ptr, *ptr_members;
-    mrb_int i, len;
-    
-    members = mrb_struct_members(mrb, s);
-    len = RARRAY_LEN(members);
-    if (RSTRUCT_LEN(s) != len) {
-        mrb->mrb_raisef(E_TYPE_ERROR,
-                        "struct size differs (%S required %S given)",
-                        mrb_fixnum_value(len), mrb_fixnum_value(RSTRUCT_LEN(s)));
-    }
-    ptr = RSTRUCT_PTR(s);
-    ptr_members = RARRAY_PTR(members);
-    for (i=0; i<len; i++) {
-        if (mrb_symbol(ptr_members[i]) == id) {
-            ptr[i] = val;
-            return val;
-        }
+    mrb_int i = struct_member_slot(mrb, s, id);
+
+    if (i < 0) {
+        mrb->mrb_raisef(E_INDEX_ERROR, "no member '%S' in struct", mrb_sym2str(mrb, id));
     }
-    mrb->mrb_raisef(E_INDEX_ERROR, "no member '%S' in struct", mrb_sym2str(mrb, id));
-    return val;                   /* not reach */
+    RSTRUCT_ARY(s)->set(i, val);
+    return val;
 }
 
 /* 15.2.18.4.3  */
@@ -674,7 +688,38 @@ mrb_struct_aset(mrb_state *mrb, mrb_value s)
                         "offset %S too large for struct(size:%S)",
                         mrb_fixnum_value(i), mrb_fixnum_value(RSTRUCT_LEN(s)));
     }
-    return RSTRUCT_PTR(s)[i] = val;
+    RSTRUCT_ARY(s)->set(i, val);
+    return val;
+}
+
+/*
+ *  call-seq:
+ *     struct.to_a     -> array
+ *     struct.values   -> array
+ *
+ *  Returns the values for this struct as an <code>Array</code>.
+ *
+ *     Customer = Struct.new(:name, :address, :zip)
+ *     joe = Customer.new("Joe Smith", "123 Maple, Anytown NC", 12345)
+ *     joe.to_a[1]   #=> "123 Maple, Anytown NC"
+ */
+static mrb_value
+mrb_struct_to_a(mrb_state *mrb, mrb_value s)
+{
+    return RArray::new_from_values(mrb, RSTRUCT_LEN(s), RSTRUCT_PTR(s))->wrap();
+}
+
+/*
+ *  call-seq:
+ *     struct.length    -> fixnum
+ *     struct.size      -> fixnum
+ *
+ *  Returns the number of members in the struct.
+ */
+static mrb_value
+mrb_struct_len(mrb_state *mrb, mrb_value s)
+{
+    return mrb_fixnum_value(RSTRUCT_LEN(s));
 }
 
 /* 15.2.18.4.1  */
@@ -707,7 +752,7 @@ mrb_struct_equal(mrb_state *mrb, mrb_value s)
     if (mrb_obj_equal(s, s2)) {
         equal_p = 1;
     }
-    else if (!strcmp(mrb_obj_class(mrb, s)->class_name(), "Struct") ||
+    else if (mrb_obj_class(mrb, s) == struct_class(mrb) ||
              mrb_obj_class(mrb, s) != mrb_obj_class(mrb, s2)) {
         equal_p = 0;
     }
@@ -750,7 +795,7 @@ static mrb_value mrb_struct_eql(mrb_state *mrb, mrb_value s)
     if (mrb_obj_equal(s, s2)) {
         eql_p = 1;
     }
-    else if (strcmp(mrb_obj_class(mrb, s2)->class_name(), "Struct") ||
+    else if (mrb_obj_class(mrb, s) == struct_class(mrb) ||
              mrb_obj_class(mrb, s) != mrb_obj_class(mrb, s2)) {
         eql_p = 0;
     }
@@ -792,6 +837,7 @@ static mrb_value mrb_struct_eql(mrb_state *mrb, mrb_value s)
 void
 mrb_mruby_struct_gem_init(mrb_state* mrb)
 {
+    index_sym = mrb_intern_lit(mrb, "__member_index__");
     mrb->define_class("Struct",  mrb->object_class)
             .define_class_method("new",       mrb_struct_s_def,       MRB_ARGS_ANY())  /* 15.2.18.3.1  */
             .define_method("==",              mrb_struct_equal,       MRB_ARGS_REQ(1)) /* 15.2.18.4.1  */
@@ -803,6 +849,10 @@ mrb_mruby_struct_gem_init(mrb_state* mrb)
             .define_method("inspect",         mrb_struct_inspect,     MRB_ARGS_NONE()) /* 15.2.18.4.10(x)  */
             .define_alias("to_s", "inspect")                                       /* 15.2.18.4.11(x)  */
             .define_method("eql?",            mrb_struct_eql,         MRB_ARGS_REQ(1)) /* 15.2.18.4.12(x)  */
+            .define_method("size",            mrb_struct_len,         MRB_ARGS_NONE())
+            .define_method("length",          mrb_struct_len,         MRB_ARGS_NONE())
+            .define_method("to_a",            mrb_struct_to_a,        MRB_ARGS_NONE())
+            .define_method("values",          mrb_struct_to_a,        MRB_ARGS_NONE())
             ;
 }
 
@@ -73,5 +73,34 @@ if Object.const_defined?(:Struct)
     cc = c.new(1,2)
     cc.select{|v| v % 2 == 0} == [2]
   end
+
+  assert('Struct#to_a') do
+    c = Struct.new(:m1, :m2)
+    cc = c.new(1,2)
+    cc.to_a == [1, 2] and cc.values == [1, 2] and cc.size == 2
+  end
+
+  assert('Struct#eql?') do
+    c = Struct.new(:m1, :m2)
+    c.new(1,2).eql?(c.new(1,2)) and not c.new(1,2).eql?(c.new(1,3))
+  end
+
+  assert('Struct with many members') do
+    names = (0...40).map {|i| "m#{i}".to_sym }
+    c = Struct.new(*names)
+    cc = c.new(*(0...40).to_a)
+    cc.m0 == 0 and cc.m39 == 39 and cc[:m35] == 35 and
+      (cc.m38 = 7) == 7 and cc[38] == 7 and cc["m38"] == 7 and
+      (cc[:m33] = 9) == 9 and cc.m33 == 9 and
+      cc.to_a.size == 40 and cc == c.new(*cc.to_a)
+  end
+
+  assert('Struct subclass member lookup') do
+    class StructSubLookup < Struct.new(:m1, :m2); end
+    class StructSubSubLookup < StructSubLookup; end
+    a = StructSubLookup.new(1, 2)
+    b = StructSubSubLookup.new(3, 4)
+    a[:m2] == 2 and b[:m1] == 3 and (b[:m2] = 5) == 5 and b.m2 == 5 and a[:m2] == 2
+  end
 end
 
@@ -0,0 +1,966 @@
+/*
+** time.cpp - Time class
+**
+** See Copyright Notice in mruby.h
+*/
+
+
+#include "mruby.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "mruby/class.h"
+#include "mruby/data.h"
+#include "mruby/error.h"
+#include "mruby/numeric.h"
+#include "mruby/variable.h"
+
+/** Time class configuration */
+
+/* clock_gettime(2) */
+/* C99 has no clock with sub-second resolution; uncomment following macro */
+/* on platforms without POSIX clock_gettime(2) */
+/* #define NO_CLOCK_GETTIME */
+
+/* localtime(3) */
+/* C99 does not have reentrant localtime_r() so it might cause troubles under */
+/* multi-threading environment.  undef following macro on platforms that */
+/* does not have localtime_r(). */
+/* #define NO_GMTIME_R */
+
+#ifdef _WIN32
+#if _MSC_VER
+/* Win32 platform do not provide localtime_r; emulate it using localtime_s */
+#define localtime_r(tp, tm)    ((localtime_s((tm), (tp)) == 0) ? (tm) : NULL)
+#else
+#define NO_GMTIME_R
+#endif
+#endif
+
+/** end of Time class configuration */
+
+#ifdef NO_GMTIME_R
+#define localtime_r(t,r) (tzset(),localtime(t))
+#endif
+
+/* Since we are limited to using ISO C89, this implementation is based
+* on time_t. That means the resolution of time is only precise to the
+* second level. Also, there are only 2 timezones, namely UTC and LOCAL.
+*/
+
+enum mrb_timezone {
+    MRB_TIMEZONE_NONE   = 0,
+    MRB_TIMEZONE_UTC    = 1,
+    MRB_TIMEZONE_LOCAL  = 2,
+    MRB_TIMEZONE_LAST   = 3
+};
+
+static const char *timezone_names[] = {
+    "none",
+    "UTC",
+    "LOCAL",
+    NULL
+};
+
+static const char *mon_names[] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec",
+};
+
+static const char *wday_names[] = {
+    "Sun", "Mon", "Tus", "Wed", "Thu", "Fri", "Sat",
+};
+
+/* The calendar breakdown is only computed when a field is first read, so
+   creating and comparing Time objects never touches the timezone. */
+struct mrb_time {
+    time_t              sec;
+    time_t              usec;
+    mrb_timezone        timezone;
+    bool                have_datetime;
+    struct tm           datetime;
+};
+
+static void
+mrb_time_free(mrb_state *mrb, void *ptr)
+{
+    mrb->gc()._free(ptr);
+}
+
+static const struct mrb_data_type mrb_time_type = { "Time", mrb_time_free };
+
+/*
+  CALENDAR ARITHMETIC
+*/
+
+static const int days_before_month[2][12] = {
+    {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334},
+    {0, 31, 60, 91, 121, 152, 182, 213, 244, 274, 305, 335},
+};
+
+static int
+is_leapyear(int64_t y)
+{
+    return (y % 4) == 0 && ((y % 100) != 0 || (y % 400) == 0);
+}
+
+/* days since 1970-01-01 of a proleptic Gregorian date (H. Hinnant's algorithm) */
+static int64_t
+days_from_civil(int64_t y, int m, int d)
+{
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+/* fills the date and time fields of d from seconds since the epoch */
+static void
+time_civil(int64_t t, struct tm *d)
+{
+    int64_t days = t / 86400, rem = t % 86400;
+
+    if (rem < 0) {
+        rem += 86400;
+        days--;
+    }
+    d->tm_hour = (int)(rem / 3600);
+    d->tm_min  = (int)(rem % 3600 / 60);
+    d->tm_sec  = (int)(rem % 60);
+    d->tm_wday = (int)((days % 7 + 11) % 7);   /* 1970-01-01 was a Thursday */
+
+    int64_t z = days + 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    int mon = mp < 10 ? mp + 3 : mp - 9;
+    int64_t year = (int64_t)yoe + era * 400 + (mon <= 2);
+
+    d->tm_year = (int)(year - 1900);
+    d->tm_mon  = mon - 1;
+    d->tm_mday = (int)(doy - (153 * mp + 2) / 5 + 1);
+    d->tm_yday = days_before_month[is_leapyear(year)][mon - 1] + d->tm_mday - 1;
+    d->tm_isdst = 0;
+}
+
+/* mktime() creates tm structure for localtime; this is the UTC counterpart */
+static time_t
+time_timegm(const struct tm *tm)
+{
+    return (time_t)(days_from_civil(tm->tm_year + 1900LL, tm->tm_mon + 1, tm->tm_mday) * 86400
+                    + tm->tm_hour * 3600 + tm->tm_min * 60 + tm->tm_sec);
+}
+
+/*
+  LOCAL TIMEZONE
+
+  localtime_r() consults the timezone database on every call. The offset
+  from UTC is instead cached per mrb_state for one 15-minute window of
+  time: a window whose two ends have the same offset and DST flag cannot
+  contain a transition (no zone has two within 15 minutes), so every time
+  inside it shares that offset. Windows that do contain a transition are
+  not cached and fall back to localtime_r().
+*/
+
+#define TZ_CACHE_KEY    "$mrb_g_time_zone"
+#define TZ_WINDOW       900
+
+struct time_zone_cache {
+    bool valid;
+    int64_t window;     /* sec / TZ_WINDOW */
+    long offset;        /* seconds east of UTC */
+    int isdst;
+};
+
+static void
+time_zone_cache_free(mrb_state *mrb, void *p)
+{
+    mrb->gc()._free(p);
+}
+
+static const struct mrb_data_type time_zone_cache_type = {
+    "time_zone_cache", time_zone_cache_free,
+};
+
+static time_zone_cache *
+time_zone_cache_get(mrb_state *mrb)
+{
+    mrb_sym key = mrb_intern_lit(mrb, TZ_CACHE_KEY);
+    time_zone_cache *cache = DATA_GET_PTR(mrb, mrb->mrb_gv_get(key), &time_zone_cache_type, time_zone_cache);
+
+    if (!cache) {
+        cache = (time_zone_cache *)mrb->gc()._malloc(sizeof(time_zone_cache));
+        cache->valid = false;
+        mrb->gv_set(key, RData::object_alloc(mrb, mrb->object_class, cache, &time_zone_cache_type)->wrap());
+    }
+    return cache;
+}
+
+static bool
+local_offset(time_t t, long *offset, int *isdst)
+{
+    struct tm buf, *lt;
+
+    if (!(lt = localtime_r(&t, &buf)))
+        return false;
+    *offset = (long)(time_timegm(lt) - t);
+    *isdst = lt->tm_isdst;
+    return true;
+}
+
+static void
+time_local_breakdown(mrb_state *mrb, time_t sec, struct tm *d)
+{
+    time_zone_cache *cache = time_zone_cache_get(mrb);
+    int64_t window = (int64_t)sec / TZ_WINDOW - (sec % TZ_WINDOW < 0);
+
+    if (!cache->valid || cache->window != window) {
+        long off0, off1;
+        int dst0, dst1;
+        time_t start = (time_t)(window * TZ_WINDOW);
+
+        if (!local_offset(start, &off0, &dst0) ||
+                !local_offset(start + TZ_WINDOW - 1, &off1, &dst1)) {
+            mrb->mrb_raise(E_ARGUMENT_ERROR, "time out of range");
+        }
+        if (off0 != off1 || dst0 != dst1) {
+            /* a transition falls inside this window */
+            cache->valid = false;
+            if (!local_offset(sec, &off0, &dst0)) {
+                mrb->mrb_raise(E_ARGUMENT_ERROR, "time out of range");
+            }
+            time_civil((int64_t)sec + off0, d);
+            d->tm_isdst = dst0;
+            return;
+        }
+        cache->valid = true;
+        cache->window = window;
+        cache->offset = off0;
+        cache->isdst = dst0;
+    }
+    time_civil((int64_t)sec + cache->offset, d);
+    d->tm_isdst = cache->isdst;
+}
+
+/** Returns the calendar breakdown of a mrb_time in its timezone,
+computing it on first use. */
+static struct tm *
+mrb_time_datetime(mrb_state *mrb, mrb_time *self)
+{
+    if (!self->have_datetime) {
+        if (self->timezone == MRB_TIMEZONE_UTC) {
+            time_civil((int64_t)self->sec, &self->datetime);
+        }
+        else {
+            time_local_breakdown(mrb, self->sec, &self->datetime);
+        }
+        self->have_datetime = true;
+    }
+    return &self->datetime;
+}
+
+static void
+mrb_time_set_timezone(mrb_time *self, mrb_timezone timezone)
+{
+    if (self->timezone != timezone) {
+        self->timezone = timezone;
+        self->have_datetime = false;
+    }
+}
+
+static mrb_value
+mrb_time_wrap(mrb_state *mrb, RClass *tc, mrb_time *tm)
+{
+    return RData::object_alloc(mrb, tc, tm, &mrb_time_type)->wrap();
+}
+
+static mrb_time *
+time_get(mrb_state *mrb, mrb_value self)
+{
+    return DATA_GET_PTR(mrb, self, &mrb_time_type, mrb_time);
+}
+
+/* Allocates a mrb_time object and initializes it. */
+static mrb_time*
+mrb_time_alloc(mrb_state *mrb, double sec, double usec, mrb_timezone timezone)
+{
+    mrb_time *tm;
+
+    tm = (mrb_time *)mrb->gc()._malloc(sizeof(mrb_time));
+    tm->sec  = (time_t)sec;
+    tm->usec = (sec - tm->sec) * 1.0e6 + usec;
+    while (tm->usec < 0) {
+        tm->sec--;
+        tm->usec += 1.0e6;
+    }
+    while (tm->usec > 1.0e6) {
+        tm->sec++;
+        tm->usec -= 1.0e6;
+    }
+    tm->timezone = timezone;
+    tm->have_datetime = false;
+
+    return tm;
+}
+
+static mrb_value
+mrb_time_make(mrb_state *mrb, RClass *c, double sec, double usec, mrb_timezone timezone)
+{
+    return mrb_time_wrap(mrb, c, mrb_time_alloc(mrb, sec, usec, timezone));
+}
+
+static mrb_time*
+current_mrb_time(mrb_state *mrb)
+{
+    mrb_time *tm;
+
+    tm = (mrb_time *)mrb->gc()._malloc(sizeof(*tm));
+#ifdef NO_CLOCK_GETTIME
+    {
+        static time_t last_sec = 0, last_usec = 0;
+
+        tm->sec  = time(NULL);
+        if (tm->sec != last_sec) {
+            last_sec = tm->sec;
+            last_usec = 0;
+        }
+        else {
+            /* add 1 usec to differentiate two times */
+            last_usec += 1;
+        }
+        tm->usec = last_usec;
+    }
+#else
+    {
+        struct timespec ts;
+
+        clock_gettime(CLOCK_REALTIME, &ts);
+        tm->sec = ts.tv_sec;
+        tm->usec = ts.tv_nsec / 1000;
+    }
+#endif
+    tm->timezone = MRB_TIMEZONE_LOCAL;
+    tm->have_datetime = false;
+
+    return tm;
+}
+
+/* Allocates a new Time object with given millis value. */
+static mrb_value
+mrb_time_now(mrb_state *mrb, mrb_value self)
+{
+    return mrb_time_wrap(mrb, self.ptr<RClass>(), current_mrb_time(mrb));
+}
+
+/* 15.2.19.6.1 */
+/* Creates an instance of time at the given time in seconds, etc. */
+static mrb_value
+mrb_time_at(mrb_state *mrb, mrb_value self)
+{
+    mrb_float f, f2 = 0;
+
+    mrb_get_args(mrb, "f|f", &f, &f2);
+    return mrb_time_make(mrb, self.ptr<RClass>(), f, f2, MRB_TIMEZONE_LOCAL);
+}
+
+static mrb_time*
+time_mktime(mrb_state *mrb, mrb_int ayear, mrb_int amonth, mrb_int aday,
+            mrb_int ahour, mrb_int amin, mrb_int asec, mrb_int ausec,
+            mrb_timezone timezone)
+{
+    time_t nowsecs;
+    struct tm nowtime = { 0 };
+
+    nowtime.tm_year  = (int)ayear  - 1900;
+    nowtime.tm_mon   = (int)amonth - 1;
+    nowtime.tm_mday  = (int)aday;
+    nowtime.tm_hour  = (int)ahour;
+    nowtime.tm_min   = (int)amin;
+    nowtime.tm_sec   = (int)asec;
+    nowtime.tm_isdst = -1;
+    if (timezone == MRB_TIMEZONE_UTC) {
+        nowsecs = time_timegm(&nowtime);
+    }
+    else {
+        nowsecs = mktime(&nowtime);
+    }
+    if (nowsecs < 0) {
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "Not a valid time.");
+    }
+
+    return mrb_time_alloc(mrb, nowsecs, ausec, timezone);
+}
+
+/* 15.2.19.6.2 */
+/* Creates an instance of time at the given time in UTC. */
+static mrb_value
+mrb_time_gm(mrb_state *mrb, mrb_value self)
+{
+    mrb_int ayear = 0, amonth = 1, aday = 1, ahour = 0, amin = 0, asec = 0, ausec = 0;
+
+    mrb_get_args(mrb, "i|iiiiii",
+                 &ayear, &amonth, &aday, &ahour, &amin, &asec, &ausec);
+    return mrb_time_wrap(mrb, self.ptr<RClass>(),
+                         time_mktime(mrb, ayear, amonth, aday, ahour, amin, asec, ausec, MRB_TIMEZONE_UTC));
+}
+
+
+/* 15.2.19.6.3 */
+/* Creates an instance of time at the given time in local time zone. */
+static mrb_value
+mrb_time_local(mrb_state *mrb, mrb_value self)
+{
+    mrb_int ayear = 0, amonth = 1, aday = 1, ahour = 0, amin = 0, asec = 0, ausec = 0;
+
+    mrb_get_args(mrb, "i|iiiiii",
+                 &ayear, &amonth, &aday, &ahour, &amin, &asec, &ausec);
+    return mrb_time_wrap(mrb, self.ptr<RClass>(),
+                         time_mktime(mrb, ayear, amonth, aday, ahour, amin, asec, ausec, MRB_TIMEZONE_LOCAL));
+}
+
+/*
+ *  call-seq:
+ *     Time.monotonic   ->  float
+ *
+ *  Seconds from an arbitrary starting point that never jumps with changes
+ *  to the system clock. Meant for measuring durations; no Time object is
+ *  allocated.
+ *
+ *     t = Time.monotonic
+ *     work
+ *     elapsed = Time.monotonic - t
+ */
+#ifdef NO_CLOCK_GETTIME
+#ifndef CLOCK_REALTIME
+#define CLOCK_REALTIME 0
+#endif
+#ifndef CLOCK_MONOTONIC
+#define CLOCK_MONOTONIC 1
+#endif
+#endif
+
+/* reads clock id; without clock_gettime(2) both clocks are time(3), at
+   one-second resolution, as in current_mrb_time */
+static void
+time_clock_read(mrb_state *mrb, mrb_int id, int64_t *sec, int64_t *nsec)
+{
+#ifdef NO_CLOCK_GETTIME
+    if (id != CLOCK_REALTIME && id != CLOCK_MONOTONIC) {
+        mrb->mrb_raisef(E_ARGUMENT_ERROR, "unsupported clock: %S", mrb_fixnum_value(id));
+    }
+    *sec = (int64_t)time(NULL);
+    *nsec = 0;
+#else
+    struct timespec ts;
+
+    if (clock_gettime((clockid_t)id, &ts) < 0) {
+        mrb_sys_fail(mrb, "clock_gettime");
+    }
+    *sec = (int64_t)ts.tv_sec;
+    *nsec = (int64_t)ts.tv_nsec;
+#endif
+}
+
+static mrb_value
+mrb_time_monotonic(mrb_state *mrb, mrb_value self)
+{
+    int64_t sec, nsec;
+
+    time_clock_read(mrb, CLOCK_MONOTONIC, &sec, &nsec);
+    return mrb_float_value((mrb_float)sec + (mrb_float)nsec / 1.0e9);
+}
+
+/*
+ *  call-seq:
+ *     Process.clock_gettime(clock_id [, unit])   ->  number
+ *
+ *  Reads the clock_id clock (Process::CLOCK_REALTIME, CLOCK_MONOTONIC,
+ *  ...). unit is one of :float_second (the default), :float_millisecond,
+ *  :float_microsecond, :second, :millisecond, :microsecond and
+ *  :nanosecond. Integer units that overflow a Fixnum come back as Float,
+ *  like any other Fixnum arithmetic.
+ */
+static mrb_value
+mrb_process_clock_gettime(mrb_state *mrb, mrb_value self)
+{
+    mrb_int id;
+    mrb_sym unit = 0;
+    int64_t sec, nsec;
+    int64_t scale;
+
+    mrb_get_args(mrb, "i|n", &id, &unit);
+    time_clock_read(mrb, id, &sec, &nsec);
+    if (unit == 0 || unit == mrb_intern_lit(mrb, "float_second"))
+        return mrb_float_value((mrb_float)sec + (mrb_float)nsec / 1.0e9);
+    if (unit == mrb_intern_lit(mrb, "float_millisecond"))
+        return mrb_float_value((mrb_float)sec * 1.0e3 + (mrb_float)nsec / 1.0e6);
+    if (unit == mrb_intern_lit(mrb, "float_microsecond"))
+        return mrb_float_value((mrb_float)sec * 1.0e6 + (mrb_float)nsec / 1.0e3);
+
+    if (unit == mrb_intern_lit(mrb, "second"))
+        scale = 1;
+    else if (unit == mrb_intern_lit(mrb, "millisecond"))
+        scale = 1000;
+    else if (unit == mrb_intern_lit(mrb, "microsecond"))
+        scale = 1000000;
+    else if (unit == mrb_intern_lit(mrb, "nanosecond"))
+        scale = 1000000000;
+    else
+        mrb->mrb_raisef(E_ARGUMENT_ERROR, "unexpected unit: %S", mrb_symbol_value(unit));
+
+    int64_t v = sec * scale + nsec / (1000000000 / scale);
+    if (FIXABLE(v))
+        return mrb_fixnum_value((mrb_int)v);
+    return mrb_float_value((mrb_float)v);
+}
+
+
+static mrb_value
+mrb_time_eq(mrb_state *mrb, mrb_value self)
+{
+    mrb_value other;
+    mrb_time *tm1, *tm2;
+
+    mrb_get_args(mrb, "o", &other);
+    tm1 = time_get(mrb, self);
+    tm2 = time_get(mrb, other);
+
+    return mrb_value::wrap(tm1 && tm2 && tm1->sec == tm2->sec && tm1->usec == tm2->usec);
+}
+
+static mrb_value
+mrb_time_cmp(mrb_state *mrb, mrb_value self)
+{
+    mrb_value other;
+    mrb_time *tm1, *tm2;
+
+    mrb_get_args(mrb, "o", &other);
+    tm1 = time_get(mrb, self);
+    tm2 = time_get(mrb, other);
+    if (!tm1 || !tm2) return mrb_value::nil();
+    if (tm1->sec > tm2->sec) {
+        return mrb_fixnum_value(1);
+    }
+    else if (tm1->sec < tm2->sec) {
+        return mrb_fixnum_value(-1);
+    }
+    /* tm1->sec == tm2->sec */
+    if (tm1->usec > tm2->usec) {
+        return mrb_fixnum_value(1);
+    }
+    else if (tm1->usec < tm2->usec) {
+        return mrb_fixnum_value(-1);
+    }
+    return mrb_fixnum_value(0);
+}
+
+static mrb_value
+mrb_time_plus(mrb_state *mrb, mrb_value self)
+{
+    mrb_float f;
+    mrb_time *tm;
+
+    mrb_get_args(mrb, "f", &f);
+    tm = time_get(mrb, self);
+    if (!tm) return mrb_value::nil();
+    return mrb_time_make(mrb, mrb_obj_class(mrb, self), (double)tm->sec+f, tm->usec, tm->timezone);
+}
+
+static mrb_value
+mrb_time_minus(mrb_state *mrb, mrb_value self)
+{
+    mrb_float f;
+    mrb_value other;
+    mrb_time *tm, *tm2;
+
+    mrb_get_args(mrb, "o", &other);
+    tm = time_get(mrb, self);
+    if (!tm) return mrb_value::nil();
+
+    tm2 = time_get(mrb, other);
+    if (tm2) {
+        f = (mrb_float)(tm->sec - tm2->sec)
+                + (mrb_float)(tm->usec - tm2->usec) / 1.0e6;
+        return mrb_float_value(f);
+    }
+    else {
+        mrb_get_args(mrb, "f", &f);
+        return mrb_time_make(mrb, mrb_obj_class(mrb, self), (double)tm->sec-f, tm->usec, tm->timezone);
+    }
+}
+
+/* 15.2.19.7.30 */
+/* Returns week day number of time. */
+static mrb_value
+mrb_time_wday(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    return mrb_fixnum_value(mrb_time_datetime(mrb, tm)->tm_wday);
+}
+
+/* 15.2.19.7.31 */
+/* Returns year day number of time. */
+static mrb_value
+mrb_time_yday(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    return mrb_fixnum_value(mrb_time_datetime(mrb, tm)->tm_yday + 1);
+}
+
+/* 15.2.19.7.32 */
+/* Returns year of time. */
+static mrb_value
+mrb_time_year(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    return mrb_fixnum_value(mrb_time_datetime(mrb, tm)->tm_year + 1900);
+}
+
+/* 15.2.19.7.33 */
+/* Returns name of time's timezone. */
+static mrb_value
+mrb_time_zone(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    if (tm->timezone <= MRB_TIMEZONE_NONE) return mrb_value::nil();
+    if (tm->timezone >= MRB_TIMEZONE_LAST) return mrb_value::nil();
+    return mrb_str_new_cstr(mrb, timezone_names[tm->timezone])->wrap();
+}
+
+/* 15.2.19.7.4 */
+/* Returns a string that describes the time. */
+static mrb_value
+mrb_time_asctime(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+    struct tm *d;
+    char buf[256];
+    int len;
+
+    if (!tm) return mrb_value::nil();
+    d = mrb_time_datetime(mrb, tm);
+    len = snprintf(buf, sizeof(buf), "%s %s %02d %02d:%02d:%02d %s%d",
+                   wday_names[d->tm_wday], mon_names[d->tm_mon], d->tm_mday,
+                   d->tm_hour, d->tm_min, d->tm_sec,
+                   tm->timezone == MRB_TIMEZONE_UTC ? "UTC " : "",
+                   d->tm_year + 1900);
+    return mrb_str_new(mrb, buf, len);
+}
+
+/* 15.2.19.7.6 */
+/* Returns the day in the month of the time. */
+static mrb_value
+mrb_time_day(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    return mrb_fixnum_value(mrb_time_datetime(mrb, tm)->tm_mday);
+}
+
+
+/* 15.2.19.7.7 */
+/* Returns true if daylight saving was applied for this time. */
+static mrb_value
+mrb_time_dstp(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    return mrb_value::wrap(mrb_time_datetime(mrb, tm)->tm_isdst > 0);
+}
+
+static mrb_value
+time_copy_in_zone(mrb_state *mrb, mrb_value self, mrb_timezone timezone)
+{
+    mrb_time *tm, *tm2;
+
+    tm = time_get(mrb, self);
+    if (!tm) return self;
+    tm2 = (mrb_time *)mrb->gc()._malloc(sizeof(*tm));
+    *tm2 = *tm;
+    mrb_time_set_timezone(tm2, timezone);
+    return mrb_time_wrap(mrb, mrb_obj_class(mrb, self), tm2);
+}
+
+/* 15.2.19.7.8 */
+/* 15.2.19.7.10 */
+/* Returns the Time object of the UTC(GMT) timezone. */
+static mrb_value
+mrb_time_getutc(mrb_state *mrb, mrb_value self)
+{
+    return time_copy_in_zone(mrb, self, MRB_TIMEZONE_UTC);
+}
+
+/* 15.2.19.7.9 */
+/* Returns the Time object of the LOCAL timezone. */
+static mrb_value
+mrb_time_getlocal(mrb_state *mrb, mrb_value self)
+{
+    return time_copy_in_zone(mrb, self, MRB_TIMEZONE_LOCAL);
+}
+
+/* 15.2.19.7.15 */
+/* Returns hour of time. */
+static mrb_value
+mrb_time_hour(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    return mrb_fixnum_value(mrb_time_datetime(mrb, tm)->tm_hour);
+}
+
+/* 15.2.19.7.16 */
+/* Initializes a time by setting the amount of milliseconds since the epoch.*/
+static mrb_value
+mrb_time_initialize(mrb_state *mrb, mrb_value self)
+{
+    mrb_int ayear = 0, amonth = 1, aday = 1, ahour = 0,
+            amin = 0, asec = 0, ausec = 0;
+    int n;
+    mrb_time *tm;
+
+    tm = (mrb_time*)DATA_PTR(self);
+    if (tm) {
+        mrb_time_free(mrb, tm);
+    }
+    DATA_TYPE(self) = &mrb_time_type;
+    DATA_PTR(self) = NULL;
+
+    n = mrb_get_args(mrb, "|iiiiiii",
+                     &ayear, &amonth, &aday, &ahour, &amin, &asec, &ausec);
+    if (n == 0) {
+        tm = current_mrb_time(mrb);
+    }
+    else {
+        tm = time_mktime(mrb, ayear, amonth, aday, ahour, amin, asec, ausec, MRB_TIMEZONE_LOCAL);
+    }
+    DATA_PTR(self) = tm;
+    return self;
+}
+
+/* 15.2.19.7.17(x) */
+/* Initializes a copy of this time object. */
+static mrb_value
+mrb_time_initialize_copy(mrb_state *mrb, mrb_value copy)
+{
+    mrb_value src;
+
+    mrb_get_args(mrb, "o", &src);
+    if (mrb_obj_equal(copy, src)) return copy;
+    if (!src.is_instance_of(mrb, mrb_obj_class(mrb, copy))) {
+        mrb->mrb_raise(E_TYPE_ERROR, "wrong argument class");
+    }
+    if (!DATA_PTR(copy)) {
+        DATA_PTR(copy) = mrb->gc()._malloc(sizeof(mrb_time));
+        DATA_TYPE(copy) = &mrb_time_type;
+    }
+    *(mrb_time *)DATA_PTR(copy) = *(mrb_time *)DATA_PTR(src);
+    return copy;
+}
+
+/* 15.2.19.7.18 */
+/* Sets the timezone attribute of the Time object to LOCAL. */
+static mrb_value
+mrb_time_localtime(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (tm)
+        mrb_time_set_timezone(tm, MRB_TIMEZONE_LOCAL);
+    return self;
+}
+
+/* 15.2.19.7.19 */
+/* Returns day of month of time. */
+static mrb_value
+mrb_time_mday(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    return mrb_fixnum_value(mrb_time_datetime(mrb, tm)->tm_mday);
+}
+
+/* 15.2.19.7.20 */
+/* Returns minutes of time. */
+static mrb_value
+mrb_time_min(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    return mrb_fixnum_value(mrb_time_datetime(mrb, tm)->tm_min);
+}
+
+/* 15.2.19.7.21 and 15.2.19.7.22 */
+/* Returns month of time. */
+static mrb_value
+mrb_time_mon(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    return mrb_fixnum_value(mrb_time_datetime(mrb, tm)->tm_mon + 1);
+}
+
+/* 15.2.19.7.23 */
+/* Returns seconds in minute of time. */
+static mrb_value
+mrb_time_sec(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    return mrb_fixnum_value(mrb_time_datetime(mrb, tm)->tm_sec);
+}
+
+
+/* 15.2.19.7.24 */
+/* Returns a Float with the time since the epoch in seconds. */
+static mrb_value
+mrb_time_to_f(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    return mrb_float_value((mrb_float)tm->sec + (mrb_float)tm->usec/1.0e6);
+}
+
+/* 15.2.19.7.25 */
+/* Returns a Fixnum with the time since the epoch in seconds. */
+static mrb_value
+mrb_time_to_i(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    return mrb_fixnum_value(tm->sec);
+}
+
+/* 15.2.19.7.26 */
+/* Returns a Float with the time since the epoch in microseconds. */
+static mrb_value
+mrb_time_usec(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    return mrb_fixnum_value(tm->usec);
+}
+
+/* 15.2.19.7.27 */
+/* Sets the timezone attribute of the Time object to UTC. */
+static mrb_value
+mrb_time_utc(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (tm)
+        mrb_time_set_timezone(tm, MRB_TIMEZONE_UTC);
+    return self;
+}
+
+/* 15.2.19.7.28 */
+/* Returns true if this time is in the UTC timezone false if not. */
+static mrb_value
+mrb_time_utcp(mrb_state *mrb, mrb_value self)
+{
+    mrb_time *tm = time_get(mrb, self);
+
+    if (!tm) return mrb_value::nil();
+    return mrb_value::wrap(tm->timezone == MRB_TIMEZONE_UTC);
+}
+
+
+
+void
+mrb_mruby_time_gem_init(mrb_state* mrb)
+{
+    /* ISO 15.2.19.2 */
+    RClass &tc = mrb->define_class("Time", mrb->object_class);
+
+    tc.instance_tt(MRB_TT_DATA)
+            .include_module("Comparable")
+            .define_class_method("at", mrb_time_at, MRB_ARGS_ANY())            /* 15.2.19.6.1 */
+            .define_class_method("gm", mrb_time_gm, MRB_ARGS_ARG(1,6))         /* 15.2.19.6.2 */
+            .define_class_method("local", mrb_time_local, MRB_ARGS_ARG(1,6))   /* 15.2.19.6.3 */
+            .define_class_method("mktime", mrb_time_local, MRB_ARGS_ARG(1,6))  /* 15.2.19.6.4 */
+            .define_class_method("now", mrb_time_now, MRB_ARGS_NONE())         /* 15.2.19.6.5 */
+            .define_class_method("utc", mrb_time_gm, MRB_ARGS_ARG(1,6))        /* 15.2.19.6.6 */
+            .define_class_method("monotonic", mrb_time_monotonic, MRB_ARGS_NONE())
+
+            .define_method("=="     , mrb_time_eq     , MRB_ARGS_REQ(1))
+            .define_method("<=>"    , mrb_time_cmp    , MRB_ARGS_REQ(1)) /* 15.2.19.7.1 */
+            .define_method("+"      , mrb_time_plus   , MRB_ARGS_REQ(1)) /* 15.2.19.7.2 */
+            .define_method("-"      , mrb_time_minus  , MRB_ARGS_REQ(1)) /* 15.2.19.7.3 */
+            .define_method("to_s"   , mrb_time_asctime, MRB_ARGS_NONE())
+            .define_method("inspect", mrb_time_asctime, MRB_ARGS_NONE())
+            .define_method("asctime", mrb_time_asctime, MRB_ARGS_NONE()) /* 15.2.19.7.4 */
+            .define_method("ctime"  , mrb_time_asctime, MRB_ARGS_NONE()) /* 15.2.19.7.5 */
+            .define_method("day"    , mrb_time_day    , MRB_ARGS_NONE()) /* 15.2.19.7.6 */
+            .define_method("dst?"   , mrb_time_dstp   , MRB_ARGS_NONE()) /* 15.2.19.7.7 */
+            .define_method("getgm"  , mrb_time_getutc , MRB_ARGS_NONE()) /* 15.2.19.7.8 */
+            .define_method("getlocal",mrb_time_getlocal,MRB_ARGS_NONE()) /* 15.2.19.7.9 */
+            .define_method("getutc" , mrb_time_getutc , MRB_ARGS_NONE()) /* 15.2.19.7.10 */
+            .define_method("gmt?"   , mrb_time_utcp   , MRB_ARGS_NONE()) /* 15.2.19.7.11 */
+            .define_method("gmtime" , mrb_time_utc    , MRB_ARGS_NONE()) /* 15.2.19.7.13 */
+            .define_method("hour"   , mrb_time_hour, MRB_ARGS_NONE())    /* 15.2.19.7.15 */
+            .define_method("localtime", mrb_time_localtime, MRB_ARGS_NONE()) /* 15.2.19.7.18 */
+            .define_method("mday"   , mrb_time_mday, MRB_ARGS_NONE())    /* 15.2.19.7.19 */
+            .define_method("min"    , mrb_time_min, MRB_ARGS_NONE())     /* 15.2.19.7.20 */
+
+            .define_method("mon"  , mrb_time_mon, MRB_ARGS_NONE())       /* 15.2.19.7.21 */
+            .define_method("month", mrb_time_mon, MRB_ARGS_NONE())       /* 15.2.19.7.22 */
+
+            .define_method("sec" , mrb_time_sec, MRB_ARGS_NONE())        /* 15.2.19.7.23 */
+            .define_method("to_i", mrb_time_to_i, MRB_ARGS_NONE())       /* 15.2.19.7.25 */
+            .define_method("to_f", mrb_time_to_f, MRB_ARGS_NONE())       /* 15.2.19.7.24 */
+            .define_method("usec", mrb_time_usec, MRB_ARGS_NONE())       /* 15.2.19.7.26 */
+            .define_method("utc" , mrb_time_utc, MRB_ARGS_NONE())        /* 15.2.19.7.27 */
+            .define_method("utc?", mrb_time_utcp, MRB_ARGS_NONE())       /* 15.2.19.7.28 */
+            .define_method("wday", mrb_time_wday, MRB_ARGS_NONE())       /* 15.2.19.7.30 */
+            .define_method("yday", mrb_time_yday, MRB_ARGS_NONE())       /* 15.2.19.7.31 */
+            .define_method("year", mrb_time_year, MRB_ARGS_NONE())       /* 15.2.19.7.32 */
+            .define_method("zone", mrb_time_zone, MRB_ARGS_NONE())       /* 15.2.19.7.33 */
+
+            .define_method("initialize", mrb_time_initialize, MRB_ARGS_REQ(1)) /* 15.2.19.7.16 */
+            .define_method("initialize_copy", mrb_time_initialize_copy, MRB_ARGS_REQ(1)) /* 15.2.19.7.17 */
+            .fin();
+
+    /*
+    methods not available:
+      gmt_offset(15.2.19.7.12)
+      gmtoff(15.2.19.7.14)
+      utc_offset(15.2.19.7.29)
+  */
+
+    mrb->define_module("Process")
+            .define_const("CLOCK_REALTIME", mrb_fixnum_value(CLOCK_REALTIME))
+            .define_const("CLOCK_MONOTONIC", mrb_fixnum_value(CLOCK_MONOTONIC))
+        #ifdef CLOCK_PROCESS_CPUTIME_ID
+            .define_const("CLOCK_PROCESS_CPUTIME_ID", mrb_fixnum_value(CLOCK_PROCESS_CPUTIME_ID))
+        #endif
+        #ifdef CLOCK_THREAD_CPUTIME_ID
+            .define_const("CLOCK_THREAD_CPUTIME_ID", mrb_fixnum_value(CLOCK_THREAD_CPUTIME_ID))
+        #endif
+            .define_module_function("clock_gettime", mrb_process_clock_gettime, MRB_ARGS_ARG(1,1))
+            .fin();
+}
+
+void
+mrb_mruby_time_gem_final(mrb_state* mrb)
+{
+}
@@ -197,5 +197,46 @@ if Object.const_defined?(:Time)
   assert('Time#inspect') do
     Time.at(1300000000.0).utc.inspect == "Sun Mar 13 07:06:40 UTC 2011"
   end
-end
 
+  assert('Time fields across dates') do
+    t = Time.gm(2000, 2, 29, 23, 59, 58)
+    assert_equal [2000, 2, 29, 23, 59, 58], [t.year, t.mon, t.day, t.hour, t.min, t.sec]
+    assert_equal 2, t.wday
+    assert_equal 60, t.yday
+    t = Time.gm(1970, 1, 1) - 43200
+    assert_equal [1969, 12, 31, 3, 365], [t.year, t.mon, t.day, t.wday, t.yday]
+    t = Time.at(1300000000.0).utc + 86400 * 366
+    assert_equal "Tus Mar 13 07:06:40 UTC 2012", t.to_s
+  end
+
+  assert('Time#utc and #localtime recompute fields') do
+    t = Time.local(2012, 7, 1, 12, 30, 15)
+    assert_equal 12, t.hour
+    u = t.getutc
+    assert_equal t.to_i, u.to_i
+    assert_equal 15, u.sec
+    t.utc
+    assert_equal u.hour, t.hour
+    t.localtime
+    assert_equal 12, t.hour
+  end
+
+  assert('Time.monotonic') do
+    t1 = Time.monotonic
+    t2 = Time.monotonic
+    assert_kind_of Float, t1
+    assert_true t2 >= t1
+  end
+
+  assert('Process.clock_gettime') do
+    t = Process.clock_gettime(Process::CLOCK_REALTIME)
+    assert_kind_of Float, t
+    assert_true (t - Time.now.to_f).abs < 1
+    assert_kind_of Fixnum, Process.clock_gettime(Process::CLOCK_REALTIME, :second)
+    m1 = Process.clock_gettime(Process::CLOCK_MONOTONIC, :float_millisecond)
+    m2 = Process.clock_gettime(Process::CLOCK_MONOTONIC, :float_millisecond)
+    assert_true m2 >= m1
+    assert_true Process.clock_gettime(Process::CLOCK_MONOTONIC, :nanosecond) > 0
+    assert_raise(ArgumentError) { Process.clock_gettime(Process::CLOCK_MONOTONIC, :fortnight) }
+  end
+end
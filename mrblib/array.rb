@@ -101,9 +101,122 @@ class Array
   include Comparable
 
   ##
-  # Sort all elements and replace +self+ with these
-  # elements.
+  # Sort +self+ in place. Elements are compared with
+  # <=>, or with the block, which must return a
+  # negative number, zero or a positive number. The
+  # sort is stable.
+  #
+  # Arrays of only Fixnums, only Floats or only
+  # Strings are sorted natively. Everything else is
+  # merged here in Ruby, so <=> and the block may
+  # switch fibers.
   def sort!(&block)
-    self.replace(self.sort(&block))
+    unless !block && self.__sort_builtin__(nil)
+      work = [].replace(self)
+      __sort_merge__(work) {|a, b| __sort_cmp__(a, b, block) }
+      self.replace(work)
+    end
+    self
+  end
+
+  ##
+  # Return a new array with the elements of +self+
+  # sorted; see Array#sort!.
+  def sort(&block)
+    [].replace(self).sort!(&block)
+  end
+
+  ##
+  # Return a new array with the elements of +self+
+  # ordered by the keys the block returns for them.
+  # The block is called once per element. The sort
+  # is stable.
+  def sort_by(&block)
+    raise ArgumentError, "no block given" unless block
+    vals = [].replace(self)
+    keys = vals.map(&block)
+    idx = Array.new(vals.size) {|i| i }
+    unless idx.__sort_builtin__(keys)
+      __sort_merge__(idx) {|i, j| __sort_cmp__(keys[i], keys[j], nil) }
+    end
+    idx.collect! {|i| vals[i] }
+  end
+
+  ##
+  # Private method for #sort! and #sort_by: compare
+  # +a+ and +b+ with the block, or with <=> if there
+  # is none.
+  def __sort_cmp__(a, b, block)
+    r = block ? block.call(a, b) : a <=> b
+    unless r.kind_of?(Numeric)
+      raise ArgumentError, "comparison of #{a.class} with #{b.class} failed"
+    end
+    r
+  end
+
+  ##
+  # Private method for #sort! and #sort_by: stable
+  # merge sort of +ary+ in place. The block compares
+  # two elements like <=>. Runs of 16 are insertion
+  # sorted first, then merged bottom-up.
+  def __sort_merge__(ary, &cmp)
+    n = ary.size
+    lo = 0
+    while lo < n
+      hi = lo + 16
+      hi = n if hi > n
+      i = lo + 1
+      while i < hi
+        v = ary[i]
+        j = i
+        while j > lo && cmp.call(ary[j - 1], v) > 0
+          ary[j] = ary[j - 1]
+          j -= 1
+        end
+        ary[j] = v
+        i += 1
+      end
+      lo = hi
+    end
+
+    src, dst = ary, Array.new(n)
+    width = 16
+    while width < n
+      lo = 0
+      while lo < n
+        mid = lo + width
+        mid = n if mid > n
+        hi = mid + width
+        hi = n if hi > n
+        i, j, k = lo, mid, lo
+        if mid < hi && cmp.call(src[mid - 1], src[mid]) > 0
+          while i < mid && j < hi
+            if cmp.call(src[j], src[i]) < 0
+              dst[k] = src[j]
+              j += 1
+            else
+              dst[k] = src[i]
+              i += 1
+            end
+            k += 1
+          end
+        end
+        while i < mid
+          dst[k] = src[i]
+          i += 1
+          k += 1
+        end
+        while j < hi
+          dst[k] = src[j]
+          j += 1
+          k += 1
+        end
+        lo = hi
+      end
+      src, dst = dst, src
+      width *= 2
+    end
+    ary.replace(src) unless src.equal?(ary)
+    ary
   end
 end
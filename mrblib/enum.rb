@@ -333,45 +333,6 @@ module Enumerable
   # ISO 15.3.2.2.18
   alias select find_all
 
-  ##
-  # TODO
-  # Does this OK? Please test it.
-  def __sort_sub__(sorted, work, src_ary, head, tail, &block)
-    if head == tail
-      sorted[head] = work[head] if src_ary == 1
-      return
-    end
-
-    # on current step, which is a src ary?
-    if src_ary == 0
-      src, dst = sorted, work
-    else
-      src, dst = work, sorted
-    end
-
-    key = src[head]    # key value for dividing values
-    i, j = head, tail  # position to store on the dst ary
-
-    (head + 1).upto(tail){|idx|
-      if ((block)? block.call(src[idx], key): (src[idx] <=> key)) > 0
-        # larger than key
-        dst[j] = src[idx]
-        j -= 1
-      else
-        dst[i] = src[idx]
-        i += 1
-      end
-    }
-
-    sorted[i] = key
-
-    # sort each sub-array
-    src_ary = (src_ary + 1) % 2  # exchange a src ary
-    __sort_sub__(sorted, work, src_ary, head, i - 1, &block) if i > head
-    __sort_sub__(sorted, work, src_ary, i + 1, tail, &block) if i < tail
-  end
-#  private :__sort_sub__
-
   ##
   # Return a sorted array of all elements
   # which are yield by +each+. If no block
@@ -384,10 +345,18 @@ module Enumerable
   def sort(&block)
     ary = []
     self.each{|val| ary.push(val)}
-    unless ary.empty?
-      __sort_sub__(ary, ::Array.new(ary.size), 0, 0, ary.size - 1, &block)
-    end
-    ary
+    ary.sort!(&block)
+  end
+
+  ##
+  # Return a sorted array of all elements
+  # which are yield by +each+, ordered by
+  # the values the block returns for them.
+  # The block is called once per element.
+  def sort_by(&block)
+    ary = []
+    self.each{|val| ary.push(val)}
+    ary.sort_by(&block)
   end
 
   ##
@@ -103,8 +103,10 @@ class String
 
   ##
   # Call the given block for each character of
-  # +self+.
+  # +self+. Without a block, return the characters
+  # as an Array.
   def each_char(&block)
+    return self.chars unless block
     pos = 0
     while(pos < self.size)
       block.call(self[pos])
@@ -115,11 +117,12 @@ class String
 
   ##
   # Call the given block for each byte of +self+.
+  # Without a block, return the bytes as an Array.
   def each_byte(&block)
-    bytes = self.bytes
+    return self.bytes unless block
     pos = 0
-    while(pos < bytes.size)
-      block.call(bytes[pos])
+    while(pos < self.size)
+      block.call(self.getbyte(pos))
       pos += 1
     end
     self
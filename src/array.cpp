@@ -3,6 +3,7 @@
 **
 ** See Copyright Notice in mruby.h
 */
+#include <algorithm>
 #include <vector>
 #include <limits.h>
 #include "mruby.h"
@@ -20,7 +21,7 @@
 #define ARY_SHARED_P(a) ((a)->flags & MRB_ARY_SHARED)
 #define ARY_SET_SHARED_FLAG(a) ((a)->flags |= MRB_ARY_SHARED)
 #define ARY_UNSET_SHARED_FLAG(a) ((a)->flags &= ~MRB_ARY_SHARED)
-#define ARY_SHIFT_SHARED_MIN 10
+#define ARY_MAX_GAP UINT32_MAX /* RBasic::m_gap is 32 bit */
 size_t gAllocatedSize=0;
 RArray* RArray::ary_new_capa(mrb_state *mrb, size_t capa)
 {
@@ -84,10 +85,10 @@ void RArray::ary_modify()
         return;
     mrb_shared_array *shared = m_aux.shared;
 
-    if (shared->refcnt == 1 && m_ptr == shared->ptr) {
-        // single reference, we can use already allocated buffer
-        m_ptr = shared->ptr;
-        m_aux.capa = m_len; // overwrites m_aux.shared
+    if (shared->refcnt == 1 && (size_t)(m_ptr - shared->ptr) <= ARY_MAX_GAP) {
+        // single reference, we can use already allocated buffer, slots before m_ptr become the gap
+        m_gap = m_ptr - shared->ptr;
+        m_aux.capa = shared->len - m_gap; // overwrites m_aux.shared
         m_vm->gc()._free(shared);
     }
     else {
@@ -97,6 +98,7 @@ void RArray::ary_modify()
             array_copy(_ptr, m_ptr, m_len);
         }
         m_ptr = _ptr;
+        m_gap = 0;
         m_aux.capa = m_len;
         mrb_ary_decref(m_vm, shared);
     }
@@ -115,23 +117,43 @@ void RArray::ary_make_shared()
     mrb_shared_array *shared = (mrb_shared_array *)m_vm->gc()._malloc(sizeof(mrb_shared_array));
 
     shared->refcnt = 1;
+    mrb_value *base = m_ptr - m_gap;
     if (m_aux.capa > m_len) {
-        m_ptr = (mrb_value *)m_vm->gc()._realloc(m_ptr, sizeof(mrb_value)*m_len+1);
+        base = (mrb_value *)m_vm->gc()._realloc(base, sizeof(mrb_value)*(m_gap+m_len)+1);
+        m_ptr = base + m_gap;
     }
-    shared->ptr = m_ptr;
-    shared->len = m_len;
+    shared->ptr = base;
+    shared->len = m_gap + m_len;
+    m_gap = 0;
     m_aux.shared = shared;
     ARY_SET_SHARED_FLAG(this);
 }
 
+/* moves the elements back to the start of the buffer */
+void RArray::ary_compact()
+{
+    mrb_value *base = m_ptr - m_gap;
+
+    value_move(base, m_ptr, m_len);
+    m_aux.capa += m_gap;
+    m_ptr = base;
+    m_gap = 0;
+}
+
 void RArray::ary_expand_capa(mrb_state *mrb, size_t _len)
 {
     assert(!ARY_SHARED_P(this)); // will not work if in shared mode
-    mrb_int capa = m_aux.capa;
 
     if (_len > ARY_MAX_SIZE) {
         mrb_raise(E_ARGUMENT_ERROR, "array size too big");
     }
+    if (m_gap && m_gap >= m_len) {
+        // at least as many free slots in front as there are elements, sliding them is cheaper
+        ary_compact();
+        if ((size_t)m_aux.capa >= _len)
+            return;
+    }
+    mrb_int capa = m_aux.capa;
 
     if (capa == 0) {
         capa = ARY_DEFAULT_LEN;
@@ -144,14 +166,14 @@ void RArray::ary_expand_capa(mrb_state *mrb, size_t _len)
         capa = ARY_MAX_SIZE; /* len <= capa <= ARY_MAX_SIZE */
 
     if (capa > m_aux.capa) {
-        mrb_value *expanded_ptr = (mrb_value *)mrb->gc()._realloc(m_ptr, sizeof(mrb_value)*capa);
+        mrb_value *expanded_ptr = (mrb_value *)mrb->gc()._realloc(m_ptr - m_gap, sizeof(mrb_value)*(m_gap+capa));
 
         if(!expanded_ptr) {
             mrb_raise(E_RUNTIME_ERROR, "out of memory");
         }
 
         m_aux.capa = capa;
-        m_ptr = expanded_ptr;
+        m_ptr = expanded_ptr + m_gap;
     }
 }
 
@@ -174,27 +196,66 @@ void RArray::ary_shrink_capa()
 
     if (capa > m_len && capa < m_aux.capa) {
         m_aux.capa = capa;
-        m_ptr = (mrb_value *)m_vm->gc()._realloc(m_ptr, sizeof(mrb_value)*capa);
+        m_ptr = (mrb_value *)m_vm->gc()._realloc(m_ptr - m_gap, sizeof(mrb_value)*(m_gap+capa)) + m_gap;
+    }
+}
+
+/* moves m_ptr back over n writable slots, keeping front room for further unshifts */
+void RArray::ary_unshift_room(mrb_int n)
+{
+    if (ARY_SHARED_P(this)
+            && m_aux.shared->refcnt == 1 /* shared only referenced from this array */
+            && m_ptr - base_ptr() >= n) /* there's room for unshifted item */ {
+        m_ptr -= n;
+        return;
     }
+    ary_modify();
+    if (m_gap < n) {
+        // reallocate with as many free slots in front as there are elements, so a run
+        // of unshifts pays for the copy
+        mrb_int room = n + std::max<mrb_int>(m_len, ARY_DEFAULT_LEN);
+        mrb_int tail = m_aux.capa - m_len;
+
+        if ((size_t)room > ARY_MAX_GAP || m_len + tail > ARY_MAX_SIZE - room) {
+            m_vm->mrb_raise(A_ARGUMENT_ERROR(m_vm), "array size too big");
+        }
+        mrb_value *base = (mrb_value *)m_vm->gc()._malloc(sizeof(mrb_value)*(room+m_len+tail));
+        if (m_len)
+            array_copy(base + room, m_ptr, m_len);
+        m_vm->gc()._free(m_ptr - m_gap);
+        m_ptr = base + room;
+        m_gap = room;
+        m_aux.capa = m_len + tail;
+    }
+    m_ptr -= n;
+    m_gap -= n;
+    m_aux.capa += n;
 }
 
 RArray * RArray::s_create(mrb_state *mrb, mrb_value )
 {
-    mrb_value *vals;
-    int len;
+    ArgRest vals;
 
-    mrb_get_args(mrb, "*", &vals, &len);
-    return RArray::new_from_values(mrb, len, vals);
+    mrb->get_args(vals);
+    return RArray::new_from_values(mrb, vals.len, vals.ptr);
 }
 
 void RArray::ary_concat(const mrb_value *_ptr, mrb_int blen)
 {
     mrb_int _len = m_len + blen;
+    ptrdiff_t off = -1;
 
     ary_modify();
+    if (_ptr >= m_ptr && _ptr <= m_ptr + m_len) {
+        /* our own elements, expanding may move them */
+        off = _ptr - m_ptr;
+    }
     if (m_aux.capa < _len)
         ary_expand_capa(m_vm, _len);
-    array_copy(m_ptr+m_len, _ptr, blen);
+    if (off != -1)
+        value_move(m_ptr+m_len, m_ptr+off, blen);
+    else
+        array_copy(m_ptr+m_len, _ptr, blen);
     m_vm->gc().mrb_write_barrier(this);
     m_len = _len;
 }
@@ -206,18 +267,19 @@ void RArray::concat(const RArray *a2)
 
 void RArray::concat_m()
 {
-    mrb_value *ptr;
-    mrb_int blen;
-    mrb_get_args(m_vm, "a", &ptr, &blen);
-    this->ary_concat(ptr, blen);
+    RArray *a2;
+
+    m_vm->get_args(a2);
+    this->ary_concat(a2->m_ptr, a2->m_len);
 }
 
 RArray *RArray::plus() const
 {
-    mrb_value *ptr;
-    mrb_int blen;
+    RArray *other;
 
-    mrb_get_args(m_vm, "a", &ptr, &blen);
+    m_vm->get_args(other);
+    mrb_value *ptr = other->m_ptr;
+    mrb_int blen = other->m_len;
     RArray *a2 = RArray::create(m_vm, m_len + blen);
     assert(a2->m_ptr && m_ptr && ptr);
     array_copy(a2->m_ptr, m_ptr, m_len);
@@ -274,10 +336,19 @@ mrb_value RArray::cmp() const
 
 void RArray::ary_replace(const mrb_value *argv, mrb_int len)
 {
+    ptrdiff_t off = -1;
+
     ary_modify();
+    if (argv >= m_ptr && argv <= m_ptr + m_len) {
+        /* our own elements, expanding may move them */
+        off = argv - m_ptr;
+    }
     if (m_aux.capa < len)
         ary_expand_capa(m_vm, len);
-    array_copy(m_ptr, argv, len);
+    if (off != -1)
+        value_move(m_ptr, m_ptr+off, len);
+    else
+        array_copy(m_ptr, argv, len);
     m_vm->gc().mrb_write_barrier(this);
     m_len = len;
 }
@@ -291,10 +362,10 @@ void RArray::replace(const mrb_value &other)
 
 void RArray::replace_m()
 {
-    mrb_value other;
+    RArray *other;
 
-    mrb_get_args(m_vm, "A", &other);
-    replace(other);
+    m_vm->get_args(other);
+    this->ary_replace(other->m_ptr, other->m_len);
 }
 
 RArray* RArray::times()
@@ -367,7 +438,7 @@ void RArray::release() {
     if (flags & MRB_ARY_SHARED)
         mrb_ary_decref(m_vm, m_aux.shared);
     else
-        m_vm->gc()._free(m_ptr);
+        m_vm->gc()._free(m_ptr - m_gap);
 }
 
 void RArray::push(const mrb_value &elem) /* mrb_ary_push */
@@ -381,12 +452,11 @@ void RArray::push(const mrb_value &elem) /* mrb_ary_push */
 
 void RArray::push_m()
 {
-    mrb_value *argv;
-    int len;
+    ArgRest argv;
 
-    mrb_get_args(m_vm, "*", &argv, &len);
-    while(len--) {
-        push(*argv++);
+    m_vm->get_args(argv);
+    for (int i = 0; i < argv.len; i++) {
+        push(argv.ptr[i]);
     }
 
 }
@@ -406,23 +476,18 @@ mrb_value RArray::shift()
     if (m_len == 0)
         return mrb_value::nil();
     assert(m_ptr);
-    if (this->flags & MRB_ARY_SHARED) {
-        mrb_value val = m_ptr[0];
-        m_ptr++;
-        m_len--;
-        return val;
-    }
-    if (m_len > ARY_SHIFT_SHARED_MIN) {
-        this->ary_make_shared();
-        mrb_value val = m_ptr[0];
-        m_ptr++;
-        m_len--;
-        return val;
-    }
-    mrb_value val = *m_ptr;
-    --m_len;
-    assert(m_len<m_aux.capa);
-    memmove(m_ptr,m_ptr+1,sizeof(mrb_value)*m_len);
+    mrb_value val = m_ptr[0];
+    if (!ARY_SHARED_P(this)) {
+        // the vacated slot joins the front gap
+        if (m_gap == ARY_MAX_GAP)
+            ary_compact();
+        m_gap++;
+        m_aux.capa--;
+    }
+    m_ptr++;
+    m_len--;
+    if (m_len == 0 && !ARY_SHARED_P(this))
+        ary_compact();
     return val;
 }
 
@@ -432,17 +497,7 @@ mrb_value RArray::shift()
    p self #=> [0, 1, 2, 3] */
 void RArray::unshift(const mrb_value &item)
 {
-    if (ARY_SHARED_P(this)
-            && m_aux.shared->refcnt == 1 /* shared only referenced from this array */
-            && m_ptr - base_ptr() >= 1) /* there's room for unshifted item */ {
-        m_ptr--;
-    }
-    else {
-        this->ary_modify();
-        if (m_aux.capa < m_len + 1)
-            this->ary_expand_capa(m_vm, m_len + 1);
-        value_move(m_ptr + 1, m_ptr, m_len);
-    }
+    ary_unshift_room(1);
     m_ptr[0] = item;
     m_len+= 1;
     m_vm->gc().mrb_write_barrier(this);
@@ -450,25 +505,16 @@ void RArray::unshift(const mrb_value &item)
 
 void RArray::unshift_m()
 {
-    mrb_value *vals;
-    int len;
+    ArgRest vals;
 
-    mrb_get_args(m_vm, "*", &vals, &len);
-    if (ARY_SHARED_P(this)
-            && m_aux.shared->refcnt == 1 /* shared only referenced from this array */
-            && m_ptr - base_ptr() >= len) /* there's room for unshifted item */ {
-        m_ptr -= len;
-    }
-    else {
+    m_vm->get_args(vals);
+    if (vals.len == 0) {
         this->ary_modify();
-        if (len == 0)
-            return;
-        if (m_aux.capa < m_len + len)
-            this->ary_expand_capa(m_vm, m_len + len);
-        value_move(m_ptr + len, m_ptr, m_len);
+        return;
     }
-    array_copy(m_ptr, vals, len);
-    m_len += len;
+    ary_unshift_room(vals.len);
+    array_copy(m_ptr, vals.ptr, vals.len);
+    m_len += vals.len;
     m_vm->gc().mrb_write_barrier(this);
 }
 
@@ -579,7 +625,7 @@ mrb_int RArray::aget_index(mrb_value index)
     }
     else {
         mrb_int i;
-        mrb_get_args(m_vm, "i", &i);
+        m_vm->get_args(i);
         return i;
     }
 }
@@ -616,7 +662,7 @@ mrb_value RArray::get()
     mrb_int i, len;
     mrb_value index;
 
-    if (mrb_get_args(m_vm, "o|i", &index, &len) == 1) {
+    if (m_vm->get_args<1>(index, len) == 1) {
         switch (mrb_type(index)) {
             case MRB_TT_RANGE:
                 len = this->m_len;
@@ -686,7 +732,7 @@ mrb_value RArray::aset()
     mrb_value v1, v2, v3;
     mrb_int i, len;
 
-    if (mrb_get_args(m_vm, "oo|o", &v1, &v2, &v3) == 2) {
+    if (m_vm->get_args<2>(v1, v2, v3) == 2) {
         switch (mrb_type(v1)) {
             /* a[n..m] = v */
             case MRB_TT_RANGE:
@@ -739,7 +785,7 @@ mrb_value RArray::first()
 {
     mrb_int _size;
 
-    if (mrb_get_args(m_vm, "|i", &_size) == 0) {
+    if (m_vm->get_args<0>(_size) == 0) {
         return (m_len > 0)? m_ptr[0]: mrb_value::nil();
         }
         if (_size < 0) {
@@ -757,14 +803,15 @@ mrb_value RArray::last()
 {
     mrb_int _size;
     mrb_value *vals;
-    int _len;
+    ArgRest rest;
 
-    mrb_get_args(m_vm, "*", &vals, &_len);
-    if (_len > 1) {
+    m_vm->get_args(rest);
+    if (rest.len > 1) {
         m_vm->mrb_raise(A_ARGUMENT_ERROR(m_vm), "wrong number of arguments");
     }
 
-    if (_len == 0)
+    vals = rest.ptr;
+    if (rest.len == 0)
         return (m_len > 0)? m_ptr[m_len - 1]: mrb_value::nil();
 
             /* len == 1 */
@@ -827,8 +874,9 @@ void RArray::clear()
     ary_modify();
     m_len = 0;
     m_aux.capa = 0;
-    m_vm->gc()._free(m_ptr);
+    m_vm->gc()._free(m_ptr - m_gap);
     m_ptr = 0;
+    m_gap = 0;
 }
 
 bool RArray::empty_p() const
@@ -988,10 +1036,10 @@ RString *RArray::join(mrb_value sep)
 
 RString *RArray::join_m()
 {
-    mrb_value sep = mrb_value::nil();
+    RString *sep = nullptr;
 
-    mrb_get_args(m_vm, "|S", &sep);
-    return RArray::join(sep);
+    m_vm->get_args<0>(sep);
+    return RArray::join(sep ? sep->wrap() : mrb_value::nil());
 }
 
 /* 15.2.12.5.33 (x) */
@@ -1067,6 +1115,129 @@ bool RArray::mrb_ary_eql()
 
     return true;
 }
+/* ---------------------------*/
+/* sort engine */
+
+namespace {
+enum eSortKind { SORT_GENERIC, SORT_FIXNUM, SORT_FLOAT, SORT_STRING };
+
+struct SortContext {
+    mrb_state *mrb;
+    const mrb_value *keys;  /* sort_by: elements are Fixnum indices into keys */
+
+    const mrb_value &key(const mrb_value &v) const {
+        return keys ? keys[mrb_fixnum(v)] : v;
+    }
+};
+
+struct FixnumLess {
+    const SortContext *c;
+    bool operator()(const mrb_value &a, const mrb_value &b) const {
+        return mrb_fixnum(c->key(a)) < mrb_fixnum(c->key(b));
+    }
+};
+struct FloatLess {
+    const SortContext *c;
+    bool operator()(const mrb_value &a, const mrb_value &b) const {
+        return mrb_float(c->key(a)) < mrb_float(c->key(b));
+    }
+};
+struct StringLess {
+    const SortContext *c;
+    bool operator()(const mrb_value &a, const mrb_value &b) const {
+        return mrb_str_cmp(c->mrb, c->key(a), c->key(b)) < 0;
+    }
+};
+
+/* true while k#<=> is still the core method remembered in m_inlinable */
+bool core_cmp(mrb_state *mrb, RClass *k, mrb_inlinable which)
+{
+    RProc *m = RClass::method_search_vm(&k, mrb_intern_lit(mrb, "<=>"));
+    return m && m == mrb->m_inlinable[which];
+}
+
+/* keys that are all Fixnums, all Floats or all plain Strings are compared
+   without calling <=>, as long as <=> is the core one. String subclasses and
+   strings with a singleton class may have their own <=>, so they are not. */
+eSortKind sort_kind(mrb_state *mrb, const mrb_value *keys, mrb_int n)
+{
+    mrb_vtype tt = mrb_type(keys[0]);
+
+    for (mrb_int i = 0; i < n; i++) {
+        if (mrb_type(keys[i]) != tt)
+            return SORT_GENERIC;
+        if (tt == MRB_TT_FLOAT && mrb_float(keys[i]) != mrb_float(keys[i]))
+            return SORT_GENERIC; /* NaN; let <=> report the failed comparison */
+        if (tt == MRB_TT_STRING && RClass::mrb_class(mrb, keys[i]) != mrb->string_class)
+            return SORT_GENERIC;
+    }
+    switch (tt) {
+        case MRB_TT_FIXNUM:
+            return core_cmp(mrb, mrb->fixnum_class, MRB_INLINE_FIXNUM_CMP) ? SORT_FIXNUM : SORT_GENERIC;
+        case MRB_TT_FLOAT:
+            return core_cmp(mrb, mrb->float_class, MRB_INLINE_FLOAT_CMP) ? SORT_FLOAT : SORT_GENERIC;
+        case MRB_TT_STRING:
+            return core_cmp(mrb, mrb->string_class, MRB_INLINE_STRING_CMP) ? SORT_STRING : SORT_GENERIC;
+        default:
+            return SORT_GENERIC;
+    }
+}
+} // end of anonymous namespace
+
+/*
+ * Stable-sorts self in place when its elements (with keys, the keys its
+ * Fixnum elements index) can be ordered without calling <=>. Returns false
+ * and leaves self alone otherwise; no Ruby code runs either way.
+ */
+bool RArray::sort_builtin(const mrb_value *keys)
+{
+    if (m_len <= 1)
+        return true;
+    SortContext c = {m_vm, keys};
+    eSortKind kind = sort_kind(m_vm, keys ? keys : m_ptr, m_len);
+
+    if (kind == SORT_GENERIC)
+        return false;
+    ary_modify();
+    switch (kind) {
+        case SORT_FIXNUM: std::stable_sort(m_ptr, m_ptr + m_len, FixnumLess{&c}); break;
+        case SORT_FLOAT:  std::stable_sort(m_ptr, m_ptr + m_len, FloatLess{&c});  break;
+        case SORT_STRING: std::stable_sort(m_ptr, m_ptr + m_len, StringLess{&c}); break;
+        case SORT_GENERIC: break;
+    }
+    return true;
+}
+
+/*
+ *  call-seq:
+ *     ary.__sort_builtin__(keys)   -> true or false
+ *
+ *  Helper of Array#sort! and Array#sort_by in mrblib. Sorts +self+ in place
+ *  and returns true if its elements, or with +keys+ the keys its elements
+ *  index, are all Fixnums, all Floats or all Strings with the core
+ *  <code><=></code>. Otherwise returns false; the caller then sorts in Ruby,
+ *  so that <code><=></code> and blocks may switch fibers.
+ */
+static mrb_value
+sort_builtin(mrb_state *mrb, mrb_value self)
+{
+    RArray *a = mrb_ary_ptr(self);
+    mrb_value keys;
+
+    mrb->get_args(keys);
+    if (keys.is_nil())
+        return mrb_value::wrap(a->sort_builtin(nullptr));
+    mrb_check_type(mrb, keys, MRB_TT_ARRAY);
+    RArray *k = mrb_ary_ptr(keys);
+    if (k->m_len != a->m_len)
+        mrb->mrb_raise(E_ARGUMENT_ERROR, "wrong number of sort keys");
+    for (mrb_int i = 0; i < a->m_len; i++) {
+        if (!a->m_ptr[i].is_fixnum() || mrb_fixnum(a->m_ptr[i]) < 0 || mrb_fixnum(a->m_ptr[i]) >= k->m_len)
+            mrb->mrb_raise(E_INDEX_ERROR, "sort key index out of range");
+    }
+    return mrb_value::wrap(a->sort_builtin(k->m_ptr));
+}
+
 namespace {
 #define FORWARD_TO_INSTANCE(name)\
     static mrb_value name(mrb_state *mrb, mrb_value self) {\
@@ -1149,5 +1320,6 @@ void mrb_init_array(mrb_state *mrb)
             .define_method("==",              mrb_ary_equal,  MRB_ARGS_REQ(1)) /* 15.2.12.5.33 (x) */
             .define_method("eql?",            mrb_ary_eql,    MRB_ARGS_REQ(1)) /* 15.2.12.5.34 (x) */
             .define_method("<=>",             cmp,            MRB_ARGS_REQ(1)) /* 15.2.12.5.36 (x) */
+            .define_method("__sort_builtin__", sort_builtin,  MRB_ARGS_REQ(1))
             .fin();
 }
@@ -9,6 +9,7 @@
 #include "mruby.h"
 #include "mruby/array.h"
 #include "mruby/class.h"
+#include "mruby/hash.h"
 #include "mruby/numeric.h"
 #include "mruby/proc.h"
 #include "mruby/string.h"
@@ -229,7 +230,7 @@ static mrb_value check_type(mrb_state *mrb, mrb_value val, enum mrb_vtype t, con
 {
     mrb_value tmp = mrb_check_convert_type(mrb, val, t, c, m);
     if (tmp.is_nil()) {
-        mrb->mrb_raisef(E_TYPE_ERROR, "expected %S", mrb_str_new_cstr(mrb, c));
+        mrb->mrb_raisef(E_TYPE_ERROR, "expected %S", mrb_str_new_cstr(mrb, c)->wrap());
     }
     return tmp;
 }
@@ -530,6 +531,8 @@ int mrb_get_args(mrb_state *mrb, const char *format, ...)
                     bp = mrb->m_ctx->m_stack + mrb->m_ctx->m_ci->argc + 1;
                 }
                 *p = *bp;
+                if (p->tt == MRB_TT_PROC) /* the C function may keep it */
+                    p->ptr<RProc>()->escape();
             }
                 break;
             case '|': opt = 1; break;
@@ -564,6 +567,50 @@ int mrb_get_args(mrb_state *mrb, const char *format, ...)
     return i;
 }
 
+/* conversions of mrb_state::get_args, following mrb_get_args above */
+void mrb_state::get_arg(const mrb_value &arg, mrb_float &tgt)
+{
+    switch (mrb_type(arg)) {
+        case MRB_TT_FLOAT:
+            tgt = mrb_float(arg);
+            break;
+        case MRB_TT_FIXNUM:
+            tgt = (mrb_float)mrb_fixnum(arg);
+            break;
+        case MRB_TT_STRING:
+            mrb_raise(I_TYPE_ERROR, "String can't be coerced into Float");
+            break;
+        default:
+            tgt = mrb_float(mrb_convert_type(this, arg, MRB_TT_FLOAT, "Float", "to_f"));
+            break;
+    }
+}
+void mrb_state::get_arg(const mrb_value &arg, bool &tgt)
+{
+    tgt = arg.to_bool();
+}
+void mrb_state::get_arg(const mrb_value &arg, RString *&tgt)
+{
+    tgt = to_str(this, arg).ptr<RString>();
+}
+void mrb_state::get_arg(const mrb_value &arg, RArray *&tgt)
+{
+    tgt = mrb_ary_ptr(to_ary(this, arg));
+}
+void mrb_state::get_arg(const mrb_value &arg, RHash *&tgt)
+{
+    tgt = to_hash(this, arg).ptr<RHash>();
+}
+mrb_value mrb_state::block_arg()
+{
+    int argc = m_ctx->m_ci->argc;
+    mrb_value blk = m_ctx->m_stack[(argc < 0) ? 2 : argc + 1];
+
+    if (blk.tt == MRB_TT_PROC) /* the C function may keep it */
+        blk.ptr<RProc>()->escape();
+    return blk;
+}
+
 static RClass* boot_defclass(mrb_state *mrb, RClass *super)
 {
     RClass *c  = mrb->gc().obj_alloc<RClass>(mrb->class_class);
@@ -612,6 +659,7 @@ void mrb_include_module(mrb_state *mrb, RClass *c, RClass *m)
         ic->iv = m->iv;
         ic->super = ins_pos->super;
         ins_pos->super = ic;
+        mrb->method_serial++;
 
         mrb->gc().mrb_field_write_barrier(ins_pos, ic);
         ins_pos = ic;
@@ -858,6 +906,7 @@ RClass &RClass::include_module(RClass *m)
         ic->iv = m->iv;
         ic->super = ins_pos->super;
         ins_pos->super = ic;
+        m_vm->method_serial++;
         m_vm->gc().mrb_field_write_barrier(ins_pos, ic);
         ins_pos = ic;
 skip:
@@ -1151,6 +1200,7 @@ RClass &RClass::define_method_raw(mrb_sym mid, RProc *p) {
         mt = kh_mt::init(m_vm->gc());
     khiter_t k = mt->put(mid);
     mt->value(k) = p;
+    m_vm->method_serial++;
     if (p) {
         m_vm->gc().mrb_field_write_barrier(this, p);
     }
@@ -1167,6 +1217,7 @@ void RClass::define_method_vm(mrb_sym name, mrb_value body) {
     k = this->mt->put(name);
     p = body.ptr<RProc>();
     this->mt->value(k) = p;
+    m_vm->method_serial++;
     if (p) {
         m_vm->gc().mrb_field_write_barrier(this, p);
     }
@@ -1675,6 +1726,7 @@ static void remove_method(mrb_state *mrb, mrb_value mod, mrb_sym mid)
         khiter_t k = h->get(mid);
         if (k != h->end()) {
             h->del(k);
+            mrb->method_serial++;
             return;
         }
     }
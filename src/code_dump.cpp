@@ -27,7 +27,7 @@ void mrb_state::codedump(mrb_irep *irep)
     for (int i=0; i<irep->ilen; i++) {
         int ai = this->gc().arena_save();
         sys.print_f("%03d ", i);
-        mrb_code c = irep->iseq[i];
+        mrb_code c = UNQUICKEN(irep->iseq[i]);
         switch (GET_OPCODE(c)) {
             case OP_NOP:
                 sys.print_f("OP_NOP\n");
@@ -263,6 +263,39 @@ void mrb_state::codedump(mrb_irep *irep)
             case OP_STRCAT:
                 sys.print_f("OP_STRCAT\tR%d\tR%d\n", GETARG_A(c), GETARG_B(c));
                 break;
+            case OP_STRCATN:
+                sys.print_f("OP_STRCATN\tR%d\t%d\n", GETARG_A(c), GETARG_B(c));
+                break;
+            case OP_CHKMETH:
+                sys.print_f("OP_CHKMETH\tR%d\t:%s\t%d\n", GETARG_A(c),
+                            mrb_sym2name(this, irep->syms[GETARG_B(c)]), GETARG_C(c));
+                break;
+            case OP_EQ_JMPIF: case OP_EQ_JMPNOT:
+            case OP_LT_JMPIF: case OP_LT_JMPNOT:
+            case OP_LE_JMPIF: case OP_LE_JMPNOT:
+            case OP_GT_JMPIF: case OP_GT_JMPNOT:
+            case OP_GE_JMPIF: case OP_GE_JMPNOT:
+            {
+                static const char *name[] = {
+                    "OP_EQ_JMPIF", "OP_EQ_JMPNOT", "OP_LT_JMPIF", "OP_LT_JMPNOT",
+                    "OP_LE_JMPIF", "OP_LE_JMPNOT", "OP_GT_JMPIF", "OP_GT_JMPNOT",
+                    "OP_GE_JMPIF", "OP_GE_JMPNOT",
+                };
+                sys.print_f("%s\tR%d\t:%s\t%d\n", name[GET_OPCODE(c) - OP_EQ_JMPIF], GETARG_A(c),
+                            mrb_sym2name(this, irep->syms[GETARG_B(c)]),
+                        GETARG_C(c));
+                break;
+            }
+            case OP_MOVE_SEND:
+                sys.print_f("OP_MOVE_SEND\tR%d\tR%d\n", GETARG_A(c), GETARG_B(c));
+                break;
+            case OP_LOADI_SEND:
+                sys.print_f("OP_LOADI_SEND\tR%d\t%d\n", GETARG_A(c), GETARG_sBx(c));
+                break;
+            case OP_GETIV_RETURN:
+                sys.print_f("OP_GETIV_RETURN\tR%d\t%s\n", GETARG_A(c),
+                            mrb_sym2name(this, irep->syms[GETARG_Bx(c)]));
+                break;
             case OP_HASH:
                 sys.print_f("OP_HASH\tR%d\tR%d\t%d\n", GETARG_A(c), GETARG_B(c), GETARG_C(c));
                 break;
@@ -23,6 +23,7 @@
 #include "mrb_throw.h"
 
 #define CALL_MAXARGS 127
+#define STRCATN_MAXARGS 127
 
 typedef mrb_ast_node node;
 typedef struct mrb_parser_state parser_state;
@@ -58,6 +59,7 @@ struct codegen_scope : public NodeVisitor {
 
     loopinfo *m_loop = nullptr;
     int m_ensure_level =0;
+    mrb_sym m_mid = 0;          /* name of the method being compiled, 0 outside def */
     const char *m_filename = nullptr;
     uint16_t m_lineno = 0;
 
@@ -244,6 +246,7 @@ protected:
     void visit(LVarNode * n);
     void visit(BlockArgNode * n);
     void visit(BreakNode * n);
+    void visit(MethodCheckNode * n);
     void visit(ArgNode *n);
     void visit(LiteralDelimNode *n);
 protected:
@@ -455,14 +458,29 @@ int codegen_scope::genop_peep(mrb_code i, bool val)
             genop_peep(i0, false);
             i0 = m_iseq[m_pc-1];
             return genop(MKOP_AB(OP_RETURN, GETARG_A(i0), OP_R_NORMAL));
-#if 0
+        case OP_GETIV:
+            /* attribute reader */
+            if (GETARG_A(i) == GETARG_A(i0) && GETARG_B(i) == OP_R_NORMAL)
+                m_iseq[m_pc-1] = MKOP_ABx(OP_GETIV_RETURN, GETARG_A(i0), GETARG_Bx(i0));
+            break;
         case OP_SEND:
-            if (GETARG_B(i) == OP_R_NORMAL && GETARG_A(i) == GETARG_A(i0)) {
+            /* self-recursive call in tail position: reuse the frame, unless a
+               rescue, ensure or loop still has to see the result */
+            if (GETARG_B(i) == OP_R_NORMAL && GETARG_A(i) == GETARG_A(i0) &&
+                    m_mid && m_mid == m_irep->syms[GETARG_B(i0)] &&
+                    !m_loop && m_ensure_level == 0) {
                 m_iseq[m_pc-1] = MKOP_ABC(OP_TAILCALL, GETARG_A(i0), GETARG_B(i0), GETARG_C(i0));
+                /* argument-and-send superinstructions always go on to OP_SEND */
+                if (m_pc >= 2) {
+                    mrb_code i1 = m_iseq[m_pc-2];
+                    if (GET_OPCODE(i1) == OP_MOVE_SEND)
+                        m_iseq[m_pc-2] = MKOP_AB(OP_MOVE, GETARG_A(i1), GETARG_B(i1));
+                    else if (GET_OPCODE(i1) == OP_LOADI_SEND)
+                        m_iseq[m_pc-2] = MKOP_AsBx(OP_LOADI, GETARG_A(i1), GETARG_sBx(i1));
+                }
                 return 0;
             }
             break;
-#endif
         default:
             break;
         }
@@ -495,6 +513,31 @@ int codegen_scope::genop_peep(mrb_code i, bool val)
             m_iseq[m_pc-1] = MKOP_AsBx(c1, GETARG_B(i0), GETARG_sBx(i));
             return m_pc-1;
         }
+        if (GETARG_A(i) == GETARG_A(i0)) {
+            /* compare-and-branch superinstruction */
+            int op = 0;
+            switch (c0) {
+            case OP_EQ: op = OP_EQ_JMPIF; break;
+            case OP_LT: op = OP_LT_JMPIF; break;
+            case OP_LE: op = OP_LE_JMPIF; break;
+            case OP_GT: op = OP_GT_JMPIF; break;
+            case OP_GE: op = OP_GE_JMPIF; break;
+            default: break;
+            }
+            if (op) {
+                if (c1 == OP_JMPNOT)
+                    op++;   /* OP_xx_JMPNOT follows OP_xx_JMPIF */
+                m_iseq[m_pc-1] = MKOP_ABC(op, GETARG_A(i0), GETARG_B(i0), GETARG_C(i0));
+            }
+        }
+        break;
+    case OP_SEND:
+    case OP_SENDB:
+        /* argument setup falling into the call */
+        if (c0 == OP_MOVE)
+            m_iseq[m_pc-1] = MKOP_AB(OP_MOVE_SEND, GETARG_A(i0), GETARG_B(i0));
+        else if (c0 == OP_LOADI)
+            m_iseq[m_pc-1] = MKOP_AsBx(OP_LOADI_SEND, GETARG_A(i0), GETARG_sBx(i0));
         break;
     default:
         break;
@@ -682,7 +725,7 @@ void codegen_scope::do_lambda_args(ArgsStore *args)
     ra = args->m_rest ? 1 : 0;
     pa = node_len(args->m_post_mandatory);
     ka = kd = 0;
-    ba = args->m_blk ? 1 : 0;
+    ba = (args->m_blk && args->m_blk_escapes) ? 1 : 0;
 
     a = ((mrb_aspec)(ma & 0x1f) << 18)
             | ((mrb_aspec)(oa & 0x1f) << 13)
@@ -726,7 +769,9 @@ void codegen_scope::do_lambda_body(mrb_ast_node *body)
     if (m_pc <= 0)
         return;
     mrb_code c = m_iseq[m_pc-1];
-    if (GET_OPCODE(c) != OP_RETURN || GETARG_B(c) != OP_R_NORMAL || m_pc == m_lastlabel) {
+    bool returns = (GET_OPCODE(c) == OP_RETURN && GETARG_B(c) == OP_R_NORMAL) ||
+            GET_OPCODE(c) == OP_TAILCALL;
+    if (!returns || m_pc == m_lastlabel) {
         if (m_nregs == 0) {
             genop( MKOP_A(OP_LOADNIL, 0));
             genop( MKOP_AB(OP_RETURN, 0, OP_R_NORMAL));
@@ -755,6 +800,7 @@ int codegen_scope::do_lambda_internal(DefCommonNode *tree)
 {
     codegen_scope *parent = this;
     m_mscope = 1;
+    m_mid = tree->name();
 
     if(tree->args())
         do_lambda_args(tree->args());
@@ -907,7 +953,7 @@ void codegen_scope::gen_call_common(mrb_sym _sym, int sendv, int noop, int idx,
             }
         }
         mrb_code cd = MKOP_ABC(op, m_sp, idx, n);
-        if(was_peep)
+        if(was_peep || op == OP_SEND || op == OP_SENDB)
             genop_peep(cd,val);
         else
             genop( cd );
@@ -1149,6 +1195,10 @@ void codegen_scope::gen_literal_array(node *tree, int sym, int val)
             case NODE_BEGIN:
             case NODE_BLOCK:
                 codegen(tree->left(), false);
+                break;
+            default:
+                /* literal parts have no side effects */
+                break;
             }
             tree = tree->right();
         }
@@ -1511,13 +1561,23 @@ void codegen_scope::visit_loop(BinaryNode *n,eOpEnum op) {
 
     loopinfo *lp = loop_push(LOOP_NORMAL);
 
+    if (op == OP_JMPIF && n->lhs()->getType() == NODE_TRUE) {
+        /* `while true`: no condition to test, next and redo restart the body */
+        lp->pc1 = lp->pc2 = new_label();
+        codegen(n->rhs(), false);
+        genop(MKOP_sBx(OP_JMP, lp->pc2 - m_pc));
+        loop_pop(val);
+        return;
+    }
     lp->pc1 = genop(MKOP_sBx(OP_JMP, 0));
     lp->pc2 = new_label();
     codegen(n->rhs(), false);
     dispatch(lp->pc1);
     codegen(n->lhs(), true);
     pop_sp();
-    genop(MKOP_AsBx(op , m_sp, lp->pc2 - m_pc));
+    /* the peephole may fold the jump into the preceding instruction */
+    int pos = genop_peep(MKOP_AsBx(op, m_sp, 0), false);
+    m_iseq[pos] = MKOP_AsBx(op, GETARG_A(m_iseq[pos]), lp->pc2 - pos);
 
     loop_pop(val);
 
@@ -1626,15 +1686,38 @@ void codegen_scope::visit(SplatNode *node) {
 void codegen_scope::walk_string(mrb_ast_node *n) {
     bool val = m_val_stack.back();
     if (val) {
-        codegen( n->left(), true);
-        n = n->right();
+        /* all parts are evaluated into consecutive registers, and joined by a
+           single OP_STRCATN, so the result is allocated once at its final size */
+        int cnt = 0;
         while (n) {
-            codegen( n->left(), true);
-            pop_sp(2);
-            genop_peep(MKOP_AB(OP_STRCAT, m_sp, m_sp+1), true);
-            push_();
+            mrb_ast_node *part = n->left();
+            if (part->getType() == NODE_STR) {
+                StrNode *sn = (StrNode *)part;
+                if (sn->m_length != 0) {
+                    int ai = m_mrb->gc().arena_save();
+                    int off = new_lit(mrb_str_new(m_mrb, sn->m_str, sn->m_length));
+                    m_mrb->gc().arena_restore(ai);
+                    /* literal is only read by OP_STRCATN, no need for a copy */
+                    genop(MKOP_ABx(OP_LOADL, m_sp, off));
+                    push_();
+                    cnt++;
+                }
+            }
+            else {
+                codegen(part, true);
+                cnt++;
+            }
+            if (cnt == STRCATN_MAXARGS) {
+                pop_sp(cnt);
+                genop(MKOP_AB(OP_STRCATN, m_sp, cnt));
+                push_();
+                cnt = 1;
+            }
             n = n->right();
         }
+        pop_sp(cnt);
+        genop(MKOP_AB(OP_STRCATN, m_sp, cnt));
+        push_();
     }
     else {
         while (n) {
@@ -2321,6 +2404,14 @@ void codegen_scope::visit(FloatLiteralNode *n) {
     genop( MKOP_ABx(OP_LOADL, m_sp, off));
     push_();
 }
+void codegen_scope::visit(MethodCheckNode *n) {
+    bool val = m_val_stack.back();
+    codegen(n->m_recv, true);
+    pop_sp();
+    genop(MKOP_ABC(OP_CHKMETH, m_sp, new_msym(n->m_method), n->m_which));
+    if (val)
+        push_();
+}
 void codegen_scope::visit(BreakNode *n) {
     loop_break(n->child());
     if (m_val_stack.back())
@@ -2578,6 +2669,7 @@ RProc *mrb_generate_code (mrb_state *mrb, parser_state *p) {
     scope->filename_index = p->current_filename_index;
     MRB_TRY(&scope->jmp) {
         // prepare irep
+        mrb_ast_optimize(p);
         scope->codegen(p->m_tree, false);
         RProc *proc = RProc::create(mrb, scope->m_irep);
         mrb_irep_decref(mrb->gc(), scope->m_irep);
@@ -121,16 +121,59 @@ mrb_debug_info_alloc(mrb_state *mrb, mrb_irep *irep)
     return ret;
 }
 
+static void
+fill_lines(mrb_state *mrb, mrb_irep *irep, mrb_irep_debug_info_file *ret,
+           uint32_t start_pos, uint32_t end_pos)
+{
+    uint32_t file_pc_count = end_pos - start_pos;
+    uint32_t i;
+
+    ret->line_type = select_line_type(irep->lines + start_pos, end_pos - start_pos);
+    ret->lines.ptr = NULL;
+
+    switch(ret->line_type) {
+    case mrb_debug_line_ary:
+        ret->line_entry_count = file_pc_count;
+        ret->lines.ary = (uint16_t *)mrb->gc()._malloc(file_pc_count*sizeof(uint16_t));
+        for(i = 0; i < file_pc_count; ++i) {
+            ret->lines.ary[i] = irep->lines[start_pos + i];
+        }
+        break;
+
+    case mrb_debug_line_flat_map: {
+        uint16_t prev_line = 0;
+        mrb_irep_debug_info_line m;
+        ret->lines.flat_map = mrb->gc().new_t<mrb_irep_debug_info_line>();
+        ret->line_entry_count = 0;
+        for(i = 0; i < file_pc_count; ++i) {
+            if(irep->lines[start_pos + i] == prev_line) { continue; }
+
+            ret->lines.flat_map = (mrb_irep_debug_info_line*)mrb->gc()._realloc(
+                        ret->lines.flat_map,
+                        sizeof(mrb_irep_debug_info_line) * (ret->line_entry_count + 1));
+            m.start_pos = start_pos + i;
+            m.line = irep->lines[start_pos + i];
+            ret->lines.flat_map[ret->line_entry_count] = m;
+
+            /* update */
+            ++ret->line_entry_count;
+            prev_line = irep->lines[start_pos + i];
+        }
+    }
+        break;
+
+    default: mrb_assert(0); break;
+    }
+}
+
 mrb_irep_debug_info_file *
 mrb_debug_info_append_file(mrb_state *mrb, mrb_irep *irep,
                            uint32_t start_pos, uint32_t end_pos)
 {
     mrb_irep_debug_info *info;
     mrb_irep_debug_info_file *ret;
-    uint32_t file_pc_count;
     size_t fn_len;
     size_t len;
-    uint32_t i;
 
     if (!irep->debug_info) { return NULL; }
 
@@ -151,8 +194,6 @@ mrb_debug_info_append_file(mrb_state *mrb, mrb_irep *irep,
                : mrb->gc()._malloc(sizeof(mrb_irep_debug_info_file*)));
     info->files[info->flen++] = ret;
 
-    file_pc_count = end_pos - start_pos;
-
     ret->start_pos = start_pos;
     info->pc_count = end_pos;
 
@@ -161,44 +202,40 @@ mrb_debug_info_append_file(mrb_state *mrb, mrb_irep *irep,
     len = 0;
     ret->filename = mrb_sym2name_len(mrb, ret->filename_sym, len);
 
-    ret->line_type = select_line_type(irep->lines + start_pos, end_pos - start_pos);
-    ret->lines.ptr = NULL;
+    fill_lines(mrb, irep, ret, start_pos, end_pos);
 
-    switch(ret->line_type) {
-    case mrb_debug_line_ary:
-        ret->line_entry_count = file_pc_count;
-        ret->lines.ary = (uint16_t *)mrb->gc()._malloc(file_pc_count*sizeof(uint16_t));
-        for(i = 0; i < file_pc_count; ++i) {
-            ret->lines.ary[i] = irep->lines[start_pos + i];
-        }
-        break;
+    return ret;
+}
 
-    case mrb_debug_line_flat_map: {
-        uint16_t prev_line = 0;
-        mrb_irep_debug_info_line m;
-        ret->lines.flat_map = mrb->gc().new_t<mrb_irep_debug_info_line>();
-        ret->line_entry_count = 0;
-        for(i = 0; i < file_pc_count; ++i) {
-            if(irep->lines[start_pos + i] == prev_line) { continue; }
+/* rebuilds the line tables after irep->iseq and irep->lines were rewritten;
+   pcmap gives the new position of every old one */
+void
+mrb_debug_info_remap(mrb_state *mrb, mrb_irep *irep, const uint32_t *pcmap)
+{
+    mrb_irep_debug_info *info = irep->debug_info;
+    uint16_t flen = 0;
+    uint16_t i;
 
-            ret->lines.flat_map = (mrb_irep_debug_info_line*)mrb->gc()._realloc(
-                        ret->lines.flat_map,
-                        sizeof(mrb_irep_debug_info_line) * (ret->line_entry_count + 1));
-            m.start_pos = start_pos + i;
-            m.line = irep->lines[start_pos + i];
-            ret->lines.flat_map[ret->line_entry_count] = m;
+    if (!info || !irep->lines) { return; }
 
-            /* update */
-            ++ret->line_entry_count;
-            prev_line = irep->lines[start_pos + i];
-        }
+    for (i = 0; i < info->flen; ++i) {
+        info->files[i]->start_pos = pcmap[info->files[i]->start_pos];
     }
-        break;
-
-    default: mrb_assert(0); break;
+    for (i = 0; i < info->flen; ++i) {
+        mrb_irep_debug_info_file *f = info->files[i];
+        uint32_t end_pos = (i + 1 < info->flen) ? info->files[i+1]->start_pos : irep->ilen;
+
+        mrb->gc()._free(f->lines.ptr);
+        if (f->start_pos == end_pos) {
+            /* nothing of this file left */
+            mrb->gc()._free(f);
+            continue;
+        }
+        fill_lines(mrb, irep, f, f->start_pos, end_pos);
+        info->files[flen++] = f;
     }
-
-    return ret;
+    info->flen = flen;
+    info->pc_count = irep->ilen;
 }
 
 void mrb_debug_info_free(MemManager &mm, mrb_irep_debug_info *d)
@@ -11,6 +11,7 @@
 #include "mruby/irep.h"
 #include "mruby/numeric.h"
 #include "mruby/debug.h"
+#include "opcode.h"
 
 
 static size_t get_irep_record_size_1(mrb_state *mrb, mrb_irep *irep);
@@ -52,7 +53,8 @@ static int write_iseq_block(mrb_state *mrb, mrb_irep *irep, uint8_t *buf)
 
     cur += uint32_to_bin(irep->ilen, cur); /* number of opcode */
     for (iseq_no = 0; iseq_no < irep->ilen; iseq_no++) {
-        cur += uint32_to_bin(irep->iseq[iseq_no], cur); /* opcode */
+        /* quickened instructions are a runtime detail, dump the generic ones */
+        cur += uint32_to_bin(UNQUICKEN(irep->iseq[iseq_no]), cur); /* opcode */
     }
 
     return (cur - buf);
@@ -37,11 +37,11 @@ void mrb_data_check_type(mrb_state *mrb, const mrb_value &obj, const mrb_data_ty
         const mrb_data_type *t2 = DATA_TYPE(obj);
         if (t2) {
             mrb->mrb_raisef(E_TYPE_ERROR, "wrong argument type %S (expected %S)",
-                       mrb_str_new_cstr(mrb, t2->struct_name), mrb_str_new_cstr(mrb, type->struct_name));
+                       mrb_str_new_cstr(mrb, t2->struct_name)->wrap(), mrb_str_new_cstr(mrb, type->struct_name)->wrap());
         } else {
             const RClass *c = RClass::mrb_class(mrb, obj);
             mrb->mrb_raisef(E_TYPE_ERROR, "uninitialized %S (expected %S)",
-                       mrb_value::wrap((RClass *)c), mrb_str_new_cstr(mrb, type->struct_name));
+                       mrb_value::wrap((RClass *)c), mrb_str_new_cstr(mrb, type->struct_name)->wrap());
         }
     }
 }
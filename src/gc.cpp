@@ -14,8 +14,8 @@
 #include "mruby/proc.h"
 #include "mruby/range.h"
 #include "mruby/string.h"
-#include "mruby/variable.h"
 #include "mruby/gc.h"
+#include "mruby/variable.h"
 
 #define is_dead(s, o) (((o)->color & other_white_part(s) & MRB_GC_WHITES) || (o)->tt == MRB_TT_FREE)
 #define other_white_part(s) ((s)->current_white_part ^ MRB_GC_WHITES)
@@ -91,7 +91,6 @@
 
   For details, see the comments for each function.
 */
-extern void mrb_free_context(mrb_state *mrb, struct mrb_context *ctx);
 
 struct free_obj {
     RBasic z;
@@ -480,7 +479,8 @@ void MemManager::mark_children(RBasic *obj)
     case MRB_TT_FIBER:
     {
         mrb_context *c = ((RFiber*)obj)->cxt;
-        mark_context(c);
+        if (c)
+            mark_context(c);
     }
         break;
     case MRB_TT_ARRAY:
@@ -552,6 +552,7 @@ void MemManager::obj_free(RBasic *obj)
     case MRB_TT_CLASS:
     case MRB_TT_MODULE:
     case MRB_TT_SCLASS:
+        m_vm->method_serial++;      /* a CallSite may still point at it */
         mrb_gc_free_mt(m_vm, (RClass*)obj);
         mrb_gc_free_iv((RObject*)obj);
         break;
@@ -569,8 +570,8 @@ void MemManager::obj_free(RBasic *obj)
     case MRB_TT_FIBER:
     {
         mrb_context *c = ((RFiber*)obj)->cxt;
-        if(c !=m_vm->root_c)
-            mrb_free_context(m_vm,c);
+        if (c && c != m_vm->root_c)
+            mrb_context_release(m_vm, c);
     }
         break;
     case MRB_TT_ARRAY:
@@ -632,6 +633,8 @@ void MemManager::root_scan_phase()
     mark(m_vm->object_class); /* mark class hierarchy */
     mark(m_vm->top_self); /* mark top_self */
     mark(m_vm->m_exc); /* mark exception */
+    for (RProc *p : m_vm->m_inlinable) /* kept alive for OP_CHKMETH */
+        mark(p);
 
     mark_context(m_vm->root_c);
     if (m_vm->root_c != m_vm->m_ctx) {
@@ -675,6 +678,8 @@ size_t MemManager::gc_gray_mark(RBasic *obj)
         mrb_context *c = ((RFiber*)obj)->cxt;
         size_t i;
 
+        if (!c)
+            break;
         /* mark stack */
         i = c->m_stack - c->m_stbase;
         if (c->m_ci)
@@ -75,7 +75,8 @@ mrb_value RHash::get(mrb_value key)
 
     /* not found */
     if (flags & MRB_HASH_PROC_DEFAULT) {
-        return mrb->funcall(iv_get(mrb->intern2("ifnone", 6)), "call", 2, mrb_value::wrap(this), key);
+        mrb_value args[] = {mrb_value::wrap(this), key};
+        return mrb->funcall(MRB_CALL_CALL, iv_get(mrb->intern2("ifnone", 6)), 2, args);
     }
     return iv_get(mrb->intern2("ifnone", 6));
 }
@@ -204,8 +205,11 @@ void RHash::modify()
  */
 RHash *RHash::init_core(mrb_value block,int argc, mrb_value *argv) {
     mrb_value ifnone;
+    ArgRest rest;
 
-    mrb_get_args(m_vm, "o*", &block, &argv, &argc);
+    m_vm->get_args(block, rest);
+    argv = rest.ptr;
+    argc = rest.len;
     modify();
     if (block.is_nil()) {
         if (argc > 0) {
@@ -277,11 +281,12 @@ mrb_value RHash::default_val()
 {
     mrb_value key = mrb_value::nil();
 
-    mrb_get_args(m_vm, "|o", &key);
+    m_vm->get_args<0>(key);
     if (flags & MRB_HASH_PROC_DEFAULT) {
         if (key.is_nil())
             return mrb_value::nil();
-        return m_vm->funcall(iv_get(m_vm->intern2("ifnone", 6)), "call", 2, mrb_value::wrap(this), key);
+        mrb_value args[] = {mrb_value::wrap(this), key};
+        return m_vm->funcall(MRB_CALL_CALL, iv_get(m_vm->intern2("ifnone", 6)), 2, args);
     }
     return iv_get(m_vm->intern2("ifnone", 6));
 }
@@ -428,7 +433,8 @@ mrb_value RHash::shift()
     }
 
     if (flags & MRB_HASH_PROC_DEFAULT) {
-        return m_vm->funcall(iv_get(m_vm->intern2("ifnone", 6)), "call", 2, mrb_value::wrap(this), mrb_value::nil());
+        mrb_value args[] = {mrb_value::wrap(this), mrb_value::nil()};
+        return m_vm->funcall(MRB_CALL_CALL, iv_get(m_vm->intern2("ifnone", 6)), 2, args);
     }
     else {
         return iv_get(m_vm->intern2("ifnone", 6));
@@ -820,7 +826,7 @@ namespace {
 #define FORWARD_TO_INSTANCE_ARG2(name)\
     static mrb_value name(mrb_state *mrb, mrb_value self) {\
     mrb_value arg0,arg1;\
-    mrb_get_args(mrb, "oo", &arg0,&arg1);\
+    mrb->get_args(arg0, arg1);\
     return self.ptr<RHash>()->name(arg0,arg1);\
 }
 #define FORWARD_TO_INSTANCE_RET_SELF(name)\
@@ -856,11 +862,10 @@ FORWARD_TO_INSTANCE_ARG1(replace)
 static mrb_value mrb_hash_init_core(mrb_state *mrb, mrb_value hash)
 {
     mrb_value block;
-    mrb_value *argv;
-    int argc;
+    ArgRest rest;
 
-    mrb_get_args(mrb, "o*", &block, &argv, &argc);
-    return mrb_value::wrap(hash.ptr<RHash>()->init_core(block,argc,argv));
+    mrb->get_args(block, rest);
+    return mrb_value::wrap(hash.ptr<RHash>()->init_core(block,rest.len,rest.ptr));
 }
 mrb_value hash_equal(mrb_state *mrb, mrb_value hash1)
 {
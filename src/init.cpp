@@ -6,6 +6,7 @@
 #include <stdarg.h>
 
 #include "mruby.h"
+#include "mruby/class.h"
 
 extern "C" {
 }
@@ -32,10 +33,42 @@ void mrb_init_proc(mrb_state*);
 void mrb_init_comparable(mrb_state*);
 
 #define DONE mrb->gc().arena_restore(0);
+
+/* remember the core definitions codegen and the sort inline, before gems or
+   user code get a chance to redefine them; OP_CHKMETH compares against these */
+static void
+mrb_init_inlinable(mrb_state *mrb)
+{
+  static const struct { const char *klass, *name; } core[MRB_INLINE_MAX] = {
+    { "Integer", "times" },
+    { "Range", "each" },
+    { "Kernel", "loop" },
+    { "Fixnum", "<=>" },
+    { "Float", "<=>" },
+    { "String", "<=>" },
+  };
+
+  for (int k = 0; k < MRB_INLINE_MAX; k++) {
+    RClass *c = mrb->class_get(core[k].klass);
+    mrb->m_inlinable[k] = RClass::method_search_vm(&c, mrb_intern_cstr(mrb, core[k].name));
+  }
+}
+
+/* intern the names behind mrb_state::m_calls; the lookups fill in lazily */
+static void
+mrb_init_calls(mrb_state *mrb)
+{
+  static const char *name[MRB_CALL_MAX] = { "hash", "eql?", "==", "call", "inspect" };
+
+  for (int k = 0; k < MRB_CALL_MAX; k++)
+    mrb->m_calls[k].mid = mrb_intern_cstr(mrb, name[k]);
+}
+
 void
 mrb_core_init(mrb_state *mrb)
 {
   mrb_init_symtbl(mrb); DONE;
+  mrb_init_calls(mrb); DONE;
 
   mrb_init_class(mrb); DONE;
   mrb_init_object(mrb); DONE;
@@ -54,6 +87,7 @@ mrb_core_init(mrb_state *mrb)
   mrb_init_gc(mrb); DONE;
   mrb_init_version(mrb); DONE;
   mrb_init_mrblib(mrb); DONE;
+  mrb_init_inlinable(mrb); DONE;
 #ifndef DISABLE_GEMS
   mrb_init_mrbgems(mrb); DONE;
 #endif
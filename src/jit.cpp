@@ -0,0 +1,482 @@
+/*
+** jit.cpp - baseline JIT for hot ireps
+**
+** Copies a small machine-code template per instruction and patches in the
+** register offsets and jump targets. Only instructions with a fast path
+** that can neither raise, allocate nor call are compiled (moves, literals,
+** jumps and Fixnum/Float arithmetic and comparison); everything else, and
+** any fast-path guard that fails, leaves native code with the address of
+** the instruction so the interpreter carries on from there.
+**
+** See Copyright Notice in mruby.h
+*/
+
+#ifdef MRB_JIT
+
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include "mruby.h"
+#include "mruby/irep.h"
+#include "opcode.h"
+#include "jit.h"
+
+#if defined(__x86_64__) && defined(__linux__) && !defined(MRB_INT64) && !defined(MRB_INT16) && \
+    !defined(MRB_USE_FLOAT) && !defined(MRB_NAN_BOXING) && !defined(MRB_WORD_BOXING)
+#define JIT_X86_64
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef JIT_X86_64
+
+static_assert(sizeof(mrb_value) == 16, "templates assume 16 byte values");
+static_assert(offsetof(mrb_value, tt) == 8, "templates assume the type tag follows the value");
+static_assert(MRB_TT_FALSE == 0 && MRB_TT_TRUE == 2, "boolean results are computed as 2 * flag");
+
+#define VAL(r) ((int32_t)((r) * sizeof(mrb_value)))
+#define TT(r)  ((int32_t)((r) * sizeof(mrb_value) + offsetof(mrb_value, tt)))
+
+/* register numbers as used in ModRM */
+enum { RAX = 0, RCX = 1, XMM0 = 0, XMM1 = 1 };
+
+/* condition codes, the low nibble of Jcc and SETcc */
+enum {
+    CC_O = 0x0, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_A = 0x7,
+    CC_NP = 0xb, CC_L = 0xc, CC_GE = 0xd, CC_LE = 0xe, CC_G = 0xf,
+};
+
+/* SSE2 scalar double opcodes (F2 0F xx) */
+enum { SD_LOAD = 0x10, SD_STORE = 0x11, SD_ADD = 0x58, SD_MUL = 0x59, SD_SUB = 0x5c, SD_DIV = 0x5e };
+
+namespace {
+
+struct Fixup {
+    size_t at;          /* position of the rel32 */
+    size_t pc;          /* target instruction */
+    bool exit;          /* to the exit stub of pc rather than its code */
+};
+
+/* Code is built in a plain buffer and copied into an executable mapping
+   afterwards: jumps are rip-relative and absolute addresses only point into
+   the irep, so nothing depends on where the code ends up. All templates
+   address registers as [rdi + disp32] and clobber only rax, rcx, rdx,
+   xmm0 and xmm1. */
+struct Assembler {
+    std::vector<uint8_t> buf;
+    std::vector<Fixup> fixups;
+
+    size_t pos() const { return buf.size(); }
+    void b(uint8_t v) { buf.push_back(v); }
+    void b(uint8_t v1, uint8_t v2) { b(v1); b(v2); }
+    void b(uint8_t v1, uint8_t v2, uint8_t v3) { b(v1); b(v2); b(v3); }
+    void u32(uint32_t v) {
+        for (int i = 0; i < 32; i += 8)
+            b((uint8_t)(v >> i));
+    }
+    void u64(uint64_t v) {
+        for (int i = 0; i < 64; i += 8)
+            b((uint8_t)(v >> i));
+    }
+    /* ModRM + disp32 for [rdi + disp] */
+    void mem(int reg, int32_t disp) {
+        b(0x80 | (reg << 3) | 7);
+        u32((uint32_t)disp);
+    }
+    void patch(size_t at, size_t target) {
+        int32_t rel = (int32_t)(target - (at + 4));
+        memcpy(&buf[at], &rel, 4);
+    }
+
+    /* jumps to other instructions and to exit stubs, resolved at the end */
+    void jmp(size_t pc) { b(0xe9); fixups.push_back({pos(), pc, false}); u32(0); }
+    void jcc(int cc, size_t pc) { b(0x0f, 0x80 | cc); fixups.push_back({pos(), pc, false}); u32(0); }
+    void jcc_exit(int cc, size_t pc) { b(0x0f, 0x80 | cc); fixups.push_back({pos(), pc, true}); u32(0); }
+    /* jumps within a template; bind() sets their target to the current position */
+    size_t jmp_fwd() { b(0xe9); u32(0); return pos() - 4; }
+    size_t jcc_fwd(int cc) { b(0x0f, 0x80 | cc); u32(0); return pos() - 4; }
+    void bind(size_t at) { patch(at, pos()); }
+
+    void exit_to(const mrb_code *pc) {
+        b(0x48, 0xb8); u64((uint64_t)(uintptr_t)pc);    /* mov rax, pc */
+        b(0xc3);                                        /* ret */
+    }
+    void cmp_tt(int r, mrb_vtype tt) { b(0x80); mem(7, TT(r)); b(tt); }
+    /* leaves native code at pc unless R(r) has type tt */
+    void guard_tt(int r, mrb_vtype tt, size_t pc) {
+        cmp_tt(r, tt);
+        jcc_exit(CC_NE, pc);
+    }
+    void load32(int reg, int r) { b(0x8b); mem(reg, VAL(r)); }
+    /* R(r).value := eax, sign-extended like mrb_fixnum_value() */
+    void store_fixnum(int r) {
+        b(0x48, 0x63, 0xc0);                            /* movsxd rax, eax */
+        b(0x48, 0x89); mem(RAX, VAL(r));
+    }
+    void set_word(int r, int32_t v) { b(0x48, 0xc7); mem(0, VAL(r)); u32((uint32_t)v); }
+    void set_tt(int r, mrb_vtype tt) { b(0xc6); mem(0, TT(r)); b(tt); }
+    void copy_value(int dst, int src) {
+        b(0x0f, 0x10); mem(XMM0, VAL(src));             /* movups xmm0, [src] */
+        b(0x0f, 0x11); mem(XMM0, VAL(dst));             /* movups [dst], xmm0 */
+    }
+    void sd(uint8_t op, int xmm, int r) { b(0xf2, 0x0f, op); mem(xmm, VAL(r)); }
+    /* R(r) := al ? true : false */
+    void store_bool(int r) {
+        b(0x00, 0xc0);                                  /* add al, al */
+        set_word(r, 1);
+        b(0x88); mem(RAX, TT(r));                       /* mov [tt], al */
+    }
+};
+
+}
+
+/* xmm := R(r) as a double, or leave native code if it is not a number */
+static void
+load_double(Assembler &as, int xmm, int r, size_t pc)
+{
+    as.cmp_tt(r, MRB_TT_FLOAT);
+    size_t not_float = as.jcc_fwd(CC_NE);
+    as.sd(SD_LOAD, xmm, r);
+    size_t done = as.jmp_fwd();
+    as.bind(not_float);
+    as.guard_tt(r, MRB_TT_FIXNUM, pc);
+    as.b(0xf2, 0x0f, 0x2a); as.mem(xmm, VAL(r));       /* cvtsi2sd xmm, [r] */
+    as.bind(done);
+}
+
+/* Branches to the returned position unless R(a) and R(a+1) are Fixnums. */
+static size_t
+unless_fixnums(Assembler &as, int a)
+{
+    as.cmp_tt(a, MRB_TT_FIXNUM);
+    size_t l1 = as.jcc_fwd(CC_NE);
+    as.cmp_tt(a + 1, MRB_TT_FIXNUM);
+    size_t l2 = as.jcc_fwd(CC_NE);
+    /* the first jump lands on the second one, which takes it too since the
+       flags still say "not equal"; only one position is left to bind */
+    as.patch(l1, l2 - 2);
+    return l2;
+}
+
+/* R(a) := xmm0 <op> xmm1, as a Float */
+static void
+float_op(Assembler &as, int a, uint8_t sd_op)
+{
+    as.b(0xf2, 0x0f, sd_op); as.b(0xc1);               /* op xmm0, xmm1 */
+    as.sd(SD_STORE, XMM0, a);
+    as.set_tt(a, MRB_TT_FLOAT);
+}
+
+/* OP_ADD, OP_SUB, OP_MUL: Fixnums (exiting on overflow), otherwise Floats
+   with Fixnum operands converted, like the interpreter does */
+static void
+emit_arith(Assembler &as, int a, size_t pc, uint8_t int_op, uint8_t sd_op)
+{
+    size_t not_fixnums = unless_fixnums(as, a);
+    as.load32(RAX, a);
+    if (int_op == 0xaf)
+        as.b(0x0f);                                     /* imul eax, [b] */
+    as.b(int_op); as.mem(RAX, VAL(a + 1));              /* add/sub eax, [b] */
+    as.jcc_exit(CC_O, pc);
+    as.store_fixnum(a);
+    size_t done = as.jmp_fwd();
+
+    as.bind(not_fixnums);
+    load_double(as, XMM0, a, pc);
+    load_double(as, XMM1, a + 1, pc);
+    float_op(as, a, sd_op);
+    as.bind(done);
+}
+
+/* OP_DIV: the interpreter's Float results for x/0 and MIN/-1 stay there */
+static void
+emit_div(Assembler &as, int a, size_t pc)
+{
+    size_t not_fixnums = unless_fixnums(as, a);
+    as.load32(RCX, a + 1);
+    as.b(0x85, 0xc9);                                   /* test ecx, ecx */
+    as.jcc_exit(CC_E, pc);
+    as.b(0x83, 0xf9, 0xff);                             /* cmp ecx, -1 */
+    as.jcc_exit(CC_E, pc);
+    as.load32(RAX, a);
+    as.b(0x99);                                         /* cdq */
+    as.b(0xf7, 0xf9);                                   /* idiv ecx */
+    as.store_fixnum(a);
+    size_t done = as.jmp_fwd();
+
+    as.bind(not_fixnums);
+    load_double(as, XMM0, a, pc);
+    load_double(as, XMM1, a + 1, pc);
+    float_op(as, a, SD_DIV);
+    as.bind(done);
+}
+
+/* OP_ADDI, OP_SUBI */
+static void
+emit_arith_imm(Assembler &as, int a, int c, size_t pc, bool add)
+{
+    as.cmp_tt(a, MRB_TT_FIXNUM);
+    size_t not_fixnum = as.jcc_fwd(CC_NE);
+    as.load32(RAX, a);
+    as.b(add ? 0x05 : 0x2d); as.u32((uint32_t)c);      /* add/sub eax, imm32 */
+    as.jcc_exit(CC_O, pc);
+    as.store_fixnum(a);
+    size_t done = as.jmp_fwd();
+
+    as.bind(not_fixnum);
+    as.guard_tt(a, MRB_TT_FLOAT, pc);
+    as.b(0xb8); as.u32((uint32_t)c);                   /* mov eax, imm32 */
+    as.b(0xf2, 0x0f, 0x2a); as.b(0xc8);                /* cvtsi2sd xmm1, eax */
+    as.sd(SD_LOAD, XMM0, a);
+    as.b(0xf2, 0x0f, add ? SD_ADD : SD_SUB); as.b(0xc1); /* addsd/subsd xmm0, xmm1 */
+    as.sd(SD_STORE, XMM0, a);
+    as.bind(done);
+}
+
+/* OP_EQ, OP_LT, OP_LE, OP_GT, OP_GE on Fixnums and Floats. Float operands
+   are swapped for < and <= so that NaN, which sets CF, compares false
+   everywhere. */
+static void
+emit_cmp(Assembler &as, int a, size_t pc, int int_cc, int float_cc, bool swap)
+{
+    size_t not_fixnums = unless_fixnums(as, a);
+    as.load32(RAX, a);
+    as.b(0x3b); as.mem(RAX, VAL(a + 1));               /* cmp eax, [b] */
+    as.b(0x0f, 0x90 | int_cc, 0xc0);                   /* setcc al */
+    as.store_bool(a);
+    size_t done = as.jmp_fwd();
+
+    as.bind(not_fixnums);
+    load_double(as, XMM0, swap ? a + 1 : a, pc);
+    load_double(as, XMM1, swap ? a : a + 1, pc);
+    as.b(0x66, 0x0f, 0x2e); as.b(0xc1);                /* ucomisd xmm0, xmm1 */
+    as.b(0x0f, 0x90 | float_cc, 0xc0);                 /* setcc al */
+    if (float_cc == CC_E) {
+        as.b(0x0f, 0x90 | CC_NP, 0xc1);                /* setnp cl */
+        as.b(0x20, 0xc8);                              /* and al, cl */
+    }
+    as.store_bool(a);
+    as.bind(done);
+}
+
+/* Emits the template for instruction k; returns false, emitting nothing,
+   if the instruction has to run in the interpreter. */
+static bool
+emit_insn(Assembler &as, const mrb_irep *irep, size_t k)
+{
+    mrb_code i = UNQUICKEN(irep->iseq[k]);
+    /* a superinstruction compiles as its first half; the second one follows */
+    i = (i & ~(mrb_code)0x7f) | MKOPCODE(mrb_unfused_opcode(GET_OPCODE(i)));
+    int a = GETARG_A(i);
+
+    switch (GET_OPCODE(i)) {
+    case OP_NOP:
+        return true;
+    case OP_MOVE:
+        as.copy_value(a, GETARG_B(i));
+        return true;
+    case OP_LOADL:
+        as.b(0x48, 0xb8); as.u64((uint64_t)(uintptr_t)&irep->pool[GETARG_Bx(i)]); /* mov rax, &lit */
+        as.b(0x0f, 0x10, 0x00);                         /* movups xmm0, [rax] */
+        as.b(0x0f, 0x11); as.mem(XMM0, VAL(a));
+        return true;
+    case OP_LOADI:
+        as.set_word(a, GETARG_sBx(i));
+        as.set_tt(a, MRB_TT_FIXNUM);
+        return true;
+    case OP_LOADSYM:
+        as.set_word(a, irep->syms[GETARG_Bx(i)]);
+        as.set_tt(a, MRB_TT_SYMBOL);
+        return true;
+    case OP_LOADNIL:
+        as.set_word(a, 0);
+        as.set_tt(a, MRB_TT_FALSE);
+        return true;
+    case OP_LOADSELF:
+        as.copy_value(a, 0);
+        return true;
+    case OP_LOADT:
+        as.set_word(a, 1);
+        as.set_tt(a, MRB_TT_TRUE);
+        return true;
+    case OP_LOADF:
+        as.set_word(a, 1);
+        as.set_tt(a, MRB_TT_FALSE);
+        return true;
+    case OP_JMP:
+        as.jmp(k + GETARG_sBx(i));
+        return true;
+    case OP_JMPIF:
+        as.cmp_tt(a, MRB_TT_FALSE);
+        as.jcc(CC_NE, k + GETARG_sBx(i));
+        return true;
+    case OP_JMPNOT:
+        as.cmp_tt(a, MRB_TT_FALSE);
+        as.jcc(CC_E, k + GETARG_sBx(i));
+        return true;
+    case OP_ADD:
+        emit_arith(as, a, k, 0x03, SD_ADD);
+        return true;
+    case OP_SUB:
+        emit_arith(as, a, k, 0x2b, SD_SUB);
+        return true;
+    case OP_MUL:
+        emit_arith(as, a, k, 0xaf, SD_MUL);
+        return true;
+    case OP_DIV:
+        emit_div(as, a, k);
+        return true;
+    case OP_ADDI:
+        emit_arith_imm(as, a, GETARG_C(i), k, true);
+        return true;
+    case OP_SUBI:
+        emit_arith_imm(as, a, GETARG_C(i), k, false);
+        return true;
+    case OP_EQ:
+        emit_cmp(as, a, k, CC_E, CC_E, false);
+        return true;
+    case OP_LT:
+        emit_cmp(as, a, k, CC_L, CC_A, true);
+        return true;
+    case OP_LE:
+        emit_cmp(as, a, k, CC_LE, CC_AE, true);
+        return true;
+    case OP_GT:
+        emit_cmp(as, a, k, CC_G, CC_A, false);
+        return true;
+    case OP_GE:
+        emit_cmp(as, a, k, CC_GE, CC_AE, false);
+        return true;
+    default:
+        return false;
+    }
+}
+
+void
+mrb_jit_compile(mrb_state *mrb, mrb_irep *irep)
+{
+    size_t ilen = irep->ilen;
+    Assembler as;
+    std::vector<uint32_t> start(ilen), stub(ilen, 0);
+    std::vector<bool> compiled(ilen);
+    size_t native_ops = 0;
+
+    if (irep->jit || ilen == 0)
+        return;
+    as.b(0xcc);                     /* offset 0 stands for "no native code" */
+    for (size_t k = 0; k < ilen; k++) {
+        start[k] = (uint32_t)as.pos();
+        compiled[k] = emit_insn(as, irep, k);
+        if (compiled[k])
+            native_ops++;
+        else
+            as.exit_to(irep->iseq + k);
+    }
+    /* bytecode always ends in OP_RETURN or OP_STOP, but never run off the end */
+    if (native_ops == 0 || (compiled[ilen - 1] && GET_OPCODE(irep->iseq[ilen - 1]) != OP_JMP))
+        return;
+    for (const Fixup &f : as.fixups) {
+        if (f.pc >= ilen)
+            return;
+        if (f.exit && !stub[f.pc]) {
+            stub[f.pc] = (uint32_t)as.pos();
+            as.exit_to(irep->iseq + f.pc);
+        }
+    }
+    for (const Fixup &f : as.fixups)
+        as.patch(f.at, f.exit ? stub[f.pc] : start[f.pc]);
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t mem_size = (as.pos() + page - 1) / page * page;
+    void *mem = mmap(nullptr, mem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return;
+    memcpy(mem, as.buf.data(), as.pos());
+    if (mprotect(mem, mem_size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, mem_size);
+        return;
+    }
+
+    mrb_jit_code *jit = (mrb_jit_code *)mrb->gc()._malloc(sizeof(mrb_jit_code));
+    jit->mrb = mrb;
+    jit->irep = irep;
+    jit->mem = (uint8_t *)mem;
+    jit->mem_size = mem_size;
+    jit->code_size = as.pos();
+    jit->entry = (uint32_t *)mrb->gc()._malloc(ilen * sizeof(uint32_t));
+    for (size_t k = 0; k < ilen; k++)
+        jit->entry[k] = compiled[k] ? start[k] : 0;
+    jit->native_ops = native_ops;
+    jit->enters = 0;
+    jit->prev = nullptr;
+    jit->next = mrb->jit_list;
+    if (jit->next)
+        jit->next->prev = jit;
+    mrb->jit_list = jit;
+    irep->jit = jit;
+}
+
+void
+mrb_jit_free(MemManager &mm, mrb_irep *irep)
+{
+    mrb_jit_code *jit = irep->jit;
+
+    if (jit->prev)
+        jit->prev->next = jit->next;
+    else
+        jit->mrb->jit_list = jit->next;
+    if (jit->next)
+        jit->next->prev = jit->prev;
+    munmap(jit->mem, jit->mem_size);
+    mm._free(jit->entry);
+    mm._free(jit);
+    irep->jit = nullptr;
+}
+
+#else
+
+void
+mrb_jit_compile(mrb_state *mrb, mrb_irep *irep)
+{
+    /* no code generator for this platform; everything stays interpreted */
+}
+
+void
+mrb_jit_free(MemManager &mm, mrb_irep *irep)
+{
+}
+
+#endif
+
+void
+mrb_jit_dump_stats(mrb_state *mrb, FILE *out)
+{
+    size_t n = 0, bytes = 0;
+
+    for (mrb_jit_code *jit = mrb->jit_list; jit; jit = jit->next) {
+        n++;
+        bytes += jit->code_size;
+    }
+    fprintf(out, "jit: %zu ireps compiled, %zu bytes of native code\n", n, bytes);
+    if (n == 0)
+        return;
+    fprintf(out, "%8s %8s %8s %12s  %s\n", "insns", "native", "bytes", "entries", "irep");
+    for (mrb_jit_code *jit = mrb->jit_list; jit; jit = jit->next) {
+        const mrb_irep *irep = jit->irep;
+
+        fprintf(out, "%8zu %8zu %8zu %12llu  ", irep->ilen, jit->native_ops, jit->code_size,
+                (unsigned long long)jit->enters);
+        if (irep->filename && irep->lines) {
+            int line = irep->lines[0];
+            for (size_t k = 1; k < irep->ilen; k++) {
+                if (irep->lines[k] && irep->lines[k] < line)
+                    line = irep->lines[k];
+            }
+            fprintf(out, "%s:%d\n", irep->filename, line);
+        }
+        else
+            fprintf(out, "%p\n", (const void *)irep);
+    }
+}
+
+#endif
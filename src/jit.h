@@ -0,0 +1,44 @@
+/*
+** jit.h - baseline JIT for hot ireps
+**
+** See Copyright Notice in mruby.h
+*/
+#pragma once
+#ifdef MRB_JIT
+
+#include "mruby.h"
+#include "mruby/irep.h"
+
+/* back-edges an irep takes in the interpreter before it is compiled */
+#ifndef MRB_JIT_THRESHOLD
+#define MRB_JIT_THRESHOLD 1000
+#endif
+
+/* Native code runs on the interpreter's own register window: it is called
+   with the current `regs` and returns the address of the first instruction
+   it could not execute, which the interpreter then dispatches as usual.
+   Only instructions that can neither raise, allocate nor call are compiled,
+   so callinfo, exception handling and GC never see a native frame. */
+typedef mrb_code *(*mrb_jit_func)(mrb_value *regs);
+
+struct mrb_jit_code {
+    mrb_state *mrb;
+    mrb_jit_code *prev, *next;  /* compiled ireps of mrb, for the stats dump */
+    mrb_irep *irep;
+    uint8_t *mem;               /* executable mapping */
+    size_t mem_size;
+    size_t code_size;
+    uint32_t *entry;            /* native offset per instruction, 0 if not compiled */
+    size_t native_ops;
+    uint64_t enters;
+
+    mrb_jit_func func_at(const mrb_code *pc) const {
+        uint32_t off = entry[pc - irep->iseq];
+        return off ? (mrb_jit_func)(mem + off) : nullptr;
+    }
+};
+
+void mrb_jit_compile(mrb_state *mrb, mrb_irep *irep);
+void mrb_jit_free(MemManager &mm, mrb_irep *irep);
+
+#endif
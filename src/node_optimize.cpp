@@ -0,0 +1,886 @@
+/*
+** node_optimize.cpp - AST optimizer, run between parsing and codegen
+**
+** See Copyright Notice in mruby.h
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <map>
+
+#include "mruby.h"
+#include "mruby/compile.h"
+#include "mruby/node.h"
+#include "mruby/NodeVisitor.h"
+
+namespace {
+
+typedef mrb_ast_node node;
+
+/* Visits every node of a tree, leaving in m_result the node that should take
+   the visited one's place. Children held in public members are replaced in
+   place; the others can only change by building a new parent. */
+class NodeRewriter : public NodeVisitor {
+public:
+    explicit NodeRewriter(mrb_parser_state *p) : m_p(p) {}
+
+    node *walk(node *n) {
+        if (!n)
+            return n;
+        node *saved = m_result;
+        m_result = n;
+        n->accept(this);
+        node *res = m_result;
+        m_result = saved;
+        return res;
+    }
+
+protected:
+    void walk_list(node *l) {
+        for (; l; l = l->right())
+            l->left(walk(l->left()));
+    }
+    void walk_args(CommandArgs *a) {
+        if (!a)
+            return;
+        walk_list(a->m_args);
+        a->m_blk = walk(a->m_blk);
+    }
+    void walk_defaults(ArgsStore *a) {
+        if (!a)
+            return;
+        for (node *o = a->m_opt; o; o = o->right())
+            o->left()->right(walk(o->left()->right()));
+    }
+    /* the receiver and arguments of an assignment target, not the target */
+    void walk_target(node *lhs) {
+        if (lhs && lhs->getType() == NODE_CALL) {
+            CallNode *c = (CallNode *)lhs;
+            c->m_receiver = walk(c->m_receiver);
+            walk_args(c->m_cmd_args);
+        }
+    }
+    template<typename T, typename... Args>
+    T *make(node *at, Args... args) {
+        T *res = m_p->new_t<T>(args...);
+        res->locationInit(at->lineno, at->filename_index);
+        return res;
+    }
+
+    mrb_parser_state *m_p;
+    node *m_result = nullptr;
+
+public:
+    int  visit(ScopeNode *n) { n->m_body = walk(n->m_body); return 0; }
+    void visit(PostExeNode *n) { n->m_chld = walk(n->m_chld); }
+    void visit(SelfNode *) {}
+    void visit(WordsNode *) {}
+    void visit(SymbolsNode *) {}
+    void visit(NilNode *) {}
+    void visit(TrueNode *) {}
+    void visit(FalseNode *) {}
+    void visit(RetryNode *) {}
+    void visit(RedoNode *) {}
+    void visit(EnsureNode *n) {
+        node *body = walk(n->body());
+        walk(n->ensure());
+        if (body != n->body())
+            m_result = make<EnsureNode>(n, body, n->ensure());
+    }
+    void visit(NegateNode *n) { n->m_chld = walk(n->m_chld); }
+    void visit(StrNode *) {}
+    void visit(XstrNode *) {}
+    void visit(RegxNode *) {}
+    void visit(DregxNode *n) { walk_list(n->m_a); }
+    void visit(BeginNode *n) {
+        for (node *&e : n->m_entries)
+            e = walk(e);
+    }
+    void visit(LambdaNode *n) {
+        walk_defaults(n->args());
+        node *body = walk(n->body());
+        if (body != n->body())
+            m_result = make<LambdaNode>(n, n->locals(), n->args(), body);
+    }
+    void visit(BlockNode *n) {
+        walk_defaults(n->args());
+        node *body = walk(n->body());
+        if (body != n->body())
+            m_result = make<BlockNode>(n, n->locals(), n->args(), body);
+    }
+    void visit(ModuleNode *n) { walk(n->scope()); }
+    void visit(ClassNode *n) { walk(n->scope()); }
+    void visit(SclassNode *n) { walk(n->scope()); }
+    void visit(CaseNode *n) {
+        for (node *c = n->cases(); c; c = c->right()) {
+            walk_list(c->left()->left());
+            c->left()->right(walk(c->left()->right()));
+        }
+        node *cond = walk(n->switched_on());
+        if (cond != n->switched_on())
+            m_result = make<CaseNode>(n, cond, n->cases());
+    }
+    void visit(RescueNode *n) {
+        for (node *c = n->rescue(); c; c = c->right()) {
+            node *clause = c->left()->right()->right();
+            clause->left(walk(clause->left()));
+        }
+        node *body = walk(n->body());
+        node *els = walk(n->r_else());
+        if (body != n->body() || els != n->r_else())
+            m_result = make<RescueNode>(n, body, n->rescue(), els);
+    }
+    void visit(ForNode *n) {
+        node *obj = walk(n->object());
+        node *body = walk(n->body());
+        if (obj != n->object() || body != n->body())
+            m_result = make<ForNode>(n, n->var(), obj, body);
+    }
+    void visit(SdefNode *n) {
+        walk_defaults(n->args());
+        node *body = walk(n->body());
+        if (body != n->body())
+            m_result = make<SdefNode>(n, n->receiver(), n->name(), n->ve_locals(), n->args(), body);
+    }
+    void visit(DefNode *n) {
+        walk_defaults(n->args());
+        node *body = walk(n->body());
+        if (body != n->body())
+            m_result = make<DefNode>(n, n->name(), n->ve_locals(), n->args(), body);
+    }
+    void visit(OpAsgnNode *n) { walk_target(n->m_lhs); n->m_rhs = walk(n->m_rhs); }
+    void visit(IfNode *n) {
+        node *cond = walk(n->cond());
+        node *tr = walk(n->true_body());
+        node *fl = walk(n->false_body());
+        if (cond != n->cond() || tr != n->true_body() || fl != n->false_body())
+            m_result = make<IfNode>(n, cond, tr, fl);
+    }
+    void visit(HeredocNode *n) { walk_list(n->contents()->doc); }
+    void visit(DsymNode *n) { walk_list(n->m_str->m_chld); }
+    void visit(DstrNode *n) { walk_list(n->m_chld); }
+    void visit(AsgnNode *n) { walk_target(n->m_lhs); n->m_rhs = walk(n->m_rhs); }
+    void visit(SymNode *) {}
+    void visit(Colon2Node *n) { n->m_val = walk(n->m_val); }
+    void visit(AndNode *n) { n->m_lhs = walk(n->m_lhs); n->m_rhs = walk(n->m_rhs); }
+    void visit(OrNode *n) { n->m_lhs = walk(n->m_lhs); n->m_rhs = walk(n->m_rhs); }
+    void visit(Dot3Node *n) { n->m_lhs = walk(n->m_lhs); n->m_rhs = walk(n->m_rhs); }
+    void visit(Dot2Node *n) { n->m_lhs = walk(n->m_lhs); n->m_rhs = walk(n->m_rhs); }
+    void visit(YieldNode *n) { walk_list(n->m_chld); }
+    void visit(UntilNode *n) { n->m_lhs = walk(n->m_lhs); n->m_rhs = walk(n->m_rhs); }
+    void visit(WhileNode *n) { n->m_lhs = walk(n->m_lhs); n->m_rhs = walk(n->m_rhs); }
+    void visit(AliasNode *) {}
+    void visit(SplatNode *n) { n->m_chld = walk(n->m_chld); }
+    void visit(MAsgnNode *n) { n->m_rhs = walk(n->m_rhs); }
+    void visit(UndefNode *) {}
+    void visit(HashNode *n) {
+        for (node *l = n->m_chld; l; l = l->right()) {
+            node *kv = l->left();
+            kv->left(walk(kv->left()));
+            kv->right(walk(kv->right()));
+        }
+    }
+    void visit(SuperNode *n) { walk_args(n->cmd_args); }
+    void visit(Colon3Node *) {}
+    void visit(CallNode *n) { n->m_receiver = walk(n->m_receiver); walk_args(n->m_cmd_args); }
+    void visit(FCallNode *n) { n->m_receiver = walk(n->m_receiver); walk_args(n->m_cmd_args); }
+    void visit(ReturnNode *n) { n->m_chld = walk(n->m_chld); }
+    void visit(NextNode *n) { n->m_chld = walk(n->m_chld); }
+    void visit(ArrayNode *n) { walk_list(n->m_chld); }
+    void visit(NthRefNode *) {}
+    void visit(BackRefNode *) {}
+    void visit(ZsuperNode *n) { walk_args(n->cmd_args); }
+    void visit(IntLiteralNode *) {}
+    void visit(FloatLiteralNode *) {}
+    void visit(ConstNode *) {}
+    void visit(IVarNode *) {}
+    void visit(CVarNode *) {}
+    void visit(GVarNode *) {}
+    void visit(LVarNode *) {}
+    void visit(BlockArgNode *n) { n->m_chld = walk(n->m_chld); }
+    void visit(BreakNode *n) { n->m_chld = walk(n->m_chld); }
+    void visit(MethodCheckNode *n) { n->m_recv = walk(n->m_recv); }
+    void visit(LiteralDelimNode *) {}
+    void visit(ArgNode *) {}
+    void visit(DxstrNode *) {}
+};
+
+/* What a block body does that would change meaning once it runs as the body
+   of a while loop in the enclosing scope instead. */
+class LoopBodyScan : public NodeRewriter {
+public:
+    explicit LoopBodyScan(mrb_parser_state *p) : NodeRewriter(p) {}
+
+    bool closure = false;   /* a block, lambda or for: could capture the loop variables */
+    bool redo = false;
+    bool brk = false;       /* break out of the block, i.e. out of the loop */
+    bool ret = false;
+    bool bad_next = false;  /* next under rescue/ensure: codegen would return instead */
+
+    void visit(LambdaNode *) { closure = true; }
+    void visit(BlockNode *) { closure = true; }
+    void visit(ForNode *) { closure = true; }
+    /* new scopes, which cannot see the loop variables */
+    void visit(DefNode *) {}
+    void visit(SdefNode *) {}
+    void visit(ClassNode *) {}
+    void visit(ModuleNode *) {}
+    void visit(SclassNode *) {}
+
+    void visit(WhileNode *n) { m_loops++; NodeRewriter::visit(n); m_loops--; }
+    void visit(UntilNode *n) { m_loops++; NodeRewriter::visit(n); m_loops--; }
+    void visit(RescueNode *n) { m_handlers++; NodeRewriter::visit(n); m_handlers--; }
+    void visit(EnsureNode *n) { m_handlers++; NodeRewriter::visit(n); m_handlers--; }
+    void visit(RedoNode *) { if (!m_loops) redo = true; }
+    void visit(BreakNode *n) { if (!m_loops) brk = true; NodeRewriter::visit(n); }
+    void visit(NextNode *n) {
+        if (!m_loops && m_handlers)
+            bad_next = true;
+        NodeRewriter::visit(n);
+    }
+    void visit(ReturnNode *n) { ret = true; NodeRewriter::visit(n); }
+
+private:
+    int m_loops = 0;
+    int m_handlers = 0;
+};
+
+/* Whether a block parameter is used as anything but the receiver of call or
+   [], the condition of an if, or a block passed on to another call. */
+class BlockUseScan : public NodeRewriter {
+public:
+    BlockUseScan(mrb_parser_state *p, mrb_sym blk) : NodeRewriter(p), m_blk(blk) {
+        m_call = p->intern("call");
+        m_aref = p->intern("[]");
+    }
+
+    bool escapes = false;
+
+    void visit(LVarNode *n) { if (n->sym() == m_blk) escapes = true; }
+    void visit(CallNode *n) {
+        if (is_blk(n->m_receiver) && (n->m_method == m_call || n->m_method == m_aref))
+            walk_args(n->m_cmd_args);
+        else
+            NodeRewriter::visit(n);
+    }
+    void visit(BlockArgNode *n) { if (!is_blk(n->child())) NodeRewriter::visit(n); }
+    void visit(IfNode *n) {
+        if (!is_blk(n->cond()))
+            walk(n->cond());
+        walk(n->true_body());
+        walk(n->false_body());
+    }
+    /* new scopes, where the name means something else */
+    void visit(DefNode *) {}
+    void visit(SdefNode *) {}
+    void visit(ClassNode *) {}
+    void visit(ModuleNode *) {}
+    void visit(SclassNode *) {}
+
+private:
+    bool is_blk(node *n) const {
+        return n && n->getType() == NODE_LVAR && ((LVarNode *)n)->sym() == m_blk;
+    }
+    mrb_sym m_blk, m_call, m_aref;
+};
+
+struct Num {
+    bool flo;
+    mrb_int i;
+    mrb_float f;
+    mrb_float as_float() const { return flo ? f : (mrb_float)i; }
+};
+
+/* Folds constant expressions and turns loops written with core iterators
+   into while loops.
+
+   Arithmetic and comparisons are folded only where the VM would take its
+   Fixnum/Float/String fast path, which never looks the operator up either.
+   Integer#times, Range#each and Kernel#loop calls with a literal block are
+   inlined as a counted or infinite while loop behind an OP_CHKMETH guard,
+   with the original call kept as the fallback should the method have been
+   redefined.
+
+   It also notes the block parameters (&blk) that never escape the call, so
+   that the blocks passed to them need not outlive their frame. */
+class NodeOptimizer : public NodeRewriter {
+public:
+    explicit NodeOptimizer(mrb_parser_state *p) : NodeRewriter(p) {
+        m_times = p->intern("times");
+        m_each = p->intern("each");
+        m_loop = p->intern("loop");
+        m_plus = p->intern("+");
+        m_lt = p->intern("<");
+        m_le = p->intern("<=");
+    }
+
+    using NodeRewriter::visit;
+
+    int visit(ScopeNode *n) {
+        bool ensure = (n == m_ensure_scope);
+        m_scopes.push_back(Scope(n->m_locals, !ensure, false, false, !ensure));
+        NodeRewriter::visit(n);
+        if (m_scopes.back().changed)
+            n->m_locals = m_scopes.back().locals;
+        m_scopes.pop_back();
+        return 0;
+    }
+    void visit(EnsureNode *n) {
+        ScopeNode *saved = m_ensure_scope;
+        m_ensure_scope = n->ensure();
+        NodeRewriter::visit(n);
+        m_ensure_scope = saved;
+    }
+    void visit(ForNode *n) {
+        /* the body runs as a block that shares the enclosing scope's variables */
+        m_scopes.push_back(Scope(tLocals(), false, false, false, false));
+        NodeRewriter::visit(n);
+        m_scopes.pop_back();
+    }
+    void visit(DefNode *n) {
+        note_block_use(n->args(), n->body());
+        m_scopes.push_back(Scope(n->ve_locals(), true, true, false, true));
+        NodeRewriter::visit(n);
+        DefNode *d = (DefNode *)m_result;
+        node *body = tail_returns(d->body(), d->name(), false);
+        if (body != d->body())
+            m_result = make<DefNode>(d, d->name(), d->ve_locals(), d->args(), body);
+        leave_scope();
+    }
+    void visit(SdefNode *n) {
+        note_block_use(n->args(), n->body());
+        m_scopes.push_back(Scope(n->ve_locals(), true, true, false, true));
+        NodeRewriter::visit(n);
+        SdefNode *d = (SdefNode *)m_result;
+        node *body = tail_returns(d->body(), d->name(), false);
+        if (body != d->body())
+            m_result = make<SdefNode>(d, d->receiver(), d->name(), d->ve_locals(), d->args(), body);
+        leave_scope();
+    }
+    void visit(BlockNode *n) {
+        note_block_use(n->args(), n->body());
+        m_scopes.push_back(Scope(n->locals(), false, false, false, true));
+        NodeRewriter::visit(n);
+        leave_scope();
+    }
+    void visit(LambdaNode *n) {
+        note_block_use(n->args(), n->body());
+        m_scopes.push_back(Scope(n->locals(), false, false, true, true));
+        NodeRewriter::visit(n);
+        leave_scope();
+    }
+
+    void visit(BeginNode *n) {
+        std::vector<node *> &e = n->m_entries;
+        for (size_t k = 0; k < e.size(); k++)
+            e[k] = inline_loop(walk(e[k]), k + 1 == e.size());
+    }
+    void visit(CallNode *n) {
+        NodeRewriter::visit(n);
+        fold_call(n);
+    }
+    void visit(DstrNode *n) {
+        NodeRewriter::visit(n);
+        if (merge_parts(n) && n->m_chld && !n->m_chld->right())
+            m_result = n->m_chld->left();
+    }
+    void visit(DsymNode *n) {
+        NodeRewriter::visit(n);
+        merge_parts(n->m_str);
+    }
+    void visit(IfNode *n) {
+        NodeRewriter::visit(n);
+        IfNode *r = (IfNode *)m_result;
+        int t = truth(r->cond());
+        if (t > 0)
+            m_result = r->true_body() ? r->true_body() : make<NilNode>(r);
+        else if (t == 0)
+            m_result = r->false_body() ? r->false_body() : make<NilNode>(r);
+    }
+    void visit(WhileNode *n) {
+        NodeRewriter::visit(n);
+        int t = truth(n->m_lhs);
+        if (t > 0 && n->m_lhs->getType() != NODE_TRUE)
+            n->m_lhs = make<TrueNode>(n->m_lhs);
+        else if (t == 0)
+            m_result = make<NilNode>(n);
+    }
+    void visit(UntilNode *n) {
+        NodeRewriter::visit(n);
+        int t = truth(n->m_lhs);
+        if (t == 0)
+            m_result = make<WhileNode>(n, make<TrueNode>(n->m_lhs), n->m_rhs);
+        else if (t > 0)
+            m_result = make<NilNode>(n);
+    }
+
+private:
+    struct Scope {
+        Scope(const tLocals &l, bool boundary, bool def, bool lambda, bool inlines) :
+            locals(l), boundary(boundary), def(def), lambda(lambda), inlines(inlines) {}
+        tLocals locals;
+        std::vector<mrb_sym> added;     /* variables of blocks inlined here */
+        bool boundary;                  /* def, class body or top level: nothing visible beyond */
+        bool def;
+        bool lambda;
+        bool inlines;                   /* may take an inlined loop */
+        bool changed = false;
+    };
+
+    static bool has(const std::vector<mrb_sym> &v, mrb_sym s) {
+        return std::find(v.begin(), v.end(), s) != v.end();
+    }
+
+    void note_block_use(ArgsStore *args, node *body) {
+        if (!args || !args->m_blk)
+            return;
+        BlockUseScan scan(m_p, args->m_blk);
+        for (node *o = args->m_opt; o; o = o->right())
+            scan.walk(o->left()->right());
+        scan.walk(body);
+        args->m_blk_escapes = scan.escapes;
+    }
+
+    /* A call of the method itself that ends a branch of its body returns
+       explicitly, so that codegen can see it as a tail call. The tail of the
+       body itself already is one. */
+    node *tail_returns(node *n, mrb_sym name, bool branch) {
+        if (!n)
+            return n;
+        switch (n->getType()) {
+        case NODE_BEGIN: {
+            std::vector<node *> &e = ((BeginNode *)n)->m_entries;
+            if (!e.empty())
+                e.back() = tail_returns(e.back(), name, branch);
+            return n;
+        }
+        case NODE_IF: {
+            IfNode *f = (IfNode *)n;
+            node *tr = tail_returns(f->true_body(), name, true);
+            node *fl = tail_returns(f->false_body(), name, true);
+            if (tr != f->true_body() || fl != f->false_body())
+                return make<IfNode>(f, f->cond(), tr, fl);
+            return n;
+        }
+        case NODE_CALL:
+        case NODE_FCALL: {
+            CallCommonNode *c = (CallCommonNode *)n;
+            if (!branch || c->m_method != name || (c->m_cmd_args && c->m_cmd_args->m_blk))
+                return n;
+            return make<ReturnNode>(n, n);
+        }
+        default:
+            return n;
+        }
+    }
+
+    /* rebuilds a def or block whose scope got the variables of inlined loops */
+    void leave_scope() {
+        Scope &s = m_scopes.back();
+        if (s.changed) {
+            node *n = m_result;
+            switch (n->getType()) {
+            case NODE_DEF: {
+                DefNode *d = (DefNode *)n;
+                m_result = make<DefNode>(d, d->name(), s.locals, d->args(), d->body());
+                break;
+            }
+            case NODE_SDEF: {
+                SdefNode *d = (SdefNode *)n;
+                m_result = make<SdefNode>(d, d->receiver(), d->name(), s.locals, d->args(), d->body());
+                break;
+            }
+            case NODE_BLOCK: {
+                BlockNode *b = (BlockNode *)n;
+                m_result = make<BlockNode>(b, s.locals, b->args(), b->body());
+                break;
+            }
+            default: {
+                LambdaNode *b = (LambdaNode *)n;
+                m_result = make<LambdaNode>(b, s.locals, b->args(), b->body());
+                break;
+            }
+            }
+            m_inlined_vars[m_result] = s.added;
+        }
+        m_scopes.pop_back();
+    }
+
+    /* 1 for a literal that is always true, 0 for false and nil, -1 if unknown */
+    static int truth(node *n) {
+        switch (n->getType()) {
+        case NODE_TRUE: case NODE_INT: case NODE_FLOAT: case NODE_STR: case NODE_SYM:
+            return 1;
+        case NODE_FALSE: case NODE_NIL:
+            return 0;
+        default:
+            return -1;
+        }
+    }
+
+    static bool int_literal(node *n, mrb_int &v) {
+        bool neg = false;
+        if (n->getType() == NODE_NEGATE) {
+            n = ((NegateNode *)n)->child();
+            neg = true;
+        }
+        if (n->getType() != NODE_INT)
+            return false;
+        IntLiteralNode *lit = (IntLiteralNode *)n;
+        char *end;
+        errno = 0;
+        long long x = strtoll(lit->m_val, &end, lit->m_base);
+        if (errno || *end || x > MRB_INT_MAX)
+            return false;   /* left to codegen, which turns it into a Float */
+        v = neg ? -(mrb_int)x : (mrb_int)x;
+        return true;
+    }
+    static bool num_literal(node *n, Num &v) {
+        if (int_literal(n, v.i)) {
+            v.flo = false;
+            return true;
+        }
+        bool neg = false;
+        if (n->getType() == NODE_NEGATE) {
+            n = ((NegateNode *)n)->child();
+            neg = true;
+        }
+        if (n->getType() != NODE_FLOAT)
+            return false;
+        v.flo = true;
+        v.f = ((FloatLiteralNode *)n)->value();
+        if (neg)
+            v.f = -v.f;
+        return true;
+    }
+    node *int_node(node *at, mrb_int v) {
+        char buf[32];
+        if (v == MRB_INT_MIN)
+            return nullptr;
+        snprintf(buf, sizeof(buf), "%lld", (long long)(v < 0 ? -v : v));
+        node *lit = make<IntLiteralNode>(at, buf, 10);
+        return v < 0 ? make<NegateNode>(at, lit) : lit;
+    }
+    node *float_node(node *at, mrb_float v) {
+        char buf[64];
+        if (!std::isfinite(v))
+            return nullptr;
+        snprintf(buf, sizeof(buf), "%.17g", (double)(std::signbit(v) ? -v : v));
+        node *lit = make<FloatLiteralNode>(at, buf);
+        return std::signbit(v) ? make<NegateNode>(at, lit) : lit;
+    }
+
+    void fold_call(CallNode *n) {
+        CommandArgs *a = n->m_cmd_args;
+        if (!a || a->m_blk || !a->m_args || a->m_args->right())
+            return;
+        node *rhs = a->m_args->left();
+        size_t len;
+        const char *name = mrb_sym2name_len(m_p->m_mrb, n->m_method, len);
+        if (len < 1 || len > 2)
+            return;
+
+        /* numeric literals only: "a" + "b" stays a call, String#+ may
+           be redefined */
+        Num x, y;
+        if (!num_literal(n->m_receiver, x) || !num_literal(rhs, y))
+            return;
+        bool ints = !x.flo && !y.flo;
+        node *res = nullptr;
+        if (len == 1) {
+            switch (name[0]) {
+            case '+': case '-': case '*': {
+                if (ints) {
+                    int64_t r = name[0] == '+' ? (int64_t)x.i + y.i :
+                                name[0] == '-' ? (int64_t)x.i - y.i : (int64_t)x.i * y.i;
+                    if (r >= MRB_INT_MIN && r <= MRB_INT_MAX && (name[0] != '*' || x.i == 0 || r / x.i == y.i))
+                        res = int_node(n, (mrb_int)r);
+                }
+                else {
+                    mrb_float p = x.as_float(), q = y.as_float();
+                    res = float_node(n, name[0] == '+' ? p + q : name[0] == '-' ? p - q : p * q);
+                }
+                break;
+            }
+            case '/':
+                if (ints) {
+                    if (y.i != 0 && !(x.i == MRB_INT_MIN && y.i == -1))
+                        res = int_node(n, x.i / y.i);
+                }
+                else {
+                    res = float_node(n, x.as_float() / y.as_float());
+                }
+                break;
+            case '<':
+                res = bool_node(n, ints ? x.i < y.i : x.as_float() < y.as_float());
+                break;
+            case '>':
+                res = bool_node(n, ints ? x.i > y.i : x.as_float() > y.as_float());
+                break;
+            }
+        }
+        else if (name[1] == '=') {
+            switch (name[0]) {
+            case '<':
+                res = bool_node(n, ints ? x.i <= y.i : x.as_float() <= y.as_float());
+                break;
+            case '>':
+                res = bool_node(n, ints ? x.i >= y.i : x.as_float() >= y.as_float());
+                break;
+            case '=':
+                res = bool_node(n, ints ? x.i == y.i : x.as_float() == y.as_float());
+                break;
+            }
+        }
+        if (res)
+            m_result = res;
+    }
+    node *bool_node(node *at, bool v) {
+        if (v)
+            return make<TrueNode>(at);
+        return make<FalseNode>(at);
+    }
+
+    /* joins adjacent literal parts of an interpolated string; a String
+       interpolated as #{"..."} is used as is, so it counts as literal.
+       Returns true if nothing but literal text is left. */
+    bool merge_parts(DstrNode *n) {
+        node *head = nullptr, *tail = nullptr;
+        StrNode *run = nullptr;
+        bool literal = true;
+        for (node *l = n->m_chld; l; l = l->right()) {
+            node *part = l->left();
+            if (part->getType() == NODE_BEGIN && ((BeginNode *)part)->m_entries.size() == 1 &&
+                    ((BeginNode *)part)->m_entries[0]->getType() == NODE_STR)
+                part = ((BeginNode *)part)->m_entries[0];
+            if (part->getType() == NODE_STR) {
+                StrNode *s = (StrNode *)part;
+                if (run) {
+                    char *buf = (char *)m_p->parser_palloc(run->m_length + s->m_length + 1);
+                    memcpy(buf, run->m_str, run->m_length);
+                    memcpy(buf + run->m_length, s->m_str, s->m_length);
+                    buf[run->m_length + s->m_length] = '\0';
+                    run->m_str = buf;
+                    run->m_length += s->m_length;
+                    continue;
+                }
+                part = run = make<StrNode>(s, s->m_str, s->m_length);
+            }
+            else {
+                run = nullptr;
+                literal = false;
+            }
+            node *cell = m_p->cons(part, nullptr);
+            if (tail)
+                tail->right(cell);
+            else
+                head = cell;
+            tail = cell;
+        }
+        n->m_chld = head;
+        return literal;
+    }
+
+    mrb_sym hidden_var() {
+        char buf[16];
+        int len = snprintf(buf, sizeof(buf), "(it%d)", m_hidden++);
+        return m_p->intern2(buf, len);
+    }
+    void add_var(mrb_sym s) {
+        Scope &sc = m_scopes.back();
+        if (!has(sc.locals, s))
+            sc.locals.push_back(s);
+        if (!has(sc.added, s))
+            sc.added.push_back(s);
+        sc.changed = true;
+    }
+    /* a variable of the block would capture or shadow one already visible here */
+    bool visible(mrb_sym s) const {
+        for (auto it = m_scopes.rbegin(); it != m_scopes.rend(); ++it) {
+            if (has(it->locals, s) && !has(it->added, s))
+                return true;
+            if (it->boundary)
+                break;
+        }
+        return false;
+    }
+    /* `return` in the block leaves the method around it, as it will from a
+       while loop; anywhere else it might not */
+    bool return_ok() const {
+        for (auto it = m_scopes.rbegin(); it != m_scopes.rend(); ++it) {
+            if (it->lambda)
+                return false;
+            if (it->boundary)
+                return it->def;
+        }
+        return false;
+    }
+
+    /* Rewrites a statement `recv.times {|i| body }`, `(a..b).each {|i| body }`
+       or `loop { body }` into
+
+           if <method is still the core one>
+             i = counter while the loop runs
+             body
+           else
+             original call
+           end
+
+       `used` tells whether the statement's value is needed. */
+    node *inline_loop(node *e, bool used) {
+        if ((e->getType() != NODE_CALL && e->getType() != NODE_FCALL) || !m_scopes.back().inlines)
+            return e;
+        CallCommonNode *call = (CallCommonNode *)e;
+        bool fcall = e->getType() == NODE_FCALL;
+        CommandArgs *a = call->m_cmd_args;
+        if (!a || a->m_args || !a->m_blk || a->m_blk->getType() != NODE_BLOCK)
+            return e;
+        BlockNode *blk = (BlockNode *)a->m_blk;
+
+        int which;
+        mrb_int first = 0, last = 0;
+        bool exclusive = false;
+        node *recv = call->m_receiver;
+        if (fcall) {
+            if (call->m_method != m_loop)
+                return e;
+            which = MRB_INLINE_LOOP;
+        }
+        else if (call->m_method == m_times) {
+            which = MRB_INLINE_TIMES;
+        }
+        else if (call->m_method == m_each) {
+            node *r = recv;
+            if (r->getType() == NODE_BEGIN && ((BeginNode *)r)->m_entries.size() == 1)
+                r = ((BeginNode *)r)->m_entries[0];
+            if (r->getType() != NODE_DOT2 && r->getType() != NODE_DOT3)
+                return e;
+            exclusive = r->getType() == NODE_DOT3;
+            if (!int_literal(((BinaryNode *)r)->lhs(), first) ||
+                    !int_literal(((BinaryNode *)r)->rhs(), last))
+                return e;
+            /* the counter starts one below and may end one above the range */
+            if (first == MRB_INT_MIN || (!exclusive && last == MRB_INT_MAX))
+                return e;
+            which = MRB_INLINE_EACH;
+        }
+        else {
+            return e;
+        }
+
+        /* the block takes at most one plain argument, none for loop */
+        ArgsStore *args = blk->args();
+        mrb_sym param = 0;
+        if (args) {
+            if (args->m_opt || args->m_rest || args->m_post_mandatory || args->m_blk)
+                return e;
+            node *m = args->m_mandatory;
+            if (m) {
+                if (m->right() || m->left()->getType() != NODE_ARG || which == MRB_INLINE_LOOP)
+                    return e;
+                param = ((ArgNode *)m->left())->sym();
+            }
+        }
+
+        LoopBodyScan scan(m_p);
+        scan.walk(blk->body());
+        if (scan.closure || scan.redo || scan.bad_next)
+            return e;
+        if (scan.brk && used && which != MRB_INLINE_LOOP)
+            return e;   /* the loop's value would be the break value instead of self */
+        if (scan.ret && !return_ok())
+            return e;
+
+        /* the block's variables move to this scope, so none may be visible here */
+        const std::vector<mrb_sym> &inner = m_inlined_vars[blk];
+        tLocals vars = blk->locals();
+        for (mrb_sym s : vars)
+            if (s && !has(inner, s) && visible(s))
+                return e;
+        std::vector<node *> pre;    /* run every iteration before the body */
+        for (mrb_sym s : vars) {
+            if (!s)
+                continue;
+            add_var(s);
+            /* a fresh block-local variable starts out nil on each call */
+            if (s != param && !has(inner, s))
+                pre.push_back(make<AsgnNode>(blk, make<LVarNode>(blk, s), make<NilNode>(blk)));
+        }
+
+        node *loop;
+        node *value = nullptr;
+        BeginNode *then = make<BeginNode>(call, nullptr);
+        BeginNode *stmts = make<BeginNode>(call, nullptr);
+        MethodCheckNode *guard;
+        if (which == MRB_INLINE_LOOP) {
+            guard = make<MethodCheckNode>(call, make<SelfNode>(call), m_loop, which);
+            loop = make<TrueNode>(call);
+        }
+        else {
+            /* counter = first - 1; while (counter += 1) < limit */
+            mrb_sym counter = hidden_var();
+            add_var(counter);
+            node *limit;
+            mrb_int v;
+            if (which == MRB_INLINE_EACH) {
+                limit = int_node(call, last);
+                guard = make<MethodCheckNode>(call, recv, m_each, which);
+                value = recv;
+            }
+            else if (int_literal(recv, v)) {
+                limit = recv;
+                guard = make<MethodCheckNode>(call, recv, m_times, which);
+                value = recv;
+            }
+            else {
+                /* the receiver is evaluated once */
+                mrb_sym self = hidden_var();
+                add_var(self);
+                stmts->push_back(make<AsgnNode>(call, make<LVarNode>(call, self), recv));
+                limit = make<LVarNode>(call, self);
+                call->m_receiver = limit;
+                guard = make<MethodCheckNode>(call, limit, m_times, which);
+                value = limit;
+            }
+            then->push_back(make<AsgnNode>(call, make<LVarNode>(call, counter), int_node(call, first - 1)));
+            node *step = make<AsgnNode>(call, make<LVarNode>(call, counter),
+                                        make<CallNode>(call, make<LVarNode>(call, counter), m_plus,
+                                                       m_p->new_simple<CommandArgs>(m_p->list1(int_node(call, 1)))));
+            loop = make<CallNode>(call, step, (which == MRB_INLINE_EACH && !exclusive) ? m_le : m_lt,
+                                  m_p->new_simple<CommandArgs>(m_p->list1(limit)));
+            if (param)
+                pre.insert(pre.begin(), make<AsgnNode>(blk, make<LVarNode>(blk, param), make<LVarNode>(blk, counter)));
+        }
+
+        BeginNode *body = make<BeginNode>(blk, nullptr);
+        for (node *p : pre)
+            body->push_back(p);
+        body->push_back(blk->body() ? blk->body() : make<NilNode>(blk));
+        then->push_back(make<WhileNode>(call, loop, body));
+        if (used && value)
+            then->push_back(value);
+        stmts->push_back(make<IfNode>(call, guard, then, call));
+        if (stmts->m_entries.size() == 1)
+            return stmts->m_entries[0];
+        return stmts;
+    }
+
+    std::vector<Scope> m_scopes;
+    ScopeNode *m_ensure_scope = nullptr;
+    std::map<node *, std::vector<mrb_sym>> m_inlined_vars;  /* per rebuilt block */
+    int m_hidden = 0;
+    mrb_sym m_times, m_each, m_loop, m_plus, m_lt, m_le;
+};
+
+} // end of anonymous namespace
+
+void mrb_ast_optimize(mrb_parser_state *p)
+{
+    if (!p->m_tree)
+        return;
+    NodeOptimizer opt(p);
+    p->m_tree = opt.walk(p->m_tree);
+}
@@ -96,7 +96,7 @@ static mrb_value num_div(mrb_state *mrb, mrb_value x)
 {
     mrb_float y;
 
-    mrb_get_args(mrb, "f", &y);
+    mrb->get_args(y);
     return mrb_float_value(mrb_to_flo(mrb, x) / y);
 }
 
@@ -353,7 +353,7 @@ static mrb_value num_equal(mrb_state *mrb, mrb_value x, mrb_value y)
 {
     if (mrb_obj_equal(x, y))
         return mrb_true_value();
-    return mrb->funcall(y, "==", 1, x);
+    return mrb->funcall(MRB_CALL_EQ, y, 1, &x);
 }
 
 /* 15.2.9.3.7  */
@@ -558,7 +558,7 @@ static mrb_value flo_round(mrb_state *mrb, mrb_value num)
     mrb_int ndigits = 0;
     int i;
 
-    mrb_get_args(mrb, "|i", &ndigits);
+    mrb->get_args<0>(ndigits);
     number = mrb_float(num);
     f = 1.0;
     i = abs(ndigits);
@@ -786,7 +786,7 @@ flo_divmod(mrb_state *mrb, mrb_value x)
     mrb_float div, mod;
     mrb_value a, b;
 
-    mrb_get_args(mrb, "o", &y);
+    mrb->get_args(y);
 
     flodivmod(mrb, mrb_float(x), mrb_to_flo(mrb, y), &div, &mod);
     a = mrb_float_value((mrb_int)div);
@@ -1183,7 +1183,7 @@ static mrb_value fix_to_s(mrb_state *mrb, mrb_value self)
 {
     mrb_int base = 10;
 
-    mrb_get_args(mrb, "|i", &base);
+    mrb->get_args<0>(base);
     return mrb_fixnum_to_str(mrb, self, base)->wrap();
 }
 
@@ -1238,7 +1238,7 @@ flo_plus(mrb_state *mrb, mrb_value self)
     mrb_float x,  y;
 
     x = mrb_float(self);
-    mrb_get_args(mrb, "f", &y);
+    mrb->get_args(y);
 
     return mrb_float_value(x + y);
 }
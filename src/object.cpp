@@ -41,7 +41,7 @@ bool mrb_equal(mrb_state *mrb, mrb_value obj1, mrb_value obj2)
 
     if (mrb_obj_eq(obj1, obj2))
         return true;
-    mrb_value result = mrb->funcall(obj1, "==", 1, obj2);
+    mrb_value result = mrb->funcall(MRB_CALL_EQ, obj1, 1, &obj2);
     return result.to_bool();
 }
 
@@ -288,7 +288,7 @@ static mrb_value convert_type(mrb_state *mrb, const mrb_value &val, const char *
         return mrb_funcall_argv(mrb, val, m, 0, 0);
 
     if (raise)
-        mrb->mrb_raisef(E_TYPE_ERROR, "can't convert %S into %S", inspect_type(mrb, val), mrb_str_new_cstr(mrb, tname));
+        mrb->mrb_raisef(E_TYPE_ERROR, "can't convert %S into %S", inspect_type(mrb, val)->wrap(), mrb_str_new_cstr(mrb, tname)->wrap());
 
     return mrb_value::nil();
 }
@@ -310,7 +310,7 @@ mrb_value mrb_convert_type(mrb_state *mrb, const mrb_value &val, mrb_vtype type,
     mrb_value v = convert_type(mrb, val, tname, method, 1/*Qtrue*/);
     if (mrb_type(v) != type) {
         mrb->mrb_raisef(E_TYPE_ERROR, "%S cannot be converted to %S by #%S", val,
-                        mrb_str_new_cstr(mrb, tname), mrb_str_new_cstr(mrb, method));
+                        mrb_str_new_cstr(mrb, tname)->wrap(), mrb_str_new_cstr(mrb, method)->wrap());
     }
     return v;
 }
@@ -381,7 +381,7 @@ void mrb_check_type(mrb_state *mrb, mrb_value x, mrb_vtype t)
                 etype = mrb_obj_classname(mrb, x);
             }
             mrb->mrb_raisef(E_TYPE_ERROR, "wrong argument type %S (expected %S)",
-                            mrb_str_new_cstr(mrb, etype), mrb_str_new_cstr(mrb, type->name));
+                            mrb_str_new_cstr(mrb, etype)->wrap(), mrb_str_new_cstr(mrb, type->name)->wrap());
         }
         type++;
     }
@@ -471,7 +471,7 @@ static mrb_value mrb_to_integer(mrb_state *mrb, mrb_value val, const char *metho
     if (!v.is_kind_of(mrb, mrb->fixnum_class)) {
         mrb_value type = inspect_type(mrb, val)->wrap();
         mrb->mrb_raisef(E_TYPE_ERROR, "can't convert %S to Integer (%S#%S gives %S)",
-                        type, type, mrb_str_new_cstr(mrb, method), inspect_type(mrb, v)->wrap());
+                        type, type, mrb_str_new_cstr(mrb, method)->wrap(), inspect_type(mrb, v)->wrap());
     }
     return v;
 }
@@ -548,20 +548,20 @@ mrb_value mrb_Float(mrb_state *mrb, mrb_value val)
 
 RString *mrb_inspect(mrb_state *mrb, mrb_value obj)
 {
-    return mrb_obj_as_string(mrb, mrb->funcall(obj, "inspect", 0));
+    return mrb_obj_as_string(mrb, mrb->funcall(MRB_CALL_INSPECT, obj, 0, nullptr));
 }
 
 bool mrb_eql(mrb_state *mrb, mrb_value obj1, mrb_value obj2)
 {
     if (mrb_obj_eq(obj1, obj2))
         return true;
-    return mrb->funcall(obj1, "eql?", 1, obj2).to_bool();
+    return mrb->funcall(MRB_CALL_EQL, obj1, 1, &obj2).to_bool();
 }
 mrb_value mrb_value::check_type(mrb_state *mrb, mrb_vtype t, const char *c, const char *m) const {
 
     mrb_value tmp = mrb_check_convert_type(mrb, *this, t, c, m);
     if (tmp.is_nil()) {
-        mrb->mrb_raisef(E_TYPE_ERROR, "expected %S", mrb_str_new_cstr(mrb, c));
+        mrb->mrb_raisef(E_TYPE_ERROR, "expected %S", mrb_str_new_cstr(mrb, c)->wrap());
     }
     return tmp;
 }
@@ -590,15 +590,8 @@ void mrb_state::get_arg(const mrb_value &arg,mrb_int &tgt) {
             tgt = (mrb_int)f;
         }
             break;
-        case MRB_TT_FALSE:
-            tgt = 0;
-            break;
         default:
-        {
-            mrb_value tmp;
-            tmp = mrb_convert_type(this, arg, MRB_TT_FIXNUM, "Integer", "to_int");
-            tgt = mrb_fixnum(tmp);
-        }
+            tgt = mrb_fixnum(mrb_Integer(this, arg));
             break;
     }
 }
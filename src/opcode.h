@@ -140,11 +140,70 @@ enum eOpEnum {
     OP_STOP,/*              stop VM                                         */
     OP_ERR,/*       Bx      raise RuntimeError with message Lit(Bx)         */
 
-    OP_RSVD1,/*             reserved instruction #1                         */
+    OP_STRCATN,/*   A B     R(A) := str_new(R(A),R(A+1),..,R(A+B-1))        */
+    OP_CHKMETH,/*   A B C   R(A) := R(A).mSym(B) is core method C           */
+
+    /* superinstructions: the first instruction of a frequent pair, fused by
+       codegen so that it runs the following one without a dispatch. The
+       second instruction stays in place, so jumps into it still work. */
+    OP_EQ_JMPIF,/*  A B C   R(A) := R(A)==R(A+1); then OP_JMPIF A              */
+    OP_EQ_JMPNOT,/* A B C   R(A) := R(A)==R(A+1); then OP_JMPNOT A             */
+    OP_LT_JMPIF,/*  A B C   R(A) := R(A)<R(A+1); then OP_JMPIF A               */
+    OP_LT_JMPNOT,/* A B C   R(A) := R(A)<R(A+1); then OP_JMPNOT A              */
+    OP_LE_JMPIF,/*  A B C   R(A) := R(A)<=R(A+1); then OP_JMPIF A              */
+    OP_LE_JMPNOT,/* A B C   R(A) := R(A)<=R(A+1); then OP_JMPNOT A             */
+    OP_GT_JMPIF,/*  A B C   R(A) := R(A)>R(A+1); then OP_JMPIF A               */
+    OP_GT_JMPNOT,/* A B C   R(A) := R(A)>R(A+1); then OP_JMPNOT A              */
+    OP_GE_JMPIF,/*  A B C   R(A) := R(A)>=R(A+1); then OP_JMPIF A              */
+    OP_GE_JMPNOT,/* A B C   R(A) := R(A)>=R(A+1); then OP_JMPNOT A             */
+    OP_MOVE_SEND,/* A B     R(A) := R(B); then OP_SEND or OP_SENDB          */
+    OP_LOADI_SEND,/* A sBx  R(A) := sBx; then OP_SEND or OP_SENDB           */
+    OP_GETIV_RETURN,/* A Bx R(A) := ivget(Bx); then OP_RETURN               */
+
+    /* quickened forms: written over OP_ADD..OP_GE by the VM once it has seen
+       the operand types, never emitted by codegen nor dumped */
+    OP_ADD_FIXFIX,/* A B C  R(A) := R(A)+R(A+1), both Fixnum                */
+    OP_ADD_FLOFLO,/* A B C  R(A) := R(A)+R(A+1), both Float                 */
+    OP_ADDI_FIX,/*  A B C   R(A) := R(A)+C, Fixnum                          */
+    OP_ADDI_FLO,/*  A B C   R(A) := R(A)+C, Float                           */
+    OP_SUB_FIXFIX,/* A B C  R(A) := R(A)-R(A+1), both Fixnum                */
+    OP_SUB_FLOFLO,/* A B C  R(A) := R(A)-R(A+1), both Float                 */
+    OP_SUBI_FIX,/*  A B C   R(A) := R(A)-C, Fixnum                          */
+    OP_SUBI_FLO,/*  A B C   R(A) := R(A)-C, Float                           */
+    OP_MUL_FIXFIX,/* A B C  R(A) := R(A)*R(A+1), both Fixnum                */
+    OP_MUL_FLOFLO,/* A B C  R(A) := R(A)*R(A+1), both Float                 */
+    OP_DIV_FIXFIX,/* A B C  R(A) := R(A)/R(A+1), both Fixnum                */
+    OP_DIV_FLOFLO,/* A B C  R(A) := R(A)/R(A+1), both Float                 */
+    OP_EQ_FIXFIX,/* A B C   R(A) := R(A)==R(A+1), both Fixnum               */
+    OP_EQ_FLOFLO,/* A B C   R(A) := R(A)==R(A+1), both Float                */
+    OP_LT_FIXFIX,/* A B C   R(A) := R(A)<R(A+1), both Fixnum                */
+    OP_LT_FLOFLO,/* A B C   R(A) := R(A)<R(A+1), both Float                 */
+    OP_LE_FIXFIX,/* A B C   R(A) := R(A)<=R(A+1), both Fixnum               */
+    OP_LE_FLOFLO,/* A B C   R(A) := R(A)<=R(A+1), both Float                */
+    OP_GT_FIXFIX,/* A B C   R(A) := R(A)>R(A+1), both Fixnum                */
+    OP_GT_FLOFLO,/* A B C   R(A) := R(A)>R(A+1), both Float                 */
+    OP_GE_FIXFIX,/* A B C   R(A) := R(A)>=R(A+1), both Fixnum               */
+    OP_GE_FLOFLO,/* A B C   R(A) := R(A)>=R(A+1), both Float                */
+
+    /* megamorphic forms: what a quickened instruction becomes once it meets
+       operand types it was not specialised for. They run the generic code
+       but never quicken again, so a site that keeps seeing mixed types stops
+       rewriting itself. Never emitted by codegen nor dumped either. */
+    OP_ADD_MEGA,/*  A B C   R(A) := R(A)+R(A+1), as OP_ADD                 */
+    OP_ADDI_MEGA,/* A B C   R(A) := R(A)+C, as OP_ADDI                      */
+    OP_SUB_MEGA,/*  A B C   R(A) := R(A)-R(A+1), as OP_SUB                  */
+    OP_SUBI_MEGA,/* A B C   R(A) := R(A)-C, as OP_SUBI                      */
+    OP_MUL_MEGA,/*  A B C   R(A) := R(A)*R(A+1), as OP_MUL                  */
+    OP_DIV_MEGA,/*  A B C   R(A) := R(A)/R(A+1), as OP_DIV                  */
+    OP_EQ_MEGA,/*   A B C   R(A) := R(A)==R(A+1), as OP_EQ                  */
+    OP_LT_MEGA,/*   A B C   R(A) := R(A)<R(A+1), as OP_LT                   */
+    OP_LE_MEGA,/*   A B C   R(A) := R(A)<=R(A+1), as OP_LE                  */
+    OP_GT_MEGA,/*   A B C   R(A) := R(A)>R(A+1), as OP_GT                   */
+    OP_GE_MEGA,/*   A B C   R(A) := R(A)>=R(A+1), as OP_GE                  */
+
     OP_RSVD2,/*             reserved instruction #2                         */
     OP_RSVD3,/*             reserved instruction #3                         */
     OP_RSVD4,/*             reserved instruction #4                         */
-    OP_RSVD5,/*             reserved instruction #5                         */
     OP_LAST
 };
 enum eLambdaFlags{
@@ -155,6 +214,57 @@ OP_L_LAMBDA  =(OP_L_STRICT|OP_L_CAPTURE),
 OP_L_BLOCK   =OP_L_CAPTURE,
 };
 
+/* generic instruction a quickened or megamorphic one was rewritten from */
+static inline int
+mrb_generic_opcode(int op)
+{
+    static const unsigned char generic[] = {
+        OP_ADD, OP_ADD, OP_ADDI, OP_ADDI, OP_SUB, OP_SUB, OP_SUBI, OP_SUBI,
+        OP_MUL, OP_MUL, OP_DIV, OP_DIV, OP_EQ, OP_EQ, OP_LT, OP_LT,
+        OP_LE, OP_LE, OP_GT, OP_GT, OP_GE, OP_GE,
+        OP_ADD, OP_ADDI, OP_SUB, OP_SUBI, OP_MUL, OP_DIV,
+        OP_EQ, OP_LT, OP_LE, OP_GT, OP_GE,
+    };
+    static_assert(sizeof(generic) == OP_GE_MEGA - OP_ADD_FIXFIX + 1,
+                  "quickened opcode table out of sync");
+    static_assert(OP_LAST <= 0x80, "opcodes must fit in 7 bits");
+    if (op >= OP_ADD_FIXFIX && op <= OP_GE_MEGA)
+        return generic[op - OP_ADD_FIXFIX];
+    return op;
+}
+
+/* megamorphic form of a quickened instruction */
+static inline int
+mrb_megamorphic_opcode(int op)
+{
+    static const unsigned char mega[] = {
+        OP_ADD_MEGA, OP_ADD_MEGA, OP_ADDI_MEGA, OP_ADDI_MEGA,
+        OP_SUB_MEGA, OP_SUB_MEGA, OP_SUBI_MEGA, OP_SUBI_MEGA,
+        OP_MUL_MEGA, OP_MUL_MEGA, OP_DIV_MEGA, OP_DIV_MEGA,
+        OP_EQ_MEGA, OP_EQ_MEGA, OP_LT_MEGA, OP_LT_MEGA,
+        OP_LE_MEGA, OP_LE_MEGA, OP_GT_MEGA, OP_GT_MEGA, OP_GE_MEGA, OP_GE_MEGA,
+    };
+    static_assert(sizeof(mega) == OP_GE_FLOFLO - OP_ADD_FIXFIX + 1,
+                  "megamorphic opcode table out of sync");
+    return mega[op - OP_ADD_FIXFIX];
+}
+#define UNQUICKEN(i)  (((i) & ~(mrb_code)0x7f) | MKOPCODE(mrb_generic_opcode(GET_OPCODE(i))))
+
+/* first half of a superinstruction, run on its own */
+static inline int
+mrb_unfused_opcode(int op)
+{
+    static const unsigned char first[] = {
+        OP_EQ, OP_EQ, OP_LT, OP_LT, OP_LE, OP_LE, OP_GT, OP_GT, OP_GE, OP_GE,
+        OP_MOVE, OP_LOADI, OP_GETIV,
+    };
+    static_assert(sizeof(first) == OP_GETIV_RETURN - OP_EQ_JMPIF + 1,
+                  "superinstruction table out of sync");
+    if (op >= OP_EQ_JMPIF && op <= OP_GETIV_RETURN)
+        return first[op - OP_EQ_JMPIF];
+    return op;
+}
+
 #define OP_R_NORMAL 0
 #define OP_R_BREAK  1
 #define OP_R_RETURN 2
@@ -0,0 +1,731 @@
+/*
+** optimize.cpp - bytecode optimizer for compiled ireps
+**
+** Runs over the finished iseq of an irep (and its children) when a load
+** context asks for it, as `mrbc -O` does. The passes are:
+**
+**   - jump threading: jumps to an OP_JMP go straight to its target, and an
+**     OP_JMP to an OP_RETURN becomes a copy of the OP_RETURN
+**   - constant folding of Fixnum literal arithmetic and comparisons, and of
+**     conditional jumps on a register just loaded with a literal
+**   - removal of unreachable code and of jumps to the next instruction
+**   - dead store elimination of moves and literal loads into temporaries
+**   - renumbering of the temporaries so that nregs shrinks
+**
+** Folding follows the VM's Fixnum fast paths exactly, so an optimized irep
+** computes what the unoptimized one would have.
+**
+** See Copyright Notice in mruby.h
+*/
+
+#include <bitset>
+#include <vector>
+#include "mruby.h"
+#include "mruby/irep.h"
+#include "mruby/debug.h"
+#include "opcode.h"
+
+#define CALL_MAXARGS 127
+
+namespace {
+
+enum {
+    F_PINNED = 1,   /* part of OP_ENTER's jump table, must stay in place */
+    F_TARGET = 2,   /* some jump lands here */
+};
+
+typedef std::bitset<512> RegSet;   /* A and B are 9 bits wide */
+
+/* what an instruction does to registers */
+struct RegEffect {
+    int def;            /* register always written, or -1 */
+    int use_lo, use_hi; /* registers read, inclusive; empty if use_lo > use_hi */
+    int use2;           /* one more register read, or -1 */
+    int top;            /* R(A)..R(top) may be touched, explicitly or not */
+    bool reg_a, reg_b;  /* A and B name registers */
+};
+
+static bool
+is_jump(int op)
+{
+    return op == OP_JMP || op == OP_JMPIF || op == OP_JMPNOT || op == OP_ONERR;
+}
+
+static bool
+ends_block(int op)
+{
+    switch (op) {
+    case OP_JMP: case OP_RETURN: case OP_TAILCALL:
+    case OP_RAISE: case OP_STOP: case OP_ERR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* stores that can be dropped when nobody reads the register */
+static bool
+is_pure_store(int op)
+{
+    switch (op) {
+    case OP_MOVE: case OP_LOADL: case OP_LOADI: case OP_LOADSYM:
+    case OP_LOADNIL: case OP_LOADSELF: case OP_LOADT: case OP_LOADF:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool
+fits_sBx(long long v)
+{
+    return v >= -MAXARG_sBx && v <= MAXARG_sBx;
+}
+
+static mrb_code
+with_opcode(mrb_code i, int op)
+{
+    return (i & ~(mrb_code)0x7f) | MKOPCODE(op);
+}
+
+static mrb_code
+with_sBx(mrb_code i, int sbx)
+{
+    return (i & ~MKARG_Bx(MAXARG_Bx)) | MKARG_sBx(sbx);
+}
+
+/* number of argument registers a call at A passes, block slot excluded */
+static int
+call_args(mrb_code i)
+{
+    int n = GETARG_C(i);
+    return n == CALL_MAXARGS ? 1 : n;
+}
+
+/* Describes the opcodes codegen emits; returns false for anything else,
+   which keeps the register passes away from the irep. */
+static bool
+reg_effect(mrb_code i, RegEffect &e)
+{
+    int a = GETARG_A(i);
+    int b = GETARG_B(i);
+    int c = GETARG_C(i);
+
+    e.def = -1;
+    e.use_lo = 0; e.use_hi = -1;
+    e.use2 = -1;
+    e.top = -1;
+    e.reg_a = true;
+    e.reg_b = false;
+
+    switch (GET_OPCODE(i)) {
+    case OP_NOP: case OP_JMP: case OP_ONERR: case OP_POPERR:
+    case OP_EPUSH: case OP_EPOP: case OP_ERR: case OP_ENTER:
+    case OP_STOP:   /* reads R(nlocals), see remove_dead_stores */
+        e.reg_a = false;
+        return true;
+
+    case OP_MOVE:
+        e.def = a; e.use2 = b; e.reg_b = true; e.top = a;
+        return true;
+    case OP_LOADL: case OP_LOADI: case OP_LOADSYM: case OP_LOADNIL:
+    case OP_LOADSELF: case OP_LOADT: case OP_LOADF:
+    case OP_GETGLOBAL: case OP_GETSPECIAL: case OP_GETIV: case OP_GETCV:
+    case OP_GETCONST: case OP_GETUPVAR: case OP_RESCUE:
+    case OP_KARG: case OP_KDICT: case OP_BLKPUSH:
+    case OP_STRING: case OP_LAMBDA: case OP_OCLASS: case OP_TCLASS:
+        e.def = a; e.top = a;
+        return true;
+    case OP_ARGARY:
+        e.def = a; e.top = a + 1;
+        return true;
+    case OP_SETGLOBAL: case OP_SETSPECIAL: case OP_SETIV: case OP_SETCV:
+    case OP_SETCONST: case OP_SETUPVAR: case OP_JMPIF: case OP_JMPNOT:
+    case OP_RAISE: case OP_RETURN: case OP_DEBUG:
+        e.use_lo = e.use_hi = a; e.top = a;
+        return true;
+    case OP_GETMCNST: case OP_MODULE: case OP_EXEC: case OP_CHKMETH:
+        e.def = a; e.use_lo = e.use_hi = a; e.top = a;
+        return true;
+    case OP_SETMCNST: case OP_METHOD:
+        e.use_lo = a; e.use_hi = a + 1; e.top = a + 1;
+        return true;
+    case OP_CLASS:
+        e.def = a; e.use_lo = a; e.use_hi = a + 1; e.top = a + 1;
+        return true;
+
+    case OP_SEND: case OP_SENDB: case OP_SUPER: case OP_TAILCALL: {
+        /* the block slot follows the arguments; method_missing may pack
+           the arguments into A+1 and move the block to A+2 */
+        int n = call_args(i);
+        e.def = a; e.use_lo = a; e.use_hi = a + n + 1;
+        if (GET_OPCODE(i) == OP_SEND || GET_OPCODE(i) == OP_TAILCALL)
+            e.use_hi--;         /* the block slot is cleared, not read */
+        e.top = a + (n < 1 ? 1 : n) + 1;
+        return true;
+    }
+    case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV:
+    case OP_EQ: case OP_LT: case OP_LE: case OP_GT: case OP_GE:
+        /* falls back to a one-argument send */
+        e.def = a; e.use_lo = a; e.use_hi = a + 1; e.top = a + 2;
+        return true;
+    case OP_ADDI: case OP_SUBI:
+        e.def = a; e.use_lo = e.use_hi = a; e.top = a + 2;
+        return true;
+
+    case OP_ARRAY:
+        e.def = a; e.use_lo = b; e.use_hi = b + c - 1; e.reg_b = true; e.top = a;
+        return true;
+    case OP_HASH:
+        e.def = a; e.use_lo = b; e.use_hi = b + 2*c - 1; e.reg_b = true; e.top = a;
+        return true;
+    case OP_RANGE:
+        e.def = a; e.use_lo = b; e.use_hi = b + 1; e.reg_b = true; e.top = a;
+        return true;
+    case OP_AREF: case OP_SCLASS:
+        e.def = a; e.use2 = b; e.reg_b = true; e.top = a;
+        return true;
+    case OP_ASET: case OP_ARYCAT: case OP_ARYPUSH: case OP_STRCAT:
+        e.use_lo = e.use_hi = a; e.use2 = b; e.reg_b = true; e.top = a;
+        return true;
+    case OP_APOST:
+        /* B and C are counts; writes R(A)..R(A+C) */
+        e.use_lo = e.use_hi = a; e.top = a + c;
+        return true;
+    case OP_STRCATN:
+        /* B is a count */
+        e.def = a; e.use_lo = a; e.use_hi = a + b - 1;
+        e.top = b > 0 ? a + b - 1 : a;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+class IrepOptimizer {
+public:
+    IrepOptimizer(mrb_state *mrb, mrb_irep *irep) : m_mrb(mrb), m_irep(irep) {}
+    void run();
+
+private:
+    int target_of(size_t pc) const { return (int)pc + GETARG_sBx(m_code[pc]); }
+    void successors(size_t pc, std::vector<int> &out) const;
+    void mark_targets();
+    bool thread_jumps();
+    bool fold_constants();
+    bool fold_literal_op(size_t pc);
+    bool remove_dead_stores();
+    bool compact();
+    void renumber_registers();
+    void fuse();
+    void store();
+
+    mrb_state *m_mrb;
+    mrb_irep *m_irep;
+    std::vector<mrb_code> m_code;
+    std::vector<uint16_t> m_lines;
+    std::vector<uint32_t> m_origin;  /* original pc of each instruction */
+    std::vector<uint8_t> m_flags;
+    int m_floor = 0;                 /* first register the passes may touch */
+    bool m_known = true;             /* every opcode has a RegEffect */
+    bool m_has_rescue = false;
+};
+
+void
+IrepOptimizer::successors(size_t pc, std::vector<int> &out) const
+{
+    mrb_code i = m_code[pc];
+    int op = GET_OPCODE(i);
+
+    out.clear();
+    if (op == OP_ENTER) {
+        /* jump table of o OP_JMPs, indexed by the argument count */
+        int o = (GETARG_Ax(i) >> 13) & 0x1f;
+        for (int k = 1; k <= o + 1; k++)
+            out.push_back((int)pc + k);
+        return;
+    }
+    if (is_jump(op))
+        out.push_back(target_of(pc));
+    if (!ends_block(op))
+        out.push_back((int)pc + 1);
+}
+
+void
+IrepOptimizer::mark_targets()
+{
+    for (size_t pc = 0; pc < m_code.size(); pc++)
+        m_flags[pc] &= ~F_TARGET;
+    for (size_t pc = 0; pc < m_code.size(); pc++) {
+        mrb_code i = m_code[pc];
+
+        if (is_jump(GET_OPCODE(i))) {
+            m_flags[target_of(pc)] |= F_TARGET;
+        }
+        else if (GET_OPCODE(i) == OP_ENTER) {
+            int o = (GETARG_Ax(i) >> 13) & 0x1f;
+            for (int k = 1; k <= o + 1 && pc + k < m_code.size(); k++)
+                m_flags[pc + k] |= F_TARGET;
+        }
+    }
+}
+
+bool
+IrepOptimizer::thread_jumps()
+{
+    bool changed = false;
+
+    for (size_t pc = 0; pc < m_code.size(); pc++) {
+        mrb_code i = m_code[pc];
+        int op = GET_OPCODE(i);
+
+        if (op != OP_JMP && op != OP_JMPIF && op != OP_JMPNOT)
+            continue;
+        int t = target_of(pc);
+        for (int hops = 0; hops < 16; hops++) {
+            mrb_code j = m_code[t];
+            int next;
+
+            if (GET_OPCODE(j) == OP_JMP) {
+                next = target_of(t);
+            }
+            else if (op != OP_JMP && (GET_OPCODE(j) == OP_JMPIF || GET_OPCODE(j) == OP_JMPNOT)
+                     && GETARG_A(j) == GETARG_A(i)) {
+                /* the same register tested again: its outcome is known */
+                bool taken = (op == OP_JMPIF) == (GET_OPCODE(j) == OP_JMPIF);
+                next = taken ? target_of(t) : t + 1;
+            }
+            else {
+                break;
+            }
+            if (next == t || !fits_sBx(next - (int)pc))
+                break;
+            t = next;
+        }
+        if (t != target_of(pc)) {
+            m_code[pc] = with_sBx(i, t - (int)pc);
+            changed = true;
+        }
+        if (op == OP_JMP && !(m_flags[pc] & F_PINNED) && GET_OPCODE(m_code[t]) == OP_RETURN) {
+            m_code[pc] = m_code[t];
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+/* LOADI a,x; LOADI a+1,y; OP a  and  LOADI a,x; ADDI/SUBI a,y */
+bool
+IrepOptimizer::fold_literal_op(size_t pc)
+{
+    mrb_code i = m_code[pc];
+    mrb_code p = m_code[pc-1];
+    int op = GET_OPCODE(i);
+    int a = GETARG_A(i);
+
+    if (op == OP_ADDI || op == OP_SUBI) {
+        if (GET_OPCODE(p) != OP_LOADI || GETARG_A(p) != a)
+            return false;
+        long long x = GETARG_sBx(p);
+        long long r = op == OP_ADDI ? x + GETARG_C(i) : x - GETARG_C(i);
+        if (!fits_sBx(r))
+            return false;
+        m_code[pc-1] = MKOP_A(OP_NOP, 0);
+        m_code[pc] = MKOP_AsBx(OP_LOADI, a, (int)r);
+        return true;
+    }
+
+    if (pc < 2 || (m_flags[pc-1] & F_TARGET))
+        return false;
+    mrb_code pp = m_code[pc-2];
+    if (GET_OPCODE(p) != OP_LOADI || GETARG_A(p) != a + 1 ||
+        GET_OPCODE(pp) != OP_LOADI || GETARG_A(pp) != a)
+        return false;
+
+    long long x = GETARG_sBx(pp);
+    long long y = GETARG_sBx(p);
+    long long r;
+    mrb_code folded;
+
+    switch (op) {
+    case OP_ADD: r = x + y; goto arith;
+    case OP_SUB: r = x - y; goto arith;
+    case OP_MUL: r = x * y; goto arith;
+    case OP_DIV:
+        /* the VM turns division by zero into a Float */
+        if (y == 0)
+            return false;
+        r = x / y;
+    arith:
+        if (!fits_sBx(r))
+            return false;
+        folded = MKOP_AsBx(OP_LOADI, a, (int)r);
+        break;
+    case OP_EQ: folded = MKOP_A(x == y ? OP_LOADT : OP_LOADF, a); break;
+    case OP_LT: folded = MKOP_A(x <  y ? OP_LOADT : OP_LOADF, a); break;
+    case OP_LE: folded = MKOP_A(x <= y ? OP_LOADT : OP_LOADF, a); break;
+    case OP_GT: folded = MKOP_A(x >  y ? OP_LOADT : OP_LOADF, a); break;
+    case OP_GE: folded = MKOP_A(x >= y ? OP_LOADT : OP_LOADF, a); break;
+    default:
+        return false;
+    }
+    /* R(A+1) keeps the literal, as after the unfolded operation */
+    m_code[pc-2] = MKOP_A(OP_NOP, 0);
+    m_code[pc] = folded;
+    return true;
+}
+
+bool
+IrepOptimizer::fold_constants()
+{
+    bool changed = false;
+
+    for (size_t pc = 1; pc < m_code.size(); pc++) {
+        mrb_code i = m_code[pc];
+        int op = GET_OPCODE(i);
+
+        if (m_flags[pc] & F_TARGET)
+            continue;
+        if (op == OP_JMPIF || op == OP_JMPNOT) {
+            /* branch on a literal just loaded */
+            mrb_code p = m_code[pc-1];
+            bool truthy;
+
+            if (GETARG_A(p) != GETARG_A(i))
+                continue;
+            switch (GET_OPCODE(p)) {
+            case OP_LOADT: case OP_LOADI: case OP_LOADSYM: truthy = true; break;
+            case OP_LOADF: case OP_LOADNIL: truthy = false; break;
+            default: continue;
+            }
+            if ((op == OP_JMPIF) == truthy)
+                m_code[pc] = MKOP_sBx(OP_JMP, GETARG_sBx(i));
+            else
+                m_code[pc] = MKOP_A(OP_NOP, 0);
+            changed = true;
+        }
+        else if (fold_literal_op(pc)) {
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool
+IrepOptimizer::remove_dead_stores()
+{
+    size_t n = m_code.size();
+    std::vector<RegSet> live_in(n);
+    std::vector<RegEffect> eff(n);
+    std::vector<int> succ;
+    bool changed = true;
+
+    for (size_t pc = 0; pc < n; pc++)
+        reg_effect(m_code[pc], eff[pc]);
+
+    /* backward liveness until nothing changes */
+    while (changed) {
+        changed = false;
+        for (size_t pc = n; pc-- > 0;) {
+            const RegEffect &e = eff[pc];
+            RegSet live;
+
+            successors(pc, succ);
+            for (int s : succ) {
+                if (s < (int)n) live |= live_in[s];
+            }
+            if (e.def >= 0) live.reset(e.def);
+            for (int r = e.use_lo; r <= e.use_hi; r++) live.set(r);
+            if (e.use2 >= 0) live.set(e.use2);
+            if (GET_OPCODE(m_code[pc]) == OP_STOP)
+                live.set(m_irep->nlocals);  /* the value mrb_run returns */
+            if (live != live_in[pc]) {
+                live_in[pc] = live;
+                changed = true;
+            }
+        }
+    }
+
+    bool removed = false;
+    for (size_t pc = 0; pc < n; pc++) {
+        const RegEffect &e = eff[pc];
+        RegSet live_out;
+
+        if (!is_pure_store(GET_OPCODE(m_code[pc])) || e.def < m_floor)
+            continue;
+        successors(pc, succ);
+        for (int s : succ) {
+            if (s < (int)n) live_out |= live_in[s];
+        }
+        if (!live_out.test(e.def)) {
+            m_code[pc] = MKOP_A(OP_NOP, 0);
+            removed = true;
+        }
+    }
+    return removed;
+}
+
+/* Drops unreachable instructions, NOPs and jumps to the next instruction,
+   then fixes up jump offsets and the line table. */
+bool
+IrepOptimizer::compact()
+{
+    size_t n = m_code.size();
+    std::vector<bool> keep(n, false);
+    std::vector<int> work, succ;
+
+    /* reachability from the entry point and rescue handlers */
+    work.push_back(0);
+    keep[0] = true;
+    while (!work.empty()) {
+        int pc = work.back();
+        work.pop_back();
+        successors(pc, succ);
+        for (int s : succ) {
+            if (s < (int)n && !keep[s]) {
+                keep[s] = true;
+                work.push_back(s);
+            }
+        }
+    }
+    for (size_t pc = 0; pc < n; pc++) {
+        if (GET_OPCODE(m_code[pc]) == OP_NOP)
+            keep[pc] = false;
+        if (m_flags[pc] & F_PINNED)
+            keep[pc] = true;
+    }
+    for (size_t pc = 0; pc < n; pc++) {
+        int op = GET_OPCODE(m_code[pc]);
+
+        if (!keep[pc] || (m_flags[pc] & F_PINNED) ||
+            (op != OP_JMP && op != OP_JMPIF && op != OP_JMPNOT))
+            continue;
+        int t = target_of(pc);
+        if (t <= (int)pc)
+            continue;
+        bool skips = false;
+        for (int k = (int)pc + 1; k < t; k++) {
+            if (keep[k]) { skips = true; break; }
+        }
+        if (!skips)
+            keep[pc] = false;
+    }
+
+    /* a removed position maps to the next instruction that stays */
+    std::vector<int> newpc(n + 1);
+    int count = 0;
+    for (size_t pc = 0; pc < n; pc++) {
+        newpc[pc] = count;
+        if (keep[pc]) count++;
+    }
+    newpc[n] = count;
+    if (count == (int)n)
+        return false;
+
+    size_t to = 0;
+    for (size_t pc = 0; pc < n; pc++) {
+        if (!keep[pc])
+            continue;
+        mrb_code i = m_code[pc];
+        if (is_jump(GET_OPCODE(i)))
+            i = with_sBx(i, newpc[target_of(pc)] - newpc[pc]);
+        m_code[to] = i;
+        m_lines[to] = m_lines[pc];
+        m_origin[to] = m_origin[pc];
+        m_flags[to] = m_flags[pc];
+        to++;
+    }
+    m_code.resize(to);
+    m_lines.resize(to);
+    m_origin.resize(to);
+    m_flags.resize(to);
+    return true;
+}
+
+/* Packs the temporaries still in use above m_floor, keeping their order so
+   that argument ranges stay contiguous and above anything live across the
+   call. */
+void
+IrepOptimizer::renumber_registers()
+{
+    std::vector<bool> used(512, false);
+    RegEffect e;
+    int top = m_floor;
+
+    for (mrb_code i : m_code) {
+        reg_effect(i, e);
+        if (e.reg_a) used[GETARG_A(i)] = true;
+        if (e.reg_b) used[GETARG_B(i)] = true;
+        for (int r = e.use_lo; r <= e.use_hi; r++) used[r] = true;
+        if (e.reg_a) {
+            for (int r = GETARG_A(i); r <= e.top; r++) used[r] = true;
+        }
+    }
+
+    std::vector<int> map(512);
+    for (int r = 0; r < 512; r++) {
+        if (r < m_floor) {
+            map[r] = r;
+        }
+        else {
+            map[r] = top;
+            if (used[r]) top++;
+        }
+    }
+    for (mrb_code &i : m_code) {
+        reg_effect(i, e);
+        if (e.reg_a)
+            i = (i & ~MKARG_A(0x1ff)) | MKARG_A(map[GETARG_A(i)]);
+        if (e.reg_b)
+            i = (i & ~MKARG_B(0x1ff)) | MKARG_B(map[GETARG_B(i)]);
+    }
+    if (top < m_floor + 1)
+        top = m_floor + 1;
+    if (top < m_irep->nregs)
+        m_irep->nregs = top;
+}
+
+/* Same pairs as genop_peep in codegen.cpp. */
+void
+IrepOptimizer::fuse()
+{
+    for (size_t pc = 1; pc < m_code.size(); pc++) {
+        mrb_code i = m_code[pc];
+        mrb_code p = m_code[pc-1];
+        int op = GET_OPCODE(i);
+        int c0 = GET_OPCODE(p);
+
+        switch (op) {
+        case OP_JMPIF:
+        case OP_JMPNOT: {
+            int fused = 0;
+
+            if (GETARG_A(i) != GETARG_A(p))
+                break;
+            switch (c0) {
+            case OP_EQ: fused = OP_EQ_JMPIF; break;
+            case OP_LT: fused = OP_LT_JMPIF; break;
+            case OP_LE: fused = OP_LE_JMPIF; break;
+            case OP_GT: fused = OP_GT_JMPIF; break;
+            case OP_GE: fused = OP_GE_JMPIF; break;
+            default: break;
+            }
+            if (fused)
+                m_code[pc-1] = with_opcode(p, fused + (op == OP_JMPNOT));
+            break;
+        }
+        case OP_SEND:
+        case OP_SENDB:
+            if (c0 == OP_MOVE)
+                m_code[pc-1] = with_opcode(p, OP_MOVE_SEND);
+            else if (c0 == OP_LOADI)
+                m_code[pc-1] = with_opcode(p, OP_LOADI_SEND);
+            break;
+        case OP_RETURN:
+            if (c0 == OP_GETIV && GETARG_A(i) == GETARG_A(p) && GETARG_B(i) == OP_R_NORMAL)
+                m_code[pc-1] = with_opcode(p, OP_GETIV_RETURN);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void
+IrepOptimizer::store()
+{
+    mrb_irep *irep = m_irep;
+    size_t n = m_code.size();
+
+    for (size_t pc = 0; pc < n; pc++)
+        irep->iseq[pc] = m_code[pc];
+    if (irep->lines) {
+        for (size_t pc = 0; pc < n; pc++)
+            irep->lines[pc] = m_lines[pc];
+    }
+    if (irep->debug_info && n != irep->ilen) {
+        /* old position -> first surviving instruction at or after it */
+        std::vector<uint32_t> pcmap(irep->ilen + 1);
+        size_t k = 0;
+        for (size_t old = 0; old <= irep->ilen; old++) {
+            while (k < n && m_origin[k] < old) k++;
+            pcmap[old] = (uint32_t)k;
+        }
+        irep->ilen = n;
+        mrb_debug_info_remap(m_mrb, irep, pcmap.data());
+    }
+    irep->ilen = n;
+}
+
+void
+IrepOptimizer::run()
+{
+    mrb_irep *irep = m_irep;
+    size_t n = irep->ilen;
+
+    m_code.assign(irep->iseq, irep->iseq + n);
+    m_lines.assign(n, 0);
+    if (irep->lines)
+        m_lines.assign(irep->lines, irep->lines + n);
+    m_origin.resize(n);
+    m_flags.assign(n, 0);
+    m_floor = irep->nlocals;
+
+    for (size_t pc = 0; pc < n; pc++) {
+        mrb_code i = UNQUICKEN(m_code[pc]);
+        RegEffect e;
+
+        i = with_opcode(i, mrb_unfused_opcode(GET_OPCODE(i)));
+        m_code[pc] = i;
+        m_origin[pc] = (uint32_t)pc;
+        if (!reg_effect(i, e))
+            m_known = false;
+        if (GET_OPCODE(i) == OP_ONERR)
+            m_has_rescue = true;
+        if (GET_OPCODE(i) == OP_ENTER) {
+            mrb_aspec ax = GETARG_Ax(i);
+            int o = (ax>>13)&0x1f;
+            int len = ((ax>>18)&0x1f) + o + ((ax>>12)&0x1) + ((ax>>7)&0x1f);
+
+            /* the block lands in R(len+1) */
+            if (m_floor < len + 2)
+                m_floor = len + 2;
+            for (int k = 0; k <= o && pc + k < n; k++)
+                m_flags[pc + k] |= F_PINNED;
+        }
+    }
+
+    for (int round = 0; round < 8; round++) {
+        bool changed = thread_jumps();
+
+        mark_targets();
+        changed |= fold_constants();
+        /* an exception can leave from any instruction, which the liveness
+           analysis does not model */
+        if (m_known && !m_has_rescue)
+            changed |= remove_dead_stores();
+        changed |= compact();
+        if (!changed)
+            break;
+    }
+    if (m_known)
+        renumber_registers();
+    fuse();
+    store();
+}
+
+}
+
+void
+mrb_irep_optimize(mrb_state *mrb, mrb_irep *irep)
+{
+    if (irep->flags & MRB_ISEQ_NO_FREE)
+        return;
+    if (irep->ilen > 0) {
+        IrepOptimizer opt(mrb, irep);
+        opt.run();
+    }
+    for (size_t k = 0; k < irep->rlen; k++)
+        mrb_irep_optimize(mrb, irep->reps[k]);
+}
@@ -780,6 +780,14 @@ block:
         }
             break;
 
+        case NODE_METHOD_CHECK:
+        {
+            MethodCheckNode *mc = (MethodCheckNode *)orig;
+            printf("NODE_METHOD_CHECK: method='%s' core=%d\n", mrb_sym2name(mrb, mc->m_method), mc->m_which);
+            parser_dump(mrb, mc->m_recv, offset+1);
+        }
+            break;
+
         default:
             printf("node type: %d (0x%x)\n", (int)n, (int)n);
             break;
@@ -822,6 +830,7 @@ load_exec(mrb_state *mrb, mrb_parser_state *p, mrbc_context *c)
         return mrb_value::undef();
     }
     if (c) {
+        if (c->optimize) mrb_irep_optimize(mrb, proc->ireps());
         if (c->dump_result) mrb->codedump_all(proc);
         if (c->no_exec) return mrb_value::wrap(proc);
         if (c->target_class) {
@@ -40,6 +40,7 @@ static inline void closure_setup(RProc *p, int nlocals)
         e->mid   = ctx->m_ci->mid;
         e->cioff = ctx->m_ci - ctx->cibase;
         e->stack = ctx->m_stack;
+        e->escaped = false;
         ctx->m_ci->env = e;
     }
     p->env = ctx->m_ci->env;
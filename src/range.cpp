@@ -152,8 +152,8 @@ mrb_value mrb_range_eq(mrb_state *mrb, mrb_value range)
     }
     rr = mrb_range_ptr(range);
     ro = mrb_range_ptr(obj);
-    if (mrb_type(mrb->funcall(rr->edges->beg, "==", 1, ro->edges->beg))!=MRB_TT_TRUE ||
-            mrb_type(mrb->funcall(rr->edges->end, "==", 1, ro->edges->end))!=MRB_TT_TRUE ||
+    if (mrb_type(mrb->funcall(MRB_CALL_EQ, rr->edges->beg, 1, &ro->edges->beg))!=MRB_TT_TRUE ||
+            mrb_type(mrb->funcall(MRB_CALL_EQ, rr->edges->end, 1, &ro->edges->end))!=MRB_TT_TRUE ||
             rr->excl != ro->excl) {
         return mrb_value::_false();
     }
@@ -6,11 +6,14 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include "mruby.h"
 #include "mruby/irep.h"
 #include "mruby/variable.h"
 #include "mruby/debug.h"
 #include "mruby/string.h"
+#include "mruby/gc.h"
+#include "jit.h"
 
 void mrb_core_init(mrb_state*);
 void mrb_core_final(mrb_state*);
@@ -27,6 +30,19 @@ static void* allocf(mrb_state */*mrb*/, void *p, size_t size, void */*ud*/)
     }
 }
 
+/* mixes the state address (randomized by ASLR) with the clock */
+static uint64_t hash_seed_init(mrb_state *mrb)
+{
+    uint64_t seed = (uint64_t)(uintptr_t)mrb;
+
+    seed ^= (uint64_t)time(nullptr) << 32;
+    seed ^= (uint64_t)clock();
+    seed ^= seed >> 33;
+    seed *= 0xff51afd7ed558ccdull;
+    seed ^= seed >> 33;
+    return seed;
+}
+
 static mrb_value inspect_main(mrb_state *mrb, mrb_value mod)
 {
     return mrb_str_new_lit(mrb, "main")->wrap();
@@ -50,6 +66,7 @@ mrb_state* mrb_state::create(mrb_allocf f, void *ud)
     mrb->m_ctx = ( mrb_context*)mrb->gc()._calloc(1,sizeof(mrb_context));
     *mrb->m_ctx = mrb_context_zero;
     mrb->root_c = mrb->m_ctx;
+    mrb->hash_seed = hash_seed_init(mrb);
     mrb_core_init(mrb);
     return mrb;
 }
@@ -102,6 +119,10 @@ mrb_irep_decref(MemManager &mrb, mrb_irep *irep)
 }
 void mrb_irep_free(MemManager &mm, mrb_irep *irep)
 {
+#ifdef MRB_JIT
+    if (irep->jit)
+        mrb_jit_free(mm, irep);
+#endif
     if (!(irep->flags & MRB_ISEQ_NO_FREE))
         mm._free(irep->iseq);
     for (int i=0; i<irep->plen; i++) {
@@ -165,6 +186,74 @@ void mrb_free_context(mrb_state *mrb, struct mrb_context *ctx)
     mm._free(ctx);
 }
 
+/* finished fiber contexts are kept for reuse unless their stacks grew past these sizes */
+#define CTX_POOL_MAX        32
+#define CTX_POOL_STACK_MAX  1024
+#define CTX_POOL_CI_MAX     128
+
+mrb_context *mrb_context_new(mrb_state *mrb, size_t stack_size, size_t ci_size)
+{
+    static constexpr struct mrb_context mrb_context_zero = { 0 };
+    MemManager &mm(mrb->gc());
+    mrb_context *c = mrb->ctx_pool;
+
+    if (c) {
+        mrb_context keep = *c;
+
+        mrb->ctx_pool = c->prev;
+        mrb->ctx_pool_len--;
+        *c = mrb_context_zero;
+        c->m_stbase = keep.m_stbase;
+        c->stend = keep.stend;
+        c->cibase = keep.cibase;
+        c->ciend = keep.ciend;
+        c->rescue = keep.rescue;
+        c->m_rsize = keep.m_rsize;
+        c->m_ensure = keep.m_ensure;
+        c->m_esize = keep.m_esize;
+        if ((size_t)(c->stend - c->m_stbase) < stack_size) {
+            c->m_stbase = (mrb_value *)mm._realloc(c->m_stbase, stack_size * sizeof(mrb_value));
+            c->stend = c->m_stbase + stack_size;
+        }
+        if ((size_t)(c->ciend - c->cibase) < ci_size) {
+            c->cibase = (mrb_callinfo *)mm._realloc(c->cibase, ci_size * sizeof(mrb_callinfo));
+            c->ciend = c->cibase + ci_size;
+        }
+        /* the old contents may refer to objects collected since; nothing
+           above the high-water marks was written, so that part is as clean
+           as in a fresh context */
+        memset(c->m_stbase, 0, keep.stused * sizeof(mrb_value));
+        memset(c->cibase, 0, keep.ciused * sizeof(mrb_callinfo));
+    }
+    else {
+        c = (mrb_context *)mm._malloc(sizeof(mrb_context));
+        *c = mrb_context_zero;
+        c->m_stbase = (mrb_value *)mm._calloc(stack_size, sizeof(mrb_value));
+        c->stend = c->m_stbase + stack_size;
+        c->cibase = (mrb_callinfo *)mm._calloc(ci_size, sizeof(mrb_callinfo));
+        c->ciend = c->cibase + ci_size;
+    }
+    c->m_stack = c->m_stbase;
+    c->m_ci = c->cibase;
+    return c;
+}
+
+void mrb_context_release(mrb_state *mrb, struct mrb_context *ctx)
+{
+    if (!ctx)
+        return;
+    if (mrb->ctx_pool_len >= CTX_POOL_MAX || !ctx->m_stbase || !ctx->cibase ||
+            ctx->stend - ctx->m_stbase > CTX_POOL_STACK_MAX ||
+            ctx->ciend - ctx->cibase > CTX_POOL_CI_MAX) {
+        mrb_free_context(mrb, ctx);
+        return;
+    }
+    ctx->fib = nullptr;
+    ctx->prev = mrb->ctx_pool;
+    mrb->ctx_pool = ctx;
+    mrb->ctx_pool_len++;
+}
+
 void mrb_state::destroy()
 {
     MemManager &mm(gc());
@@ -174,6 +263,11 @@ void mrb_state::destroy()
     /* free */
     mrb_gc_free_gv(this);
     mrb_free_context(this,this->root_c);
+    while (ctx_pool) {
+        mrb_context *c = ctx_pool;
+        ctx_pool = c->prev;
+        mrb_free_context(this, c);
+    }
     mrb_symtbl_free(this);
     mm.mrb_heap_free();
     mm.mrb_alloca_free();
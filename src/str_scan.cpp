@@ -0,0 +1,357 @@
+/*
+** str_scan.cpp - byte scanning kernels used by String
+**
+** See Copyright Notice in mruby.h
+*/
+
+#include <cstdint>
+#include <string.h>
+#include "str_scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define MRB_SCAN_X86
+#include <immintrin.h>
+#endif
+
+/* isspace() in the "C" locale: ' ', '\t', '\n', '\v', '\f', '\r' */
+static inline bool scan_isspace(uint8_t c)
+{
+    return c == ' ' || (uint8_t)(c - '\t') <= ('\r' - '\t');
+}
+
+/* Quick Search; used for short haystacks and as the portable fallback */
+static mrb_int memsearch_qs(const uint8_t *xs, mrb_int m, const uint8_t *ys, mrb_int n)
+{
+    const uint8_t *x = xs, *xe = xs + m;
+    const uint8_t *y = ys;
+    int i, qstable[256];
+
+    /* Preprocessing */
+    for (i = 0; i < 256; ++i)
+        qstable[i] = m + 1;
+    for (; x < xe; ++x)
+        qstable[*x] = xe - x;
+    /* Searching */
+    for (; y + m <= ys + n; y += *(qstable + y[m])) {
+        if (*xs == *y && memcmp(xs, y, m) == 0)
+            return y - ys;
+    }
+    return -1;
+}
+
+static const char *scan_space_generic(const char *p, const char *e)
+{
+    while (p < e && !scan_isspace(*p)) p++;
+    return p;
+}
+
+static const char *skip_space_generic(const char *p, const char *e)
+{
+    while (p < e && scan_isspace(*p)) p++;
+    return p;
+}
+
+/*
+ * Case mapping flips bit 0x20 of every byte in [lo, lo+25]. Setting `fold`
+ * to 0x20 first folds 'A'..'Z' onto 'a'..'z', which is how swapcase matches
+ * both ranges with one compare.
+ */
+static bool case_flip_generic(char *p, size_t n, uint8_t lo, uint8_t fold)
+{
+    bool modified = false;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t c = p[i];
+        if ((uint8_t)((c | fold) - lo) <= 25) {
+            p[i] = c ^ 0x20;
+            modified = true;
+        }
+    }
+    return modified;
+}
+
+static inline bool needs_escape(uint8_t c)
+{
+    return (uint8_t)(c - 0x20) > 0x5e || c == '"' || c == '\\' || c == '#';
+}
+
+static const char *scan_escape_generic(const char *p, const char *e)
+{
+    while (p < e && !needs_escape(*p)) p++;
+    return p;
+}
+
+#ifdef MRB_SCAN_X86
+
+/*
+ * Substring search filters candidate positions by comparing the first and the
+ * last byte of the needle against a whole block of the haystack at once; only
+ * positions where both match are verified with memcmp.
+ */
+static mrb_int memsearch_sse2(const uint8_t *x, mrb_int m, const uint8_t *y, mrb_int n)
+{
+    const __m128i first = _mm_set1_epi8((char)x[0]);
+    const __m128i last = _mm_set1_epi8((char)x[m-1]);
+    mrb_int i = 0;
+
+    for (; i + m + 15 <= n; i += 16) {
+        __m128i bf = _mm_loadu_si128((const __m128i *)(y + i));
+        __m128i bl = _mm_loadu_si128((const __m128i *)(y + i + m - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, bf),
+                                                        _mm_cmpeq_epi8(last, bl)));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(y + i + bit + 1, x + 1, m - 2) == 0)
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    mrb_int pos = memsearch_qs(x, m, y + i, n - i);
+    return pos < 0 ? -1 : pos + i;
+}
+
+/* (c - '\t') <= 4 as an unsigned compare, or c == ' ' */
+static inline __m128i space_mask_sse2(__m128i v)
+{
+    __m128i t = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    __m128i ctl = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8('\r' - '\t')), t);
+    return _mm_or_si128(ctl, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+}
+
+static const char *scan_space_sse2(const char *p, const char *e)
+{
+    for (; e - p >= 16; p += 16) {
+        unsigned mask = _mm_movemask_epi8(space_mask_sse2(_mm_loadu_si128((const __m128i *)p)));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_space_generic(p, e);
+}
+
+static const char *skip_space_sse2(const char *p, const char *e)
+{
+    for (; e - p >= 16; p += 16) {
+        unsigned mask = ~_mm_movemask_epi8(space_mask_sse2(_mm_loadu_si128((const __m128i *)p))) & 0xffff;
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return skip_space_generic(p, e);
+}
+
+static bool case_flip_sse2(char *p, size_t n, uint8_t lo, uint8_t fold)
+{
+    const __m128i vlo = _mm_set1_epi8((char)lo), vfold = _mm_set1_epi8((char)fold);
+    const __m128i span = _mm_set1_epi8(25), bit = _mm_set1_epi8(0x20);
+    __m128i any = _mm_setzero_si128();
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i t = _mm_sub_epi8(_mm_or_si128(v, vfold), vlo);
+        __m128i m = _mm_cmpeq_epi8(_mm_min_epu8(t, span), t);
+        _mm_storeu_si128((__m128i *)(p + i), _mm_xor_si128(v, _mm_and_si128(m, bit)));
+        any = _mm_or_si128(any, m);
+    }
+    bool modified = _mm_movemask_epi8(any) != 0;
+    return case_flip_generic(p + i, n - i, lo, fold) || modified;
+}
+
+/* outside 0x20..0x7e, or one of '"', '\\', '#' */
+static inline __m128i escape_mask_sse2(__m128i v)
+{
+    __m128i t = _mm_sub_epi8(v, _mm_set1_epi8(0x20));
+    __m128i print = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(0x5e)), t);
+    __m128i special = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                   _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')),
+                                                _mm_cmpeq_epi8(v, _mm_set1_epi8('#'))));
+    return _mm_or_si128(_mm_andnot_si128(print, _mm_set1_epi8(-1)), special);
+}
+
+static const char *scan_escape_sse2(const char *p, const char *e)
+{
+    for (; e - p >= 16; p += 16) {
+        unsigned mask = _mm_movemask_epi8(escape_mask_sse2(_mm_loadu_si128((const __m128i *)p)));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_escape_generic(p, e);
+}
+
+__attribute__((target("avx2")))
+static mrb_int memsearch_avx2(const uint8_t *x, mrb_int m, const uint8_t *y, mrb_int n)
+{
+    const __m256i first = _mm256_set1_epi8((char)x[0]);
+    const __m256i last = _mm256_set1_epi8((char)x[m-1]);
+    mrb_int i = 0;
+
+    for (; i + m + 31 <= n; i += 32) {
+        __m256i bf = _mm256_loadu_si256((const __m256i *)(y + i));
+        __m256i bl = _mm256_loadu_si256((const __m256i *)(y + i + m - 1));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, bf),
+                                                              _mm256_cmpeq_epi8(last, bl)));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(y + i + bit + 1, x + 1, m - 2) == 0)
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    mrb_int pos = memsearch_sse2(x, m, y + i, n - i);
+    return pos < 0 ? -1 : pos + i;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i space_mask_avx2(__m256i v)
+{
+    __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    __m256i ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8('\r' - '\t')), t);
+    return _mm256_or_si256(ctl, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+}
+
+__attribute__((target("avx2")))
+static const char *scan_space_avx2(const char *p, const char *e)
+{
+    for (; e - p >= 32; p += 32) {
+        unsigned mask = _mm256_movemask_epi8(space_mask_avx2(_mm256_loadu_si256((const __m256i *)p)));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_space_sse2(p, e);
+}
+
+__attribute__((target("avx2")))
+static const char *skip_space_avx2(const char *p, const char *e)
+{
+    for (; e - p >= 32; p += 32) {
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(space_mask_avx2(_mm256_loadu_si256((const __m256i *)p)));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return skip_space_sse2(p, e);
+}
+
+__attribute__((target("avx2")))
+static bool case_flip_avx2(char *p, size_t n, uint8_t lo, uint8_t fold)
+{
+    const __m256i vlo = _mm256_set1_epi8((char)lo), vfold = _mm256_set1_epi8((char)fold);
+    const __m256i span = _mm256_set1_epi8(25), bit = _mm256_set1_epi8(0x20);
+    __m256i any = _mm256_setzero_si256();
+    size_t i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i t = _mm256_sub_epi8(_mm256_or_si256(v, vfold), vlo);
+        __m256i m = _mm256_cmpeq_epi8(_mm256_min_epu8(t, span), t);
+        _mm256_storeu_si256((__m256i *)(p + i), _mm256_xor_si256(v, _mm256_and_si256(m, bit)));
+        any = _mm256_or_si256(any, m);
+    }
+    bool modified = _mm256_movemask_epi8(any) != 0;
+    return case_flip_sse2(p + i, n - i, lo, fold) || modified;
+}
+
+__attribute__((target("avx2")))
+static const char *scan_escape_avx2(const char *p, const char *e)
+{
+    const __m256i lo = _mm256_set1_epi8(0x20), span = _mm256_set1_epi8(0x5e);
+    for (; e - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i t = _mm256_sub_epi8(v, lo);
+        __m256i print = _mm256_cmpeq_epi8(_mm256_min_epu8(t, span), t);
+        __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                                          _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')),
+                                                          _mm256_cmpeq_epi8(v, _mm256_set1_epi8('#'))));
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(print) | (unsigned)_mm256_movemask_epi8(special);
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return scan_escape_sse2(p, e);
+}
+
+#endif /* MRB_SCAN_X86 */
+
+namespace {
+struct ScanKernels {
+    mrb_int (*memsearch)(const uint8_t *, mrb_int, const uint8_t *, mrb_int);
+    const char *(*scan_space)(const char *, const char *);
+    const char *(*skip_space)(const char *, const char *);
+    bool (*case_flip)(char *, size_t, uint8_t, uint8_t);
+    const char *(*scan_escape)(const char *, const char *);
+
+    ScanKernels() {
+#ifdef MRB_SCAN_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            memsearch = memsearch_avx2;
+            scan_space = scan_space_avx2;
+            skip_space = skip_space_avx2;
+            case_flip = case_flip_avx2;
+            scan_escape = scan_escape_avx2;
+            return;
+        }
+        memsearch = memsearch_sse2;
+        scan_space = scan_space_sse2;
+        skip_space = skip_space_sse2;
+        case_flip = case_flip_sse2;
+        scan_escape = scan_escape_sse2;
+#else
+        memsearch = memsearch_qs;
+        scan_space = scan_space_generic;
+        skip_space = skip_space_generic;
+        case_flip = case_flip_generic;
+        scan_escape = scan_escape_generic;
+#endif
+    }
+};
+const ScanKernels &kernels()
+{
+    static const ScanKernels k;
+    return k;
+}
+} // end of anonymous namespace
+
+const char *mrb_memchr(const char *p, int c, size_t n)
+{
+    /* the C library's memchr is already vectorized and dispatched per CPU */
+    return (const char *)memchr(p, c, n);
+}
+
+mrb_int mrb_memsearch(const void *x0, mrb_int m, const void *y0, mrb_int n)
+{
+    const uint8_t *x = (const uint8_t *)x0, *y = (const uint8_t *)y0;
+
+    if (m > n) return -1;
+    else if (m == n) {
+        return memcmp(x0, y0, m) == 0 ? 0 : -1;
+    }
+    else if (m < 1) {
+        return 0;
+    }
+    else if (m == 1) {
+        const char *p = mrb_memchr((const char *)y0, *x, n);
+        return p ? p - (const char *)y0 : -1;
+    }
+    return kernels().memsearch(x, m, y, n);
+}
+
+const char *mrb_scan_space(const char *p, const char *e)
+{
+    return kernels().scan_space(p, e);
+}
+
+const char *mrb_skip_space(const char *p, const char *e)
+{
+    return kernels().skip_space(p, e);
+}
+
+bool mrb_ascii_upcase(char *p, size_t n)
+{
+    return kernels().case_flip(p, n, 'a', 0);
+}
+
+bool mrb_ascii_downcase(char *p, size_t n)
+{
+    return kernels().case_flip(p, n, 'A', 0);
+}
+
+bool mrb_ascii_swapcase(char *p, size_t n)
+{
+    return kernels().case_flip(p, n, 'a', 0x20);
+}
+
+const char *mrb_scan_escape(const char *p, const char *e)
+{
+    return kernels().scan_escape(p, e);
+}
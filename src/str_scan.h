@@ -0,0 +1,26 @@
+/*
+** str_scan.h - byte scanning kernels used by String
+**
+** See Copyright Notice in mruby.h
+*/
+
+#pragma once
+
+#include <cstddef>
+#include "mruby.h"
+
+/* returns pointer to the first byte equal to `c` in [p, p+n), or nullptr */
+const char *mrb_memchr(const char *p, int c, size_t n);
+/* returns offset of the first occurrence of x[0..m) in y[0..n), or -1 */
+mrb_int mrb_memsearch(const void *x, mrb_int m, const void *y, mrb_int n);
+/* returns pointer to the first ASCII whitespace in [p, e), or e */
+const char *mrb_scan_space(const char *p, const char *e);
+/* returns pointer to the first non-whitespace byte in [p, e), or e */
+const char *mrb_skip_space(const char *p, const char *e);
+/* ASCII case mapping in place; each returns true if any byte changed */
+bool mrb_ascii_upcase(char *p, size_t n);
+bool mrb_ascii_downcase(char *p, size_t n);
+bool mrb_ascii_swapcase(char *p, size_t n);
+/* returns pointer to the first byte in [p, e) that String#inspect or #dump
+   may have to escape (non-printable, '"', '\\' or '#'), or e */
+const char *mrb_scan_escape(const char *p, const char *e);
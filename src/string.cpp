@@ -16,6 +16,7 @@
 #include "mruby/range.h"
 #include "mruby/string.h"
 #include "re.h"
+#include "str_scan.h"
 
 const char mrb_digitmap[] = "0123456789abcdefghijklmnopqrstuvwxyz";
 
@@ -62,6 +63,7 @@ RString *RString::create(mrb_state *mrb, mrb_int capa) {
 
 void RString::str_modify()
 {
+    flags &= ~MRB_STR_HASHED;
     if (STR_SHARED_P(this)) {
         mrb_shared_string *shared = this->aux.shared;
 
@@ -305,23 +307,64 @@ mrb_str_body(mrb_value str, int *len_p)
  */
 void mrb_str_concat(mrb_state *mrb, mrb_value self, mrb_value other)
 {
-    RString *s1 = self.ptr<RString>(), *s2;
-    int len;
-
-    s1->str_modify();
     if (!other.is_string()) {
         other = mrb_str_to_str(mrb, other);
     }
-    s2 = other.ptr<RString>();
-    len = s1->len + s2->len;
+    /* str_buf_cat grows the capacity geometrically, so repeated appends are amortized O(1) */
+    self.ptr<RString>()->str_buf_cat(RSTRING_PTR(other), RSTRING_LEN(other));
+}
 
-    if (s1->aux.capa < len) {
-        s1->aux.capa = len;
-        s1->m_ptr = (char *)mrb->gc()._realloc(s1->m_ptr, len+1);
+/*
+ *  Builds a new string from <i>n</i> String values in one exact-size
+ *  allocation. Used by OP_STRCATN for string interpolation.
+ */
+RString *RString::new_from_values(mrb_state *mrb, int n, const mrb_value *vals)
+{
+    mrb_int total = 0;
+    for (int k = 0; k < n; ++k) {
+        mrb_int l = RSTRING_LEN(vals[k]);
+        if (total >= MRB_INT_MAX - l) {
+            mrb->mrb_raise(E_ARGUMENT_ERROR, "string sizes too big");
+        }
+        total += l;
+    }
+    RString *res = RString::create(mrb, nullptr, total);
+    char *p = res->m_ptr;
+    for (int k = 0; k < n; ++k) {
+        memcpy(p, RSTRING_PTR(vals[k]), RSTRING_LEN(vals[k]));
+        p += RSTRING_LEN(vals[k]);
     }
-    memcpy(s1->m_ptr+s1->len, s2->m_ptr, s2->len);
-    s1->len = len;
-    s1->m_ptr[len] = '\0';
+    return res;
+}
+
+/*
+ *  call-seq:
+ *     str << obj      => str
+ *     str.concat(obj) => str
+ *
+ *  Append---Concatenates the given object to <i>str</i>. If the object is a
+ *  <code>Fixnum</code> between 0 and 255, it is appended as a single byte.
+ *
+ *     a = "hello "
+ *     a << "world"   #=> "hello world"
+ *     a << 33        #=> "hello world!"
+ */
+static mrb_value
+mrb_str_concat_m(mrb_state *mrb, mrb_value self)
+{
+    mrb_value str = mrb->get_arg<mrb_value>();
+
+    if (str.is_fixnum()) {
+        mrb_int c = mrb_fixnum(str);
+        if (c < 0 || c > 0xff) {
+            mrb->mrb_raisef(E_RANGE_ERROR, "%S out of char range", str);
+        }
+        char b = (char)c;
+        self.ptr<RString>()->str_buf_cat(&b, 1);
+        return self;
+    }
+    mrb_str_concat(mrb, self, str);
+    return self;
 }
 
 /*
@@ -352,10 +395,10 @@ mrb_value mrb_str_plus(mrb_state *mrb, mrb_value a, mrb_value b)
 static mrb_value
 mrb_str_plus_m(mrb_state *mrb, mrb_value self)
 {
-    mrb_value str;
+    RString *str;
 
-    mrb_get_args(mrb, "S", &str);
-    return mrb_str_plus(mrb, self, str);
+    mrb->get_args(str);
+    return mrb_str_plus(mrb, self, str->wrap());
 }
 
 /*
@@ -402,7 +445,7 @@ static mrb_value mrb_str_times(mrb_state *mrb, mrb_value self)
     RString *str2;
     char *p;
 
-    mrb_get_args(mrb, "i", &times);
+    mrb->get_args(times);
     if (times < 0) {
         mrb->mrb_raise(E_ARGUMENT_ERROR, "negative argument");
     }
@@ -490,7 +533,7 @@ mrb_str_cmp_m(mrb_state *mrb, mrb_value str1)
     mrb_value str2;
     mrb_int result;
 
-    mrb_get_args(mrb, "o", &str2);
+    mrb->get_args(str2);
     if (!str2.is_string()) {
         if (!str2.respond_to(mrb, mrb_intern_lit(mrb, "to_s"))) {
             return mrb_value::nil();
@@ -608,47 +651,6 @@ static void regexp_check(mrb_state *mrb, mrb_value obj)
  */
 
 
-static inline mrb_int mrb_memsearch_qs(const uint8_t *xs, mrb_int m, const uint8_t *ys, mrb_int n)
-{
-    const uint8_t *x = xs, *xe = xs + m;
-    const uint8_t *y = ys;
-    int i, qstable[256];
-
-    /* Preprocessing */
-    for (i = 0; i < 256; ++i)
-        qstable[i] = m + 1;
-    for (; x < xe; ++x)
-        qstable[*x] = xe - x;
-    /* Searching */
-    for (; y + m <= ys + n; y += *(qstable + y[m])) {
-        if (*xs == *y && memcmp(xs, y, m) == 0)
-            return y - ys;
-    }
-    return -1;
-}
-
-static mrb_int mrb_memsearch(const void *x0, mrb_int m, const void *y0, mrb_int n)
-{
-    const uint8_t *x = (const uint8_t *)x0, *y = (const uint8_t *)y0;
-
-    if (m > n) return -1;
-    else if (m == n) {
-        return memcmp(x0, y0, m) == 0 ? 0 : -1;
-    }
-    else if (m < 1) {
-        return 0;
-    }
-    else if (m == 1) {
-        const uint8_t *ys = y, *ye = ys + n;
-        for (; y < ye; ++y) {
-            if (*x == *y)
-                return y - ys;
-        }
-        return -1;
-    }
-    return mrb_memsearch_qs((const uint8_t *)x0, m, (const uint8_t *)y0, n);
-}
-
 static mrb_int mrb_str_index(mrb_value str, mrb_value sub, mrb_int offset)
 {
     mrb_int pos;
@@ -683,6 +685,26 @@ static mrb_int mrb_str_index(mrb_value str, mrb_value sub, mrb_int offset)
 //    return s->dup()->wrap();
 //}
 
+/* every byte value followed by a NUL; backs the one-byte strings handed out by
+   str[index] and chars. They are NOFREE, so modifying one copies it first.
+   Filled at compile time, as it is shared by every mrb_state. */
+#define SB1(n)   {(char)(n), 0}
+#define SB4(n)   SB1(n), SB1((n)+1), SB1((n)+2), SB1((n)+3)
+#define SB16(n)  SB4(n), SB4((n)+4), SB4((n)+8), SB4((n)+12)
+#define SB64(n)  SB16(n), SB16((n)+16), SB16((n)+32), SB16((n)+48)
+static const char single_byte_table[256][2] = {
+    SB64(0), SB64(64), SB64(128), SB64(192)
+};
+#undef SB64
+#undef SB16
+#undef SB4
+#undef SB1
+
+static inline mrb_value str_single_byte(mrb_state *mrb, uint8_t c)
+{
+    return RString::create_static(mrb, single_byte_table[c], 1)->wrap();
+}
+
 static mrb_value mrb_str_aref(mrb_state *mrb, mrb_value str, mrb_value indx)
 {
     mrb_int idx;
@@ -694,9 +716,10 @@ static mrb_value mrb_str_aref(mrb_state *mrb, mrb_value str, mrb_value indx)
 
 num_index:
         {
-            RString *res = str.ptr<RString>()->substr(idx, 1);
-            if (!res || res->len == 0) return mrb_value::nil();
-            return res->wrap();
+            RString *s = str.ptr<RString>();
+            if (idx < 0) idx += s->len;
+            if (idx < 0 || idx >= s->len) return mrb_value::nil();
+            return str_single_byte(mrb, s->m_ptr[idx]);
         }
 
         case MRB_TT_STRING:
@@ -778,7 +801,7 @@ mrb_str_aref_m(mrb_state *mrb, mrb_value str)
     mrb_value a1, a2;
     int argc;
 
-    argc = mrb_get_args(mrb, "o|o", &a1, &a2);
+    argc = mrb->get_args<1>(a1, a2);
     if (argc == 2) {
         regexp_check(mrb, a1);
         RString *res= str.ptr<RString>()->substr(mrb_fixnum(a1), mrb_fixnum(a2));
@@ -805,27 +828,13 @@ mrb_str_aref_m(mrb_state *mrb, mrb_value str)
  */
 bool RString::capitalize_bang()
 {
-    char *p, *pend;
-    int modify = 0;
+    bool modify;
 
     this->str_modify();
     if (this->len == 0 || !this->m_ptr)
-        return nullptr;
-    p = this->m_ptr;
-    pend = this->m_ptr + this->len;
-    if (ISLOWER(*p)) {
-        *p = TOUPPER(*p);
-        modify = 1;
-    }
-    while (++p < pend) {
-        if (ISUPPER(*p)) {
-            *p = TOLOWER(*p);
-            modify = 1;
-        }
-    }
-    if (modify)
-        return this;
-    return nullptr;
+        return false;
+    modify = mrb_ascii_upcase(m_ptr, 1);
+    return mrb_ascii_downcase(m_ptr + 1, len - 1) || modify;
 }
 static mrb_value mrb_str_capitalize_bang(mrb_state *mrb, mrb_value str)
 {
@@ -925,11 +934,8 @@ smart_chomp:
 static mrb_value
 mrb_str_chomp_bang(mrb_state *mrb, mrb_value str)
 {
-    mrb_value rs;
     RString *sep=nullptr;
-    if(mrb_get_args(mrb, "|S", &rs) != 0) {
-        sep = rs.ptr<RString>();
-    }
+    mrb->get_args<0>(sep);
     return str.ptr<RString>()->chomp_bang(sep) ? str:mrb_value::nil();
 }
 
@@ -955,11 +961,8 @@ mrb_str_chomp_bang(mrb_state *mrb, mrb_value str)
 static mrb_value
 mrb_str_chomp(mrb_state *mrb, mrb_value self)
 {
-    mrb_value rs;
     RString *sep=nullptr;
-    if(mrb_get_args(mrb, "|S", &rs) != 0) {
-        sep = rs.ptr<RString>();
-    }
+    mrb->get_args<0>(sep);
     RString *res = self.ptr<RString>()->dup();
     res->chomp_bang(sep);
     return res->wrap();
@@ -1032,19 +1035,8 @@ static mrb_value mrb_str_chop(mrb_state *mrb, mrb_value self)
  */
 bool RString::downcase_bang()
 {
-    char *p, *pend;
-    bool modify = false;
     str_modify();
-    p = m_ptr;
-    pend = m_ptr + this->len;
-    while (p < pend) {
-        if (ISUPPER(*p)) {
-            *p = TOLOWER(*p);
-            modify = 1;
-        }
-        p++;
-    }
-    return modify;
+    return mrb_ascii_downcase(m_ptr, len);
 }
 
 static mrb_value mrb_str_downcase_bang(mrb_state *mrb, mrb_value str)
@@ -1154,19 +1146,93 @@ void RString::buf_append(mrb_value str2)
     this->str_cat(RSTRING_PTR(str2), RSTRING_LEN(str2));
 }
 
-mrb_int mrb_str_hash(mrb_state *mrb, RString *s)
+/*
+ * wyhash (final version 3), reduced to 32 bits. Reads the input eight bytes
+ * at a time; the per-state seed keeps hash values unpredictable across runs.
+ */
+static const uint64_t wyp0 = 0xa0761d6478bd642full, wyp1 = 0xe7037ed1a0b428dbull;
+static const uint64_t wyp2 = 0x8ebc6af09c88c6e3ull, wyp3 = 0x589965cc75374cc3ull;
+
+static inline void wymum(uint64_t *a, uint64_t *b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = *a;
+    r *= *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+static inline uint64_t wymix(uint64_t a, uint64_t b) { wymum(&a, &b); return a ^ b; }
+static inline uint64_t wyr8(const uint8_t *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint64_t wyr4(const uint8_t *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint64_t wyr3(const uint8_t *p, size_t k)
 {
-    /* 1-8-7 */
-    mrb_int len = s->len;
-    char *p = s->m_ptr;
-    mrb_int key = 0;
+    return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+}
 
-    while (len--) {
-        key = key*65599 + *p;
-        p++;
+uint32_t mrb_hash_bytes(mrb_state *mrb, const char *ptr, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)ptr;
+    uint64_t seed = mrb->hash_seed ^ wymix(mrb->hash_seed ^ wyp0, wyp1);
+    uint64_t a, b;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (len > 0) {
+            a = wyr3(p, len);
+            b = 0;
+        }
+        else {
+            a = b = 0;
+        }
     }
-    key = key + (key>>5);
-    return key;
+    else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wymix(wyr8(p) ^ wyp1, wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ wyp2, wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ wyp3, wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wymix(wyr8(p) ^ wyp1, wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+    a ^= wyp1;
+    b ^= seed;
+    wymum(&a, &b);
+    uint64_t h = wymix(a ^ wyp0 ^ len, b ^ wyp1);
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+/* the hash is cached in the string until its contents change (str_modify) */
+mrb_int mrb_str_hash(mrb_state *mrb, RString *s)
+{
+    if (!(s->flags & MRB_STR_HASHED)) {
+        s->m_hash = mrb_hash_bytes(mrb, s->m_ptr, s->len);
+        s->flags |= MRB_STR_HASHED;
+    }
+    return s->m_hash;
 }
 
 /* 15.2.10.5.20 */
@@ -1203,9 +1269,9 @@ mrb_str_include(mrb_state *mrb, mrb_value self)
     mrb_value str2;
     mrb_bool include_p;
 
-    mrb_get_args(mrb, "o", &str2);
+    mrb->get_args(str2);
     if (mrb_type(str2) == MRB_TT_FIXNUM) {
-        include_p = (memchr(RSTRING_PTR(self), mrb_fixnum(str2), RSTRING_LEN(self))) != nullptr;
+        include_p = mrb_memchr(RSTRING_PTR(self), mrb_fixnum(str2), RSTRING_LEN(self)) != nullptr;
     }
     else {
         str2 = mrb_str_to_str(mrb, str2);
@@ -1241,13 +1307,13 @@ mrb_str_include(mrb_state *mrb, mrb_value self)
 static mrb_value
 mrb_str_index_m(mrb_state *mrb, mrb_value str)
 {
-    mrb_value *argv;
-    int argc;
-
+    ArgRest rest;
     mrb_value sub;
     mrb_int pos;
 
-    mrb_get_args(mrb, "*", &argv, &argc);
+    mrb->get_args(rest);
+    mrb_value *argv = rest.ptr;
+    int argc = rest.len;
     if (argc == 2) {
         pos = mrb_fixnum(argv[1]);
         sub = argv[0];
@@ -1272,12 +1338,14 @@ mrb_str_index_m(mrb_state *mrb, mrb_value str)
         case MRB_TT_FIXNUM: {
             int c = mrb_fixnum(sub);
             mrb_int len = RSTRING_LEN(str);
-            uint8_t *p = (uint8_t*)RSTRING_PTR(str);
+            const char *p = RSTRING_PTR(str);
+            const char *found;
 
-            for (;pos<len;pos++) {
-                if (p[pos] == c) return mrb_fixnum_value(pos);
-            }
-            return mrb_value::nil();
+            if (pos >= len || (c & ~0xff))
+                return mrb_value::nil();
+            found = mrb_memchr(p + pos, c, len - pos);
+            if (!found) return mrb_value::nil();
+            return mrb_fixnum_value(found - p);
         }
 
         default: {
@@ -1304,6 +1372,7 @@ mrb_str_index_m(mrb_state *mrb, mrb_value str)
 static mrb_value
 str_replace(mrb_state *mrb, RString *s1, RString *s2)
 {
+    s1->flags &= ~MRB_STR_HASHED;
     if (STR_SHARED_P(s2)) {
 L_SHARE:
         if (STR_SHARED_P(s1)){
@@ -1351,10 +1420,10 @@ L_SHARE:
 static mrb_value
 mrb_str_replace(mrb_state *mrb, mrb_value str)
 {
-    mrb_value str2;
+    RString *str2;
 
-    mrb_get_args(mrb, "S", &str2);
-    return str_replace(mrb, str.ptr<RString>(), str2.ptr<RString>());
+    mrb->get_args(str2);
+    return str_replace(mrb, str.ptr<RString>(), str2);
 }
 
 /* 15.2.10.5.23 */
@@ -1367,10 +1436,10 @@ mrb_str_replace(mrb_state *mrb, mrb_value str)
 static mrb_value
 mrb_str_init(mrb_state *mrb, mrb_value self)
 {
-    mrb_value str2;
+    RString *str2;
 
-    if (mrb_get_args(mrb, "|S", &str2) == 1) {
-        str_replace(mrb, self.ptr<RString>(), str2.ptr<RString>());
+    if (mrb->get_args<0>(str2) == 1) {
+        str_replace(mrb, self.ptr<RString>(), str2);
     }
     return self;
 }
@@ -1578,13 +1647,14 @@ mrb_str_rindex(mrb_state *mrb, mrb_value str, mrb_value sub, mrb_int pos)
 static mrb_value
 mrb_str_rindex_m(mrb_state *mrb, mrb_value str)
 {
-    mrb_value *argv;
-    int argc;
+    ArgRest rest;
     mrb_value sub;
     mrb_value vpos;
     int pos, len = RSTRING_LEN(str);
 
-    mrb_get_args(mrb, "*", &argv, &argc);
+    mrb->get_args(rest);
+    mrb_value *argv = rest.ptr;
+    int argc = rest.len;
     if (argc == 2) {
         sub = argv[0];
         vpos = argv[1];
@@ -1640,8 +1710,6 @@ mrb_str_rindex_m(mrb_state *mrb, mrb_value str)
     return mrb_value::nil();
 }
 
-#define ascii_isspace(c) isspace(c)
-
 /* 15.2.10.5.35 */
 
 /*
@@ -1697,7 +1765,7 @@ mrb_str_split_m(mrb_state *mrb, mrb_value str)
     mrb_int end;
     mrb_int lim = 0;
     mrb_value tmp;
-    argc = mrb_get_args(mrb, "|oi", &spat, &lim);
+    argc = mrb->get_args<0>(spat, lim);
     lim_p = (lim > 0 && argc == 2);
     if (argc == 2) {
         if (lim == 1) {
@@ -1725,37 +1793,24 @@ mrb_str_split_m(mrb_state *mrb, mrb_value str)
 
     RArray *p_result = RArray::create(mrb);
     beg = 0;
+    /* the fields below share str's buffer; sharing it first keeps the pointers
+       taken from it valid (str_make_shared may shrink it with realloc) */
+    str_make_shared(mrb, str.ptr<RString>());
     if (split_type == split_awk) {
-        char *ptr = RSTRING_PTR(str);
-        char *eptr = RSTRING_END(str);
-        char *bptr = ptr;
-        int skip = 1;
-        unsigned int c;
+        const char *ptr = RSTRING_PTR(str);
+        const char *eptr = RSTRING_END(str);
+        const char *bptr = ptr;
+        int ai = mrb->gc().arena_save();
 
-        end = beg;
         while (ptr < eptr) {
-            int ai = mrb->gc().arena_save();
-            c = (uint8_t)*ptr++;
-            if (skip) {
-                if (ascii_isspace(c)) {
-                    beg = ptr - bptr;
-                }
-                else {
-                    end = ptr - bptr;
-                    skip = 0;
-                    if (lim_p && lim <= i) break;
-                }
-            }
-            else if (ascii_isspace(c)) {
-                p_result->push(mrb_str_subseq(mrb, str, beg, end-beg));
-                mrb->gc().arena_restore(ai);
-                skip = 1;
-                beg = ptr - bptr;
-                if (lim_p) ++i;
-            }
-            else {
-                end = ptr - bptr;
-            }
+            const char *tok = mrb_skip_space(ptr, eptr);
+            beg = tok - bptr;
+            if (tok == eptr || (lim_p && lim <= i)) break;
+            ptr = mrb_scan_space(tok, eptr);
+            if (ptr == eptr) break; /* last field is pushed below */
+            p_result->push(mrb_str_subseq(mrb, str, beg, ptr - tok));
+            mrb->gc().arena_restore(ai);
+            if (lim_p) ++i;
         }
     }
     else if (split_type == split_string) {
@@ -1922,7 +1977,7 @@ mrb_int mrb_cstr_to_inum(mrb_state *mrb, const char *str, int base, int badcheck
 
     n = strtoul((char*)str, &end, base);
     if (n > MRB_INT_MAX) {
-        mrb->mrb_raisef(E_ARGUMENT_ERROR, "string (%S) too big for integer", mrb_str_new_cstr(mrb, str));
+        mrb->mrb_raisef(E_ARGUMENT_ERROR, "string (%S) too big for integer", mrb_str_new_cstr(mrb, str)->wrap());
     }
     val = n;
     if (badcheck) {
@@ -1933,7 +1988,7 @@ mrb_int mrb_cstr_to_inum(mrb_state *mrb, const char *str, int base, int badcheck
 
     return sign ? val : -val;
 bad:
-    mrb->mrb_raisef(E_ARGUMENT_ERROR, "invalid string for number(%S)", mrb_str_new_cstr(mrb, str));
+    mrb->mrb_raisef(E_ARGUMENT_ERROR, "invalid string for number(%S)", mrb_str_new_cstr(mrb, str)->wrap());
     /* not reached */
     return 0;
 }
@@ -1991,15 +2046,14 @@ mrb_int RString::mrb_str_to_inum(int base, int badcheck)
 static mrb_value
 mrb_str_to_i(mrb_state *mrb, mrb_value self)
 {
-    mrb_value *argv;
-    int argc;
+    ArgRest rest;
     int base;
 
-    mrb_get_args(mrb, "*", &argv, &argc);
-    if (argc == 0)
+    mrb->get_args(rest);
+    if (rest.len == 0)
         base = 10;
     else
-        base = mrb_fixnum(argv[0]);
+        base = mrb_fixnum(rest.ptr[0]);
 
     if (base < 0) {
         mrb->mrb_raisef(E_ARGUMENT_ERROR, "illegal radix %S", mrb_fixnum_value(base));
@@ -2031,7 +2085,7 @@ mrb_cstr_to_dbl(mrb_state *mrb, const char * p, int badcheck)
     if (p == end) {
         if (badcheck) {
 bad:
-            mrb->mrb_raisef(E_ARGUMENT_ERROR, "invalid string for float(%S)", mrb_str_new_cstr(mrb, p));
+            mrb->mrb_raisef(E_ARGUMENT_ERROR, "invalid string for float(%S)", mrb_str_new_cstr(mrb, p)->wrap());
             /* not reached */
         }
         return d;
@@ -2142,20 +2196,8 @@ mrb_str_to_s(mrb_state *mrb, mrb_value self)
  */
 bool RString::upcase_bang()
 {
-    char *p, *pend;
-    bool modify = false;
-
     this->str_modify();
-    p = m_ptr;
-    pend = m_ptr+this->len;
-    while (p < pend) {
-        if (ISLOWER(*p)) {
-            *p = TOUPPER(*p);
-            modify = true;
-        }
-        p++;
-    }
-    return modify;
+    return mrb_ascii_upcase(m_ptr, len);
 }
 
 static mrb_value mrb_str_upcase_bang(mrb_state *mrb, mrb_value str)
@@ -2182,6 +2224,42 @@ static mrb_value mrb_str_upcase(mrb_state *mrb, mrb_value self)
     return str->wrap();
 }
 
+/*
+ *  call-seq:
+ *     str.swapcase!   => str or nil
+ *
+ *  Equivalent to <code>String#swapcase</code>, but modifies the receiver in
+ *  place, returning <i>str</i>, or <code>nil</code> if no changes were made.
+ */
+bool RString::swapcase_bang()
+{
+    this->str_modify();
+    return mrb_ascii_swapcase(m_ptr, len);
+}
+
+static mrb_value mrb_str_swapcase_bang(mrb_state *mrb, mrb_value str)
+{
+    RString *s = str.ptr<RString>();
+    return s->swapcase_bang() ? str : mrb_value::nil();
+}
+
+/*
+ *  call-seq:
+ *     str.swapcase   => new_str
+ *
+ *  Returns a copy of <i>str</i> with uppercase alphabetic characters converted
+ *  to lowercase and lowercase characters converted to uppercase.
+ *
+ *     "Hello".swapcase          #=> "hELLO"
+ *     "cYbEr_PuNk11".swapcase   #=> "CyBeR_pUnK11"
+ */
+static mrb_value mrb_str_swapcase(mrb_state *mrb, mrb_value self)
+{
+    auto str = self.ptr<RString>()->dup();
+    str->swapcase_bang();
+    return str->wrap();
+}
+
 /*
  *  call-seq:
  *     str.dump   -> new_str
@@ -2199,6 +2277,11 @@ RString *RString::mrb_str_dump()
     p = this->m_ptr;
     pend = p + this->len;
     while (p < pend) {
+        const char *run = mrb_scan_escape(p, pend);
+        len += run - p;
+        p = run;
+        if (p == pend)
+            break;
         uint8_t c = *p++;
         switch (c) {
             case '"': case '\\':
@@ -2230,6 +2313,12 @@ RString *RString::mrb_str_dump()
 
     *q++ = '"';
     while (p < pend) {
+        const char *run = mrb_scan_escape(p, pend);
+        memcpy(q, p, run - p);
+        q += run - p;
+        p = run;
+        if (p == pend)
+            break;
         uint8_t c = *p++;
 
         switch (c) {
@@ -2335,12 +2424,29 @@ mrb_value mrb_str_inspect(mrb_state *mrb, mrb_value str)
     const char *p, *pend;
     char buf[CHAR_ESC_LEN + 1];
     RString *self = str.ptr<RString>();
-    RString *result = RString::create(mrb, "\"", 1);
+    RString *result;
     p = self->m_ptr;
     pend = self->m_ptr+self->len;
+    const char *run = mrb_scan_escape(p, pend);
+    if (run == pend) {
+        /* nothing to escape: quote the contents with a single allocation */
+        result = RString::create(mrb, nullptr, self->len + 2);
+        result->m_ptr[0] = '"';
+        memcpy(result->m_ptr + 1, p, self->len);
+        result->m_ptr[self->len + 1] = '"';
+        return result->wrap();
+    }
+    result = RString::create(mrb, "\"", 1);
     for (;p < pend; p++) {
         uint8_t c, cc;
 
+        run = mrb_scan_escape(p, pend);
+        if (run != p) {
+            result->str_buf_cat(p, run - p);
+            p = run;
+            if (p == pend)
+                break;
+        }
         c = *p;
         if (c == '"'|| c == '\\' || (c == '#' && IS_EVSTR(p, pend))) {
             buf[0] = '\\'; buf[1] = c;
@@ -2403,6 +2509,49 @@ mrb_str_bytes(mrb_state *mrb, mrb_value str)
     return mrb_value::wrap(arr);
 }
 
+/*
+ * call-seq:
+ *   str.getbyte(index)   -> fixnum or nil
+ *
+ * Returns the byte at _index_ as a Fixnum, or nil if _index_ is out of range.
+ *
+ *    "hello".getbyte(1)    #=> 101
+ *    "hello".getbyte(-1)   #=> 111
+ */
+static mrb_value
+mrb_str_getbyte(mrb_state *mrb, mrb_value str)
+{
+    RString *s = str.ptr<RString>();
+    mrb_int pos;
+
+    mrb->get_args(pos);
+    if (pos < 0) pos += s->len;
+    if (pos < 0 || pos >= s->len) return mrb_value::nil();
+    return mrb_fixnum_value((uint8_t)s->m_ptr[pos]);
+}
+
+/*
+ *  call-seq:
+ *     str.chars    -> array of strings
+ *
+ *  Returns an array of the characters in <i>str</i>.
+ *
+ *     "hello".chars   #=> ["h", "e", "l", "l", "o"]
+ */
+static mrb_value
+mrb_str_chars(mrb_state *mrb, mrb_value str)
+{
+    RString *s = str.ptr<RString>();
+    RArray *arr = RArray::create(mrb, s->len);
+    int ai = mrb->gc().arena_save();
+
+    for (mrb_int i = 0; i < s->len; i++) {
+        arr->push(str_single_byte(mrb, s->m_ptr[i]));
+        mrb->gc().arena_restore(ai);
+    }
+    return mrb_value::wrap(arr);
+}
+
 /* ---------------------------*/
 void
 mrb_init_string(mrb_state *mrb)
@@ -2414,6 +2563,8 @@ mrb_init_string(mrb_state *mrb)
             .define_method("bytesize",        mrb_str_bytesize,        MRB_ARGS_NONE())
             .define_method("*",               mrb_str_times,           MRB_ARGS_REQ(1))              /* 15.2.10.5.1  */
             .define_method("+",               mrb_str_plus_m,          MRB_ARGS_REQ(1))              /* 15.2.10.5.2  */
+            .define_method("<<",              mrb_str_concat_m,        MRB_ARGS_REQ(1))
+            .define_method("concat",          mrb_str_concat_m,        MRB_ARGS_REQ(1))
             .define_method("<=>",             mrb_str_cmp_m,           MRB_ARGS_REQ(1))              /* 15.2.10.5.3  */
             .define_method("==",              mrb_str_equal_m,         MRB_ARGS_REQ(1))              /* 15.2.10.5.4  */
             .define_method("[]",              mrb_str_aref_m,          MRB_ARGS_ANY())               /* 15.2.10.5.6  */
@@ -2427,6 +2578,7 @@ mrb_init_string(mrb_state *mrb)
             .define_method("downcase!",       mrb_str_downcase_bang,   MRB_ARGS_NONE())              /* 15.2.10.5.14 */
             .define_method("empty?",          mrb_str_empty_p,         MRB_ARGS_NONE())              /* 15.2.10.5.16 */
             .define_method("eql?",            mrb_str_eql,             MRB_ARGS_REQ(1))              /* 15.2.10.5.17 */
+            .define_method("getbyte",         mrb_str_getbyte,         MRB_ARGS_REQ(1))
             .define_method("hash",            mrb_str_hash_m,          MRB_ARGS_REQ(1))              /* 15.2.10.5.20 */
             .define_method("include?",        mrb_str_include,         MRB_ARGS_REQ(1))              /* 15.2.10.5.21 */
             .define_method("index",           mrb_str_index_m,         MRB_ARGS_ANY())               /* 15.2.10.5.22 */
@@ -2448,8 +2600,11 @@ mrb_init_string(mrb_state *mrb)
             .define_method("to_sym",          mrb_str_intern,          MRB_ARGS_NONE())              /* 15.2.10.5.41 */
             .define_method("upcase",          mrb_str_upcase,          MRB_ARGS_REQ(1))              /* 15.2.10.5.42 */
             .define_method("upcase!",         mrb_str_upcase_bang,     MRB_ARGS_REQ(1))              /* 15.2.10.5.43 */
+            .define_method("swapcase",        mrb_str_swapcase,        MRB_ARGS_NONE())
+            .define_method("swapcase!",       mrb_str_swapcase_bang,   MRB_ARGS_NONE())
             .define_method("inspect",         mrb_str_inspect,         MRB_ARGS_NONE())              /* 15.2.10.5.46(x) */
             .define_method("bytes",           mrb_str_bytes,           MRB_ARGS_NONE())
+            .define_method("chars",           mrb_str_chars,           MRB_ARGS_NONE())
             ;
 }
 
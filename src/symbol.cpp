@@ -19,16 +19,9 @@ struct symbol_name {
 };
 
 struct SymHashFunc {
-    inline khint_t operator()(MemManager *, const symbol_name &s) const
+    inline khint_t operator()(MemManager *m, const symbol_name &s) const
     {
-        khint_t h = 0;
-        size_t i;
-        const char *p = s.name;
-
-        for (i=0; i<s.len; i++) {
-            h = (h << 5) - h + *p++;
-        }
-        return h;
+        return mrb_hash_bytes(m->vm(), s.name, s.len);
     }
 };
 struct SymHashEqual {
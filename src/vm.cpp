@@ -17,9 +17,11 @@
 #include "mruby/string.h"
 #include "mruby/variable.h"
 #include "mruby/error.h"
+#include "mruby/gc.h"
 #include "opcode.h"
 #include "value_array.h"
 #include "mrb_throw.h"
+#include "jit.h"
 // overflow check in addition/subtraction etc. are based on:
 // https://www.securecoding.cert.org/confluence/display/seccode/INT32-C.+Ensure+that+operations+on+signed+integers+do+not+result+in+overflow
 
@@ -27,7 +29,8 @@
 static constexpr int STACK_INIT_SIZE=128;
 static constexpr int CALLINFO_INIT_SIZE=32;
 
-/* Define amount of linear stack growth. */
+/* Define amount of linear stack growth (MRB_STACK_EXTEND_LINEAR), and the
+   least the stack grows by otherwise. */
 #ifndef MRB_STACK_GROWTH
 #define MRB_STACK_GROWTH 128
 #endif
@@ -109,13 +112,26 @@ void stack_extend_alloc(mrb_state *mrb, int room)
     int size = mrb->m_ctx->stend - mrb->m_ctx->m_stbase;
     int off = mrb->m_ctx->m_stack - mrb->m_ctx->m_stbase;
 
-    /* Use linear stack growth.
-     It is slightly slower than doubling the stack space,
-     but it saves memory on small devices. */
-    if (room <= size)
-        size += MRB_STACK_GROWTH;
-    else
-        size += room;
+#ifdef MRB_STACK_EXTEND_LINEAR
+    int grow = MRB_STACK_GROWTH;
+#else
+    /* Double the stack, so that each value is moved (and each frame rebased
+       by envadjust) a bounded number of times however deep the recursion. */
+    int grow = (size < MRB_STACK_GROWTH) ? MRB_STACK_GROWTH : size;
+#endif
+    if (grow < room)
+        grow = room;
+    if (size < MRB_STACK_MAX && size + grow > MRB_STACK_MAX) {
+        /* stop at the limit first, so doubling does not lower it */
+        grow = MRB_STACK_MAX - size;
+        if (grow < room)
+            grow = room;
+    }
+    else if (size >= MRB_STACK_MAX) {
+        /* only room for raising the error below */
+        grow = (room > MRB_STACK_GROWTH) ? room : MRB_STACK_GROWTH;
+    }
+    size += grow;
 
     mrb->m_ctx->m_stbase = (mrb_value *)mrb->gc()._realloc(mrb->m_ctx->m_stbase, sizeof(mrb_value) * size);
     mrb->m_ctx->m_stack = mrb->m_ctx->m_stbase + off;
@@ -130,9 +146,14 @@ void stack_extend_alloc(mrb_state *mrb, int room)
 static
 inline void stack_extend(mrb_state *mrb, int room, int keep)
 {
-    if (mrb->m_ctx->m_stack + room >= mrb->m_ctx->stend) {
+    mrb_context *c = mrb->m_ctx;
+
+    if (c->m_stack + room >= c->stend) {
         stack_extend_alloc(mrb, room);
     }
+    int used = (c->m_stack - c->m_stbase) + room;
+    if (used > c->stused)
+        c->stused = used;
 
     if (room > keep) {
         /* do not leave uninitialized malloc region */
@@ -191,6 +212,8 @@ mrb_callinfo* cipush(mrb_state *mrb)
         c->ciend = c->cibase + size * 2;
     }
     ci = ++c->m_ci;
+    if (ci - c->cibase >= c->ciused)
+        c->ciused = ci - c->cibase + 1;
     ci->nregs = 2;   /* protect method_missing arg and block */
     ci->eidx = eidx;
     ci->ridx = ridx;
@@ -199,21 +222,69 @@ mrb_callinfo* cipush(mrb_state *mrb)
     ci->err = 0;
     return ci;
 }
+/* gives a closure environment its own copy of the frame's registers, if one
+   of its closures escaped; otherwise nothing can use them after the frame */
+static void ci_detach_env(mrb_state *mrb, mrb_callinfo *ci)
+{
+    REnv *e = ci->env;
+
+    if (!e)
+        return;
+    e->cioff = -1;
+    if (!e->escaped) {
+        e->stack = nullptr;
+        e->flags = 0;
+        return;
+    }
+    size_t len = (size_t)e->flags;
+    mrb_value *p = (mrb_value *)mrb->gc()._malloc(sizeof(mrb_value)*len);
+
+    stack_copy(p, e->stack, len);
+    /* blocks held in the registers are now reachable through e */
+    for (size_t k = 0; k < len; k++) {
+        if (p[k].tt == MRB_TT_PROC)
+            p[k].ptr<RProc>()->escape();
+    }
+    e->stack = p;
+}
 void cipop(mrb_state *mrb)
 {
     mrb_context *c = mrb->m_ctx;
-    if (c->m_ci->env) {
-        REnv *e = c->m_ci->env;
-        size_t len = (size_t)e->flags;
-        mrb_value *p = (mrb_value *)mrb->gc()._malloc(sizeof(mrb_value)*len);
-
-        e->cioff = -1;
-        stack_copy(p, e->stack, len);
-        e->stack = p;
-    }
 
+    ci_detach_env(mrb, c->m_ci);
     c->m_ci--;
 }
+/*
+ * Frames entered from C (acc < 0) form a chain through cbound_prev, so a
+ * fiber can tell whether it would cross a C frame without walking the
+ * stack. Frames are popped without touching the chain; stale links are
+ * dropped when the next boundary is pushed or when the chain is queried.
+ */
+static void ci_set_acc(mrb_context *c, mrb_callinfo *ci, int acc)
+{
+    int idx = (int)(ci - c->cibase) + 1;
+
+    while (c->cbound >= idx) {
+        c->cbound = c->cibase[c->cbound - 1].cbound_prev;
+    }
+    ci->acc = acc;
+    ci->cbound_prev = c->cbound;
+    c->cbound = idx;
+}
+/* the fiber running on c has finished; its context goes back to the pool */
+static void fiber_terminate(mrb_state *mrb, mrb_context *c)
+{
+    for (mrb_callinfo *ci = c->m_ci; ci >= c->cibase; ci--) {
+        ci_detach_env(mrb, ci);
+    }
+    c->status = MRB_FIBER_TERMINATED;
+    c->prev = nullptr;
+    if (c->fib) {
+        c->fib->cxt = nullptr;
+        c->fib->terminated = true;
+    }
+    mrb_context_release(mrb, c);
+}
 void ecall(mrb_state *mrb, int i)
 {
     mrb_value *self = mrb->m_ctx->m_stack;
@@ -226,7 +297,7 @@ void ecall(mrb_state *mrb, int i)
     mrb_callinfo *ci = cipush(mrb);
     ci->stackent = mrb->m_ctx->m_stack;
     ci->mid = ci[-1].mid;
-    ci->acc = CI_ACC_SKIP;
+    ci_set_acc(mrb->m_ctx, ci, CI_ACC_SKIP);
     ci->argc = 0;
     ci->proc = p;
     ci->nregs = p->ireps()->nregs;
@@ -253,6 +324,19 @@ void call_stack_sizing(mrb_state *mrb,const mrb_callinfo *_ci,const mrb_irep *ir
 }
 
 
+bool mrb_context_crosses_c(mrb_context *c)
+{
+    int top = (int)(c->m_ci - c->cibase) + 1;
+
+    while (c->cbound > 0) {
+        mrb_callinfo *ci = c->cibase + c->cbound - 1;
+        if (c->cbound <= top && ci->acc < 0)
+            return true;
+        c->cbound = ci->cbound_prev;
+    }
+    return false;
+}
+
 
 #ifndef MRB_FUNCALL_ARGC_MAX
 #define MRB_FUNCALL_ARGC_MAX 16
@@ -278,6 +362,65 @@ mrb_value mrb_state::funcall(mrb_value self, const char *name, int argc, ...)
     return mrb_funcall_argv(this, self, mid, argc, argv);
 }
 
+/* call p, found as mid for self in c (nullptr for none), under the caller's
+   jump buffer */
+static mrb_value
+funcall_found(mrb_state *mrb, mrb_value self, mrb_sym mid, RClass *c, RProc *p, int argc, const mrb_value *argv, mrb_value blk)
+{
+    mrb_value val;
+    mrb_sym undef = 0;
+    int n = mrb->m_ctx->m_ci->nregs;
+
+    if (!p) {
+        undef = mid;
+        mid = mrb_intern(mrb, "method_missing", 14);
+        assert(c);
+        p = RClass::method_search_vm(&c, mid);
+        assert(p);
+        n++;
+        argc++;
+    }
+    mrb_callinfo *ci = cipush(mrb);
+    ci->mid = mid;
+    ci->proc = p;
+    ci->stackent = mrb->m_ctx->m_stack;
+    ci->argc = argc;
+    ci->target_class = c;
+    if (p->is_cfunc()) {
+        ci->nregs = argc + 2;
+    }
+    else {
+        ci->nregs = p->ireps()->nregs + n;
+    }
+    mrb->m_ctx->m_stack = mrb->m_ctx->m_stack + n;
+
+    stack_extend(mrb, ci->nregs, 0);
+    mrb->m_ctx->m_stack[0] = self;
+    if (undef) {
+        mrb->m_ctx->m_stack[1] = mrb_symbol_value(undef);
+        stack_copy(mrb->m_ctx->m_stack+2, argv, argc-1);
+    }
+    else if (argc > 0) {
+        stack_copy(mrb->m_ctx->m_stack+1, argv, argc);
+    }
+    mrb->m_ctx->m_stack[argc+1] = blk;
+
+    if (p->is_cfunc()) {
+        int ai = mrb->gc().arena_save();
+
+        ci_set_acc(mrb->m_ctx, ci, CI_ACC_DIRECT);
+        val = p->call_cfunc(self);
+        mrb->m_ctx->m_stack = mrb->m_ctx->m_ci->stackent;
+        cipop(mrb);
+        mrb->gc().arena_restore(ai);
+    }
+    else {
+        ci_set_acc(mrb->m_ctx, ci, CI_ACC_SKIP);
+        val = mrb->mrb_run(p, self);
+    }
+    return val;
+}
+
 mrb_value mrb_funcall_with_block(mrb_state *mrb, mrb_value self, mrb_sym mid, int argc, const mrb_value *argv, mrb_value blk)
 {
     mrb_value val;
@@ -298,73 +441,53 @@ mrb_value mrb_funcall_with_block(mrb_state *mrb, mrb_value self, mrb_sym mid, in
             }
             mrb->jmp = nullptr;
             val = mrb_value::nil();
+            if (!mrb->m_exc && mrb->m_break.pending) {
+                /* break from a block out of the C function we called */
+                val = mrb->m_break.val;
+                mrb->m_break.pending = false;
+            }
         }
         MRB_END_EXC(&c_jmp);
     }
     else {
-        mrb_sym undef = 0;
-
         if (!mrb->m_ctx->m_stack) {
             stack_init(mrb);
         }
-        int n = mrb->m_ctx->m_ci->nregs;
         if (argc < 0) {
             mrb->mrb_raisef(E_ARGUMENT_ERROR, "negative argc for funcall (%S)", mrb_fixnum_value(argc));
         }
         RClass *c = RClass::mrb_class(mrb, self);
         RProc *p = RClass::method_search_vm(&c, mid);
-        if (!p) {
-            undef = mid;
-            mid = mrb_intern(mrb, "method_missing", 14);
-            assert(c);
-            p = RClass::method_search_vm(&c, mid);
-            assert(p);
-            n++;
-            argc++;
-        }
-        mrb_callinfo *ci = cipush(mrb);
-        ci->mid = mid;
-        ci->proc = p;
-        ci->stackent = mrb->m_ctx->m_stack;
-        ci->argc = argc;
-        ci->target_class = c;
-        if (p->is_cfunc()) {
-            ci->nregs = argc + 2;
-        }
-        else {
-            ci->nregs = p->ireps()->nregs + n;
-        }
-        mrb->m_ctx->m_stack = mrb->m_ctx->m_stack + n;
-
-        stack_extend(mrb, ci->nregs, 0);
-        mrb->m_ctx->m_stack[0] = self;
-        if (undef) {
-            mrb->m_ctx->m_stack[1] = mrb_symbol_value(undef);
-            stack_copy(mrb->m_ctx->m_stack+2, argv, argc-1);
-        }
-        else if (argc > 0) {
-            stack_copy(mrb->m_ctx->m_stack+1, argv, argc);
-        }
-        mrb->m_ctx->m_stack[argc+1] = blk;
-
-        if (p->is_cfunc()) {
-            int ai = mrb->gc().arena_save();
-
-            ci->acc = CI_ACC_DIRECT;
-            val = p->call_cfunc(self);
-            mrb->m_ctx->m_stack = mrb->m_ctx->m_ci->stackent;
-            cipop(mrb);
-            mrb->gc().arena_restore(ai);
-        }
-        else {
-            ci->acc = CI_ACC_SKIP;
-            val = mrb->mrb_run(p, self);
-        }
+        val = funcall_found(mrb, self, mid, c, p, argc, argv, blk);
     }
     mrb_gc_protect(mrb, val);
     return val;
 }
 
+/* Like mrb_funcall_argv, but the method lookup is cached in cs, and when
+   called from running code (a cfunc, say) no jump buffer of its own is set
+   up: an exception unwinds straight to the caller's. */
+mrb_value mrb_state::funcall(CallSite &cs, mrb_value self, int argc, const mrb_value *argv)
+{
+    if (!jmp || !m_ctx->m_stack)
+        return mrb_funcall_with_block(this, self, cs.mid, argc, argv, mrb_value::nil());
+
+    RClass *c = RClass::mrb_class(this, self);
+    if (cs.klass != c || cs.serial != method_serial) {
+        RClass *owner = c;
+        RProc *p = RClass::method_search_vm(&owner, cs.mid);
+        if (!p)
+            return mrb_funcall_with_block(this, self, cs.mid, argc, argv, mrb_value::nil());
+        cs.klass = c;
+        cs.owner = owner;
+        cs.proc = p;
+        cs.serial = method_serial;
+    }
+    mrb_value val = funcall_found(this, self, cs.mid, cs.owner, cs.proc, argc, argv, mrb_value::nil());
+    mrb_gc_protect(this, val);
+    return val;
+}
+
 mrb_value mrb_funcall_argv(mrb_state *mrb, mrb_value self, mrb_sym mid, int argc, mrb_value *argv)
 {
     return mrb_funcall_with_block(mrb, self, mid, argc, argv, mrb_value::nil());
@@ -452,7 +575,7 @@ mrb_value mrb_yield_internal(mrb_state *mrb, mrb_value b, int argc, mrb_value *a
     else {
         ci->nregs = p->ireps()->nregs + 1;
     }
-    ci->acc = CI_ACC_SKIP;
+    ci_set_acc(mrb->m_ctx, ci, CI_ACC_SKIP);
     mrb->m_ctx->m_stack += n;
 
     stack_extend(mrb, ci->nregs, 0);
@@ -554,6 +677,89 @@ static void argnum_error(mrb_state *mrb, int num)
 
 #endif
 
+#ifdef MRB_JIT
+/* Called after a backward jump: runs the loop in native code if the irep
+   has been compiled, counting it towards compilation otherwise. Native code
+   returns the instruction it stopped at, which is dispatched next. */
+#ifdef ENABLE_DEBUG
+#define JIT_HOOKED(mrb) ((mrb)->code_fetch_hook != nullptr)
+#else
+#define JIT_HOOKED(mrb) false
+#endif
+#define JIT_BACKEDGE() do {\
+    if (irep->jit) {\
+        mrb_jit_func native = irep->jit->func_at(pc);\
+        if (native && !JIT_HOOKED(this)) {\
+            irep->jit->enters++;\
+            pc = native(regs);\
+        }\
+    }\
+    else if (++irep->jit_count == MRB_JIT_THRESHOLD) {\
+        mrb_jit_compile(this, irep);\
+    }\
+    } while (0)
+#else
+#define JIT_BACKEDGE() do {} while (0)
+#endif
+
+/* The generic arithmetic and comparison instructions rewrite themselves into
+   the variant specialised for the operand types they have just seen, so
+   numeric loops skip the type dispatch. A specialised instruction meeting
+   other types becomes the megamorphic form of the generic one
+   (L_UNQUICKEN), which runs the same code but is never quickened again.
+   iseq belongs to its irep alone; only the static Proc#call trampoline has
+   to be left as is. */
+#define QUICKEN(op) do {\
+    if (GET_OPCODE(i) < OP_ADD_FIXFIX && !(irep->flags & MRB_ISEQ_NO_FREE))\
+        *pc = (i & ~(mrb_code)0x7f) | MKOPCODE(op);\
+    } while (0)
+#if defined __GNUC__ || defined __clang__
+#define UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define UNLIKELY(x) (x)
+#endif
+
+/* Fixnum arithmetic shared by the generic and the quickened instructions;
+   results that do not fit in a Fixnum become Floats. */
+static inline void
+fixnum_add(mrb_value &r, mrb_int x, mrb_int y)
+{
+    if (((x^y) | (((x^(~(x^y) & std::numeric_limits<mrb_int>::min())) + y)^y)) >= 0)
+        r = mrb_float_value((mrb_float)x + (mrb_float)y);
+    else
+        r.value.i = x + y;
+}
+
+static inline void
+fixnum_sub(mrb_value &r, mrb_int x, mrb_int y)
+{
+    if (((x^y) & (((x ^ ((x^y) & (1 << (sizeof(mrb_int)*8-1))))-y)^y)) < 0)
+        r = mrb_float_value((mrb_float)x - (mrb_float)y); /* integer overflow */
+    else
+        r = mrb_fixnum_value(x - y);
+}
+
+static inline void
+fixnum_mul(mrb_value &r, mrb_int x, mrb_int y)
+{
+    static_assert(sizeof(long long) >= 2 * sizeof(mrb_int),
+                  "Unable to detect overflow after multiplication");
+    long long z = x * y;
+    if ((z > std::numeric_limits<mrb_int>::max()) || (z < std::numeric_limits<mrb_int>::min()))
+        r = mrb_float_value(z);
+    else
+        r = mrb_fixnum_value(z);
+}
+
+static inline void
+fixnum_div(mrb_value &r, mrb_int x, mrb_int y)
+{
+    if ((y == 0) || ((x == std::numeric_limits<mrb_int>::min()) && (y == -1)))
+        r = mrb_float_value((mrb_float)x / (mrb_float)y);
+    else
+        r.value.i = x / y;
+}
+
 mrb_value mrb_gv_val_get(mrb_state *mrb, mrb_sym sym);
 void mrb_gv_val_set(mrb_state *mrb, mrb_sym sym, mrb_value val);
 
@@ -583,6 +789,9 @@ mrb_value mrb_state::mrb_context_run(RProc *proc, mrb_value self,unsigned int st
     int ai = gc().arena_save();
     mrb_jmpbuf *prev_jmp = this->jmp;
     mrb_jmpbuf c_jmp;
+    /* frames below this one belong to whoever called us (a C function or another loop) */
+    mrb_context *ctx_entry = m_ctx;
+    const ptrdiff_t ci_entry = m_ctx->m_ci - m_ctx->cibase;
 
 #ifdef DIRECT_THREADED
     static void *optable[] = {
@@ -606,6 +815,20 @@ mrb_value mrb_state::mrb_context_run(RProc *proc, mrb_value self,unsigned int st
         &&L_OP_CLASS, &&L_OP_MODULE, &&L_OP_EXEC,
         &&L_OP_METHOD, &&L_OP_SCLASS, &&L_OP_TCLASS,
         &&L_OP_DEBUG, &&L_OP_STOP, &&L_OP_ERR,
+        &&L_OP_STRCATN, &&L_OP_CHKMETH,
+        &&L_OP_EQ_JMPIF, &&L_OP_EQ_JMPNOT, &&L_OP_LT_JMPIF, &&L_OP_LT_JMPNOT,
+        &&L_OP_LE_JMPIF, &&L_OP_LE_JMPNOT, &&L_OP_GT_JMPIF, &&L_OP_GT_JMPNOT,
+        &&L_OP_GE_JMPIF, &&L_OP_GE_JMPNOT,
+        &&L_OP_MOVE_SEND, &&L_OP_LOADI_SEND, &&L_OP_GETIV_RETURN,
+        &&L_OP_ADD_FIXFIX, &&L_OP_ADD_FLOFLO, &&L_OP_ADDI_FIX, &&L_OP_ADDI_FLO,
+        &&L_OP_SUB_FIXFIX, &&L_OP_SUB_FLOFLO, &&L_OP_SUBI_FIX, &&L_OP_SUBI_FLO,
+        &&L_OP_MUL_FIXFIX, &&L_OP_MUL_FLOFLO, &&L_OP_DIV_FIXFIX, &&L_OP_DIV_FLOFLO,
+        &&L_OP_EQ_FIXFIX, &&L_OP_EQ_FLOFLO, &&L_OP_LT_FIXFIX, &&L_OP_LT_FLOFLO,
+        &&L_OP_LE_FIXFIX, &&L_OP_LE_FLOFLO, &&L_OP_GT_FIXFIX, &&L_OP_GT_FLOFLO,
+        &&L_OP_GE_FIXFIX, &&L_OP_GE_FLOFLO,
+        &&L_OP_ADD_MEGA, &&L_OP_ADDI_MEGA, &&L_OP_SUB_MEGA, &&L_OP_SUBI_MEGA,
+        &&L_OP_MUL_MEGA, &&L_OP_DIV_MEGA, &&L_OP_EQ_MEGA, &&L_OP_LT_MEGA,
+        &&L_OP_LE_MEGA, &&L_OP_GT_MEGA, &&L_OP_GE_MEGA,
     };
 #endif
     mrb_bool exc_catched = false;
@@ -614,6 +837,8 @@ RETRY_TRY_BLOCK:
 
         if (exc_catched) {
             exc_catched = false;
+            if (!m_exc && m_break.pending)
+                goto L_BREAK;
             goto L_RAISE;
         }
         this->jmp = &c_jmp;
@@ -782,6 +1007,8 @@ RETRY_TRY_BLOCK:
             CASE(OP_JMP) {
                 /* sBx    pc+=sBx */
                 pc += GETARG_sBx(i);
+                if (GETARG_sBx(i) < 0)
+                    JIT_BACKEDGE();
                 JUMP;
             }
 
@@ -789,6 +1016,8 @@ RETRY_TRY_BLOCK:
                 /* A sBx  if R(A) pc+=sBx */
                 if (regs[GETARG_A(i)].to_bool()) {
                     pc += GETARG_sBx(i);
+                    if (GETARG_sBx(i) < 0)
+                        JIT_BACKEDGE();
                     JUMP;
                 }
                 NEXT;
@@ -798,6 +1027,8 @@ RETRY_TRY_BLOCK:
                 /* A sBx  if R(A) pc+=sBx */
                 if (!regs[GETARG_A(i)].to_bool()) {
                     pc += GETARG_sBx(i);
+                    if (GETARG_sBx(i) < 0)
+                        JIT_BACKEDGE();
                     JUMP;
                 }
                 NEXT;
@@ -946,6 +1177,9 @@ L_SEND:
                     JUMP;
                 }
                 else {
+                    /* a proc is self in a method written in Ruby, not just the core Proc#call */
+                    if (recv.tt == MRB_TT_PROC && GET_OPCODE(*m->ireps()->iseq) != OP_CALL)
+                        recv.ptr<RProc>()->escape();
                     /* setup environment for calling method */
                     proc = m_ctx->m_ci->proc = m;
                     irep = m->ireps();
@@ -1141,6 +1375,9 @@ L_SEND:
                 int len = m1 + o + r + m2;
                 mrb_value *blk = &argv[argc < 0 ? 1 : argc];
 
+                if ((ax & 1) && blk->tt == MRB_TT_PROC) /* the block is kept as an object */
+                    blk->ptr<RProc>()->escape();
+
                 if (argc < 0) {
                     RArray *ary = mrb_ary_ptr(regs[1]);
                     argv = ary->m_ptr;
@@ -1216,6 +1453,10 @@ L_RETURN:
             /* fall through */
             CASE(OP_RETURN) {
                 /* A      return R(A) */
+                mrb_callinfo *ci;
+                int acc, eidx;
+                mrb_value v;
+
                 if (m_exc) {
                     mrb_callinfo *_ci;
                     int eidx;
@@ -1256,7 +1497,8 @@ L_RAISE:
                                     mrb_context *c = m_ctx;
 
                                     m_ctx = c->prev;
-                                    c->prev = NULL;
+                                    m_ctx->status = MRB_FIBER_RUNNING;
+                                    fiber_terminate(this, c);
                                     goto L_RAISE;
                                 }
                             }
@@ -1271,9 +1513,9 @@ L_RESCUE:
                     pc = m_ctx->rescue[--_ci->ridx];
                 }
                 else {
-                    mrb_callinfo *ci = m_ctx->m_ci;
-                    int acc, eidx = m_ctx->m_ci->eidx;
-                    mrb_value v = regs[GETARG_A(i)];
+                    ci = m_ctx->m_ci;
+                    eidx = m_ctx->m_ci->eidx;
+                    v = regs[GETARG_A(i)];
 
                     switch (GETARG_B(i)) {
                     case OP_R_RETURN:
@@ -1306,9 +1548,10 @@ L_RESCUE:
                                 goto L_RAISE;
                             }
                             /* automatic yield at the end */
-                            m_ctx->status = MRB_FIBER_TERMINATED;
-                            m_ctx = m_ctx->prev;
+                            mrb_context *c = m_ctx;
+                            m_ctx = c->prev;
                             m_ctx->status = MRB_FIBER_RUNNING;
+                            fiber_terminate(this, c);
                         }
                         ci = m_ctx->m_ci;
                         break;
@@ -1323,7 +1566,27 @@ L_RESCUE:
                             m_ctx = c->prev;
                             c->prev = NULL;
                         }
-                        ci = m_ctx->m_ci = m_ctx->cibase + proc->env->cioff + 1;
+                        m_break.target = proc->env->cioff + 1;
+                        if (0) {
+L_BREAK:
+                            /* a block called from C broke out to a frame run by this loop */
+                            v = m_break.val;
+                            eidx = m_ctx->m_ci->eidx;
+                        }
+                        if (m_ctx == ctx_entry && m_break.target < ci_entry) {
+                            /* the target frame is below the C function that started this
+                               loop (e.g. mrb_yield); unwind the C stack up to it first */
+                            if (!prev_jmp) {
+                                localjump_error(this, LOCALJUMP_ERROR_BREAK);
+                                goto L_RAISE;
+                            }
+                            m_break.val = v;
+                            m_break.pending = true;
+                            this->jmp = prev_jmp;
+                            MRB_THROW(prev_jmp);
+                        }
+                        m_break.pending = false;
+                        ci = m_ctx->m_ci = m_ctx->cibase + m_break.target;
                         break;
                     default:
                         /* cannot happen */
@@ -1358,35 +1621,77 @@ L_RESCUE:
 
                 mrb_sym mid = syms[GETARG_B(i)];
                 mrb_value recv = regs[a];
+                if (n == CALL_MAXARGS) {
+                    regs[a+2] = mrb_value::nil();
+                }
+                else {
+                    regs[a+n+1] = mrb_value::nil();
+                }
+
                 RClass *c = RClass::mrb_class(this, recv);
                 RProc *m = RClass::method_search_vm(&c, mid);
                 if (!m) {
                     m = prepare_method_missing(c,mid,a,n,regs);
                 }
 
-                /* replace callinfo */
+                /* replace callinfo; the frame's registers are about to be
+                   overwritten, so its closures must let go of them first */
                 mrb_callinfo *_ci = m_ctx->m_ci;
+                ci_detach_env(this, _ci);
+                _ci->env = nullptr;
                 _ci->mid = mid;
-                _ci->target_class = c;
+                _ci->proc = m;
                 _ci->argc = (n == CALL_MAXARGS) ? -1 : n;
-                /* move stack */
-                value_move(m_ctx->m_stack, &regs[a], _ci->argc+1);
+                _ci->target_class = c;
+                if (c->tt == MRB_TT_ICLASS) {
+                    _ci->target_class = c->c;
+                }
+                /* move receiver, arguments and block down to the frame base */
+                int len = (n == CALL_MAXARGS) ? 3 : n + 2;
+                value_move(m_ctx->m_stack, &regs[a], len);
 
                 if (m->is_cfunc()) {
-                    m_ctx->m_stack[0] = m->call_cfunc(recv);
+                    _ci->nregs = len;
+                    mrb_value result = m->call_cfunc(recv);
                     gc().arena_restore(ai);
-                    goto L_RETURN;
+                    if (m_exc)
+                        goto L_RAISE;
+                    regs = m_ctx->m_stack;
+                    if (m_ctx->m_ci == _ci) {
+                        /* return the result from the reused frame */
+                        regs[0] = result;
+                        i = MKOP_A(OP_RETURN, 0);
+                        goto L_RETURN;
+                    }
+                    /* the callee replaced the frame (send, fiber switch):
+                       finish like OP_SEND does */
+                    m_ctx->m_stack[0] = result;
+                    _ci = m_ctx->m_ci;
+                    if (!_ci[-1].proc->is_cfunc()) {
+                        proc = _ci[-1].proc;
+                        irep = proc->ireps();
+                        pool = irep->pool;
+                        syms = irep->syms;
+                    }
+                    regs = m_ctx->m_stack = m_ctx->m_ci->stackent;
+                    pc = _ci->pc;
+                    cipop(this);
+                    JUMP;
                 }
                 else {
+                    if (recv.tt == MRB_TT_PROC && GET_OPCODE(*m->ireps()->iseq) != OP_CALL)
+                        recv.ptr<RProc>()->escape();
                     /* setup environment for calling method */
+                    proc = m;
                     irep = m->ireps();
                     pool = irep->pool;
                     syms = irep->syms;
+                    _ci->nregs = irep->nregs;
                     call_stack_sizing(this,_ci,irep);
                     regs = m_ctx->m_stack;
                     pc = irep->iseq;
+                    JUMP;
                 }
-                JUMP;
             }
 
             CASE(OP_BLKPUSH) {
@@ -1425,7 +1730,13 @@ L_RESCUE:
 #define OP_MATH_BODY(op,v1,v2) do {\
     regs[a].v1 = regs[a].v1 op regs[a+1].v2;\
         } while(0)
+#ifdef MRB_WORD_BOXING
+#define OP_MATH_FLOFLO(op) SET_FLT_VALUE(mrb, regs[a], mrb_float(regs[a]) op mrb_float(regs[a+1]))
+#else
+#define OP_MATH_FLOFLO(op) OP_MATH_BODY(op,attr_f,attr_f)
+#endif
 
+            CASE(OP_ADD_MEGA)
             CASE(OP_ADD) {
                 /* A B C  R(A) := R(A)+R(A+1) (Syms[B]=:+,C=1)*/
                 int a = GETARG_A(i);
@@ -1434,18 +1745,8 @@ L_RESCUE:
                 /* need to check if op is overridden */
                 switch (TYPES2(mrb_type(regs_a),mrb_type(regs[a+1]))) {
                 case TYPES2(MRB_TT_FIXNUM,MRB_TT_FIXNUM):
-                {
-                    mrb_int x, y;
-                    const mrb_value &regs_b(regs[a + 1]);
-                    x = mrb_fixnum(regs_a);
-                    y = mrb_fixnum(regs_b);
-
-                    if ( ((x^y) | (((x^(~(x^y) & std::numeric_limits<mrb_int>::min())) + y)^y)) >= 0) {
-                        regs_a = mrb_float_value((mrb_float)x + (mrb_float)y);
-                    } else {
-                        regs_a.value.i =  x+y;
-                    }
-                }
+                    QUICKEN(OP_ADD_FIXFIX);
+                    fixnum_add(regs_a, mrb_fixnum(regs_a), mrb_fixnum(regs[a+1]));
                     break;
                 case TYPES2(MRB_TT_FIXNUM,MRB_TT_FLOAT):
                 {
@@ -1466,15 +1767,8 @@ L_RESCUE:
 #endif
                     break;
                 case TYPES2(MRB_TT_FLOAT,MRB_TT_FLOAT):
-#ifdef MRB_WORD_BOXING
-                {
-                    mrb_float x = mrb_float(regs[a]);
-                    mrb_float y = mrb_float(regs[a+1]);
-                    SET_FLT_VALUE(mrb, regs[a], x + y);
-                }
-#else
-                    OP_MATH_BODY(+,attr_f,attr_f);
-#endif
+                    QUICKEN(OP_ADD_FLOFLO);
+                    OP_MATH_FLOFLO(+);
                     break;
                 case TYPES2(MRB_TT_STRING,MRB_TT_STRING):
                     regs_a = mrb_str_plus(this, regs_a, regs[a+1]);
@@ -1486,6 +1780,7 @@ L_RESCUE:
                 NEXT;
             }
 
+            CASE(OP_SUB_MEGA)
             CASE(OP_SUB) {
                 /* A B C  R(A) := R(A)-R(A+1) (Syms[B]=:-,C=1)*/
                 int a = GETARG_A(i);
@@ -1493,19 +1788,8 @@ L_RESCUE:
                 /* need to check if op is overridden */
                 switch (TYPES2(mrb_type(regs[a]),mrb_type(regs[a+1]))) {
                 case TYPES2(MRB_TT_FIXNUM,MRB_TT_FIXNUM):
-                {
-                    mrb_int x, y;
-                    x = mrb_fixnum(regs[a]);
-                    y = mrb_fixnum(regs[a+1]);
-                    if (((x^y) & (((x ^ ((x^y)
-                                         & (1 << (sizeof(mrb_int)*8-1))))-y)^y)) < 0) {
-                        /* integer overflow */
-                        regs[a] = mrb_float_value((mrb_float)x - (mrb_float)y); // SET_FLT_VALUE(regs[a], (mrb_float)x - (mrb_float)y);
-                    }
-                    else {
-                        regs[a]=mrb_fixnum_value(x-y);
-                    }
-                }
+                    QUICKEN(OP_SUB_FIXFIX);
+                    fixnum_sub(regs[a], mrb_fixnum(regs[a]), mrb_fixnum(regs[a+1]));
                     break;
                 case TYPES2(MRB_TT_FIXNUM,MRB_TT_FLOAT):
                 {
@@ -1527,15 +1811,8 @@ L_RESCUE:
 #endif
                     break;
                 case TYPES2(MRB_TT_FLOAT,MRB_TT_FLOAT):
-#ifdef MRB_WORD_BOXING
-                {
-                    mrb_float x = mrb_float(regs[a]);
-                    mrb_float y = mrb_float(regs[a+1]);
-                    SET_FLT_VALUE(mrb, regs[a], x - y);
-                }
-#else
-                    OP_MATH_BODY(-,attr_f,attr_f);
-#endif
+                    QUICKEN(OP_SUB_FLOFLO);
+                    OP_MATH_FLOFLO(-);
                     break;
                 default:
                     goto L_SEND;
@@ -1543,6 +1820,7 @@ L_RESCUE:
                 NEXT;
             }
 
+            CASE(OP_MUL_MEGA)
             CASE(OP_MUL) {
                 /* A B C  R(A) := R(A)*R(A+1) (Syms[B]=:*,C=1)*/
                 int a = GETARG_A(i);
@@ -1550,22 +1828,8 @@ L_RESCUE:
                 /* need to check if op is overridden */
                 switch (TYPES2(mrb_type(regs[a]),mrb_type(regs[a+1]))) {
                 case TYPES2(MRB_TT_FIXNUM,MRB_TT_FIXNUM):
-                {
-                    mrb_int x, y;
-                    static_assert(
-                                sizeof(long long) >= 2 * sizeof(mrb_int),
-                                "Unable to detect overflow after multiplication"
-                                );
-                    x = mrb_fixnum(regs[a]);
-                    y = mrb_fixnum(regs[a+1]);
-                    long long z = x * y;
-                    if ( (z > std::numeric_limits<mrb_int>::max()) || (z < std::numeric_limits<mrb_int>::min()) ) {
-                        regs[a] = mrb_float_value(z); // SET_FLT_VALUE(regs[a], (mrb_float)z);
-                    }
-                    else {
-                        regs[a]=mrb_fixnum_value(z);
-                    }
-                }
+                    QUICKEN(OP_MUL_FIXFIX);
+                    fixnum_mul(regs[a], mrb_fixnum(regs[a]), mrb_fixnum(regs[a+1]));
                     break;
                 case TYPES2(MRB_TT_FIXNUM,MRB_TT_FLOAT):
                 {
@@ -1586,15 +1850,8 @@ L_RESCUE:
 #endif
                     break;
                 case TYPES2(MRB_TT_FLOAT,MRB_TT_FLOAT):
-#ifdef MRB_WORD_BOXING
-                {
-                    mrb_float x = mrb_float(regs[a]);
-                    mrb_float y = mrb_float(regs[a+1]);
-                    SET_FLT_VALUE(mrb, regs[a], x * y);
-                }
-#else
-                    OP_MATH_BODY(*,attr_f,attr_f);
-#endif
+                    QUICKEN(OP_MUL_FLOFLO);
+                    OP_MATH_FLOFLO(*);
                     break;
                 default:
                     goto L_SEND;
@@ -1602,6 +1859,7 @@ L_RESCUE:
                 NEXT;
             }
 
+            CASE(OP_DIV_MEGA)
             CASE(OP_DIV) {
                 /* A B C  R(A) := R(A)/R(A+1) (Syms[B]=:/,C=1)*/
                 int a = GETARG_A(i);
@@ -1610,19 +1868,8 @@ L_RESCUE:
                 /* need to check if op is overridden */
                 switch (TYPES2(mrb_type(regs_a),mrb_type(regs[a+1]))) {
                 case TYPES2(MRB_TT_FIXNUM,MRB_TT_FIXNUM):
-                {
-                    mrb_int x = mrb_fixnum(regs_a);
-                    mrb_int y = mrb_fixnum(regs[a+1]);
-
-                    /* Initialize sl1 and sl2 */
-
-                    if ( (y == 0) || ( (x == std::numeric_limits<mrb_int>::min()) && (y == -1) ) ) {
-                        regs_a = mrb_float_value((mrb_float)x / (mrb_float)y); // SET_FLT_VALUE(regs_a, (mrb_float)x / (mrb_float)y);
-                    }
-                    else {
-                        regs_a.value.i = x / y;
-                    }
-                }
+                    QUICKEN(OP_DIV_FIXFIX);
+                    fixnum_div(regs_a, mrb_fixnum(regs_a), mrb_fixnum(regs[a+1]));
                     break;
                 case TYPES2(MRB_TT_FIXNUM,MRB_TT_FLOAT):
                 {
@@ -1643,15 +1890,8 @@ L_RESCUE:
 #endif
                     break;
                 case TYPES2(MRB_TT_FLOAT,MRB_TT_FLOAT):
-#ifdef MRB_WORD_BOXING
-                {
-                    mrb_float x = mrb_float(regs[a]);
-                    mrb_float y = mrb_float(regs[a+1]);
-                    SET_FLT_VALUE(mrb, regs[a], x / y);
-                }
-#else
-                    OP_MATH_BODY(/,attr_f,attr_f);
-#endif
+                    QUICKEN(OP_DIV_FLOFLO);
+                    OP_MATH_FLOFLO(/);
                     break;
                 default:
                     goto L_SEND;
@@ -1659,6 +1899,7 @@ L_RESCUE:
                 NEXT;
             }
 
+            CASE(OP_ADDI_MEGA)
             CASE(OP_ADDI) {
                 /* A B C  R(A) := R(A)+C (Syms[B]=:+)*/
                 int a = GETARG_A(i);
@@ -1666,19 +1907,11 @@ L_RESCUE:
                 /* need to check if + is overridden */
                 switch (mrb_type(regs[a])) {
                 case MRB_TT_FIXNUM:
-                {
-                    mrb_value &regs_a(regs[a]);
-                    mrb_int x = mrb_fixnum(regs_a);
-                    mrb_int y = GETARG_C(i);
-
-                    if ( ((x^y) | (((x^(~(x^y) & std::numeric_limits<mrb_int>::min())) + y)^y)) >= 0) {
-                        regs_a = mrb_float_value((mrb_float)x + (mrb_float)y); //SET_FLT_VALUE(regs_a, (mrb_float)x + (mrb_float)y);
-                    } else {
-                        regs_a.value.i = x+y;
-                    }
-                }
+                    QUICKEN(OP_ADDI_FIX);
+                    fixnum_add(regs[a], mrb_fixnum(regs[a]), GETARG_C(i));
                     break;
                 case MRB_TT_FLOAT:
+                    QUICKEN(OP_ADDI_FLO);
 #ifdef MRB_WORD_BOXING
                 {
                     mrb_float x = mrb_float(regs[a]);
@@ -1696,6 +1929,7 @@ L_RESCUE:
                 NEXT;
             }
 
+            CASE(OP_SUBI_MEGA)
             CASE(OP_SUBI) {
                 /* A B C  R(A) := R(A)-C (Syms[B]=:-)*/
                 int a = GETARG_A(i);
@@ -1704,20 +1938,11 @@ L_RESCUE:
                 /* need to check if + is overridden */
                 switch (mrb_type(regs_a[0])) {
                 case MRB_TT_FIXNUM:
-                {
-                    mrb_int x = mrb_fixnum(regs_a[0]);
-                    mrb_int y = GETARG_C(i);
-                    if (((x^y) & (((x ^ ((x^y)
-                                         & (1 << (sizeof(mrb_int)*8-1))))-y)^y)) < 0) {
-                        /* integer overflow */
-                        *regs_a = mrb_float_value((mrb_float)x - (mrb_float)y); //SET_FLT_VALUE(regs[a], (mrb_float)x - (mrb_float)y);
-                    }
-                    else {
-                        regs[a]=mrb_fixnum_value(x-y);
-                    }
-                }
+                    QUICKEN(OP_SUBI_FIX);
+                    fixnum_sub(regs_a[0], mrb_fixnum(regs_a[0]), GETARG_C(i));
                     break;
                 case MRB_TT_FLOAT:
+                    QUICKEN(OP_SUBI_FLO);
 #ifdef MRB_WORD_BOXING
                 {
                     mrb_float x = mrb_float(regs[a]);
@@ -1744,11 +1969,12 @@ L_RESCUE:
         }\
         } while(0)
 
-#define OP_CMP(op) do {\
+#define OP_CMP(op,fixfix,flofl) do {\
     int a = GETARG_A(i);\
     /* need to check if - is overridden */\
     switch (TYPES2(mrb_type(regs[a]),mrb_type(regs[a+1]))) {\
     case TYPES2(MRB_TT_FIXNUM,MRB_TT_FIXNUM):\
+    QUICKEN(fixfix);\
     OP_CMP_BODY(op,attr_i,attr_i);\
     break;\
     case TYPES2(MRB_TT_FIXNUM,MRB_TT_FLOAT):\
@@ -1758,6 +1984,7 @@ L_RESCUE:
     OP_CMP_BODY(op,attr_f,attr_i);\
     break;\
     case TYPES2(MRB_TT_FLOAT,MRB_TT_FLOAT):\
+    QUICKEN(flofl);\
     OP_CMP_BODY(op,attr_f,attr_f);\
     break;\
     default:\
@@ -1765,39 +1992,48 @@ L_RESCUE:
         }\
         } while (0)
 
+            CASE(OP_EQ_MEGA)
             CASE(OP_EQ) {
                 /* A B C  R(A) := R(A)<R(A+1) (Syms[B]=:==,C=1)*/
                 int a = GETARG_A(i);
                 if (mrb_obj_eq(regs[a], regs[a+1])) {
+                    if (mrb_type(regs[a]) == MRB_TT_FIXNUM)
+                        QUICKEN(OP_EQ_FIXFIX);
+                    else if (mrb_type(regs[a]) == MRB_TT_FLOAT)
+                        QUICKEN(OP_EQ_FLOFLO);
                     regs[a] = mrb_true_value();
                 }
                 else {
-                    OP_CMP(==);
+                    OP_CMP(==,OP_EQ_FIXFIX,OP_EQ_FLOFLO);
                 }
                 NEXT;
             }
 
+            CASE(OP_LT_MEGA)
             CASE(OP_LT) {
                 /* A B C  R(A) := R(A)<R(A+1) (Syms[B]=:<,C=1)*/
-                OP_CMP(<);
+                OP_CMP(<,OP_LT_FIXFIX,OP_LT_FLOFLO);
                 NEXT;
             }
 
+            CASE(OP_LE_MEGA)
             CASE(OP_LE) {
                 /* A B C  R(A) := R(A)<=R(A+1) (Syms[B]=:<=,C=1)*/
-                OP_CMP(<=);
+                OP_CMP(<=,OP_LE_FIXFIX,OP_LE_FLOFLO);
                 NEXT;
             }
 
+            CASE(OP_GT_MEGA)
             CASE(OP_GT) {
                 /* A B C  R(A) := R(A)<R(A+1) (Syms[B]=:>,C=1)*/
-                OP_CMP(>);
+                OP_CMP(>,OP_GT_FIXFIX,OP_GT_FLOFLO);
                 NEXT;
             }
 
+            CASE(OP_GE_MEGA)
             CASE(OP_GE) {
                 /* A B C  R(A) := R(A)<R(A+1) (Syms[B]=:>=,C=1)*/
-                OP_CMP(>=);
+                OP_CMP(>=,OP_GE_FIXFIX,OP_GE_FLOFLO);
                 NEXT;
             }
 
@@ -1900,6 +2136,34 @@ L_RESCUE:
                 NEXT;
             }
 
+            CASE(OP_STRCATN) {
+                /* A B    R(A) := str_new(R(A),R(A+1),..,R(A+B-1)) */
+                int a = GETARG_A(i);
+                int n = GETARG_B(i);
+
+                for (int k = 0; k < n; ++k) {
+                    if (!regs[a+k].is_string()) {
+                        mrb_value s = mrb_str_to_str(this, regs[a+k]);
+                        /* to_s may have reallocated the stack */
+                        regs = m_ctx->m_stack;
+                        regs[a+k] = s;
+                    }
+                }
+                regs[a] = RString::new_from_values(this, n, &regs[a])->wrap();
+                gc().arena_restore(ai);
+                NEXT;
+            }
+
+            CASE(OP_CHKMETH) {
+                /* A B C  R(A) := R(A).mSym(B) is core method C */
+                int a = GETARG_A(i);
+                int c = GETARG_C(i);
+                RClass *k = RClass::mrb_class(this, regs[a]);
+                RProc *m = RClass::method_search_vm(&k, syms[GETARG_B(i)]);
+                regs[a] = mrb_value::wrap(c < MRB_INLINE_MAX && m && m == m_inlinable[c]);
+                NEXT;
+            }
+
             CASE(OP_HASH) {
                 /* A B C   R(A) := hash_new(R(B),R(B+1)..R(B+C)) */
                 int b = GETARG_B(i);
@@ -1923,6 +2187,10 @@ L_RESCUE:
 
                 if (c & OP_L_CAPTURE) {
                     p = RProc::new_closure(this, irep->reps[GETARG_b(i)]);
+                    /* a lambda literal is a value from the start, a block only if
+                       the callee makes it one */
+                    if (c & OP_L_STRICT)
+                        p->escape();
                 }
                 else {
                     p = RProc::create(this, irep->reps[GETARG_b(i)]);
@@ -2092,6 +2360,287 @@ L_STOP:
                 m_exc = mrb_exc_new_str(excep_class, msg).object_ptr();
                 goto L_RAISE;
             }
+
+            /* superinstructions: run the first instruction, then the second
+               one in place without going through the dispatch */
+#define FUSED_NEXT() do {\
+    i = *++pc;\
+    CODE_FETCH_HOOK(mrb, irep, pc, regs);\
+    } while (0)
+
+#define OP_CMP_BRANCH(op,jmpif) {\
+    int a = GETARG_A(i);\
+    switch (TYPES2(mrb_type(regs[a]),mrb_type(regs[a+1]))) {\
+    case TYPES2(MRB_TT_FIXNUM,MRB_TT_FIXNUM):\
+    OP_CMP_BODY(op,attr_i,attr_i);\
+    break;\
+    case TYPES2(MRB_TT_FIXNUM,MRB_TT_FLOAT):\
+    OP_CMP_BODY(op,attr_i,attr_f);\
+    break;\
+    case TYPES2(MRB_TT_FLOAT,MRB_TT_FIXNUM):\
+    OP_CMP_BODY(op,attr_f,attr_i);\
+    break;\
+    case TYPES2(MRB_TT_FLOAT,MRB_TT_FLOAT):\
+    OP_CMP_BODY(op,attr_f,attr_f);\
+    break;\
+    default:\
+    goto L_SEND; /* the jump runs after the call returns */\
+    }\
+    FUSED_NEXT();\
+    if ((mrb_type(regs[a]) == MRB_TT_TRUE) == (jmpif)) {\
+        pc += GETARG_sBx(i);\
+        if (GETARG_sBx(i) < 0)\
+            JIT_BACKEDGE();\
+        JUMP;\
+    }\
+    NEXT;\
+    }
+
+            CASE(OP_EQ_JMPIF) {
+                if (mrb_obj_eq(regs[GETARG_A(i)], regs[GETARG_A(i)+1]))
+                    goto L_EQ_TRUE_JMPIF;
+                OP_CMP_BRANCH(==,true);
+            }
+
+            CASE(OP_EQ_JMPNOT) {
+                if (mrb_obj_eq(regs[GETARG_A(i)], regs[GETARG_A(i)+1]))
+                    goto L_EQ_TRUE_JMPNOT;
+                OP_CMP_BRANCH(==,false);
+            }
+
+            CASE(OP_LT_JMPIF) OP_CMP_BRANCH(<,true)
+            CASE(OP_LT_JMPNOT) OP_CMP_BRANCH(<,false)
+            CASE(OP_LE_JMPIF) OP_CMP_BRANCH(<=,true)
+            CASE(OP_LE_JMPNOT) OP_CMP_BRANCH(<=,false)
+            CASE(OP_GT_JMPIF) OP_CMP_BRANCH(>,true)
+            CASE(OP_GT_JMPNOT) OP_CMP_BRANCH(>,false)
+            CASE(OP_GE_JMPIF) OP_CMP_BRANCH(>=,true)
+            CASE(OP_GE_JMPNOT) OP_CMP_BRANCH(>=,false)
+
+            L_EQ_TRUE_JMPIF:
+                /* identical objects: taken */
+                regs[GETARG_A(i)] = mrb_true_value();
+                FUSED_NEXT();
+                pc += GETARG_sBx(i);
+                if (GETARG_sBx(i) < 0)
+                    JIT_BACKEDGE();
+                JUMP;
+
+            L_EQ_TRUE_JMPNOT:
+                /* identical objects: not taken */
+                regs[GETARG_A(i)] = mrb_true_value();
+                pc++;
+                NEXT;
+
+            CASE(OP_MOVE_SEND) {
+                regs[GETARG_A(i)] = regs[GETARG_B(i)];
+                FUSED_NEXT();
+                goto L_SEND;
+            }
+
+            CASE(OP_LOADI_SEND) {
+                regs[GETARG_A(i)] = mrb_fixnum_value(GETARG_sBx(i));
+                FUSED_NEXT();
+                goto L_SEND;
+            }
+
+            CASE(OP_GETIV_RETURN) {
+                regs[GETARG_A(i)] = this->vm_iv_get(syms[GETARG_Bx(i)]);
+                FUSED_NEXT();
+                goto L_RETURN;
+            }
+
+            /* quickened instructions; see QUICKEN */
+#define BOTH_TT(t) (mrb_type(regs[a]) == (t) && mrb_type(regs[a+1]) == (t))
+
+            L_UNQUICKEN:
+                /* operand types changed: settle on the generic code for good */
+                *pc = (i & ~(mrb_code)0x7f) | MKOPCODE(mrb_megamorphic_opcode(GET_OPCODE(i)));
+                JUMP;
+
+            CASE(OP_ADD_FIXFIX) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FIXNUM)))
+                    goto L_UNQUICKEN;
+                fixnum_add(regs[a], mrb_fixnum(regs[a]), mrb_fixnum(regs[a+1]));
+                NEXT;
+            }
+
+            CASE(OP_ADD_FLOFLO) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FLOAT)))
+                    goto L_UNQUICKEN;
+                OP_MATH_FLOFLO(+);
+                NEXT;
+            }
+
+            CASE(OP_ADDI_FIX) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(mrb_type(regs[a]) != MRB_TT_FIXNUM))
+                    goto L_UNQUICKEN;
+                fixnum_add(regs[a], mrb_fixnum(regs[a]), GETARG_C(i));
+                NEXT;
+            }
+
+            CASE(OP_ADDI_FLO) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(mrb_type(regs[a]) != MRB_TT_FLOAT))
+                    goto L_UNQUICKEN;
+#ifdef MRB_WORD_BOXING
+                SET_FLT_VALUE(mrb, regs[a], mrb_float(regs[a]) + GETARG_C(i));
+#else
+                regs[a].attr_f += GETARG_C(i);
+#endif
+                NEXT;
+            }
+
+            CASE(OP_SUB_FIXFIX) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FIXNUM)))
+                    goto L_UNQUICKEN;
+                fixnum_sub(regs[a], mrb_fixnum(regs[a]), mrb_fixnum(regs[a+1]));
+                NEXT;
+            }
+
+            CASE(OP_SUB_FLOFLO) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FLOAT)))
+                    goto L_UNQUICKEN;
+                OP_MATH_FLOFLO(-);
+                NEXT;
+            }
+
+            CASE(OP_SUBI_FIX) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(mrb_type(regs[a]) != MRB_TT_FIXNUM))
+                    goto L_UNQUICKEN;
+                fixnum_sub(regs[a], mrb_fixnum(regs[a]), GETARG_C(i));
+                NEXT;
+            }
+
+            CASE(OP_SUBI_FLO) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(mrb_type(regs[a]) != MRB_TT_FLOAT))
+                    goto L_UNQUICKEN;
+#ifdef MRB_WORD_BOXING
+                SET_FLT_VALUE(mrb, regs[a], mrb_float(regs[a]) - GETARG_C(i));
+#else
+                regs[a].attr_f -= GETARG_C(i);
+#endif
+                NEXT;
+            }
+
+            CASE(OP_MUL_FIXFIX) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FIXNUM)))
+                    goto L_UNQUICKEN;
+                fixnum_mul(regs[a], mrb_fixnum(regs[a]), mrb_fixnum(regs[a+1]));
+                NEXT;
+            }
+
+            CASE(OP_MUL_FLOFLO) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FLOAT)))
+                    goto L_UNQUICKEN;
+                OP_MATH_FLOFLO(*);
+                NEXT;
+            }
+
+            CASE(OP_DIV_FIXFIX) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FIXNUM)))
+                    goto L_UNQUICKEN;
+                fixnum_div(regs[a], mrb_fixnum(regs[a]), mrb_fixnum(regs[a+1]));
+                NEXT;
+            }
+
+            CASE(OP_DIV_FLOFLO) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FLOAT)))
+                    goto L_UNQUICKEN;
+                OP_MATH_FLOFLO(/);
+                NEXT;
+            }
+
+            CASE(OP_EQ_FIXFIX) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FIXNUM)))
+                    goto L_UNQUICKEN;
+                OP_CMP_BODY(==,attr_i,attr_i);
+                NEXT;
+            }
+
+            CASE(OP_EQ_FLOFLO) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FLOAT)))
+                    goto L_UNQUICKEN;
+                OP_CMP_BODY(==,attr_f,attr_f);
+                NEXT;
+            }
+
+            CASE(OP_LT_FIXFIX) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FIXNUM)))
+                    goto L_UNQUICKEN;
+                OP_CMP_BODY(<,attr_i,attr_i);
+                NEXT;
+            }
+
+            CASE(OP_LT_FLOFLO) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FLOAT)))
+                    goto L_UNQUICKEN;
+                OP_CMP_BODY(<,attr_f,attr_f);
+                NEXT;
+            }
+
+            CASE(OP_LE_FIXFIX) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FIXNUM)))
+                    goto L_UNQUICKEN;
+                OP_CMP_BODY(<=,attr_i,attr_i);
+                NEXT;
+            }
+
+            CASE(OP_LE_FLOFLO) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FLOAT)))
+                    goto L_UNQUICKEN;
+                OP_CMP_BODY(<=,attr_f,attr_f);
+                NEXT;
+            }
+
+            CASE(OP_GT_FIXFIX) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FIXNUM)))
+                    goto L_UNQUICKEN;
+                OP_CMP_BODY(>,attr_i,attr_i);
+                NEXT;
+            }
+
+            CASE(OP_GT_FLOFLO) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FLOAT)))
+                    goto L_UNQUICKEN;
+                OP_CMP_BODY(>,attr_f,attr_f);
+                NEXT;
+            }
+
+            CASE(OP_GE_FIXFIX) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FIXNUM)))
+                    goto L_UNQUICKEN;
+                OP_CMP_BODY(>=,attr_i,attr_i);
+                NEXT;
+            }
+
+            CASE(OP_GE_FLOFLO) {
+                int a = GETARG_A(i);
+                if (UNLIKELY(!BOTH_TT(MRB_TT_FLOAT)))
+                    goto L_UNQUICKEN;
+                OP_CMP_BODY(>=,attr_f,attr_f);
+                NEXT;
+            }
         }
         END_DISPATCH;
     }
@@ -2115,7 +2664,7 @@ mrb_value mrb_toplevel_run(mrb_state *mrb, RProc *proc)
         return mrb->mrb_context_run(proc, mrb_top_self(mrb), 0);
     }
     ci = cipush(mrb);
-    ci->acc = CI_ACC_SKIP;
+    ci_set_acc(mrb->m_ctx, ci, CI_ACC_SKIP);
     ci->eidx = 0;
     ci->ridx = 0;
     ci->target_class = mrb->object_class;
@@ -0,0 +1,32 @@
+# Runs one test/t file compiled with and without `mrbc -O` and fails when
+# the two reports differ. Invoked by ctest as
+#   cmake -DMRBC=... -DMRUBY=... -DSRC=file.rb -DWORK=prefix -P optimize_suite.cmake
+
+get_filename_component(TESTDIR "${CMAKE_CURRENT_LIST_DIR}" ABSOLUTE)
+file(READ "${TESTDIR}/assert.rb" PRELUDE)
+file(READ "${SRC}" BODY)
+file(READ "${TESTDIR}/report.rb" REPORT)
+file(WRITE "${WORK}.rb" "${PRELUDE}${BODY}${REPORT}")
+
+foreach(KIND plain opt)
+  if(KIND STREQUAL "opt")
+    set(FLAGS -O)
+  else()
+    set(FLAGS)
+  endif()
+  execute_process(COMMAND "${MRBC}" ${FLAGS} -o "${WORK}_${KIND}.mrb" "${WORK}.rb"
+    RESULT_VARIABLE RC ERROR_VARIABLE ERR)
+  if(NOT RC EQUAL 0)
+    message(FATAL_ERROR "mrbc ${FLAGS} failed on ${SRC}: ${ERR}")
+  endif()
+  execute_process(COMMAND "${MRUBY}" -b "${WORK}_${KIND}.mrb"
+    OUTPUT_VARIABLE OUT ERROR_VARIABLE OUT)
+  # addresses and timings differ from run to run
+  string(REGEX REPLACE "0x[0-9a-f]+" "" OUT "${OUT}")
+  string(REGEX REPLACE "Time: [^\n]*" "" OUT "${OUT}")
+  set(OUT_${KIND} "${OUT}")
+endforeach()
+
+if(NOT OUT_plain STREQUAL OUT_opt)
+  message(FATAL_ERROR "${SRC} reports differently with -O\n--- plain\n${OUT_plain}\n--- -O\n${OUT_opt}")
+endif()
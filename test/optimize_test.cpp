@@ -0,0 +1,376 @@
+/*
+** optimize_test - checks the bytecode optimizer behind `mrbc -O`
+**
+** Hand-built ireps go through mrb_irep_optimize and must come out as the
+** expected iseq; the original and the optimized irep are then both run and
+** must compute the same value. Ruby fixtures check what codegen emits
+** around rescue and ensure the same way, plus the invariants every
+** optimized irep keeps (jump targets in range, handlers on OP_RESCUE, no
+** growth of ilen or nregs).
+**
+** See Copyright Notice in mruby.h
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "mruby.h"
+#include "mruby/compile.h"
+#include "mruby/irep.h"
+#include "mruby/proc.h"
+#include "mruby/string.h"
+#include "opcode.h"
+
+typedef std::vector<mrb_code> Code;
+
+static int failures = 0;
+
+static void
+fail(const char *name, const char *fmt, const std::string &a = "", const std::string &b = "")
+{
+    printf("FAIL %s: ", name);
+    printf(fmt, a.c_str(), b.c_str());
+    putchar('\n');
+    failures++;
+}
+
+static mrb_irep *
+build_irep(mrb_state *mrb, int nregs, const Code &code, const std::vector<const char *> &syms)
+{
+    mrb_irep *irep = mrb_add_irep(mrb);
+
+    irep->nlocals = 1;  /* just self: R1 and up are temporaries */
+    irep->nregs = nregs;
+    irep->iseq = (mrb_code *)mrb->gc()._malloc(sizeof(mrb_code) * code.size());
+    memcpy(irep->iseq, code.data(), sizeof(mrb_code) * code.size());
+    irep->ilen = code.size();
+    if (!syms.empty()) {
+        irep->syms = (mrb_sym *)mrb->gc()._malloc(sizeof(mrb_sym) * syms.size());
+        for (size_t k = 0; k < syms.size(); k++)
+            irep->syms[k] = mrb_intern_cstr(mrb, syms[k]);
+        irep->slen = syms.size();
+    }
+    return irep;
+}
+
+static std::string
+inspect(mrb_state *mrb, mrb_value v)
+{
+    RString *s = mrb_inspect(mrb, v);
+    return std::string(s->m_ptr, s->len);
+}
+
+/* runs proc at the top level and describes what came out */
+static std::string
+run_proc(mrb_state *mrb, RProc *proc)
+{
+    proc->m_target_class = mrb->object_class;
+    mrb_value v = mrb->mrb_context_run(proc, mrb_top_self(mrb), 0);
+    if (mrb->m_exc) {
+        v = mrb_value::wrap(mrb->m_exc);
+        mrb->m_exc = nullptr;
+        return "raised " + inspect(mrb, v);
+    }
+    return inspect(mrb, v);
+}
+
+static std::string
+run_irep(mrb_state *mrb, mrb_irep *irep)
+{
+    RProc *proc = RProc::create(mrb, irep);
+    mrb_irep_decref(mrb->gc(), irep);
+    return run_proc(mrb, proc);
+}
+
+static std::string
+listing(const mrb_code *iseq, size_t len)
+{
+    std::string s;
+    char buf[64];
+
+    for (size_t k = 0; k < len; k++) {
+        mrb_code i = iseq[k];
+        snprintf(buf, sizeof(buf), "\n    %03d op=%d A=%d B=%d C=%d sBx=%d", (int)k,
+                 GET_OPCODE(i), GETARG_A(i), GETARG_B(i), GETARG_C(i), GETARG_sBx(i));
+        s += buf;
+    }
+    return s;
+}
+
+/* code, run through the optimizer, must become expect with expect_nregs */
+static void
+check_irep(const char *name, int nregs, const Code &code, const std::vector<const char *> &syms,
+           const Code &expect, int expect_nregs)
+{
+    mrb_state *mrb = mrb_state::create();
+    mrb_irep *plain = build_irep(mrb, nregs, code, syms);
+    mrb_irep *opt = build_irep(mrb, nregs, code, syms);
+
+    mrb_irep_optimize(mrb, opt);
+    if (opt->ilen != expect.size() || memcmp(opt->iseq, expect.data(), sizeof(mrb_code) * expect.size()) != 0)
+        fail(name, "unexpected iseq, got:%s\n  expected:%s", listing(opt->iseq, opt->ilen),
+             listing(expect.data(), expect.size()));
+    else if (opt->nregs != expect_nregs)
+        fail(name, "nregs %s, expected %s", std::to_string(opt->nregs), std::to_string(expect_nregs));
+    else {
+        std::string a = run_irep(mrb, plain), b = run_irep(mrb, opt);
+        if (a != b)
+            fail(name, "plain run gave %s, optimized %s", a, b);
+        else
+            printf("ok   %s\n", name);
+    }
+    mrb->destroy();
+}
+
+static RProc *
+compile(mrb_state *mrb, const char *src, bool optimize)
+{
+    mrbc_context *c = mrbc_context_new(mrb);
+
+    c->no_exec = 1;
+    c->optimize = optimize;
+    mrb_value v = mrb_load_string_cxt(mrb, src, c);
+    mrbc_context_free(mrb, c);
+    if (mrb_type(v) != MRB_TT_PROC)
+        return nullptr;
+    return v.ptr<RProc>();
+}
+
+/* what an optimized irep must still look like compared with plain */
+static bool
+check_shape(const char *name, const mrb_irep *plain, const mrb_irep *opt)
+{
+    if (opt->ilen > plain->ilen || opt->nregs > plain->nregs || opt->rlen != plain->rlen) {
+        fail(name, "irep grew");
+        return false;
+    }
+    for (size_t pc = 0; pc < opt->ilen; pc++) {
+        mrb_code i = opt->iseq[pc];
+        int op = GET_OPCODE(i);
+
+        if (op != OP_JMP && op != OP_JMPIF && op != OP_JMPNOT && op != OP_ONERR)
+            continue;
+        int to = (int)pc + GETARG_sBx(i);
+        if (to < 0 || to >= (int)opt->ilen) {
+            fail(name, "jump at %s out of range", std::to_string(pc));
+            return false;
+        }
+        if (op == OP_ONERR && GET_OPCODE(opt->iseq[to]) != OP_RESCUE) {
+            fail(name, "handler of OP_ONERR at %s is not an OP_RESCUE", std::to_string(pc));
+            return false;
+        }
+    }
+    for (size_t k = 0; k < opt->rlen; k++) {
+        if (!check_shape(name, plain->reps[k], opt->reps[k]))
+            return false;
+    }
+    return true;
+}
+
+static bool
+shrank(const mrb_irep *plain, const mrb_irep *opt)
+{
+    if (opt->nregs < plain->nregs)
+        return true;
+    for (size_t k = 0; k < opt->rlen; k++) {
+        if (shrank(plain->reps[k], opt->reps[k]))
+            return true;
+    }
+    return false;
+}
+
+/* src must compute the same with and without the optimizer; with
+   must_shrink, some irep in it must also need fewer registers */
+static void
+check_source(const char *name, const char *src, bool must_shrink = false)
+{
+    mrb_state *mrb = mrb_state::create();
+    RProc *plain = compile(mrb, src, false);
+    RProc *opt = compile(mrb, src, true);
+
+    if (!plain || !opt) {
+        fail(name, "does not compile");
+    }
+    else if (must_shrink && !shrank(plain->ireps(), opt->ireps())) {
+        fail(name, "nregs did not shrink");
+    }
+    else if (check_shape(name, plain->ireps(), opt->ireps())) {
+        std::string a = run_proc(mrb, plain), b = run_proc(mrb, opt);
+        if (a != b)
+            fail(name, "plain run gave %s, optimized %s", a, b);
+        else
+            printf("ok   %s\n", name);
+    }
+    mrb->destroy();
+}
+
+int
+main()
+{
+    /* a jump onto an OP_JMP goes to its target; the bypassed OP_JMP and
+       the code only it reached disappear */
+    check_irep("jump threading", 3, {
+        MKOP_A(OP_LOADSELF, 1),
+        MKOP_AsBx(OP_JMPIF, 1, 3),      /* -> 4 */
+        MKOP_AsBx(OP_LOADI, 2, 1),
+        MKOP_A(OP_RETURN, 2),
+        MKOP_sBx(OP_JMP, 2),            /* -> 6 */
+        MKOP_AsBx(OP_LOADI, 2, 2),
+        MKOP_AsBx(OP_LOADI, 2, 3),
+        MKOP_A(OP_RETURN, 2),
+    }, {}, {
+        MKOP_A(OP_LOADSELF, 1),
+        MKOP_AsBx(OP_JMPIF, 1, 3),
+        MKOP_AsBx(OP_LOADI, 2, 1),
+        MKOP_A(OP_RETURN, 2),
+        MKOP_AsBx(OP_LOADI, 2, 3),
+        MKOP_A(OP_RETURN, 2),
+    }, 3);
+
+    /* an OP_JMP onto an OP_RETURN becomes the OP_RETURN, and a jump to the
+       next instruction goes away */
+    check_irep("jump to return", 3, {
+        MKOP_A(OP_LOADSELF, 1),
+        MKOP_AsBx(OP_JMPNOT, 1, 3),     /* -> 4 */
+        MKOP_AsBx(OP_LOADI, 2, 1),
+        MKOP_sBx(OP_JMP, 3),            /* -> 6 */
+        MKOP_AsBx(OP_LOADI, 2, 2),
+        MKOP_sBx(OP_JMP, 1),            /* -> 6 */
+        MKOP_A(OP_RETURN, 2),
+    }, {}, {
+        MKOP_A(OP_LOADSELF, 1),
+        MKOP_AsBx(OP_JMPNOT, 1, 3),
+        MKOP_AsBx(OP_LOADI, 2, 1),
+        MKOP_A(OP_RETURN, 2),
+        MKOP_AsBx(OP_LOADI, 2, 2),
+        MKOP_A(OP_RETURN, 2),
+    }, 3);
+
+    /* 6 * 7 < 50 folds to true, the branch on it to a fall-through, and
+       the stores nobody reads after that go too */
+    check_irep("constant folding", 3, {
+        MKOP_AsBx(OP_LOADI, 1, 6),
+        MKOP_AsBx(OP_LOADI, 2, 7),
+        MKOP_ABC(OP_MUL, 1, 0, 1),
+        MKOP_AsBx(OP_LOADI, 2, 50),
+        MKOP_ABC(OP_LT, 1, 1, 1),
+        MKOP_AsBx(OP_JMPNOT, 1, 3),     /* -> 8 */
+        MKOP_AsBx(OP_LOADI, 1, 1),
+        MKOP_A(OP_RETURN, 1),
+        MKOP_AsBx(OP_LOADI, 1, 2),
+        MKOP_A(OP_RETURN, 1),
+    }, {"*", "<"}, {
+        MKOP_AsBx(OP_LOADI, 1, 1),
+        MKOP_A(OP_RETURN, 1),
+    }, 2);
+
+    /* a result OP_LOADI cannot hold is left to the VM */
+    check_irep("no folding past sBx", 2, {
+        MKOP_AsBx(OP_LOADI, 1, MAXARG_sBx),
+        MKOP_ABC(OP_ADDI, 1, 0, 1),
+        MKOP_A(OP_RETURN, 1),
+    }, {"+"}, {
+        MKOP_AsBx(OP_LOADI, 1, MAXARG_sBx),
+        MKOP_ABC(OP_ADDI, 1, 0, 1),
+        MKOP_A(OP_RETURN, 1),
+    }, 2);
+
+    check_irep("unreachable code", 2, {
+        MKOP_AsBx(OP_LOADI, 1, 1),
+        MKOP_A(OP_RETURN, 1),
+        MKOP_AsBx(OP_LOADI, 1, 2),
+        MKOP_A(OP_RETURN, 1),
+    }, {}, {
+        MKOP_AsBx(OP_LOADI, 1, 1),
+        MKOP_A(OP_RETURN, 1),
+    }, 2);
+
+    /* R2 = 5 is overwritten unread, 20 + 22 folds, and with R5 gone R4
+       packs down to R3 */
+    check_irep("dead stores and nregs", 6, {
+        MKOP_AsBx(OP_LOADI, 2, 5),
+        MKOP_AsBx(OP_LOADI, 4, 20),
+        MKOP_AsBx(OP_LOADI, 5, 22),
+        MKOP_ABC(OP_ADD, 4, 0, 1),
+        MKOP_AB(OP_MOVE, 2, 4),
+        MKOP_A(OP_LOADSELF, 1),
+        MKOP_AsBx(OP_JMPIF, 1, 2),      /* -> 8 */
+        MKOP_A(OP_LOADNIL, 2),
+        MKOP_A(OP_RETURN, 2),
+    }, {"+"}, {
+        MKOP_AsBx(OP_LOADI, 3, 42),
+        MKOP_AB(OP_MOVE, 2, 3),
+        MKOP_A(OP_LOADSELF, 1),
+        MKOP_AsBx(OP_JMPIF, 1, 2),
+        MKOP_A(OP_LOADNIL, 2),
+        MKOP_A(OP_RETURN, 2),
+    }, 4);
+
+    /* handlers must still be found after the code around them shrinks and
+       the temporaries get renumbered */
+    check_source("rescue and ensure",
+        "def opt_rescue(x)\n"
+        "  r = []\n"
+        "  begin\n"
+        "    a = 1 + 2\n"
+        "    r << (x > 0 ? a * x : raise(ArgumentError, 'neg'))\n"
+        "    r << 100 / x\n"
+        "  rescue ArgumentError => e\n"
+        "    r << e.message\n"
+        "  rescue ZeroDivisionError, TypeError\n"
+        "    r << :zero\n"
+        "  else\n"
+        "    r << :else\n"
+        "  ensure\n"
+        "    r << :ensure\n"
+        "  end\n"
+        "  r\n"
+        "end\n"
+        "[opt_rescue(2), opt_rescue(-1), opt_rescue(0)]\n");
+    /* the unreachable array is the only user of the top temporaries */
+    check_source("renumbering around a handler",
+        "$opt_log = []\n"
+        "def opt_renumber(x)\n"
+        "  begin\n"
+        "    raise ArgumentError, 'neg' if x < 0\n"
+        "    return x * 2\n"
+        "    [x, x, x, x, x, x, x, x].size\n"
+        "  rescue ArgumentError => e\n"
+        "    e.message\n"
+        "  ensure\n"
+        "    $opt_log << x\n"
+        "  end\n"
+        "end\n"
+        "[opt_renumber(2), opt_renumber(-1), $opt_log]\n", true);
+    check_source("nested ensure with break and retry",
+        "def opt_ensure(n)\n"
+        "  log = []\n"
+        "  tries = 0\n"
+        "  n.times do |i|\n"
+        "    begin\n"
+        "      begin\n"
+        "        tries += 1\n"
+        "        raise 'again' if tries == 2\n"
+        "        break if i == 3\n"
+        "        log << i\n"
+        "      ensure\n"
+        "        log << :inner\n"
+        "      end\n"
+        "    rescue\n"
+        "      log << :retry\n"
+        "      retry\n"
+        "    ensure\n"
+        "      log << :outer\n"
+        "    end\n"
+        "  end\n"
+        "  log\n"
+        "end\n"
+        "opt_ensure(5)\n");
+
+    if (failures) {
+        printf("%d failed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -28,6 +28,10 @@ assert('Array#*', '15.2.12.5.2') do
   end
   assert_equal([1, 1, 1], [1].*(3))
   assert_equal([], [1].*(0))
+  assert_equal([1, 1], [1].*(2.5))
+  assert_raise(TypeError) do
+    [1].*(nil)
+  end
 end
 
 assert('Array#<<', '15.2.12.5.3') do
@@ -97,6 +101,10 @@ end
 
 assert('Array#concat', '15.2.12.5.8') do
   assert_equal([1,2,3,4], [1, 2].concat([3, 4]))
+
+  a = (1..20).to_a
+  15.times { a.shift }
+  assert_equal([16,17,18,19,20,16,17,18,19,20], a.concat(a))
 end
 
 assert('Array#delete_at', '15.2.12.5.9') do
@@ -230,6 +238,10 @@ assert('Array#replace', '15.2.12.5.23') do
   b = [].replace(a)
 
   assert_equal([1,2,3], b)
+
+  a = (1..20).to_a
+  10.times { a.shift }
+  assert_equal((11..20).to_a, a.replace(a))
 end
 
 assert('Array#reverse', '15.2.12.5.24') do
@@ -333,6 +345,58 @@ end
 
 # Not ISO specified
 
+assert('Array#sort!') do
+  a = [3, 1, 2]
+  assert_equal [1, 2, 3], a.sort!
+  assert_equal [1, 2, 3], a
+  assert_equal [3, 2, 1], a.sort! {|x, y| y <=> x }
+
+  # long mixed arrays take the generic merge path
+  b = (0...100).map {|i| (i * 37) % 100 }
+  b << 0.5
+  assert_equal 0.5, b.sort![1]
+  assert_equal 99, b.last
+
+  assert_equal %w(a ab b ba), %w(ba b ab a).sort!
+  assert_raise(ArgumentError) { [1, "a"].sort! }
+end
+
+assert('Array#sort uses <=> of String subclasses') do
+  c = Class.new(String) { def <=>(o) String.new(o) <=> String.new(self) end }
+  assert_equal %w(b a), [c.new("a"), c.new("b")].sort
+  s = "a"
+  def s.<=>(o) 1 end
+  assert_equal ["b", "a"], [s, "b"].sort
+end
+
+assert('Array#sort_by') do
+  a = %w(ccc a bb dd e)
+  assert_equal %w(a e bb dd ccc), a.sort_by {|s| s.size }
+  # equal keys keep their order
+  assert_equal [[1, :a], [1, :b], [1, :c]], [[1, :a], [1, :b], [1, :c]].sort_by {|x| x[0] }
+end
+
+assert('Array (queue use)') do
+  a = []
+  100.times {|i| a.push(i, i + 100); a.shift }
+  assert_equal 100, a.size
+  assert_equal [50, 150, 51], a[0, 3]
+
+  a.unshift(-1)
+  a.unshift(-3, -2)
+  assert_equal [-3, -2, -1, 50], a.first(4)
+  b = a[1, 3]
+  b.shift
+  b.unshift(:x)
+  assert_equal [:x, -1, 50], b
+  assert_equal [-3, -2, -1, 50], a.first(4)
+
+  103.times { a.shift }
+  assert_equal [], a
+  a.push(1)
+  assert_equal [1], a
+end
+
 assert("Array (Shared Array Corruption)") do
   a = [ "a", "b", "c", "d", "e", "f" ]
   b = a.slice(1, 3)
@@ -70,3 +70,26 @@ assert('Comparable#between?', '15.3.3.2.6') do
   assert_true(c.between?( 1, -1))
   assert_true(c.between?(0, 0))
 end
+
+assert('Comparable operators as branch conditions') do
+  class Ver
+    include Comparable
+    attr_reader :n
+    def initialize(n)
+      @n = n
+    end
+    def <=>(other)
+      n <=> other.n
+    end
+  end
+
+  v, top, log = Ver.new(0), Ver.new(3), []
+  while v < top
+    log << (v == Ver.new(1) ? :one : v.n)
+    v = Ver.new(v.n + 1)
+  end
+  log << :ge if v >= top
+  log << :gt if v > top
+  log << :le unless v <= Ver.new(2)
+  assert_equal [0, :one, 2, :ge, :le], log
+end
@@ -103,6 +103,10 @@ assert('Enumerable#sort', '15.3.2.2.19') do
   assert_equal [7,6,4,3,2,1], [7,3,1,2,6,4].sort {|e1,e2|e2<=>e1}
 end
 
+assert('Enumerable#sort_by') do
+  assert_equal [3, 2, 1], (1..3).sort_by {|x| -x }
+end
+
 assert('Enumerable#to_a', '15.3.2.2.20') do
   assert_equal [1], [1].to_a
 end
@@ -234,8 +234,11 @@ assert('Hash#shift', '15.2.13.4.24') do
   a = { 'abc_key' => 'abc_value', 'cba_key' => 'cba_value' }
   b = a.shift
 
-  assert_equal({ 'abc_key' => 'abc_value' }, a)
-  assert_equal [ 'cba_key', 'cba_value' ], b
+  # which pair comes out first depends on the (seeded) key hash
+  assert_equal 1, a.size
+  assert_equal 2, b.size
+  a[b[0]] = b[1]
+  assert_equal({ 'abc_key' => 'abc_value', 'cba_key' => 'cba_value' }, a)
 end
 
 assert('Hash#size', '15.2.13.4.25') do
@@ -323,3 +326,37 @@ assert('Hash#inspect') do
   assert_include ret, '"a"=>100'
   assert_include ret, '"d"=>400'
 end
+
+assert('Hash key methods redefined after use') do
+  class HashKeyRedef
+    attr_reader :v
+    def initialize(v); @v = v; end
+    def hash; 1; end
+    def eql?(o); true; end
+  end
+  h = {}
+  h[HashKeyRedef.new(1)] = :a
+  assert_equal :a, h[HashKeyRedef.new(2)]
+
+  class HashKeyRedef
+    def hash; @v; end
+    def eql?(o); v == o.v; end
+  end
+  h = {}
+  h[HashKeyRedef.new(1)] = :a
+  assert_nil h[HashKeyRedef.new(2)]
+  assert_equal :a, h[HashKeyRedef.new(1)]
+
+  module HashKeyConst
+    def hash; 7; end
+    def eql?(o); true; end
+  end
+  HashKeyRedef.include HashKeyConst
+  class HashKeyRedef
+    remove_method :hash
+    remove_method :eql?
+  end
+  h = {}
+  h[HashKeyRedef.new(1)] = :a
+  assert_equal :a, h[HashKeyRedef.new(2)]
+end
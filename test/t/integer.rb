@@ -180,6 +180,38 @@ assert('Integer#times', '15.2.8.3.22') do
   assert_equal 3, a
 end
 
+assert('Integer#times with a literal block') do
+  r = []
+  4.times do |i|
+    v = i * 2 if i % 2 == 0
+    r << v
+    next if i == 1
+    r << -i
+  end
+  assert_equal [0, 0, nil, 4, -2, nil, -3], r
+  assert_equal 3, 3.times { |i| }
+  n = 0
+  10.times { |i| n = i; break if i == 4 }
+  assert_equal 4, n
+  k = 2
+  assert_equal 2, k.times { k = 5 }
+  assert_equal 5, k
+
+  class Integer
+    alias times_for_test times
+    def times; yield :redefined; self; end
+  end
+  begin
+    r = []
+    3.times { |i| r << i }
+    assert_equal [:redefined], r
+  ensure
+    class Integer
+      alias times times_for_test
+    end
+  end
+end
+
 assert('Integer#to_f', '15.2.8.3.23') do
   assert_equal 1.0, 1.to_f
 end
@@ -335,6 +335,21 @@ assert('Kernel#loop', '15.3.1.3.29') do
   assert_equal i, 100
 end
 
+assert('Kernel#loop with a literal block') do
+  r = []
+  i = 0
+  loop do
+    i += 1
+    t = i if i % 2 == 1
+    r << t
+    next if i < 4
+    break
+  end
+  assert_equal 4, i
+  assert_equal [1, nil, 3, nil], r
+  assert_equal 40, loop { break i * 10 }
+end
+
 assert('Kernel#method_missing', '15.3.1.3.30') do
   class MMTestClass
     def method_missing(sym)
@@ -531,7 +546,8 @@ end
 assert('stack extend') do
   def recurse(count, stop)
     return count if count > stop
-    recurse(count+1, stop)
+    # not a tail call, so every level keeps its frame
+    recurse(count+1, stop) + 0
   end
 
   assert_equal 6, recurse(0, 5)
@@ -24,6 +24,51 @@ end
 
 # Not ISO specified
 
+assert('Numeric literal expressions') do
+  assert_equal 7, 1 + 2 * 3
+  assert_equal 3, 10 / 3
+  assert_equal(-6, -2 * 3)
+  assert_equal 3.5, 1.5 + 2
+  assert_equal 0.5, 1 / 2.0
+  assert_equal 2147483648.0, 2147483647 + 1
+  assert_true 2 < 3.5
+  assert_false 2 == 3
+  assert_equal "abc", "a" + "bc"
+  assert_equal "a1b", "a#{1}#{"b"}"
+end
+
 assert('Numeric#**') do
   assert_equal 8.0, 2.0**3
 end
+
+assert('Numeric operators when operand types change at a call site') do
+  ops = []
+  [[1, 2], [1.5, 2.5], [1, 2.5], ["a", "b"], [3, 4], [2147483647, 1]].each do |a, b|
+    ops << [a + b, a == b, a < b]
+  end
+  [[6, 3], [6.0, 4.0], [6, 4], [7.5, 2.5]].each do |a, b|
+    ops << [a - b, a * b, a / b, a > b, a >= b, a <= b]
+  end
+  assert_equal [3, false, true], ops[0]
+  assert_equal [4.0, false, true], ops[1]
+  assert_equal [3.5, false, true], ops[2]
+  assert_equal ["ab", false, true], ops[3]
+  assert_equal [7, false, true], ops[4]
+  assert_equal [2147483648.0, false, false], ops[5]
+  assert_equal [3, 18, 2, true, true, false], ops[6]
+  assert_equal [2.0, 24.0, 1.5, true, true, false], ops[7]
+  assert_equal [2, 24, 1, true, true, false], ops[8]
+  assert_equal [5.0, 18.75, 3.0, true, true, false], ops[9]
+end
+
+assert('Numeric operators at a call site that keeps switching types') do
+  r = []
+  [1, 1.5, 2, 2.5, 3].each do |x|
+    r << [x + 1, x - 1, x < 2, x == 2]
+  end
+  assert_equal [2, 0, true, false], r[0]
+  assert_equal [2.5, 0.5, true, false], r[1]
+  assert_equal [3, 1, false, true], r[2]
+  assert_equal [3.5, 1.5, false, false], r[3]
+  assert_equal [4, 2, false, false], r[4]
+end
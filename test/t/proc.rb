@@ -91,3 +91,81 @@ assert('Proc#return_does_not_break_self') do
   assert_equal nil, c.return_nil
   assert_equal c, c.block.call
 end
+
+assert('Proc outliving the method it was created in') do
+  class EscapeTest
+    def lambda_literal
+      x = 10
+      -> { x += 1 }
+    end
+    def keep(&b)
+      b
+    end
+    def kept_block
+      y = 1
+      keep { y += 1 }
+    end
+    def wrap(&b)
+      Proc.new { b.call * 2 }
+    end
+    def wrapped_block
+      z = 5
+      wrap { z }
+    end
+    def store(&b)
+      @stored = b
+      nil
+    end
+    def stored_block
+      w = 3
+      store { w }
+      @stored
+    end
+    def call_only(&b)
+      b.call(1) + b[2]
+    end
+    def call_only_block
+      u = 7
+      call_only { |n| u * n }
+    end
+    def nested
+      a = 1
+      r = nil
+      [2].each { |i| c = 3; r = Proc.new { a + c + i } }
+      r
+    end
+  end
+
+  e = EscapeTest.new
+  l = e.lambda_literal
+  l.call
+  assert_equal 12, l.call
+  k = e.kept_block
+  k.call
+  assert_equal 3, k.call
+  assert_equal 10, e.wrapped_block.call
+  assert_equal 3, e.stored_block.call
+  v = 5
+  assert_equal 13, e.call_only { |n| v + n }
+  assert_equal 6, e.nested.call
+  GC.start
+  assert_equal 6, e.nested.call
+  assert_equal 13, l.call
+
+  class Proc
+    alias call_for_test call
+    def call(*a)
+      $escape_test = self
+      call_for_test(*a)
+    end
+  end
+  begin
+    e.call_only_block
+  ensure
+    class Proc
+      alias call call_for_test
+    end
+  end
+  GC.start
+  assert_equal 14, $escape_test.call(2)
+end
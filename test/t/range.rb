@@ -33,6 +33,17 @@ assert('Range#each', '15.2.14.4.4') do
   assert_equal 6, b
 end
 
+assert('Range#each with a literal range and block') do
+  a = []
+  (1..3).each { |i| a << i }
+  (1...3).each { |i| a << i }
+  (3..1).each { |i| a << i }
+  assert_equal [1, 2, 3, 1, 2], a
+  assert_equal((-2..-1), (-2..-1).each { |i| a << i })
+  assert_equal [1, 2, 3, 1, 2, -2, -1], a
+  assert_equal 7, (5..9).each { |i| break i if i == 7 }
+end
+
 assert('Range#end', '15.2.14.4.5') do
   assert_equal 10, (1..10).end
 end
@@ -265,6 +265,22 @@ assert('String#hash', '15.2.10.5.20') do
   assert_equal 'abc'.hash, a.hash
 end
 
+assert('String#hash follows modification') do
+  a = 'x' * 100
+  h = a.hash
+  a << 'y'
+  assert_not_equal h, a.hash
+  assert_equal(('x' * 100 + 'y').hash, a.hash)
+  a.chop!
+  assert_equal h, a.hash
+
+  t = { a => 1 }
+  assert_equal 1, t['x' * 100]
+  a << 'z'
+  assert_equal 1, t['x' * 100]
+  assert_nil t[a]
+end
+
 assert('String#include?', '15.2.10.5.21') do
   assert_true 'abc'.include?(97)
   assert_false 'abc'.include?(100)
@@ -278,6 +294,19 @@ assert('String#index', '15.2.10.5.22') do
   assert_equal 3, 'abcabc'.index('a', 1)
 end
 
+assert('String#index on long strings') do
+  s = 'x' * 100 + 'needle' + 'y' * 50
+  assert_equal 100, s.index('needle')
+  assert_equal 100, s.index('n')
+  assert_equal 100, s.index(110)
+  assert_equal 150, s.index('y', 150)
+  assert_nil s.index('needlf')
+  assert_nil s.index(110, 101)
+  assert_nil s.index(366)
+  assert_true s.include?('ey')
+  assert_false s.include?('ex')
+end
+
 assert('String#initialize', '15.2.10.5.23') do
   a = ''
   a.initialize('abc')
@@ -388,6 +417,16 @@ assert('String#split', '15.2.10.5.35') do
   assert_equal ['a', 'b', 'c'], 'abc'.split("")
 end
 
+assert('String#split on whitespace runs') do
+  words = (1..20).map { |i| 'w' * i }
+  assert_equal words, words.join(" \t\n\v\f\r ").split
+  assert_equal words, ("\n" * 40 + words.join('   ') + ' ' * 40).split(' ')
+  assert_equal ['a', "b  c\t"], "  a b  c\t".split(' ', 2)
+  assert_equal ['a', 'b', ''], 'a b '.split(' ', -1)
+  assert_equal [], (' ' * 70).split
+  assert_equal ['a' * 70], ('a' * 70).split
+end
+
 assert('String#sub', '15.2.10.5.36') do
   assert_equal 'aBcabc', 'abcabc'.sub('b', 'B')
   assert_equal 'aBcabc', 'abcabc'.sub('b') { |w| w.capitalize }
@@ -456,11 +495,47 @@ end
 
 # Not ISO specified
 
+assert('String case mapping on long strings') do
+  s = 'aZ@[`{' * 20
+  assert_equal 'AZ@[`{' * 20, s.upcase
+  assert_equal 'az@[`{' * 20, s.downcase
+  assert_equal 'Az@[`{' * 20, s.swapcase
+  assert_equal 'Az@[`{' + 'az@[`{' * 19, s.capitalize
+  assert_nil(('1@[`{' * 20).downcase!)
+  assert_nil(('X' + 'y' * 40).capitalize!)
+  assert_equal "\xff\xe1" * 20, ("\xff\xe1" * 20).upcase
+end
+
+assert('String#swapcase') do
+  assert_equal "hELLO", "Hello".swapcase
+  assert_equal "CyBeR_pUnK11", "cYbEr_PuNk11".swapcase
+  a = "aB"
+  assert_equal a, a.swapcase!
+  assert_equal "Ab", a
+  assert_nil "12".swapcase!
+end
+
 assert('String interpolation (mrb_str_concat for shared strings)') do
   a = "A" * 32
   assert_equal "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA:", "#{a}:"
 end
 
+assert('String interpolation with many parts') do
+  a, b = 1, nil
+  assert_equal "1-:", "#{a}-#{b}:"
+  assert_equal "", "#{}"
+  assert_equal "a1b2c3d4e", "a#{1}b#{2}c#{3}d#{4}e"
+end
+
+assert('String#<<') do
+  s = ""
+  100.times { |i| s << i.to_s }
+  s << 33
+  assert_equal (0..99).to_a.join + "!", s
+  assert_equal "abab", (t = "ab"; t << t)
+  assert_raise(RangeError) { "" << 256 }
+end
+
 assert('Check the usage of a NUL character') do
   "qqq\0ppp"
 end
@@ -486,7 +561,37 @@ assert('String#each_byte') do
   assert_equal bytes1, bytes2
 end
 
+assert('String#each_char') do
+  chars = []
+  assert_equal "ab\xff", "ab\xff".each_char {|c| chars << c }
+  assert_equal ["a", "b", "\xff"], chars
+
+  # yielded strings are independent of each other
+  "aa".each_char {|c| c << "!"; chars << c }
+  assert_equal ["a!", "a!"], chars[3, 2]
+  assert_equal "a", "a".chars[0]
+
+  assert_equal "y", "xyz".each_char {|c| break c if c == "y" }
+  assert_equal 98, "abc".each_byte {|b| break b if b == 98 }
+  assert_equal ["a", "b"], "ab".each_char
+  assert_equal [97, 98], "ab".each_byte
+end
+
+assert('String#getbyte') do
+  assert_equal 101, "hello".getbyte(1)
+  assert_equal 111, "hello".getbyte(-1)
+  assert_equal 255, "\xff".getbyte(0)
+  assert_nil "hello".getbyte(5)
+end
+
+assert('String#chars') do
+  assert_equal ["h", "e", "l", "l", "o"], "hello".chars
+  assert_equal [], "".chars
+end
+
 assert('String#inspect') do
   ("\1" * 100).inspect  # should not raise an exception - regress #1210
   assert_equal "\"\\000\"", "\0".inspect
+  assert_equal '"' + 'a' * 40 + '\\n' + 'b' * 40 + '"', ('a' * 40 + "\n" + 'b' * 40).inspect
+  assert_equal '"' + 'plain' * 10 + '"', ('plain' * 10).inspect
 end
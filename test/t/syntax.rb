@@ -226,3 +226,50 @@ assert('splat in case statement') do
   assert_equal [5], resultb
   assert_equal [3,8], resultc
 end
+
+assert('self-recursive call in tail position') do
+  class TailCallTest
+    def sum(n, acc)
+      if n == 0
+        acc
+      else
+        sum(n - 1, acc + n)
+      end
+    end
+
+    def down(n)
+      return n if n == 0
+      self.down(n - 1)
+    end
+
+    def guarded(n)
+      begin
+        return guarded(n - 1) if n > 0
+        :bottom
+      ensure
+        @ensured = (@ensured || 0) + 1
+      end
+    end
+    attr_reader :ensured
+
+    def collect(n, acc)
+      return acc if n == 0
+      x = n
+      acc << lambda { x }
+      collect(n - 1, acc)
+    end
+
+    def inspect; @v.inspect end
+
+    def initialize(v = nil) @v = v end
+  end
+
+  t = TailCallTest.new([1])
+  # deeper than the VM stack allows for ordinary calls
+  assert_equal 20000100000, t.sum(200000, 0)
+  assert_equal 0, t.down(200000)
+  assert_equal :bottom, t.guarded(10)
+  assert_equal 11, t.ensured
+  assert_equal [3, 2, 1], t.collect(3, []).map { |l| l.call }
+  assert_equal "[1]", t.inspect
+end
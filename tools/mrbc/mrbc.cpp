@@ -34,6 +34,7 @@ struct mrbc_args {
     mrb_bool check_syntax : 1;
     mrb_bool verbose      : 1;
     mrb_bool debug_info   : 1;
+    mrb_bool optimize     : 1;
 };
 
 static void
@@ -45,6 +46,7 @@ usage(const char *name)
         "-o<outfile>  place the output into <outfile>",
         "-v           print version number, then turn on verbose mode",
         "-g           produce debugging information",
+        "-O           optimize the bytecode",
         "-B<symbol>   binary <symbol> output in C language format",
         "--verbose    run at verbose mode",
         "--version    print the version",
@@ -129,6 +131,9 @@ static int parse_args(mrb_state *mrb, int argc, char **argv, mrbc_args *args)
                 case 'g':
                     args->debug_info = 1;
                     break;
+                case 'O':
+                    args->optimize = 1;
+                    break;
                 case 'h':
                     return -1;
                 case '-':
@@ -200,6 +205,8 @@ load_file(mrb_state *mrb, struct mrbc_args *args)
     if (args->verbose)
         c->dump_result = 1;
     c->no_exec = 1;
+    if (args->optimize)
+        c->optimize = 1;
     if (input[0] == '-' && input[1] == '\0') {
         infile = stdin;
     }
@@ -5,6 +5,7 @@
 #include "mruby/array.h"
 #include "mruby/compile.h"
 #include "mruby/dump.h"
+#include "mruby/irep.h"
 #include "mruby/variable.h"
 
 
@@ -30,6 +31,7 @@ struct mrbc_args {
     mrb_bool mrbfile      : 1;
     mrb_bool check_syntax : 1;
     mrb_bool verbose      : 1;
+    mrb_bool jit_stats    : 1;
     int argc;
     char** argv;
 };
@@ -46,6 +48,9 @@ usage(const char *name)
         "--verbose    run in verbose mode",
         "--version    print the version",
         "--copyright  print the copyright",
+#ifdef MRB_JIT
+        "--jit-stats  print the ireps compiled to native code on exit",
+#endif
         NULL
     };
     const char *const *p = usage_msg;
@@ -127,6 +132,12 @@ append_cmdline:
                     args->verbose = 1;
                     break;
                 }
+#ifdef MRB_JIT
+                else if (strcmp((*argv) + 2, "jit-stats") == 0) {
+                    args->jit_stats = 1;
+                    break;
+                }
+#endif
                 else if (strcmp((*argv) + 2, "copyright") == 0) {
                     mrb_show_copyright(mrb);
                     exit(EXIT_SUCCESS);
@@ -230,6 +241,10 @@ main(int argc, char **argv)
     else if (args.check_syntax) {
         printf("Syntax OK\n");
     }
+#ifdef MRB_JIT
+    if (args.jit_stats)
+        mrb_jit_dump_stats(mrb, stderr);
+#endif
     cleanup(mrb, &args);
 
     return n == 0 ? EXIT_SUCCESS : EXIT_FAILURE;